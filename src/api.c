@@ -508,20 +508,38 @@ static void *server_threadfn(void *arg)
 	/* fprintf(stderr, "Val string: %s\n", buffer + val_offset); */
 
 	Endpoint *ep = api_endpoint_get(buffer);
-	if (ep) {
+	char reply[255];
+	const char *msg;
+	if (!ep) {
+	    fprintf(stderr, "not found: %s\n", buffer);
+	    msg = "Error: endpoint not found";
+	} else if (val_offset == 0 || buffer[val_offset] == '\0') {
+	    /* Route with no value: reply with the current value */
+	    if (!ep->val) {
+		msg = "Error: endpoint has no value";
+	    } else {
+		ValType t;
+		Value val = endpoint_safe_read(ep, &t);
+		int n = jdaw_val_to_str(reply, sizeof(reply) - 1, val, t, 2);
+		if (n < 0) n = 0;
+		if (n > (int)sizeof(reply) - 2) n = (int)sizeof(reply) - 2;
+		reply[n] = ';';
+		reply[n + 1] = '\0';
+		msg = reply;
+	    }
+	} else if (ep->read_only) {
+	    msg = "Error: endpoint is read-only";
+	} else {
 	    /* fprintf(stderr, "REC: %s\n", buffer); */
 	    char dst[255];
 	    api_endpoint_get_route(ep, dst, 255);
 	    /* fprintf(stderr, "ROUTE: %s\n", dst); */
 	    Value new_val = jdaw_val_from_str(buffer + val_offset, ep->val_type);
 	    endpoint_write(ep, new_val, true, true, true, false);
-	} else {
-	    fprintf(stderr, "not found: %s\n", buffer);
+	    msg = "200 OK;";
 	}
 
-
 	/* Send response */
-	char *msg = ep ? "200 OK;" : "Error: endpoint not found";
 	if (sendto(session->server.sockfd, msg, strlen(msg), 0, (struct sockaddr *)&cliaddr, sizeof(cliaddr)) == -1) {
 	    perror("sendto");
 	}
@@ -13,7 +13,8 @@
 
     * create and maintain data structures related to UDP API
     * setup and teardown UDP server
-    * triage messages sent via UDP
+    * triage messages sent via UDP: "<route> <value>;" writes an endpoint, and "<route>;" (no value)
+      replies with its current value
 
  *****************************************************************************************************************/
 
@@ -8,9 +8,15 @@
 
 *****************************************************************************************************************/
 
+#include <errno.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "audio_clip.h"
 #include "clipref.h"
+#include "dot_jdaw.h"
+#include "log.h"
+#include "record_spill.h"
 #include "session.h"
 
 #define DEFAULT_REFS_ALLOC_LEN 2
@@ -58,18 +64,53 @@ Clip *clip_create(AudioConn *conn, Track *target)
     return clip;
 }
 
+static void clip_segments_deinit(Clip *clip)
+{
+    record_spill_close(clip);
+    uint32_t num_alloced = atomic_load(&clip->segments.num_alloced);
+    if (num_alloced > CLIP_SEG_MAX) num_alloced = CLIP_SEG_MAX;
+    for (int c=0; c<2; c++) {
+	if (!clip->segments.segs[c]) continue;
+	/* Released slots are NULL */
+	for (uint32_t i=0; i<num_alloced; i++) {
+	    free(clip->segments.segs[c][i]);
+	}
+	free(clip->segments.segs[c]);
+	clip->segments.segs[c] = NULL;
+    }
+    atomic_store(&clip->segments.num_alloced, 0);
+}
+
 void waveform_data_deinit(WaveformData *wd)
 {
-    if (wd->ck64[0]) free(wd->ck64[0]);
-    if (wd->ck64[1]) free(wd->ck64[1]);
-    if (wd->ck512[0]) free(wd->ck512[0]);
-    if (wd->ck512[1]) free(wd->ck512[1]);
+    if (!wd->mapped) {
+	if (wd->ck64[0]) free(wd->ck64[0]);
+	if (wd->ck64[1]) free(wd->ck64[1]);
+	if (wd->ck512[0]) free(wd->ck512[0]);
+	if (wd->ck512[1]) free(wd->ck512[1]);
+    }
     pthread_mutex_destroy(&wd->lock);
     memset(wd, 0, sizeof(WaveformData));
 }
 
+static void clip_free_buffers(Clip *clip)
+{
+    if (clip->map_base) {
+	if (munmap(clip->map_base, clip->map_len) != 0) {
+	    perror("munmap");
+	}
+	clip->map_base = NULL;
+    } else {
+	if (clip->L) free(clip->L);
+	if (clip->R) free(clip->R);
+    }
+    clip->L = NULL;
+    clip->R = NULL;
+}
+
 void clip_destroy_no_displace(Clip *clip)
 {
+    if (clip->save_pending) jdaw_save_wait();
     pthread_mutex_destroy(&clip->buf_realloc_lock);
     for (uint16_t i=0; i<clip->num_refs; i++) {
 	ClipRef *cr = clip->refs[i];
@@ -81,8 +122,8 @@ void clip_destroy_no_displace(Clip *clip)
     }
     
     waveform_data_deinit(&clip->waveform);
-    if (clip->L) free(clip->L);
-    if (clip->R) free(clip->R);
+    clip_segments_deinit(clip);
+    clip_free_buffers(clip);
 
     for (uint8_t i=0; i<session->source_mode.num_dropped; i++) {
 	Clip **dropped_clip = &(session->source_mode.saved_drops[i].clip);
@@ -96,6 +137,7 @@ void clip_destroy_no_displace(Clip *clip)
 
 void clip_destroy(Clip *clip)
 {
+    if (clip->save_pending) jdaw_save_wait();
     pthread_mutex_destroy(&clip->buf_realloc_lock);
     /* fprintf(stdout, "CLIP DESTROY %s, num refs: %d\n", clip->name,  clip->num_refs); */
     /* fprintf(stdout, "DESTROYING CLIP %p, num: %d\n", clip, proj->num_clips); */
@@ -125,8 +167,8 @@ void clip_destroy(Clip *clip)
     proj->num_clips--;
     proj->active_clip_index = proj->num_clips;
     waveform_data_deinit(&clip->waveform);
-    if (clip->L) free(clip->L);
-    if (clip->R) free(clip->R);
+    clip_segments_deinit(clip);
+    clip_free_buffers(clip);
 
     for (uint8_t i=0; i<session->source_mode.num_dropped; i++) {
 	Clip **dropped_clip = &(session->source_mode.saved_drops[i].clip);
@@ -147,6 +189,8 @@ void clip_split_stereo_to_mono(Clip *to_split, Clip **new_L, Clip **new_R)
     (*new_R)->recording = false;
     (*new_L)->channels = 1;
     (*new_R)->channels = 1;
+    (*new_L)->storage_fmt = to_split->storage_fmt;
+    (*new_R)->storage_fmt = to_split->storage_fmt;
     
     (*new_L)->L = malloc(to_split->len_sframes * sizeof(float));
     (*new_R)->L = malloc(to_split->len_sframes * sizeof(float));
@@ -191,6 +235,7 @@ void clip_split_stereo_to_mono(Clip *to_split, Clip **new_L, Clip **new_R)
 /* Assumes realloc has been done */
 static void clip_waveform_append(Clip *clip, int32_t start_in_clip, int32_t len_sframes)
 {
+    float samples[64];
     int32_t ck64_i = start_in_clip / 64;
     float ck512_Lmin = 1.0f;
     float ck512_Lmax = -1.0f;
@@ -203,7 +248,7 @@ static void clip_waveform_append(Clip *clip, int32_t start_in_clip, int32_t len_
 	    WaveformChunk Lck = clip->waveform.ck64[0][i];
 	    ck512_Lmin = fminf(ck512_Lmin, Lck.min);
 	    ck512_Lmax = fmaxf(ck512_Lmax, Lck.max);
-	    if (clip->R) {
+	    if (clip->channels > 1) {
 		WaveformChunk Rck = clip->waveform.ck64[1][i];
 		ck512_Rmin = fminf(ck512_Rmin, Rck.min);
 		ck512_Rmax = fmaxf(ck512_Rmax, Rck.max);
@@ -216,9 +261,10 @@ static void clip_waveform_append(Clip *clip, int32_t start_in_clip, int32_t len_
 	WaveformChunk *Lck = clip->waveform.ck64[0] + ck64_i;
 	float min = 1.0;
 	float max = -1.0;
+	clip_read(clip, 0, start_in_clip, ck_len, samples);
 	for (int32_t i=0; i<ck_len; i++) {
-	    min = fminf(clip->L[start_in_clip + i], min);
-	    max = fmaxf(clip->L[start_in_clip + i], max);
+	    min = fminf(samples[i], min);
+	    max = fmaxf(samples[i], max);
 	}
 	Lck->min = min;
 	Lck->max = max;
@@ -230,9 +276,10 @@ static void clip_waveform_append(Clip *clip, int32_t start_in_clip, int32_t len_
 	    WaveformChunk *Rck = clip->waveform.ck64[1] + ck64_i;
 	    min = 1.0;
 	    max = -1.0;
+	    clip_read(clip, 1, start_in_clip, ck_len, samples);
 	    for (int32_t i=0; i<ck_len; i++) {
-		min = fminf(clip->R[start_in_clip + i], min);
-		max = fmaxf(clip->R[start_in_clip + i], max);
+		min = fminf(samples[i], min);
+		max = fmaxf(samples[i], max);
 	    }
 	    Rck->min = min;
 	    Rck->max = max;
@@ -245,7 +292,7 @@ static void clip_waveform_append(Clip *clip, int32_t start_in_clip, int32_t len_
 	    WaveformChunk *Lck512 = clip->waveform.ck512[0] + ck512_i;
 	    Lck512->min = ck512_Lmin;
 	    Lck512->max = ck512_Lmax;
-	    if (clip->R) {
+	    if (clip->channels > 1) {
 		WaveformChunk *Rck512 = clip->waveform.ck512[1] + ck512_i;
 		Rck512->min = ck512_Rmin;
 		Rck512->max = ck512_Rmax;
@@ -261,6 +308,33 @@ static void clip_waveform_append(Clip *clip, int32_t start_in_clip, int32_t len_
 
 
 /* Waveform ops */
+/* Mapped waveform arrays can't be realloc'd; move them to the heap first */
+static void waveform_data_copy_from_mapping(WaveformData *wd)
+{
+    int32_t num_ck512 = wd->num_ck64 / 8;
+    for (int c=0; c<2; c++) {
+	if (wd->ck64[c]) {
+	    WaveformChunk *copy = malloc(wd->num_ck64 * sizeof(WaveformChunk));
+	    if (!copy) {
+		fprintf(stderr, "Fatal error: waveform allocation failed\n");
+		exit(1);
+	    }
+	    memcpy(copy, wd->ck64[c], wd->num_ck64 * sizeof(WaveformChunk));
+	    wd->ck64[c] = copy;
+	}
+	if (wd->ck512[c] && num_ck512 > 0) {
+	    WaveformChunk *copy = malloc(num_ck512 * sizeof(WaveformChunk));
+	    if (!copy) {
+		fprintf(stderr, "Fatal error: waveform allocation failed\n");
+		exit(1);
+	    }
+	    memcpy(copy, wd->ck512[c], num_ck512 * sizeof(WaveformChunk));
+	    wd->ck512[c] = copy;
+	}
+    }
+    wd->mapped = false;
+}
+
 void clip_init_or_update_waveform(Clip *clip)
 {
     int32_t len_sframes = clip->len_sframes;
@@ -273,30 +347,33 @@ void clip_init_or_update_waveform(Clip *clip)
 	clip->waveform.init_len = len_sframes;
 	clip->waveform.num_ck64 = ceil((double)len_sframes / 64);    
 	clip->waveform.ck64[0] = malloc(clip->waveform.num_ck64 * sizeof(WaveformChunk));
-	if (clip->R) {
+	if (clip->channels > 1) {
 	    clip->waveform.ck64[1] = malloc(clip->waveform.num_ck64 * sizeof(WaveformChunk));
 	}
 	int32_t num_ck512 = clip->waveform.num_ck64 / 8;
 	if (num_ck512) {
 	    clip->waveform.ck512[0] = malloc(num_ck512 * sizeof(WaveformChunk));
-	    if (clip->R) {
+	    if (clip->channels > 1) {
 		clip->waveform.ck512[1] = malloc(num_ck512 * sizeof(WaveformChunk));
 	    }
 	}
     } else {
 	/* Reinit */
 	pthread_mutex_lock(&clip->waveform.lock);
+	if (clip->waveform.mapped) {
+	    waveform_data_copy_from_mapping(&clip->waveform);
+	}
 	start_in_clip = clip->waveform.init_len;
 	clip->waveform.init_len = len_sframes;
 	clip->waveform.num_ck64 = ceil((double)len_sframes / 64);
 	clip->waveform.ck64[0] = realloc(clip->waveform.ck64[0], clip->waveform.num_ck64 * sizeof(WaveformChunk));
-	if (clip->R) {
+	if (clip->channels > 1) {
 	    clip->waveform.ck64[1] = realloc(clip->waveform.ck64[1], clip->waveform.num_ck64 * sizeof(WaveformChunk));
 	}
 	int32_t num_ck512 = clip->waveform.num_ck64 / 8;
 	if (num_ck512) {
 	    clip->waveform.ck512[0] = realloc(clip->waveform.ck512[0], num_ck512 * sizeof(WaveformChunk));
-	    if (clip->R) {
+	    if (clip->channels > 1) {
 		clip->waveform.ck512[1] = realloc(clip->waveform.ck512[1], num_ck512 * sizeof(WaveformChunk));
 	    }
 	}	
@@ -360,3 +437,222 @@ void clip_init_or_update_waveform(Clip *clip)
     /* 	} */
     /* } */
 }
+
+/* Segmented recording store */
+
+static float *clip_segment_alloc()
+{
+    float *seg = calloc(CLIP_SEG_LEN_SFRAMES, sizeof(float));
+    if (!seg) {
+	fprintf(stderr, "Fatal error: clip segment allocation failed\n");
+	exit(1);
+    }
+    return seg;
+}
+
+void clip_segments_init(Clip *clip)
+{
+    ClipSegments *s = &clip->segments;
+    for (int c=0; c<clip->channels && c<2; c++) {
+	s->segs[c] = calloc(CLIP_SEG_MAX, sizeof(float *));
+	if (!s->segs[c]) {
+	    fprintf(stderr, "Fatal error: clip segment table allocation failed\n");
+	    exit(1);
+	}
+    }
+    atomic_store(&s->num_alloced, 0);
+    atomic_store(&s->num_released, 0);
+    atomic_store(&s->overrun, false);
+    clip_segments_prealloc(clip);
+}
+
+void clip_segments_prealloc(Clip *clip)
+{
+    ClipSegments *s = &clip->segments;
+    if (!s->segs[0]) return;
+    uint32_t num_alloced = atomic_load_explicit(&s->num_alloced, memory_order_relaxed);
+    uint32_t target = clip->write_bufpos_sframes / CLIP_SEG_LEN_SFRAMES + 1 + CLIP_SEG_PREALLOC_AHEAD;
+    uint32_t max = atomic_load_explicit(&s->num_released, memory_order_relaxed) + CLIP_SEG_MAX;
+    if (target > max) target = max;
+    while (num_alloced < target) {
+	uint32_t slot = num_alloced % CLIP_SEG_MAX;
+	s->segs[0][slot] = clip_segment_alloc();
+	if (s->segs[1]) {
+	    s->segs[1][slot] = clip_segment_alloc();
+	}
+	num_alloced++;
+	atomic_store_explicit(&s->num_alloced, num_alloced, memory_order_release);
+    }
+}
+
+uint32_t clip_segments_writable(Clip *clip, uint32_t len)
+{
+    ClipSegments *s = &clip->segments;
+    uint32_t capacity = atomic_load_explicit(&s->num_alloced, memory_order_acquire) * CLIP_SEG_LEN_SFRAMES;
+    uint32_t avail = capacity > clip->write_bufpos_sframes ? capacity - clip->write_bufpos_sframes : 0;
+    if (avail < len) {
+	/* Main thread has fallen behind (or the segment table is full); drop the remainder */
+	atomic_store_explicit(&s->overrun, true, memory_order_relaxed);
+	return avail;
+    }
+    return len;
+}
+
+float *clip_segments_ptr(Clip *clip, int channel, uint32_t pos_sframes, uint32_t *run_len)
+{
+    float **segs = clip->segments.segs[channel > 0 && clip->segments.segs[1] ? 1 : 0];
+    uint32_t pos_in_seg = pos_sframes % CLIP_SEG_LEN_SFRAMES;
+    *run_len = CLIP_SEG_LEN_SFRAMES - pos_in_seg;
+    return segs[(pos_sframes / CLIP_SEG_LEN_SFRAMES) % CLIP_SEG_MAX] + pos_in_seg;
+}
+
+void clip_segments_advance(Clip *clip, uint32_t len)
+{
+    clip->write_bufpos_sframes += len;
+    /* Publishes the written samples to readers of len_sframes */
+    atomic_store_explicit(&clip->len_sframes, clip->write_bufpos_sframes, memory_order_release);
+}
+
+uint32_t clip_segments_append(Clip *clip, const float *L, const float *R, uint32_t len)
+{
+    if (!clip->segments.segs[0]) return 0;
+    len = clip_segments_writable(clip, len);
+    for (int c=0; c<clip->channels && c<2; c++) {
+	const float *src = c == 0 ? L : R;
+	if (!src) continue;
+	uint32_t pos = clip->write_bufpos_sframes;
+	uint32_t written = 0;
+	while (written < len) {
+	    uint32_t run;
+	    float *dst = clip_segments_ptr(clip, c, pos + written, &run);
+	    if (run > len - written) run = len - written;
+	    memcpy(dst, src + written, run * sizeof(float));
+	    written += run;
+	}
+    }
+    clip_segments_advance(clip, len);
+    return len;
+}
+
+void clip_segments_consolidate(Clip *clip)
+{
+    ClipSegments *s = &clip->segments;
+    if (!s->segs[0]) return;
+    if (atomic_load(&s->overrun)) {
+	log_tmp(LOG_ERROR, "Clip \"%s\": record buffer overrun; some input was dropped\n", clip->name);
+    }
+    float *bufs[2] = {NULL, NULL};
+    void *map_base;
+    size_t map_len;
+    if (record_spill_map(clip, &map_base, &map_len, &bufs[0], &bufs[1]) == 0) {
+	pthread_mutex_lock(&clip->buf_realloc_lock);
+	clip_free_buffers(clip);
+	clip->map_base = map_base;
+	clip->map_len = map_len;
+	clip->L = bufs[0];
+	clip->R = bufs[1];
+	clip_segments_deinit(clip);
+	pthread_mutex_unlock(&clip->buf_realloc_lock);
+	return;
+    }
+    uint32_t len_sframes = clip->len_sframes;
+    for (int c=0; c<clip->channels && c<2; c++) {
+	bufs[c] = malloc(sizeof(float) * (len_sframes > 0 ? len_sframes : 1));
+	if (!bufs[c]) {
+	    fprintf(stderr, "Fatal error: clip buffer allocation failed\n");
+	    exit(1);
+	}
+	clip_read(clip, c, 0, len_sframes, bufs[c]);
+    }
+    pthread_mutex_lock(&clip->buf_realloc_lock);
+    clip_free_buffers(clip);
+    clip->L = bufs[0];
+    clip->R = bufs[1];
+    clip_segments_deinit(clip);
+    pthread_mutex_unlock(&clip->buf_realloc_lock);
+}
+
+void clip_read(Clip *clip, int channel, int32_t start_in_clip, int32_t len, float *dst)
+{
+    if (!clip->segments.segs[0]) {
+	float *src = channel > 0 && clip->R ? clip->R : clip->L;
+	if (!src) {
+	    memset(dst, 0, len * sizeof(float));
+	    return;
+	}
+	memcpy(dst, src + start_in_clip, len * sizeof(float));
+	return;
+    }
+    int32_t read = 0;
+    while (read < len) {
+	uint32_t pos = start_in_clip + read;
+	uint32_t run = CLIP_SEG_LEN_SFRAMES - pos % CLIP_SEG_LEN_SFRAMES;
+	if (run > len - read) run = len - read;
+	if (pos / CLIP_SEG_LEN_SFRAMES < atomic_load_explicit(&clip->segments.num_released, memory_order_acquire)) {
+	    /* Segment has been spilled to disk and released */
+	    record_spill_read(clip, channel, pos, run, dst + read);
+	} else {
+	    uint32_t seg_run;
+	    memcpy(dst + read, clip_segments_ptr(clip, channel, pos, &seg_run), run * sizeof(float));
+	}
+	read += run;
+    }
+}
+
+void clip_attach_mapped_data(Clip *clip, void *map_base, size_t map_len, float *L, float *R, WaveformChunk *ck64[2], WaveformChunk *ck512[2])
+{
+    pthread_mutex_lock(&clip->buf_realloc_lock);
+    clip->map_base = map_base;
+    clip->map_len = map_len;
+    clip->L = L;
+    clip->R = R;
+    pthread_mutex_unlock(&clip->buf_realloc_lock);
+
+    WaveformData *wd = &clip->waveform;
+    pthread_mutex_init(&wd->lock, NULL);
+    wd->clip = clip;
+    wd->num_channels = clip->channels;
+    wd->init_len = clip->len_sframes;
+    wd->num_ck64 = ceil((double)clip->len_sframes / 64);
+    for (int c=0; c<2; c++) {
+	wd->ck64[c] = ck64[c];
+	wd->ck512[c] = ck512[c];
+    }
+    wd->mapped = true;
+}
+
+const char *clip_storage_fmt_str(enum clip_storage_fmt fmt)
+{
+    switch (fmt) {
+    case CLIP_STORAGE_FLOAT32:
+	return "float32";
+    case CLIP_STORAGE_INT24:
+	return "int24";
+    case CLIP_STORAGE_INT16:
+	return "int16";
+    }
+    return "unknown";
+}
+
+void clip_prefetch(Clip *clip, int32_t start_in_clip, int32_t len_sframes)
+{
+    if (!clip->map_base) return;
+    int32_t clip_len = clip->len_sframes;
+    if (start_in_clip < 0) {
+	len_sframes += start_in_clip;
+	start_in_clip = 0;
+    }
+    if (start_in_clip + len_sframes > clip_len) len_sframes = clip_len - start_in_clip;
+    if (len_sframes <= 0) return;
+    uintptr_t page_mask = ~((uintptr_t)sysconf(_SC_PAGESIZE) - 1);
+    float *bufs[2] = {clip->L, clip->R};
+    for (int c=0; c<clip->channels && c<2; c++) {
+	if (!bufs[c]) continue;
+	uintptr_t start = (uintptr_t)(bufs[c] + start_in_clip) & page_mask;
+	uintptr_t end = (uintptr_t)(bufs[c] + start_in_clip + len_sframes);
+	if (madvise((void *)start, end - start, MADV_WILLNEED) != 0) {
+	    log_tmp(LOG_WARN, "madvise on clip \"%s\": %s\n", clip->name, strerror(errno));
+	    return;
+	}
+    }
+}
@@ -15,6 +15,16 @@
     * referenced on timeline as ClipRef (see clipref.h)
     * can be recorded directly from a audio device (audio_conn.h)
     * MIDI counterpart in midi_clip.h
+    * while recording, samples are written to a segmented store (ClipSegments) whose segments are
+      allocated ahead of the write head on the main thread, so the record path never allocates;
+      the segments are consolidated into contiguous L/R buffers when recording stops
+    * clips loaded from a project file may instead point into a private mapping of the file (see
+      clip_attach_mapped_data), so their audio is only read from disk when it is first touched, and
+      clean pages can be dropped by the OS under memory pressure
+    * each clip has a storage format, which determines how its samples are written to the project
+      file. Samples are always float32 in memory. Only float32 blocks can be mapped, so all clips
+      default to float32. int24 and int16 (user_tl_cycle_clip_storage_fmt) store a clip in 3/4 or 1/2
+      the space, but are read and converted in full when the project is opened.
 *****************************************************************************************************************/
 
 #ifndef JDAW_AUDIO_CLIP_H
@@ -22,6 +32,8 @@
 
 #include <pthread.h>
 #include <stdatomic.h>
+#include <stdio.h>
+#include <sys/types.h>
 #include "textbox.h"
 
 typedef struct clip_ref ClipRef;
@@ -41,10 +53,50 @@ typedef struct waveform_data {
     int32_t num_ck64;
     WaveformChunk *ck64[2];
     WaveformChunk *ck512[2];
+    bool mapped; /* ck64 and ck512 point into the clip's file mapping */
     pthread_mutex_t lock;
 } WaveformData;
 
 
+enum clip_storage_fmt {
+    CLIP_STORAGE_FLOAT32=0,
+    CLIP_STORAGE_INT24=1,
+    CLIP_STORAGE_INT16=2
+};
+#define CLIP_STORAGE_NUM_FMTS 3
+
+/* Where a clip's audio was last written in a project file. Saves rewrite the block only if the clip
+   no longer matches it, or the project is saved to a different file (see dot_jdaw.h). */
+typedef struct clip_stored_block {
+    dev_t dev;
+    ino_t ino;
+    uint64_t offset; /* 0 if never stored */
+    uint32_t len_sframes;
+    uint8_t channels;
+    enum clip_storage_fmt fmt;
+} ClipStoredBlock;
+
+#define CLIP_SEG_LEN_SFRAMES 32768
+/* Segment table slots (power of 2); ~93 minutes at 48kHz. Segment i lives in slot i % CLIP_SEG_MAX.
+   In memory, a take is limited to CLIP_SEG_MAX segments; when recording to disk, slots are reused
+   once their segments are released, so only the unreleased segments count. */
+#define CLIP_SEG_MAX 8192
+#define CLIP_SEG_PREALLOC_AHEAD 8
+
+typedef struct clip_segments {
+    float **segs[2];
+    _Atomic uint32_t num_alloced; /* Published by main thread after segments are allocated */
+    atomic_bool overrun;
+
+    /* Record-to-disk (see record_spill.h); one file per channel */
+    FILE *spill_f[2];
+    int spill_read_fd[2];
+    char *spill_path[2];
+    _Atomic uint32_t spilled_sframes;
+    _Atomic uint32_t num_released; /* Segments below this index have been freed; read them from disk */
+    bool spill_error;
+} ClipSegments;
+
 typedef struct clip {
     char name[MAX_NAMELENGTH];
     bool deleted;
@@ -60,7 +112,13 @@ typedef struct clip {
     pthread_mutex_t buf_realloc_lock;
     float *L;
     float *R;
+    void *map_base; /* Non-NULL if L and R point into a file mapping owned by the clip */
+    size_t map_len;
+    enum clip_storage_fmt storage_fmt;
+    ClipStoredBlock stored;
+    bool save_pending; /* A background save is reading the clip's buffers */
     uint32_t write_bufpos_sframes;
+    ClipSegments segments;
     /* Recording in */
     Track *target;
     bool recording;
@@ -83,4 +141,44 @@ void clip_split_stereo_to_mono(Clip *to_split, Clip **new_L, Clip **new_R);
 
 void clip_init_or_update_waveform(Clip *clip);
 
+/* Main thread; the clip takes ownership of a private (copy-on-write) file mapping, and its sample
+   buffers and waveform are set to point into it. channels and len_sframes must already be set. */
+void clip_attach_mapped_data(Clip *clip, void *map_base, size_t map_len, float *L, float *R, WaveformChunk *ck64[2], WaveformChunk *ck512[2]);
+
+/* e.g. "int16" */
+const char *clip_storage_fmt_str(enum clip_storage_fmt fmt);
+
+/* Start reading mapped samples in the given range from disk, without waiting for them. No-op for
+   clips not backed by a file mapping. */
+void clip_prefetch(Clip *clip, int32_t start_in_clip, int32_t len_sframes);
+
+/* Segmented recording store */
+
+/* Main thread; call when a clip is created for recording */
+void clip_segments_init(Clip *clip);
+
+/* Main thread; allocate segments up to CLIP_SEG_PREALLOC_AHEAD past the write head */
+void clip_segments_prealloc(Clip *clip);
+
+/* Record path; return number of frames (<= len) that can be written at the write head without allocating */
+uint32_t clip_segments_writable(Clip *clip, uint32_t len);
+
+/* Record path; get a pointer to pos_sframes in channel. *run_len is set to the number of
+   contiguous frames available from that pointer. pos_sframes must be within allocated segments. */
+float *clip_segments_ptr(Clip *clip, int channel, uint32_t pos_sframes, uint32_t *run_len);
+
+/* Record path; append up to len frames at the write head and advance it. R may be NULL for mono clips.
+   Returns number of frames written. */
+uint32_t clip_segments_append(Clip *clip, const float *L, const float *R, uint32_t len);
+
+/* Record path; advance write head (and clip len) after writing through clip_segments_ptr */
+void clip_segments_advance(Clip *clip, uint32_t len);
+
+/* Main thread; copy segments into contiguous L/R buffers and free them. A take recorded to disk is
+   mapped from its spill files instead. */
+void clip_segments_consolidate(Clip *clip);
+
+/* Copy len frames from channel, starting at start_in_clip, to dst. Works on both segmented and contiguous clips. */
+void clip_read(Clip *clip, int channel, int32_t start_in_clip, int32_t len, float *dst);
+
 #endif
@@ -13,6 +13,7 @@
 */
 
 
+#include <math.h>
 #include <pthread.h>
 #include <stdlib.h>
 
@@ -94,6 +95,10 @@ void automation_destroy(Automation *a)
     TEST_FN_CALL(layout_num_children, a->track->layout);
     if (a->keyframes) 
 	free(a->keyframes);
+    AutomationSnapshot *s;
+    if ((s = atomic_exchange(&a->snapshot_pending, NULL))) free(s);
+    if ((s = atomic_exchange(&a->snapshot_retired, NULL))) free(s);
+    if (a->snapshot) free(a->snapshot);
     if (a->undo_cache)
 	free(a->undo_cache);
     if (a->label)
@@ -739,6 +744,7 @@ static void keyframe_recalculate_m(Automation *a, int16_t keyframe_i)
     }
     k->m_fwd.dy = dy;
     k->m_fwd.dx = dx;
+    a->snapshot_stale = true;
 }
 
 static void keyframe_set_y_prop(Automation *a, uint16_t insert_i)
@@ -1011,8 +1017,221 @@ static Value automation_value_at(Automation *a, int32_t pos)
 }
 
 
+/*****************************************************************************************************************
+    Snapshots
+
+    * keyframes are edited in place on the main thread, so audio threads could only read them under
+      keyframe_arr_lock, one boxed Value at a time. Instead, after edits, the main thread copies
+      them into an AutomationSnapshot: positions, values, and per-sframe slopes as plain arrays.
+    * handoff works like a loaded IR in fir_filter.c: whichever thread takes a pointer out of
+      snapshot_pending or snapshot_retired owns it. Only one audio thread reads a given automation
+      at a time (its track's mixdown job), so the snapshot in use needs no synchronization.
+    * only float, double, and int automations have snapshots; others use automation_value_at
+    * an automation with no keyframes left publishes an empty snapshot; readers then hold the
+      endpoint's current value instead of the stale keyframe array
+ *****************************************************************************************************************/
+
+static bool automation_has_snapshot_type(Automation *a)
+{
+    return a->val_type == JDAW_FLOAT || a->val_type == JDAW_DOUBLE || a->val_type == JDAW_INT;
+}
+
+static double snapshot_from_value(Value v, ValType vt)
+{
+    switch (vt) {
+    case JDAW_FLOAT:
+	return v.float_v;
+    case JDAW_DOUBLE:
+	return v.double_v;
+    case JDAW_INT:
+	return v.int_v;
+    default:
+	return 0.0;
+    }
+}
+
+static void automation_publish_snapshot(Automation *a)
+{
+    MAIN_THREAD_ONLY();
+    a->snapshot_stale = false;
+    if (!automation_has_snapshot_type(a)) return;
+    int n = a->num_keyframes;
+    /* One allocation: header, then the three arrays */
+    size_t doubles_offset = sizeof(AutomationSnapshot) + n * sizeof(int32_t);
+    doubles_offset = (doubles_offset + sizeof(double) - 1) / sizeof(double) * sizeof(double);
+    AutomationSnapshot *s = malloc(doubles_offset + 2 * n * sizeof(double));
+    if (!s) {
+	fprintf(stderr, "Fatal error: unable to allocate automation snapshot\n");
+	exit(1);
+    }
+    s->num_keyframes = n;
+    s->pos = (int32_t *)(s + 1);
+    s->value = (double *)((char *)s + doubles_offset);
+    s->slope = s->value + n;
+    for (int i=0; i<n; i++) {
+	Keyframe *k = a->keyframes + i;
+	s->pos[i] = k->pos;
+	s->value[i] = snapshot_from_value(k->value, a->val_type);
+	s->slope[i] = i + 1 < n ? snapshot_from_value(k->m_fwd.dy, a->val_type) / k->m_fwd.dx : 0.0;
+    }
+
+    AutomationSnapshot *old;
+    if ((old = atomic_exchange(&a->snapshot_retired, NULL))) {
+	free(old);
+    }
+    /* If no audio thread picked up the previous snapshot, none ever will */
+    if ((old = atomic_exchange(&a->snapshot_pending, s))) {
+	free(old);
+    }
+}
+
+void automation_publish_snapshots(Timeline *tl)
+{
+    for (int i=0; i<tl->num_tracks; i++) {
+	Track *track = tl->tracks[i];
+	for (int ai=0; ai<track->num_automations; ai++) {
+	    Automation *a = track->automations[ai];
+	    if (a->snapshot_stale) {
+		automation_publish_snapshot(a);
+	    }
+	}
+    }
+}
+
+/* Audio thread; returns NULL if no snapshot has been published */
+static AutomationSnapshot *automation_acquire_snapshot(Automation *a)
+{
+    AutomationSnapshot *s = atomic_exchange(&a->snapshot_pending, NULL);
+    if (s) {
+	AutomationSnapshot *prev = a->snapshot;
+	a->snapshot = s;
+	/* Normally empty; the main thread empties it before each publish */
+	if (prev && (prev = atomic_exchange(&a->snapshot_retired, prev))) {
+	    free(prev);
+	}
+    }
+    return a->snapshot;
+}
+
+/* Index of the last keyframe at or before pos, or -1 if pos precedes the first */
+static int snapshot_segment(const AutomationSnapshot *s, double pos)
+{
+    int lo = 0;
+    int hi = s->num_keyframes - 1;
+    if (pos < s->pos[0]) return -1;
+    while (lo < hi) {
+	int mid = (lo + hi + 1) / 2;
+	if (s->pos[mid] <= pos) {
+	    lo = mid;
+	} else {
+	    hi = mid - 1;
+	}
+    }
+    return lo;
+}
+
+static double snapshot_value_at(const AutomationSnapshot *s, double pos)
+{
+    int k = snapshot_segment(s, pos);
+    if (k < 0) return s->value[0];
+    return s->value[k] + s->slope[k] * (pos - s->pos[k]);
+}
+
+/* Fill dst with the values at start_pos, start_pos + step, ...; one straight line per segment */
+static void snapshot_get_range(const AutomationSnapshot *s, ValType vt, void *dst, int dst_len, double pos, double step)
+{
+    int k = snapshot_segment(s, pos);
+    int last = s->num_keyframes - 1;
+    int i = 0;
+    while (i < dst_len) {
+	if (step > 0.0) {
+	    while (k < last && pos >= s->pos[k + 1]) k++;
+	} else if (step < 0.0) {
+	    while (k >= 0 && pos < s->pos[k]) k--;
+	}
+	/* Samples before the next keyframe is crossed */
+	int n = dst_len - i;
+	double v0, dv;
+	if (k < 0) {
+	    v0 = s->value[0];
+	    dv = 0.0;
+	    if (step > 0.0) n = ceil((s->pos[0] - pos) / step);
+	} else {
+	    v0 = s->value[k] + s->slope[k] * (pos - s->pos[k]);
+	    dv = s->slope[k] * step;
+	    if (step > 0.0 && k < last) {
+		n = ceil((s->pos[k + 1] - pos) / step);
+	    } else if (step < 0.0) {
+		n = floor((pos - s->pos[k]) / -step) + 1;
+	    }
+	}
+	if (n > dst_len - i) n = dst_len - i;
+	if (n < 1) n = 1;
+
+	switch (vt) {
+	case JDAW_FLOAT: {
+	    float *restrict d = (float *)dst + i;
+	    for (int j=0; j<n; j++) d[j] = v0 + j * dv;
+	}
+	    break;
+	case JDAW_DOUBLE: {
+	    double *restrict d = (double *)dst + i;
+	    for (int j=0; j<n; j++) d[j] = v0 + j * dv;
+	}
+	    break;
+	case JDAW_INT: {
+	    int *restrict d = (int *)dst + i;
+	    for (int j=0; j<n; j++) d[j] = (int)round(v0 + j * dv);
+	}
+	    break;
+	default:
+	    break;
+	}
+	i += n;
+	pos += n * step;
+    }
+}
+
+static Value snapshot_to_value(double val, ValType vt)
+{
+    Value ret;
+    switch (vt) {
+    case JDAW_FLOAT:
+	ret.float_v = val;
+	break;
+    case JDAW_DOUBLE:
+	ret.double_v = val;
+	break;
+    case JDAW_INT:
+    default:
+	ret.int_v = (int)round(val);
+	break;
+    }
+    return ret;
+}
+
+/* An automation with no keyframes leaves its endpoint where it is */
+static Value automation_empty_value(Automation *a)
+{
+    if (a->endpoint) return endpoint_safe_read(a->endpoint, NULL);
+    return snapshot_to_value(0.0, a->val_type);
+}
+
 void automation_get_range(Automation *a, void *dst, int dst_len, int32_t start_pos, float step)
 {
+    AutomationSnapshot *s;
+    if (automation_has_snapshot_type(a) && (s = automation_acquire_snapshot(a))) {
+	if (s->num_keyframes == 0) {
+	    size_t size = jdaw_val_type_size(a->val_type);
+	    Value val = automation_empty_value(a);
+	    for (int i=0; i<dst_len; i++) {
+		jdaw_val_set_ptr((char *)dst + i * size, a->val_type, val);
+	    }
+	} else {
+	    snapshot_get_range(s, a->val_type, dst, dst_len, start_pos, step);
+	}
+	return;
+    }
     pthread_mutex_lock(&a->keyframe_arr_lock);
     size_t arr_incr = jdaw_val_type_size(a->val_type);
     void *arr_ptr = dst;
@@ -1432,6 +1651,11 @@ static void keyframe_draw(int x, int y)
 /* This function assumes "current" pointer has been set or unset appropriately elsewhere */
 Value inline automation_get_value(Automation *a, int32_t pos, float direction)
 {
+    AutomationSnapshot *s;
+    if (automation_has_snapshot_type(a) && (s = automation_acquire_snapshot(a))) {
+	if (s->num_keyframes == 0) return automation_empty_value(a);
+	return snapshot_to_value(snapshot_value_at(s, pos), a->val_type);
+    }
     return automation_value_at(a, pos);
 }
 
@@ -1760,6 +1984,7 @@ NEW_EVENT_FN(undo_redo_automation_write, "undo/redo automation write")
     memcpy(a->keyframes, cached_arr + cache_start_i, num_keyframes * sizeof(Keyframe));
     a->num_keyframes = num_keyframes;
     automation_clear_cache(a);
+    a->snapshot_stale = true;
 }
 
 static void automation_write_set_undo_cache(Automation *a)
@@ -13,6 +13,9 @@
 
     * Define types related to parameter automation
     * Provide an interface for writing and reading automations
+    * float, double, and int automations are read on audio threads from an immutable snapshot of
+      the keyframes, published by the main thread after edits (automation_publish_snapshots).
+      Ramps between keyframes are generated a segment at a time, without locking.
  *****************************************************************************************************************/
 
 /* NOTE on automation<>endpoints and automation->deleted:
@@ -37,6 +40,7 @@
 #define JDAW_AUTOMATION_H
 
 #include <pthread.h>
+#include <stdatomic.h>
 #include "components.h"
 #include "layout.h"
 #include "test.h"
@@ -91,6 +95,14 @@ typedef struct keyframe {
 
 /* typedef struct keyframe_clipref KClipRef; */
 
+/* Immutable copy of an automation's keyframes, for lock-free reads on audio threads */
+typedef struct automation_snapshot {
+    int num_keyframes;
+    int32_t *pos;
+    double *value;
+    double *slope; /* Change in value per sframe, up to the next keyframe */
+} AutomationSnapshot;
+
 typedef struct automation {
     char name[MAX_NAMELENGTH];
     Track *track;
@@ -114,6 +126,13 @@ typedef struct automation {
     uint16_t num_keyframes;
     uint16_t keyframe_arrlen;
     Keyframe *current;
+
+    /* Snapshot handoff. Main thread publishes to snapshot_pending; the audio thread reading
+       the automation moves it to snapshot, and hands the one it replaces back via snapshot_retired */
+    bool snapshot_stale; /* Main thread only; keyframes edited since last publish */
+    _Atomic(AutomationSnapshot *) snapshot_pending;
+    _Atomic(AutomationSnapshot *) snapshot_retired;
+    AutomationSnapshot *snapshot;
     /* int32_t current; */
     /* Keyframe *first; */
     /* Keyframe *last; */
@@ -176,8 +195,12 @@ Automation *track_add_automation(Track *track, AutomationType type);
 Automation *track_add_automation_from_endpoint(Track *track, Endpoint *ep);
 
     
+/* Audio threads only. dst holds dst_len values of a->val_type */
 Value automation_get_value(Automation *a, int32_t pos, float direction);
 void automation_get_range(Automation *a, void *dst, int dst_len, int32_t start_pos, float step);
+
+/* Main thread only. Publish keyframe snapshots for any automations on tl edited since the last call */
+void automation_publish_snapshots(Timeline *tl);
 void automation_draw(Automation *a);
 Keyframe *automation_insert_keyframe_at(
     Automation *a,
@@ -56,6 +56,10 @@ ClipRef *clipref_create(
     void *source_clip /* an audio or MIDI clip */
     )
 {
+    if (track->is_bus) {
+	status_set_errstr("Can't add clips to a bus track");
+	return NULL;
+    }
     ClipRef *cr = calloc(1, sizeof(ClipRef));
     cr->track = track;
     cr->tl_pos = tl_pos;
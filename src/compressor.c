@@ -10,6 +10,7 @@
 
 #include <stdatomic.h>
 #include <stdio.h>
+#include <string.h>
 #include "compressor.h"
 #include "consts.h"
 #include "endpoint.h"
@@ -46,111 +47,222 @@ extern Window *main_win;
 /* Type: `void (*)(Endpoint *) (aka void (*)(struct endpoint *))`   */
 
 
-float compressor_buf_apply_mono(void *compressor_v, float *buf, int len, int channel, float input_amp)
+/*------ lookahead limiter ----------------------------------------*/
+
+#define LA_MASK (COMP_MAX_LOOKAHEAD_SFRAMES - 1)
+
+static void peak_window_push(PeakWindow *pw, float val)
 {
-    Compressor *c = compressor_v;
-    /* if (!c->active) return input_amp; */
-    float amp_scalar;
-    float env = 0.0f;
-    float output_amp = 0.0f;
-    bool page_onscreen = atomic_load(&c->effect->page_onscreen);
+    /* Older values no larger than the new one can never be the maximum again */
+    while (pw->back != pw->front && pw->vals[(pw->back - 1) & LA_MASK] <= val) {
+	pw->back = (pw->back - 1) & LA_MASK;
+    }
+    pw->vals[pw->back] = val;
+    pw->indices[pw->back] = pw->num_pushed;
+    pw->back = (pw->back + 1) & LA_MASK;
+    if (pw->indices[pw->front] <= pw->num_pushed - pw->len) {
+	pw->front = (pw->front + 1) & LA_MASK;
+    }
+    pw->num_pushed++;
+}
+
+static inline float peak_window_max(PeakWindow *pw)
+{
+    return pw->vals[pw->front];
+}
+
+static void lookahead_limiter_clear(LookaheadLimiter *la)
+{
+    la->peaks.num_pushed = 0;
+    la->peaks.front = 0;
+    la->peaks.back = 0;
+    la->held_gain = 1.0f;
+    for (int i=0; i<COMP_MAX_LOOKAHEAD_SFRAMES; i++) {
+	la->gain_hist[i] = 1.0f;
+    }
+    la->gain_sum = la->lookahead_sframes;
+    memset(la->delay_buf, '\0', sizeof(la->delay_buf));
+    la->pos = 0;
+}
+
+static void lookahead_limiter_set_len(LookaheadLimiter *la, double sample_rate)
+{
+    int32_t len = COMP_LOOKAHEAD_MSEC * sample_rate / 1000.0;
+    if (len < 1) len = 1;
+    if (len > COMP_MAX_LOOKAHEAD_SFRAMES - 1) len = COMP_MAX_LOOKAHEAD_SFRAMES - 1;
+    la->lookahead_sframes = len;
+    la->peaks.len = len;
+    lookahead_limiter_clear(la);
+}
+
+/* det holds the detector input for the block, and is overwritten with the gain for each sample.
+   L and R are overwritten with the input delayed by lookahead_sframes - 1. */
+static void lookahead_limiter_gains(Compressor *c, float *restrict det, float *L, float *R, int len)
+{
+    LookaheadLimiter *la = &c->la;
+    const int32_t w = la->lookahead_sframes;
+    const float threshold = c->threshold > 1e-6f ? c->threshold : 1e-6f;
+    const float release = c->ef[0].release_coeff;
+    const double w_inv = 1.0 / w;
+    float held = la->held_gain;
+    double gain_sum = la->gain_sum;
+    int32_t pos = la->pos;
     for (int i=0; i<len; i++) {
-	if (page_onscreen) {
-	    envelope_follower_sample(&c->display_ef_in[channel], buf[i]);
-	}	
-	env = envelope_follower_sample(&c->ef[channel], buf[i]);
-	float overshoot = env - c->threshold;
-	if (overshoot > 0.0f) {
-	    overshoot *= c->m;
-	    amp_scalar = (c->threshold + overshoot) / env;
-	    buf[i] *= amp_scalar;
-	    buf[i] *= c->makeup_gain;
-	} else {
-	    buf[i] *= c->makeup_gain;
+	peak_window_push(&la->peaks, det[i]);
+	float peak = peak_window_max(&la->peaks);
+	float target = peak > threshold ? threshold / peak : 1.0f;
+	held = target < held ? target : held + release * (target - held);
+	gain_sum += held - la->gain_hist[(pos - w) & LA_MASK];
+	la->gain_hist[pos] = held;
+	det[i] = gain_sum * w_inv;
+
+	int32_t read_pos = (pos - (w - 1)) & LA_MASK;
+	if (L) {
+	    la->delay_buf[0][pos] = L[i];
+	    L[i] = la->delay_buf[0][read_pos];
+	}
+	if (R) {
+	    la->delay_buf[1][pos] = R[i];
+	    R[i] = la->delay_buf[1][read_pos];
 	}
-	output_amp += fabs(buf[i]);
-	if (page_onscreen) {
-	    envelope_follower_sample(&c->display_ef_out[channel], buf[i]);
-	}	
+	pos = (pos + 1) & LA_MASK;
+    }
+    la->held_gain = held;
+    la->gain_sum = gain_sum;
+    la->pos = pos;
+    c->env[0] = peak_window_max(&la->peaks);
+}
+
+
+/*------ block processing ----------------------------------------*/
+
+/* Overwrite env with the gain for each sample */
+static void compressor_gain_curve(Compressor *c, float *restrict env, int len)
+{
+    const float threshold = c->threshold;
+    const float m = c->m;
+    const float makeup = c->makeup_gain;
+    for (int i=0; i<len; i++) {
+	float e = env[i];
+	env[i] = e > threshold ? makeup * (threshold + (e - threshold) * m) / e : makeup;
     }
-    c->gain_scalar[channel] = amp_scalar;
-    c->env[channel] = env;
-    return output_amp;    
+}
+
+static float apply_gain(float *restrict buf, const float *restrict gain, int len, float *peak_dst)
+{
+    float sum = 0.0f;
+    float peak = 0.0f;
+    for (int i=0; i<len; i++) {
+	buf[i] *= gain[i];
+	float a = fabsf(buf[i]);
+	sum += a;
+	peak = a > peak ? a : peak;
+    }
+    *peak_dst = peak;
+    return sum;
+}
+
+static float abs_peak(const float *restrict buf, int len)
+{
+    float peak = 0.0f;
+    for (int i=0; i<len; i++) {
+	float a = fabsf(buf[i]);
+	peak = a > peak ? a : peak;
+    }
+    return peak;
 }
 
 float compressor_buf_apply_stereo(void *compressor_v, float *restrict L, float *restrict R, int len, float input_amp)
 {
     Compressor *c = compressor_v;
-    /* if (!c->active) return input_amp; */
-    float amp_scalar;
-    float env = 0.0f;
-    float output_amp = 0.0f;
-    bool page_onscreen = c->effect->page_onscreen;
+    bool page_onscreen = atomic_load(&c->effect->page_onscreen);
+    float *bufs[] = {L, R};
 
-    for (int i=0; i<len; i++) {
-	if (page_onscreen) {
-	    if (L)
-		envelope_follower_sample(&c->display_ef_in[0], L[i]);
-	    if (R)
-		envelope_follower_sample(&c->display_ef_in[1], R[i]);
+    if (page_onscreen) {
+	for (int ch=0; ch<2; ch++) {
+	    if (bufs[ch]) envelope_follower_block_peak(&c->display_ef_in[ch], abs_peak(bufs[ch], len), len);
 	}
+    }
 
-	float env_input;
-	if (L && R) {
-	    env_input = fmaxf(fabsf(L[i]), fabsf(R[i]));
-	    /* env_input = fabs(L[i]) > fabs(R[i]) ? L[i] : R[i]; */
-	} else if (L) {
-	    env_input = L[i];
-	} else {
-	    env_input = R[i];
+    /* Detector input; one channel if linked or if only one channel is present */
+    float det[2][len];
+    int num_det = 1;
+    if (L && R && (c->stereo_link || c->limiter)) {
+	for (int i=0; i<len; i++) {
+	    det[0][i] = fmaxf(fabsf(L[i]), fabsf(R[i]));
 	}
-	
-	env = envelope_follower_sample(&c->ef[0], env_input);
-	float overshoot = env - c->threshold;
-	if (overshoot > 0.0f) {
-	    overshoot *= c->m;
-	    amp_scalar = (c->threshold + overshoot) / env;
-	    if (L) {
-		L[i] *= amp_scalar;
-		L[i] *= c->makeup_gain;
-	    }
-	    if (R) {
-		R[i] *= amp_scalar;
-		R[i] *= c->makeup_gain;
-	    }
-	} else {
-	    if (L)
-		L[i] *= c->makeup_gain;
-	    if (R)
-		R[i] *= c->makeup_gain;
+    } else if (L && R) {
+	memcpy(det[0], L, len * sizeof(float));
+	memcpy(det[1], R, len * sizeof(float));
+	num_det = 2;
+    } else {
+	memcpy(det[0], L ? L : R, len * sizeof(float));
+    }
+
+    if (c->limiter) {
+	const float makeup = c->makeup_gain;
+	for (int i=0; i<len; i++) {
+	    det[0][i] = fabsf(det[0][i]) * makeup;
 	}
-	if (L) output_amp += fabs(L[i]);
-	if (R) output_amp += fabs(R[i]);
-	if (page_onscreen) {
-	    if (L)
-		envelope_follower_sample(&c->display_ef_out[0], L[i]);
-	    if (R)
-		envelope_follower_sample(&c->display_ef_out[1], R[i]);
+	lookahead_limiter_gains(c, det[0], L, R, len);
+	/* Make-up gain goes in ahead of the limiter */
+	for (int i=0; i<len; i++) {
+	    det[0][i] *= makeup;
 	}
+    } else {
+	for (int d=0; d<num_det; d++) {
+	    envelope_follower_buf(&c->ef[d], det[d], det[d], len);
+	    c->env[d] = det[d][len - 1];
+	    compressor_gain_curve(c, det[d], len);
+	}
+    }
 
-	/* output_amp += fabs(L[i]) + fabs(R[i]); */
-	
+    float output_amp = 0.0f;
+    for (int ch=0; ch<2; ch++) {
+	if (!bufs[ch]) continue;
+	const float *gain = det[num_det == 2 ? ch : 0];
+	float peak;
+	output_amp += apply_gain(bufs[ch], gain, len, &peak);
+	if (page_onscreen) envelope_follower_block_peak(&c->display_ef_out[ch], peak, len);
     }
-    c->gain_scalar[0] = amp_scalar;
-    c->env[0] = env;
+    c->gain_scalar[0] = det[0][len - 1];
     return output_amp;
-    /* return output_amp;    */
-    /* if (L) */
-    /* 	input_amp = compressor_buf_apply_mono(compressor_v, L, len, 0, input_amp); */
-    /* if (R) */
-    /* 	input_amp = compressor_buf_apply_mono(compressor_v, R, len, 1, input_amp); */
-    /* return input_amp; */
 }
 
 void compressor_set_times_msec(Compressor *c, double attack_msec, double release_msec, double sample_rate)
 {
     envelope_follower_set_times_msec(&c->ef[0], attack_msec, release_msec, sample_rate);
     envelope_follower_set_times_msec(&c->ef[1], attack_msec, release_msec, sample_rate);
+    int32_t la_len = COMP_LOOKAHEAD_MSEC * sample_rate / 1000.0;
+    if (la_len != c->la.lookahead_sframes) {
+	lookahead_limiter_set_len(&c->la, sample_rate);
+    }
+}
+
+/* Output is silent as soon as the input is, but the envelope keeps releasing. Count the time
+   for it to decay to EFFECT_TAIL_FLOOR, after which clearing the compressor makes no difference. */
+int32_t compressor_tail_len_sframes(Compressor *c)
+{
+    double release_sframes = c->release_time * session_get_sample_rate() / 1000.0;
+    double tail = release_sframes * log(1.0 / EFFECT_TAIL_FLOOR) + compressor_latency_sframes(c);
+    return tail > INT32_MAX ? INT32_MAX : (int32_t)tail;
+}
+
+int32_t compressor_latency_sframes(Compressor *c)
+{
+    return c->limiter ? c->la.lookahead_sframes - 1 : 0;
+}
+
+void compressor_clear(Compressor *c)
+{
+    for (int i=0; i<2; i++) {
+	c->ef[i].prev_out = 0.0f;
+	c->display_ef_in[i].prev_out = 0.0f;
+	c->display_ef_out[i].prev_out = 0.0f;
+	c->env[i] = 0.0f;
+	c->gain_scalar[i] = 1.0f;
+    }
+    lookahead_limiter_clear(&c->la);
 }
 
 void compressor_set_threshold(Compressor *c, float thresh)
@@ -167,6 +279,7 @@ void compressor_set_m(Compressor *c, float m)
 
 void compressor_draw(Compressor *c, SDL_Rect *target)
 {
+    float m = c->limiter ? 0.0f : c->m;
     SDL_SetRenderDrawColor(main_win->rend, 0, 15, 20, 255);
     SDL_RenderFillRect(main_win->rend, target);
     SDL_SetRenderDrawColor(main_win->rend, 255, 255, 255, 255);
@@ -180,7 +293,7 @@ void compressor_draw(Compressor *c, SDL_Rect *target)
     SDL_RenderDrawLine(main_win->rend, target->x, target->y + target->h, x_vertex, y_vertex);
 
 
-    int end_y = y_vertex - (c->m * (target->w - vertex_rel));
+    int end_y = y_vertex - (m * (target->w - vertex_rel));
     SDL_RenderDrawLine(main_win->rend, x_vertex, y_vertex, target->x + target->w, end_y);
 
 
@@ -195,7 +308,7 @@ void compressor_draw(Compressor *c, SDL_Rect *target)
     int env_x_rel = env * target->w;
     int env_y;
     if (env > c->threshold) {
-	env_y = y_vertex - (c->m * (env_x_rel - vertex_rel));
+	env_y = y_vertex - (m * (env_x_rel - vertex_rel));
     } else {
 	env_y = target->y + target->h - env_x_rel;
     }
@@ -204,7 +317,7 @@ void compressor_draw(Compressor *c, SDL_Rect *target)
     for (int x_rel=vertex_rel; x_rel<target->w; x_rel++) {
 
 	int top_y = target->y + (target->h - x_rel);
-	int btm_y = target->y + target->h - vertex_rel - (x_rel - vertex_rel) * c->m;
+	int btm_y = target->y + target->h - vertex_rel - (x_rel - vertex_rel) * m;
 	
 	if (under_env && x_rel > env_x_rel) {
 	    under_env = false;
@@ -249,6 +362,12 @@ void comp_ratio_dsp_cb(Endpoint *ep)
     c->m = 1.0f - c->ratio;
 }
 
+static void comp_limiter_dsp_cb(Endpoint *ep)
+{
+    Compressor *c = ep->xarg1;
+    lookahead_limiter_clear(&c->la);
+}
+
 static void ratio_labelfn(char *dst, size_t dstsize, Value v, ValType type)
 {
     float r = v.float_v;
@@ -273,6 +392,7 @@ void compressor_init(Compressor *c)
     c->ratio = COMP_DEFAULT_RATIO;
     c->m = 1.0 - c->ratio;
     c->threshold = COMP_DEFAULT_THRESHOLD;
+    c->stereo_link = true;
 
     /* endpoint_init( */
     /* 	&c->active_ep, */
@@ -361,6 +481,30 @@ void compressor_init(Compressor *c)
     endpoint_set_label_fn(&c->makeup_gain_ep, label_amp_to_dbstr);
     api_endpoint_register(&c->makeup_gain_ep, &c->effect->api_node);
 
+    endpoint_init(
+	&c->stereo_link_ep,
+	&c->stereo_link,
+	JDAW_BOOL,
+	"stereo_link",
+	"Stereo link",
+	JDAW_THREAD_DSP,
+	page_el_gui_cb, NULL, NULL,
+	NULL, NULL, &c->effect->page, "track_settings_comp_stereo_link_toggle");
+    endpoint_set_default_value(&c->stereo_link_ep, (Value){.bool_v = true});
+    api_endpoint_register(&c->stereo_link_ep, &c->effect->api_node);
+
+    endpoint_init(
+	&c->limiter_ep,
+	&c->limiter,
+	JDAW_BOOL,
+	"limiter",
+	"Lookahead limiter",
+	JDAW_THREAD_DSP,
+	page_el_gui_cb, NULL, comp_limiter_dsp_cb,
+	c, NULL, &c->effect->page, "track_settings_comp_limiter_toggle");
+    endpoint_set_default_value(&c->limiter_ep, (Value){.bool_v = false});
+    api_endpoint_register(&c->limiter_ep, &c->effect->api_node);
+
     double sr = session_get_sample_rate();
     envelope_follower_set_times_msec(&c->display_ef_in[0], 0, ENV_F_STD_RELEASE_MSEC * 2, sr);
     envelope_follower_set_times_msec(&c->display_ef_in[1], 0, ENV_F_STD_RELEASE_MSEC * 2, sr);
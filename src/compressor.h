@@ -12,6 +12,15 @@
     compressor.h
 
     * basic dynamic range compression
+    * processed a block at a time: detector input, envelope, gain curve, and gain application each run
+      as a separate pass over the block, so that all but the envelope recursion can be vectorized
+    * detection is stereo-linked by default (both channels get the gain computed from the louder)
+    * limiter mode is a lookahead brickwall limiter: the input is delayed by the lookahead time while
+      a sliding-window peak detector (a monotonic deque) finds the largest peak about to arrive. The
+      gain needed for that peak is held, released at the release time, and smoothed by a moving
+      average as long as the window, so it reaches its target before the peak does. Make-up gain
+      is applied before the limiter, and output never exceeds the threshold.
+    * display meters are updated once per block from block peaks
  *****************************************************************************************************************/
 
 #ifndef JDAW_COMPRESSOR_H
@@ -24,8 +33,31 @@
 #include "envelope_follower.h"
 #include "vu_meter.h"
 
+#define COMP_LOOKAHEAD_MSEC 5.0
+#define COMP_MAX_LOOKAHEAD_SFRAMES 4096 /* power of 2 */
+
 typedef struct effect Effect;
 
+/* Maximum of the last len values pushed */
+typedef struct peak_window {
+    int32_t len;
+    int64_t num_pushed;
+    int64_t indices[COMP_MAX_LOOKAHEAD_SFRAMES];
+    float vals[COMP_MAX_LOOKAHEAD_SFRAMES]; /* Decreasing from front to back */
+    int front;
+    int back;
+} PeakWindow;
+
+typedef struct lookahead_limiter {
+    int32_t lookahead_sframes;
+    PeakWindow peaks;
+    float held_gain;
+    float gain_hist[COMP_MAX_LOOKAHEAD_SFRAMES];
+    double gain_sum; /* Sum of the last lookahead_sframes entries in gain_hist */
+    float delay_buf[2][COMP_MAX_LOOKAHEAD_SFRAMES];
+    int32_t pos;
+} LookaheadLimiter;
+
 typedef struct compressor {
     EnvelopeFollower ef[2];
     float gain_scalar[2];
@@ -47,6 +79,12 @@ typedef struct compressor {
     Endpoint ratio_ep;
     Endpoint makeup_gain_ep;
 
+    bool stereo_link;
+    bool limiter;
+    Endpoint stereo_link_ep;
+    Endpoint limiter_ep;
+    LookaheadLimiter la;
+
     EnvelopeFollower display_ef_in[2];
     EnvelopeFollower display_ef_out[2];
 } Compressor;
@@ -58,6 +96,9 @@ float compressor_buf_apply(void *compressor_v, float *buf, int len, int channel,
 float compressor_buf_apply_stereo(void *compressor_v, float *restrict L, float *restrict R, int len, float input_amp);
 void compressor_set_times_msec(Compressor *c, double attack_msec, double release_msec, double sample_rate);
 void compressor_set_threshold(Compressor *c, float thresh);
+int32_t compressor_tail_len_sframes(Compressor *c);
+int32_t compressor_latency_sframes(Compressor *c);
+void compressor_clear(Compressor *c);
 void compressor_set_m(Compressor *c, float m);
 
 void compressor_draw(Compressor *c, SDL_Rect *target);
@@ -17,6 +17,12 @@
 
 #define VOL_EXP 2.0
 
+/* Effect tails are treated as silent once decayed below this amplitude (-100dBFS) */
+#define EFFECT_TAIL_FLOOR 1e-5
+
+/* Summed absolute amplitude of a chunk at or below which it is treated as silent */
+#define AMP_EPSILON 1e-7f
+
 #define CMP_EPSILON_FLOAT 1e-9f
 #define CMP_EPSILON_DOUBLE 1e-9
 
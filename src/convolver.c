@@ -0,0 +1,406 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    convolver.c
+
+    * see convolver.h
+    * with B = block_len and h_p the p-th partition of the IR (h[pB] .. h[pB + B - 1]):
+          X_j = FFT_2B(x[(j-1)B .. (j+1)B - 1])
+          Y_j = sum over p of X_(j-p) * FFT_2B(h_p, zero-padded)
+          y[jB .. (j+1)B - 1] = second half of IFFT_2B(Y_j)
+      the first half of each IFFT is circularly aliased and discarded (overlap-save)
+    * a tail stage computes the same sum for its own segment of the IR (h[2L] onward for block length
+      L), with y_seg block j landing at output times (j + 2)L .. (j + 3)L. Input block j is complete at
+      (j + 1)L, so its transform is taken then, the partition products are accumulated one share per
+      call over the next block period, and the inverse transform lands just in time.
+    * the head stage ends where the first tail stage starts (4 * block_len), and each tail stage ends
+      where the next starts (twice its own start); the last runs to the end of the IR
+ *****************************************************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "convolver.h"
+#include "fft.h"
+#include "log.h"
+
+static void *convolver_calloc(size_t num, size_t size)
+{
+    void *ret = calloc(num, size);
+    if (!ret) {
+	fprintf(stderr, "Fatal error: unable to allocate convolver buffers\n");
+	exit(1);
+    }
+    return ret;
+}
+
+static void stage_alloc(ConvolverStage *st, int block_len, int ir_end, bool stereo_capacity)
+{
+    st->block_len = block_len;
+    st->fft_len = block_len * 2;
+    st->num_bins = block_len + 1;
+    st->ir_offset = block_len * 2;
+    st->max_partitions = (ir_end - st->ir_offset + block_len - 1) / block_len;
+    st->ir_spectra[0] = convolver_calloc((size_t)st->max_partitions * st->num_bins, sizeof(float complex));
+    if (stereo_capacity) {
+	st->ir_spectra[1] = convolver_calloc((size_t)st->max_partitions * st->num_bins, sizeof(float complex));
+    }
+    for (int c=0; c<2; c++) {
+	st->input_hist[c] = convolver_calloc(st->fft_len, sizeof(float));
+	st->fdl[c] = convolver_calloc((size_t)st->max_partitions * st->num_bins, sizeof(float complex));
+	st->acc[c] = convolver_calloc(st->num_bins, sizeof(float complex));
+	st->out[c] = convolver_calloc(block_len, sizeof(float));
+    }
+}
+
+Convolver *convolver_create(int block_len, int max_ir_len, bool stereo_capacity)
+{
+    Convolver *cv = convolver_calloc(1, sizeof(Convolver));
+    if (max_ir_len < 1) max_ir_len = 1;
+    cv->block_len = block_len;
+    cv->fft_len = block_len * 2;
+    cv->num_bins = block_len + 1;
+
+    /* Tail stages double in block length until they reach the cap, or the IR ends */
+    int head_end = max_ir_len;
+    int L = block_len * 2;
+    if (L <= CONVOLVER_MAX_STAGE_BLOCK_LEN && max_ir_len > 2 * L) {
+	head_end = 2 * L;
+	while (cv->num_stages < CONVOLVER_MAX_STAGES) {
+	    bool last = 2 * L > CONVOLVER_MAX_STAGE_BLOCK_LEN || max_ir_len <= 4 * L || cv->num_stages == CONVOLVER_MAX_STAGES - 1;
+	    stage_alloc(cv->stages + cv->num_stages, L, last ? max_ir_len : 4 * L, stereo_capacity);
+	    cv->num_stages++;
+	    if (last) break;
+	    L *= 2;
+	}
+    }
+
+    cv->max_partitions = (head_end + block_len - 1) / block_len;
+    cv->ir_spectra[0] = convolver_calloc((size_t)cv->max_partitions * cv->num_bins, sizeof(float complex));
+    cv->response[0] = convolver_calloc(cv->num_bins, sizeof(float complex));
+    if (stereo_capacity) {
+	cv->ir_spectra[1] = convolver_calloc((size_t)cv->max_partitions * cv->num_bins, sizeof(float complex));
+	cv->response[1] = convolver_calloc(cv->num_bins, sizeof(float complex));
+    }
+    for (int c=0; c<2; c++) {
+	cv->input_hist[c] = convolver_calloc(cv->fft_len, sizeof(float));
+	cv->fdl[c] = convolver_calloc((size_t)cv->max_partitions * cv->num_bins, sizeof(float complex));
+    }
+    int max_fft_len = cv->num_stages > 0 ? cv->stages[cv->num_stages - 1].fft_len : cv->fft_len;
+    cv->work = convolver_calloc(FFT_REAL_BUF_LEN(max_fft_len), sizeof(float));
+    return cv;
+}
+
+/* Transform partitions of B samples of ir, starting at ir_offset, into spectra */
+static void set_partitions(float complex *spectra, int num_partitions, int B, const float *ir, int ir_offset, int ir_len)
+{
+    int fft_len = 2 * B;
+    int num_bins = B + 1;
+    float buf[FFT_REAL_BUF_LEN(fft_len)];
+    for (int p=0; p<num_partitions; p++) {
+	int start = ir_offset + p * B;
+	int n = ir_len - start < B ? ir_len - start : B;
+	memcpy(buf, ir + start, n * sizeof(float));
+	memset(buf + n, '\0', (fft_len - n) * sizeof(float));
+	fft_real_forward(buf, fft_len);
+	memcpy(spectra + p * num_bins, buf, num_bins * sizeof(float complex));
+    }
+}
+
+static void convolver_set_ir_channel(Convolver *cv, int ir_channel, const float *ir, int ir_len)
+{
+    set_partitions(cv->ir_spectra[ir_channel], cv->num_partitions, cv->block_len, ir, 0, ir_len);
+    for (int s=0; s<cv->num_active_stages; s++) {
+	ConvolverStage *st = cv->stages + s;
+	set_partitions(st->ir_spectra[ir_channel], st->num_partitions, st->block_len, ir, st->ir_offset, ir_len);
+    }
+
+    /* Partition p is delayed by pB, a whole number of periods of the 2B-point transform at even
+       bins and half a period at odd ones, so the full IR's response at 2B points is the transform
+       of the IR folded onto 2B samples */
+    float buf[FFT_REAL_BUF_LEN(cv->fft_len)];
+    memset(buf, '\0', sizeof(buf));
+    for (int i=0; i<ir_len; i++) {
+	buf[i % cv->fft_len] += ir[i];
+    }
+    fft_real_forward(buf, cv->fft_len);
+    memcpy(cv->response[ir_channel], buf, cv->num_bins * sizeof(float complex));
+}
+
+static int convolver_capacity(Convolver *cv)
+{
+    if (cv->num_stages == 0) return cv->max_partitions * cv->block_len;
+    ConvolverStage *last = cv->stages + cv->num_stages - 1;
+    return last->ir_offset + last->max_partitions * last->block_len;
+}
+
+void convolver_set_ir(Convolver *cv, const float *ir_L, const float *ir_R, int ir_len)
+{
+    int max_ir_len = convolver_capacity(cv);
+    if (ir_len > max_ir_len) {
+	log_tmp(LOG_WARN, "Convolver: IR of %d samples truncated to %d\n", ir_len, max_ir_len);
+	ir_len = max_ir_len;
+    }
+    if (ir_len < 1) ir_len = 1;
+    cv->ir_len = ir_len;
+    int head_len = ir_len < cv->max_partitions * cv->block_len ? ir_len : cv->max_partitions * cv->block_len;
+    cv->num_partitions = (head_len + cv->block_len - 1) / cv->block_len;
+    cv->num_active_stages = 0;
+    for (int s=0; s<cv->num_stages; s++) {
+	ConvolverStage *st = cv->stages + s;
+	int stage_end = st->ir_offset + st->max_partitions * st->block_len;
+	if (stage_end > ir_len) stage_end = ir_len;
+	st->num_partitions = stage_end > st->ir_offset ? (stage_end - st->ir_offset + st->block_len - 1) / st->block_len : 0;
+	if (st->num_partitions > 0) cv->num_active_stages = s + 1;
+    }
+    cv->stereo_ir = ir_R && cv->ir_spectra[1];
+    convolver_set_ir_channel(cv, 0, ir_L, ir_len);
+    if (cv->stereo_ir) {
+	convolver_set_ir_channel(cv, 1, ir_R, ir_len);
+    }
+}
+
+#define SWAP(T, x, y) do { T tmp_ = (x); (x) = (y); (y) = tmp_; } while (0)
+
+void convolver_swap_ir(Convolver *a, Convolver *b)
+{
+    for (int c=0; c<2; c++) {
+	SWAP(float complex *, a->ir_spectra[c], b->ir_spectra[c]);
+	SWAP(float complex *, a->response[c], b->response[c]);
+	for (int s=0; s<a->num_stages; s++) {
+	    SWAP(float complex *, a->stages[s].ir_spectra[c], b->stages[s].ir_spectra[c]);
+	}
+    }
+    for (int s=0; s<a->num_stages; s++) {
+	SWAP(int, a->stages[s].num_partitions, b->stages[s].num_partitions);
+    }
+    SWAP(int, a->num_partitions, b->num_partitions);
+    SWAP(int, a->num_active_stages, b->num_active_stages);
+    SWAP(int, a->ir_len, b->ir_len);
+    SWAP(bool, a->stereo_ir, b->stereo_ir);
+}
+
+#undef SWAP
+
+/* Fill dst (num_dst points, DC to Nyquist inclusive) from num_bins bins by nearest bin */
+static void bins_to_display(const float complex *bins, int num_bins, double *dst, int num_dst, double scale)
+{
+    if (num_dst == num_bins) {
+	fft_magnitude(bins, dst, num_bins, scale);
+	return;
+    }
+    for (int i=0; i<num_dst; i++) {
+	int k = num_dst > 1 ? lround((double)i * (num_bins - 1) / (num_dst - 1)) : 0;
+	dst[i] = cabsf(bins[k]) * scale;
+    }
+}
+
+/* Accumulate partitions [from, to) of a stage against its delay line, newest block first */
+static void stage_mac(ConvolverStage *st, int channel, int ir_channel, int from, int to)
+{
+    int num_bins = st->num_bins;
+    float complex *restrict Y = st->acc[channel];
+    const float complex *H = st->ir_spectra[ir_channel];
+    int slot = st->fdl_pos[channel] - from;
+    while (slot < 0) slot += st->max_partitions;
+    for (int p=from; p<to; p++) {
+	const float complex *restrict Xp = st->fdl[channel] + slot * num_bins;
+	const float complex *restrict Hp = H + p * num_bins;
+	for (int k=0; k<num_bins; k++) {
+	    Y[k] += Xp[k] * Hp[k];
+	}
+	slot--;
+	if (slot < 0) slot = st->max_partitions - 1;
+    }
+}
+
+/* Add a tail stage's output for this call's period to buf, and do this call's share of the stage's
+   work. "in" is the call's input, zero-padded to block_len. */
+static void stage_process(Convolver *cv, ConvolverStage *st, int channel, const float *in, float *buf, int len)
+{
+    int B = cv->block_len;
+    int L = st->block_len;
+    int calls_per_block = L / B;
+    int q = st->phase[channel];
+    float *hist = st->input_hist[channel];
+    memcpy(hist + L + q * B, in, B * sizeof(float));
+
+    const float *out = st->out[channel] + q * B;
+    for (int i=0; i<len; i++) {
+	buf[i] += out[i];
+    }
+
+    int ir_channel = cv->stereo_ir ? channel : 0;
+    int target = (q + 1) * st->num_partitions / calls_per_block;
+    stage_mac(st, channel, ir_channel, st->partitions_done[channel], target);
+    st->partitions_done[channel] = target;
+    if (q < calls_per_block - 1) {
+	st->phase[channel] = q + 1;
+	return;
+    }
+
+    /* End of the block period: the accumulated output is for the next one */
+    float *work = cv->work;
+    memcpy(work, st->acc[channel], st->num_bins * sizeof(float complex));
+    fft_real_inverse(work, st->fft_len);
+    memcpy(st->out[channel], work + L, L * sizeof(float));
+
+    /* Input block just completed; its spectrum is newest in the delay line for the next period */
+    int pos = st->fdl_pos[channel] + 1;
+    if (pos >= st->max_partitions) pos = 0;
+    st->fdl_pos[channel] = pos;
+    memcpy(work, hist, st->fft_len * sizeof(float));
+    fft_real_forward(work, st->fft_len);
+    memcpy(st->fdl[channel] + pos * st->num_bins, work, st->num_bins * sizeof(float complex));
+    memmove(hist, hist + L, L * sizeof(float));
+
+    memset(st->acc[channel], '\0', st->num_bins * sizeof(float complex));
+    st->partitions_done[channel] = 0;
+    st->phase[channel] = 0;
+}
+
+float convolver_process(Convolver *cv, int channel, float *buf, int len, double *mag_dst, int mag_len)
+{
+    int B = cv->block_len;
+    int num_bins = cv->num_bins;
+    if (len > B) len = B;
+    float *hist = cv->input_hist[channel];
+    int pos = cv->fdl_pos[channel] + 1;
+    if (pos >= cv->max_partitions) pos = 0;
+    cv->fdl_pos[channel] = pos;
+    float complex *X = cv->fdl[channel] + pos * num_bins;
+
+    bool silent = true;
+    for (int i=0; i<len; i++) {
+	if (buf[i] != 0.0f) {
+	    silent = false;
+	    break;
+	}
+    }
+    if (silent) {
+	cv->silent_sframes[channel] += B;
+    } else {
+	cv->silent_sframes[channel] = 0;
+    }
+
+    /* Input history, delay lines and stage outputs hold only zeros; so does the output. Tail stages
+       hold input for up to four of their own blocks past the end of the IR. */
+    int32_t quiet_len = cv->ir_len + 2 * B;
+    if (cv->num_active_stages > 0) quiet_len += 4 * cv->stages[cv->num_active_stages - 1].block_len;
+    if (silent && cv->silent_sframes[channel] > quiet_len) {
+	memset(X, '\0', num_bins * sizeof(float complex));
+	memset(buf, '\0', len * sizeof(float));
+	if (mag_dst) memset(mag_dst, '\0', mag_len * sizeof(double));
+	return 0.0f;
+    }
+
+    memmove(hist, hist + B, B * sizeof(float));
+    memcpy(hist + B, buf, len * sizeof(float));
+    memset(hist + B + len, '\0', (B - len) * sizeof(float));
+
+    float *work = cv->work;
+    memcpy(work, hist, cv->fft_len * sizeof(float));
+    fft_real_forward(work, cv->fft_len);
+    memcpy(X, work, num_bins * sizeof(float complex));
+
+    /* Multiply-accumulate against the delay line, newest block first */
+    float complex *Y = FFT_BINS(work);
+    memset(Y, '\0', num_bins * sizeof(float complex));
+    const float complex *H = cv->ir_spectra[cv->stereo_ir ? channel : 0];
+    int slot = pos;
+    for (int p=0; p<cv->num_partitions; p++) {
+	const float complex *Xp = cv->fdl[channel] + slot * num_bins;
+	const float complex *Hp = H + p * num_bins;
+	for (int k=0; k<num_bins; k++) {
+	    Y[k] += Xp[k] * Hp[k];
+	}
+	slot--;
+	if (slot < 0) slot = cv->max_partitions - 1;
+    }
+
+    if (mag_dst && cv->num_active_stages == 0) {
+	bins_to_display(Y, num_bins, mag_dst, mag_len, 1.0 / cv->fft_len);
+    }
+
+    fft_real_inverse(work, cv->fft_len);
+    for (int i=0; i<len; i++) {
+	buf[i] = work[B + i];
+    }
+
+    if (cv->num_active_stages > 0) {
+	/* hist + B is this call's input, zero-padded */
+	float in[B];
+	memcpy(in, hist + B, B * sizeof(float));
+	for (int s=0; s<cv->num_active_stages; s++) {
+	    stage_process(cv, cv->stages + s, channel, in, buf, len);
+	}
+	if (mag_dst) {
+	    memset(work, '\0', B * sizeof(float));
+	    memcpy(work + B, buf, len * sizeof(float));
+	    memset(work + B + len, '\0', (B - len) * sizeof(float));
+	    fft_real_forward(work, cv->fft_len);
+	    bins_to_display(FFT_BINS(work), num_bins, mag_dst, mag_len, 1.0 / cv->fft_len);
+	}
+    }
+
+    float output_amp = 0.0f;
+    for (int i=0; i<len; i++) {
+	output_amp += fabsf(buf[i]);
+    }
+    return output_amp;
+}
+
+void convolver_response_magnitude(Convolver *cv, int ir_channel, double *dst, int num_bins)
+{
+    if (ir_channel > 0 && !cv->stereo_ir) ir_channel = 0;
+    bins_to_display(cv->response[ir_channel], cv->num_bins, dst, num_bins, 1.0);
+}
+
+void convolver_reset(Convolver *cv)
+{
+    for (int c=0; c<2; c++) {
+	memset(cv->input_hist[c], '\0', cv->fft_len * sizeof(float));
+	memset(cv->fdl[c], '\0', (size_t)cv->max_partitions * cv->num_bins * sizeof(float complex));
+	cv->fdl_pos[c] = 0;
+	cv->silent_sframes[c] = 0;
+	for (int s=0; s<cv->num_stages; s++) {
+	    ConvolverStage *st = cv->stages + s;
+	    memset(st->input_hist[c], '\0', st->fft_len * sizeof(float));
+	    memset(st->fdl[c], '\0', (size_t)st->max_partitions * st->num_bins * sizeof(float complex));
+	    memset(st->acc[c], '\0', st->num_bins * sizeof(float complex));
+	    memset(st->out[c], '\0', st->block_len * sizeof(float));
+	    st->fdl_pos[c] = 0;
+	    st->partitions_done[c] = 0;
+	    st->phase[c] = 0;
+	}
+    }
+}
+
+void convolver_destroy(Convolver *cv)
+{
+    for (int c=0; c<2; c++) {
+	if (cv->ir_spectra[c]) free(cv->ir_spectra[c]);
+	if (cv->response[c]) free(cv->response[c]);
+	free(cv->input_hist[c]);
+	free(cv->fdl[c]);
+	for (int s=0; s<cv->num_stages; s++) {
+	    ConvolverStage *st = cv->stages + s;
+	    if (st->ir_spectra[c]) free(st->ir_spectra[c]);
+	    free(st->input_hist[c]);
+	    free(st->fdl[c]);
+	    free(st->acc[c]);
+	    free(st->out[c]);
+	}
+    }
+    free(cv->work);
+    free(cv);
+}
@@ -0,0 +1,110 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    convolver.h
+
+    * non-uniformly partitioned overlap-save convolution, for impulse responses of arbitrary length
+    * the head of the IR is cut into partitions of block_len samples (the "head stage"); each is
+      transformed once (FFT size 2 * block_len) when the IR is set
+    * each call to convolver_process does one forward FFT of the incoming block, a complex
+      multiply-accumulate against the spectra of the last N input blocks (the "frequency-domain
+      delay line"), and one inverse FFT. No latency is added beyond that of the IR itself.
+    * the rest of the IR is covered by tail stages with block lengths 2, 4, 8 ... times block_len (up
+      to CONVOLVER_MAX_STAGE_BLOCK_LEN). A stage with block length L starts 2L samples into the IR, so
+      its output for a block of input isn't needed until L samples after the block is complete, and
+      its multiply-accumulate is spread evenly over the L / block_len calls in between. Only the last
+      stage grows with the IR, by one partition per CONVOLVER_MAX_STAGE_BLOCK_LEN samples, so the work
+      per call stays roughly constant for long IRs.
+    * a mono IR is applied to both channels; a stereo IR applies ir_L to channel 0 and ir_R to channel 1
+    * once a channel's input has been silent for longer than the IR, its tail is known to be zero and
+      blocks are skipped without transforming
+*****************************************************************************************************************/
+
+#ifndef JDAW_CONVOLVER_H
+#define JDAW_CONVOLVER_H
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CONVOLVER_MAX_STAGES 12
+#define CONVOLVER_MAX_STAGE_BLOCK_LEN 8192
+
+typedef struct convolver_stage {
+    int block_len;
+    int fft_len; /* 2 * block_len */
+    int num_bins; /* block_len + 1 */
+    int ir_offset; /* IR sample at the start of partition 0 (2 * block_len) */
+    int max_partitions;
+    int num_partitions;
+    float complex *ir_spectra[2];
+
+    /* Per-channel state */
+    float *input_hist[2]; /* previous block followed by the block being filled */
+    float complex *fdl[2];
+    int fdl_pos[2];
+    float complex *acc[2]; /* Output spectrum being accumulated */
+    int partitions_done[2]; /* Partitions accumulated into acc so far */
+    float *out[2]; /* Output for the current block period */
+    int phase[2]; /* Calls into the current block period */
+} ConvolverStage;
+
+typedef struct convolver {
+    int block_len;
+    int fft_len; /* 2 * block_len */
+    int num_bins; /* block_len + 1 */
+    int max_partitions;
+    int num_partitions;
+    int ir_len;
+    bool stereo_ir;
+    float complex *ir_spectra[2]; /* max_partitions * num_bins each; [1] only allocated for stereo capacity */
+
+    /* Per-channel state */
+    float *input_hist[2]; /* previous block followed by current block */
+    float complex *fdl[2]; /* max_partitions spectra, used as a ring */
+    int fdl_pos[2];
+    int32_t silent_sframes[2];
+
+    ConvolverStage stages[CONVOLVER_MAX_STAGES]; /* Tail stages */
+    int num_stages; /* Allocated */
+    int num_active_stages; /* Used by the current IR */
+    float complex *response[2]; /* 2 * block_len point transform of the IR, folded */
+    float *work; /* Transform buffer for the largest stage */
+} Convolver;
+
+/* Allocate a convolver that can hold an IR of up to max_ir_len samples. Processing requires
+   block_len to be a power of 2 >= 2. */
+Convolver *convolver_create(int block_len, int max_ir_len, bool stereo_capacity);
+
+/* Set (or replace) the IR in place; no allocation. ir_R may be NULL for a mono IR.
+   IRs longer than the convolver's capacity are truncated. */
+void convolver_set_ir(Convolver *cv, const float *ir_L, const float *ir_R, int ir_len);
+
+/* Exchange IRs (spectra, lengths, and responses) between two convolvers created with the same
+   block_len, max_ir_len, and stereo capacity. Input history stays with each convolver, so an IR
+   set on a spare convolver can be swapped into one that is processing without a discontinuity in
+   its input. No allocation or transforms. */
+void convolver_swap_ir(Convolver *a, Convolver *b);
+
+/* Convolve one block of len <= block_len samples in place. A short block is treated as
+   the end of the stream (zero-padded). If mag_dst is not NULL, fill mag_len bins with the
+   magnitude spectrum of the output block, for display. */
+float convolver_process(Convolver *cv, int channel, float *buf, int len, double *mag_dst, int mag_len);
+
+/* Magnitude of the full IR's frequency response at num_bins points from DC to Nyquist */
+void convolver_response_magnitude(Convolver *cv, int ir_channel, double *dst, int num_bins);
+
+/* Clear input history, e.g. when playback stops */
+void convolver_reset(Convolver *cv);
+
+void convolver_destroy(Convolver *cv);
+
+#endif
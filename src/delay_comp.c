@@ -0,0 +1,202 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    delay_comp.c
+
+    * see delay_comp.h
+    * each delay is a ring of DELAY_COMP_MAX_SFRAMES per channel. A block is written in at write_pos,
+      then read back from delay_sframes behind it, so a delay of zero passes the block through.
+      The ring is written even while the delay is zero, so that a later increase reads real history.
+ *****************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "delay_comp.h"
+#include "dsp_utils.h"
+#include "effect.h"
+#include "project.h"
+#include "thread_safety.h"
+
+#define RING_MASK (DELAY_COMP_MAX_SFRAMES - 1)
+
+/* Largest delay set on any one buffer; leaves room in the ring for a block of any chunk length */
+#define MAX_COMP_SFRAMES (DELAY_COMP_MAX_SFRAMES / 2)
+
+void comp_delay_set(CompDelay *d, int32_t delay_sframes)
+{
+    if (delay_sframes < 0) delay_sframes = 0;
+    if (delay_sframes > MAX_COMP_SFRAMES) delay_sframes = MAX_COMP_SFRAMES;
+    if (delay_sframes > 0 && !atomic_load(&d->buf)) {
+	float *buf = calloc(2 * DELAY_COMP_MAX_SFRAMES, sizeof(float));
+	if (!buf) {
+	    fprintf(stderr, "Fatal error: unable to allocate delay compensation buffer\n");
+	    exit(1);
+	}
+	atomic_store(&d->buf, buf);
+    }
+    atomic_store(&d->delay_sframes, delay_sframes);
+}
+
+static void ring_write(float *restrict ring, int32_t pos, const float *restrict src, int len)
+{
+    int first = DELAY_COMP_MAX_SFRAMES - pos;
+    if (first > len) first = len;
+    memcpy(ring + pos, src, first * sizeof(float));
+    memcpy(ring, src + first, (len - first) * sizeof(float));
+}
+
+/* Pass amp < 0 to copy rather than mix */
+static void ring_read(float *restrict dst, const float *restrict ring, int32_t pos, int len, float amp)
+{
+    int first = DELAY_COMP_MAX_SFRAMES - pos;
+    if (first > len) first = len;
+    if (amp < 0.0f) {
+	memcpy(dst, ring + pos, first * sizeof(float));
+	memcpy(dst + first, ring, (len - first) * sizeof(float));
+    } else {
+	float_buf_mix_in(dst, (float *)ring + pos, amp, first);
+	float_buf_mix_in(dst + first, (float *)ring, amp, len - first);
+    }
+}
+
+static void comp_delay_process(CompDelay *d, float *buf, float *dst_L, float *dst_R, const float *src_L, const float *src_R, float amp, int len)
+{
+    int32_t delay = atomic_load_explicit(&d->delay_sframes, memory_order_relaxed);
+    if (delay > DELAY_COMP_MAX_SFRAMES - len) delay = DELAY_COMP_MAX_SFRAMES - len;
+    int32_t read_pos = (d->write_pos - delay) & RING_MASK;
+    if (src_L) {
+	ring_write(buf, d->write_pos, src_L, len);
+	ring_read(dst_L, buf, read_pos, len, amp);
+    }
+    if (src_R && dst_R) {
+	float *ring_R = buf + DELAY_COMP_MAX_SFRAMES;
+	ring_write(ring_R, d->write_pos, src_R, len);
+	ring_read(dst_R, ring_R, read_pos, len, amp);
+    }
+    d->write_pos = (d->write_pos + len) & RING_MASK;
+}
+
+void comp_delay_apply(CompDelay *d, float *restrict L, float *restrict R, int len)
+{
+    float *buf = atomic_load_explicit(&d->buf, memory_order_acquire);
+    if (!buf) return;
+    comp_delay_process(d, buf, L, R, L, R, -1.0f, len);
+}
+
+void comp_delay_mix_in(CompDelay *d, float *restrict dst_L, float *restrict dst_R, const float *src_L, const float *src_R, float amp, int len)
+{
+    float *buf = atomic_load_explicit(&d->buf, memory_order_acquire);
+    if (!buf) {
+	float_buf_mix_in(dst_L, (float *)src_L, amp, len);
+	if (dst_R)
+	    float_buf_mix_in(dst_R, (float *)src_R, amp, len);
+	return;
+    }
+    comp_delay_process(d, buf, dst_L, dst_R, src_L, src_R, amp, len);
+}
+
+void comp_delay_clear(CompDelay *d)
+{
+    float *buf = atomic_load(&d->buf);
+    if (buf) memset(buf, '\0', 2 * DELAY_COMP_MAX_SFRAMES * sizeof(float));
+}
+
+void comp_delay_deinit(CompDelay *d)
+{
+    float *buf = atomic_exchange(&d->buf, NULL);
+    if (buf) free(buf);
+}
+
+
+/*------ latency accumulation ----------------------------------------*/
+
+static int32_t track_in_latency(Track *track, int32_t *out_latencies);
+
+/* Memoized by tl_rank; the graph is acyclic (see proposed_route_has_feedback) */
+static int32_t track_out_latency(Track *track, int32_t *out_latencies)
+{
+    if (out_latencies[track->tl_rank] >= 0) return out_latencies[track->tl_rank];
+    int32_t latency = track_in_latency(track, out_latencies) + effect_chain_latency_sframes(&track->effect_chain);
+    out_latencies[track->tl_rank] = latency;
+    return latency;
+}
+
+static int32_t track_in_latency(Track *track, int32_t *out_latencies)
+{
+    int32_t latency = 0;
+    for (int i=0; i<track->num_route_ins; i++) {
+	int32_t l = track_out_latency(track->route_ins[i]->src, out_latencies);
+	if (l > latency) latency = l;
+    }
+    for (int i=0; i<track->num_bus_ins; i++) {
+	int32_t l = track_out_latency(track->bus_ins[i], out_latencies);
+	if (l > latency) latency = l;
+    }
+    return latency;
+}
+
+void timeline_update_delay_comp(Timeline *tl)
+{
+    MAIN_THREAD_ONLY(timeline_update_delay_comp);
+    int32_t out_latencies[MAX_TRACKS];
+    for (int i=0; i<tl->num_tracks; i++) {
+	out_latencies[i] = -1;
+    }
+    int32_t master_latency = 0;
+    for (int i=0; i<tl->num_tracks; i++) {
+	Track *track = tl->tracks[i];
+	int32_t l = track_out_latency(track, out_latencies);
+	track->delay_comp.out_latency_sframes = l;
+	if (!track->bus_out && track->send_to_out && l > master_latency) {
+	    master_latency = l;
+	}
+    }
+    if (master_latency > MAX_COMP_SFRAMES) master_latency = MAX_COMP_SFRAMES;
+
+    for (int i=0; i<tl->num_tracks; i++) {
+	Track *track = tl->tracks[i];
+	int32_t in_latency = track_in_latency(track, out_latencies);
+	comp_delay_set(&track->delay_comp.content, track->is_bus ? 0 : in_latency);
+	for (int r=0; r<track->num_route_ins; r++) {
+	    AudioRoute *rt = track->route_ins[r];
+	    comp_delay_set(&rt->delay, in_latency - rt->src->delay_comp.out_latency_sframes);
+	}
+	for (int b=0; b<track->num_bus_ins; b++) {
+	    Track *in = track->bus_ins[b];
+	    comp_delay_set(&in->delay_comp.out, in_latency - in->delay_comp.out_latency_sframes);
+	}
+	if (!track->bus_out) {
+	    comp_delay_set(&track->delay_comp.out, master_latency - track->delay_comp.out_latency_sframes);
+	}
+    }
+    comp_delay_set(&tl->click_delay, master_latency);
+    atomic_store(&tl->delay_comp_sframes, master_latency);
+}
+
+void timeline_clear_delay_comp(Timeline *tl)
+{
+    for (int i=0; i<tl->num_tracks; i++) {
+	Track *track = tl->tracks[i];
+	comp_delay_clear(&track->delay_comp.content);
+	comp_delay_clear(&track->delay_comp.out);
+	for (int r=0; r<track->num_routes; r++) {
+	    comp_delay_clear(&track->routes[r]->delay);
+	}
+    }
+    comp_delay_clear(&tl->click_delay);
+}
+
+void track_delay_comp_deinit(Track *track)
+{
+    comp_delay_deinit(&track->delay_comp.content);
+    comp_delay_deinit(&track->delay_comp.out);
+}
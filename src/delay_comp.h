@@ -0,0 +1,68 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    delay_comp.h
+
+    * automatic compensation for latency introduced by effects (see effect_latency_sframes)
+    * once per main loop frame, latencies are accumulated through the track graph (audio routes and
+      bus outs): a track's output latency is the latency of its latest-arriving input plus that of its
+      effect chain. Every other signal meeting it at a summing point (the track's own clips and synth,
+      other route and bus inputs, master) is delayed to match.
+    * the mixdown reads the timeline ahead by the total latency at master, so that output stays
+      aligned with the playhead, and delays click tracks by the same amount
+    * delay buffers are allocated on the main thread the first time a nonzero delay is needed, and
+      are never reallocated; the audio threads only ever see a NULL or a complete buffer
+*****************************************************************************************************************/
+
+#ifndef JDAW_DELAY_COMP_H
+#define JDAW_DELAY_COMP_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define DELAY_COMP_MAX_SFRAMES 65536 /* power of 2; length of each delay buffer */
+
+typedef struct timeline Timeline;
+typedef struct track Track;
+
+typedef struct comp_delay {
+    _Atomic(float *) buf; /* L, then R; DELAY_COMP_MAX_SFRAMES each. NULL until first needed */
+    atomic_int delay_sframes; /* Written on the main thread */
+    int32_t write_pos; /* Audio thread only */
+} CompDelay;
+
+/* Main thread. Allocates the buffer if needed */
+void comp_delay_set(CompDelay *d, int32_t delay_sframes);
+
+/* Audio thread. Delay L and R in place */
+void comp_delay_apply(CompDelay *d, float *restrict L, float *restrict R, int len);
+
+/* Audio thread. Add src, delayed and scaled by amp, into dst. src is not modified. */
+void comp_delay_mix_in(CompDelay *d, float *restrict dst_L, float *restrict dst_R, const float *src_L, const float *src_R, float amp, int len);
+
+/* Main thread, with playback stopped */
+void comp_delay_clear(CompDelay *d);
+void comp_delay_deinit(CompDelay *d);
+
+typedef struct track_delay_comp {
+    CompDelay content; /* Clips and synth, to line up with the latest route or bus input */
+    CompDelay out; /* Post-fader output, to line up at the bus or master it feeds */
+    int32_t out_latency_sframes; /* Main thread only */
+} TrackDelayComp;
+
+/* Main thread, once per frame. Recompute latencies and set all compensating delays */
+void timeline_update_delay_comp(Timeline *tl);
+
+/* Main thread, with playback stopped */
+void timeline_clear_delay_comp(Timeline *tl);
+void track_delay_comp_deinit(Track *track);
+
+#endif
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include "consts.h"
 #include "delay_line.h"
+#include "dsp_utils.h"
 #include "endpoint_callbacks.h"
 #include "session.h"
 
@@ -72,6 +73,9 @@ void delay_line_init(DelayLine *dl, uint32_t sample_rate)
 	(void *)dl, NULL, &dl->effect->page, "track_settings_delay_amp_slider");
     endpoint_set_allowed_range(&dl->amp_ep, (Value){.double_v=0.0}, (Value){.double_v=0.99});
     endpoint_set_label_fn(&dl->amp_ep, label_amp_to_dbstr);
+    int chunk_len = dl->effect->effect_chain->chunk_len_sframes;
+    dl->amp_block = calloc(chunk_len, sizeof(double));
+    endpoint_set_block_automation(&dl->amp_ep, dl->amp_block, chunk_len);
     api_endpoint_register(&dl->amp_ep, &dl->effect->api_node);
     
     endpoint_init(
@@ -161,6 +165,8 @@ float delay_line_buf_apply(void *dl_v, float *restrict buf, int len, int channel
     /* pthread_mutex_lock(&dl->lock); */
     double *del_line = channel == 0 ? dl->buf_L : dl->buf_R;
     int32_t *del_line_pos = channel == 0 ? &dl->pos_L : &dl->pos_R;
+    /* Automated feedback ramps sample by sample */
+    const double *amp_block = dl->amp_ep.block_vals_len == len ? dl->amp_block : NULL;
     for (int i=0; i<len; i++) {
 	double track_sample = buf[i];
 	int32_t pos = *del_line_pos;
@@ -173,7 +179,7 @@ float delay_line_buf_apply(void *dl_v, float *restrict buf, int len, int channel
 	buf[i] += del_line[pos];
 	output_amp += fabs(buf[i]);
 	del_line[*del_line_pos] += track_sample;
-	del_line[*del_line_pos] *= dl->amp;
+	del_line[*del_line_pos] *= amp_block ? amp_block[i] : dl->amp;
 
 	/* clip delay line */
 	if (del_line[*del_line_pos] > 1.0) del_line[*del_line_pos] = 1.0;	
@@ -195,9 +201,17 @@ float delay_line_buf_apply_stereo(void *dl_v, float *restrict L, float *restrict
 	input_amp = delay_line_buf_apply(dl_v, L, len, 0, input_amp);
     if (R)
 	input_amp = delay_line_buf_apply(dl_v, R, len, 1, input_amp);
+    ((DelayLine *)dl_v)->amp_ep.block_vals_len = 0;
     return input_amp;
 }
 
+/* Each pass through the line scales the signal by amp */
+int32_t delay_line_tail_len_sframes(DelayLine *dl)
+{
+    if (dl->amp < CMP_EPSILON_DOUBLE) return 0;
+    return feedback_tail_len_sframes(dl->amp, dl->len);
+}
+
 void delay_line_clear(DelayLine *dl)
 {
     memset(dl->buf_L, '\0', dl->len * sizeof(double));
@@ -210,4 +224,5 @@ void delay_line_deinit(DelayLine *dl)
     if (dl->buf_L) free(dl->buf_L);
     if (dl->buf_R) free(dl->buf_R);
     if (dl->cpy_buf) free(dl->cpy_buf);	
+    if (dl->amp_block) free(dl->amp_block);
 }
@@ -37,6 +37,7 @@ typedef struct delay_line {
     double *buf_L;
     double *buf_R;
     double *cpy_buf;
+    double *amp_block; /* Per-sframe automated amp for the current chunk (see amp_ep) */
     /* pthread_mutex_t lock; */
 
     /* Track *track; */
@@ -50,6 +51,8 @@ typedef struct delay_line {
 void delay_line_init(DelayLine *dl, uint32_t sample_rate);
 void delay_line_set_params(DelayLine *dl, double amp, int32_t len);
 void delay_line_clear(DelayLine *dl);
+/* Sample frames for which output may be nonzero after the input goes silent */
+int32_t delay_line_tail_len_sframes(DelayLine *dl);
 float delay_line_buf_apply(void *dl_v, float *restrict buf, int len, int channel, float input_amp);
 float delay_line_buf_apply_stereo(void *dl_v, float *restrict L, float *restrict R, int len, float input_amp);
 void delay_line_deinit(DelayLine *dl);
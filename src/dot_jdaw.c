@@ -8,13 +8,21 @@
 
 *****************************************************************************************************************/
 
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "audio_clip.h"
 #include "clipref.h"
 #include "compressor.h"
 #include "consts.h"
 #include "delay_line.h"
+#include "dot_jdaw.h"
 #include "dsp_utils.h"
 #include "effect.h"
 #include "eq.h"
@@ -37,6 +45,16 @@
 
 #define OLD_FLOAT_SER_W 16
 
+/* Clip data blocks start on this boundary, so that mapping one wastes at most a partial page */
+#define CLIP_DATA_ALIGN 4096
+#define CLIP_DATA_CONVERT_CHUNK 4096
+
+/* "JDAW", " VERSION", version, offset of the project records */
+#define JDAW_HEADER_LEN 25
+
+/* A save rewrites the whole file if blocks still in use would make up less than this share of it */
+#define SAVE_MIN_REFERENCED_RATIO 0.5
+
 extern bool SYS_BYTEORDER_LE;
 extern const char *jackdaw_version;
 /* extern JDAW_Color black; */
@@ -57,8 +75,9 @@ const static char hdr_click_segm[] = "CTSG";
 const static char hdr_trck_efct[] = "EFCT";
 const static char hdr_trck_synth[] = "SYNTH";
 const static char hdr_aud_rt[] = "AUDRT";
+const static char hdr_bus_out[] = "BUSOT";
 
-const static char current_file_spec_version[] = "00.26";
+const static char current_file_spec_version[] = "00.33";
 
 static char read_file_spec_version[6];
 bool read_file_version_older_than(const char *cmp_version)
@@ -87,37 +106,463 @@ static void debug_print_bytes_around(FILE *f)
 /**********************************************/
 
 
-static void jdaw_write_clip(FILE *f, Clip *clip, int index);
+static void jdaw_write_clip(FILE *f, Clip *clip, int index, uint64_t data_offset);
 static void jdaw_write_midi_clip(FILE *f, MIDIClip *clip);
 static void jdaw_write_timeline(FILE *f, Timeline *tl);
 
+/* A clip block to be written by the save thread. Everything it reads is captured on the main thread. */
+typedef struct clip_block_job {
+    Clip *clip;
+    uint64_t offset;
+    uint32_t len_sframes;
+    uint8_t channels;
+    enum clip_storage_fmt fmt;
+    const float *bufs[2];
+    const WaveformChunk *ck64[2];
+    const WaveformChunk *ck512[2];
+    int32_t num_ck64;
+    int32_t num_ck512;
+} ClipBlockJob;
+
+typedef struct save_job {
+    char *path;
+    char *tmp_path;
+    bool incremental;
+    bool backup_copy;
+    char *records; /* Serialized project, everything after the file header */
+    size_t records_len;
+    uint64_t records_offset;
+    ClipBlockJob *blocks;
+    int num_blocks;
+
+    /* Set by the save thread */
+    pthread_t thread;
+    atomic_bool done;
+    int err; /* errno value */
+    const char *err_step;
+    dev_t dev;
+    ino_t ino;
+} SaveJob;
+
+static SaveJob *save_job = NULL;
+
 static Project *proj;
+
+static int storage_fmt_bytes_per_sample(enum clip_storage_fmt fmt)
+{
+    switch (fmt) {
+    case CLIP_STORAGE_FLOAT32:
+	return 4;
+    case CLIP_STORAGE_INT24:
+	return 3;
+    case CLIP_STORAGE_INT16:
+	return 2;
+    }
+    return 4;
+}
+
+/* Length of the planar samples at the start of a clip's block, padded so that the waveform arrays
+   that follow are 4-byte aligned */
+static size_t clip_data_samples_len(uint8_t channels, uint32_t len_sframes, enum clip_storage_fmt fmt)
+{
+    size_t len = (size_t)channels * len_sframes * storage_fmt_bytes_per_sample(fmt);
+    return (len + 3) & ~(size_t)3;
+}
+
+/* Size of a clip's block in the CLIP DATA section: planar samples in the clip's storage format,
+   then the waveform summary arrays (see audio_clip.h) for each channel */
+static size_t clip_data_block_len(uint8_t channels, uint32_t len_sframes, enum clip_storage_fmt fmt, int32_t *num_ck64, int32_t *num_ck512)
+{
+    *num_ck64 = ceil((double)len_sframes / 64);
+    *num_ck512 = *num_ck64 / 8;
+    return clip_data_samples_len(channels, len_sframes, fmt) + (size_t)channels * (*num_ck64 + *num_ck512) * sizeof(WaveformChunk);
+}
+
+static void write_f32_le(FILE *f, const float *src, size_t n)
+{
+    if (SYS_BYTEORDER_LE) {
+	fwrite(src, sizeof(float), n, f);
+	return;
+    }
+    char buf[CLIP_DATA_CONVERT_CHUNK * 4];
+    while (n > 0) {
+	size_t len = n < CLIP_DATA_CONVERT_CHUNK ? n : CLIP_DATA_CONVERT_CHUNK;
+	for (size_t i=0; i<len; i++) {
+	    uint32_t u;
+	    memcpy(&u, src + i, 4);
+	    uint32_tostr_le(u, buf + 4 * i);
+	}
+	fwrite(buf, 4, len, f);
+	src += len;
+	n -= len;
+    }
+}
+
+static void read_f32_le(FILE *f, float *dst, size_t n)
+{
+    fread(dst, sizeof(float), n, f);
+    if (!SYS_BYTEORDER_LE) {
+	for (size_t i=0; i<n; i++) {
+	    uint32_t u = uint32_fromstr_le((char *)(dst + i));
+	    memcpy(dst + i, &u, 4);
+	}
+    }
+}
+
+/* Integer samples are scaled by the format's max value and rounded, so that int16 data read from a
+   device or WAV file (see int16_buf_to_float) survives the round trip exactly */
+static void write_int_le(FILE *f, const float *src, size_t n, enum clip_storage_fmt fmt)
+{
+    int bps = storage_fmt_bytes_per_sample(fmt);
+    float scale = fmt == CLIP_STORAGE_INT24 ? 8388607.0f : (float)INT16_MAX;
+    char buf[CLIP_DATA_CONVERT_CHUNK * 3];
+    while (n > 0) {
+	size_t len = n < CLIP_DATA_CONVERT_CHUNK ? n : CLIP_DATA_CONVERT_CHUNK;
+	char *p = buf;
+	for (size_t i=0; i<len; i++) {
+	    int32_t sample = lrintf(clip_float_sample(src[i]) * scale);
+	    p[0] = sample & 0xFF;
+	    p[1] = (sample >> 8) & 0xFF;
+	    if (bps == 3) p[2] = (sample >> 16) & 0xFF;
+	    p += bps;
+	}
+	fwrite(buf, bps, len, f);
+	src += len;
+	n -= len;
+    }
+}
+
+static void write_samples(FILE *f, const float *src, size_t n, enum clip_storage_fmt fmt)
+{
+    if (fmt == CLIP_STORAGE_FLOAT32) {
+	write_f32_le(f, src, n);
+    } else {
+	write_int_le(f, src, n, fmt);
+    }
+}
+
+/* Returns the number of samples read */
+static size_t read_int_le(FILE *f, float *dst, size_t n, enum clip_storage_fmt fmt)
+{
+    int bps = storage_fmt_bytes_per_sample(fmt);
+    unsigned char buf[CLIP_DATA_CONVERT_CHUNK * 3];
+    size_t total = 0;
+    while (n > 0) {
+	size_t len = n < CLIP_DATA_CONVERT_CHUNK ? n : CLIP_DATA_CONVERT_CHUNK;
+	size_t read = fread(buf, bps, len, f);
+	const unsigned char *p = buf;
+	if (bps == 3) {
+	    for (size_t i=0; i<read; i++) {
+		/* Place in the top 24 bits, so that the arithmetic shift extends the sign */
+		int32_t sample = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8;
+		dst[i] = (float)sample / 8388607.0f;
+		p += 3;
+	    }
+	} else {
+	    for (size_t i=0; i<read; i++) {
+		int16_t sample = (int16_t)(p[0] | p[1] << 8);
+		dst[i] = (float)sample / INT16_MAX;
+		p += 2;
+	    }
+	}
+	total += read;
+	if (read < len) break;
+	dst += len;
+	n -= len;
+    }
+    return total;
+}
+
+
+static void jdaw_write_clip(FILE *f, Clip *clip, int index, uint64_t data_offset)
+{
+    fwrite(hdr_clip, 1, 4, f);
+    uint8_t namelen = strlen(clip->name);
+    uint8_ser(f, &namelen);
+    fwrite(&clip->name, 1, namelen, f);
+    uint8_t index_8 = (uint8_t)index;
+    uint8_ser(f, &index_8);
+    uint8_ser(f, &clip->channels);
+    uint32_t len_sframes = clip->len_sframes;
+    uint32_ser_le(f, &len_sframes);
+    uint8_t storage_fmt = clip->storage_fmt;
+    uint8_ser(f, &storage_fmt);
+
+    fwrite(hdr_data, 1, 4, f);
+    uint64_ser_le(f, &data_offset);
+}
+
+static void write_header(FILE *f, uint64_t records_offset)
+{
+    fwrite(hdr_jdaw, 1, 4, f);
+    fwrite(hdr_version, 1, 8, f);
+    fwrite(current_file_spec_version, 1, 5, f);
+    uint64_ser_le(f, &records_offset);
+}
+
+/* Save thread */
+static void write_clip_block(FILE *f, ClipBlockJob *b)
+{
+    char zeros[4] = {0};
+    for (int c=0; c<b->channels; c++) {
+	write_samples(f, b->bufs[c], b->len_sframes, b->fmt);
+    }
+    size_t samples_len = (size_t)b->channels * b->len_sframes * storage_fmt_bytes_per_sample(b->fmt);
+    fwrite(zeros, 1, clip_data_samples_len(b->channels, b->len_sframes, b->fmt) - samples_len, f);
+    for (int c=0; c<b->channels; c++) {
+	write_f32_le(f, (const float *)b->ck64[c], 2 * b->num_ck64);
+    }
+    for (int c=0; c<b->channels && b->num_ck512 > 0; c++) {
+	write_f32_le(f, (const float *)b->ck512[c], 2 * b->num_ck512);
+    }
+}
+
+/* Save thread; pad with zeros up to 'offset', which must not be behind the current position */
+static int seek_forward_to(FILE *f, uint64_t offset)
+{
+    char zeros[CLIP_DATA_ALIGN] = {0};
+    long pos = ftell(f);
+    if (pos < 0 || (uint64_t)pos > offset) return EIO;
+    while ((uint64_t)pos < offset) {
+	size_t len = offset - pos < CLIP_DATA_ALIGN ? offset - pos : CLIP_DATA_ALIGN;
+	if (fwrite(zeros, 1, len, f) != len) return errno;
+	pos += len;
+    }
+    return 0;
+}
+
+#define SAVE_FAIL(step) do { job->err_step = step; job->err = errno ? errno : EIO; goto save_error; } while (0)
+
+static void *save_thread_fn(void *arg)
+{
+    SaveJob *job = arg;
+    FILE *f;
+    errno = 0;
+    if (job->incremental) {
+	if (job->backup_copy && file_backup_copy(job->path) != 0) {
+	    fprintf(stderr, "Warning: unable to back up %s before saving over it\n", job->path);
+	}
+	f = fopen(job->path, "r+b");
+	if (!f) SAVE_FAIL("opening project file");
+	if (fseek(f, 0, SEEK_END) != 0) SAVE_FAIL("seeking to end of project file");
+    } else {
+	f = fopen(job->tmp_path, "wb");
+	if (!f) SAVE_FAIL("creating temporary file");
+	/* Records offset is filled in last */
+	write_header(f, 0);
+    }
+    for (int i=0; i<job->num_blocks; i++) {
+	if ((errno = seek_forward_to(f, job->blocks[i].offset)) != 0) SAVE_FAIL("writing clip data");
+	write_clip_block(f, job->blocks + i);
+    }
+    if ((errno = seek_forward_to(f, job->records_offset)) != 0) SAVE_FAIL("writing project");
+    fwrite(job->records, 1, job->records_len, f);
+    /* Everything the header will point to must be on disk before the header is */
+    if (fflush(f) != 0 || fsync(fileno(f)) != 0) SAVE_FAIL("writing project");
+    rewind(f);
+    write_header(f, job->records_offset);
+    if (fflush(f) != 0 || fsync(fileno(f)) != 0) SAVE_FAIL("writing file header");
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0) SAVE_FAIL("writing project");
+    job->dev = st.st_dev;
+    job->ino = st.st_ino;
+    if (fclose(f) != 0) {
+	f = NULL;
+	SAVE_FAIL("closing project file");
+    }
+    f = NULL;
+    if (!job->incremental) {
+	if (file_exists(job->path)) {
+	    file_backup(job->path);
+	}
+	if (rename(job->tmp_path, job->path) != 0) SAVE_FAIL("moving project file into place");
+    }
+    atomic_store(&job->done, true);
+    return NULL;
+
+save_error:
+    if (f) fclose(f);
+    atomic_store(&job->done, true);
+    return NULL;
+}
+
+/* True if 'path' is a file of the current version, which can be appended to */
+static bool save_file_appendable(const char *path, struct stat *st)
+{
+    if (stat(path, st) != 0) return false;
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    char hdr[17];
+    bool ret = fread(hdr, 1, 17, f) == 17
+	&& strncmp(hdr, hdr_jdaw, 4) == 0
+	&& strncmp(hdr + 4, hdr_version, 8) == 0
+	&& strncmp(hdr + 12, current_file_spec_version, 5) == 0;
+    fclose(f);
+    return ret;
+}
+
+static bool clip_block_stored_in(Clip *clip, struct stat *st)
+{
+    ClipStoredBlock *s = &clip->stored;
+    return s->offset != 0
+	&& s->dev == st->st_dev
+	&& s->ino == st->st_ino
+	&& s->len_sframes == clip->len_sframes
+	&& s->channels == clip->channels
+	&& s->fmt == clip->storage_fmt;
+}
+
+static void save_job_destroy(SaveJob *job)
+{
+    for (int i=0; i<job->num_blocks; i++) {
+	job->blocks[i].clip->save_pending = false;
+    }
+    free(job->blocks);
+    free(job->records);
+    free(job->path);
+    free(job->tmp_path);
+    free(job);
+}
+
+static void save_job_finish(bool report)
+{
+    SaveJob *job = save_job;
+    pthread_join(job->thread, NULL);
+    save_job = NULL;
+    if (job->err != 0) {
+	fprintf(stderr, "Error saving project to %s (%s): %s\n", job->path, job->err_step, strerror(job->err));
+	if (report) status_set_errstr("Error saving project (%s): %s", job->err_step, strerror(job->err));
+    } else {
+	for (int i=0; i<job->num_blocks; i++) {
+	    ClipBlockJob *b = job->blocks + i;
+	    b->clip->stored = (ClipStoredBlock){
+		.dev = job->dev,
+		.ino = job->ino,
+		.offset = b->offset,
+		.len_sframes = b->len_sframes,
+		.channels = b->channels,
+		.fmt = b->fmt
+	    };
+	}
+	fprintf(stderr, "Saved project to %s (%d clip block%s written)\n", job->path, job->num_blocks, job->num_blocks == 1 ? "" : "s");
+	if (report) status_set_alertstr("Saved project to %s", job->path);
+    }
+    save_job_destroy(job);
+}
+
+void jdaw_save_poll()
+{
+    if (save_job && atomic_load(&save_job->done)) {
+	save_job_finish(true);
+    }
+}
+
+void jdaw_save_wait()
+{
+    if (save_job) {
+	save_job_finish(false);
+    }
+}
+
 void jdaw_write_project(const char *path) 
 {
     Session *session = session_get();
     proj = &session->proj;
-    if (!proj) {
-        fprintf(stderr, "No project to save. Exiting.\n");
-        return;
-    }    
+    if (session->playback.recording) {
+	status_set_errstr("Cannot save while recording");
+	return;
+    }
+    jdaw_save_wait();
 
+    SaveJob *job = calloc(1, sizeof(SaveJob));
+    if (!job) {
+	fprintf(stderr, "Fatal error: unable to allocate save job\n");
+	exit(1);
+    }
+    job->path = strdup(path);
+    int tmp_path_len = strlen(path) + 5;
+    job->tmp_path = malloc(tmp_path_len);
+    snprintf(job->tmp_path, tmp_path_len, "%s.tmp", path);
 
-    if (file_exists(path)) {
-	/* session_loading_screen_update("Backing up existing file...", 0.1); */
-	file_backup(path);
+    Clip *clips[proj->num_clips + 1];
+    int num_clips = 0;
+    for (uint16_t i=0; i<proj->num_clips; i++) {
+	if (proj->clips[i]->num_refs > 0) {
+	    Clip *clip = proj->clips[i];
+	    if ((uint32_t)clip->waveform.init_len != clip->len_sframes) {
+		clip_init_or_update_waveform(clip);
+	    }
+	    clips[num_clips] = clip;
+	    num_clips++;
+	}
     }
 
-    session_set_loading_screen("Saving project", "Writing project settings...", true);
-    
-    FILE* f = fopen(path, "wb");
+    /* Append to the file if it holds the blocks of the clips that haven't changed, and not too
+       much else */
+    struct stat st;
+    job->incremental = save_file_appendable(path, &st);
+    if (job->incremental) {
+	uint64_t referenced = JDAW_HEADER_LEN;
+	for (int i=0; i<num_clips; i++) {
+	    if (clip_block_stored_in(clips[i], &st)) {
+		int32_t num_ck64, num_ck512;
+		referenced += clip_data_block_len(clips[i]->channels, clips[i]->len_sframes, clips[i]->storage_fmt, &num_ck64, &num_ck512);
+	    }
+	}
+	if (referenced < (uint64_t)st.st_size * SAVE_MIN_REFERENCED_RATIO) {
+	    job->incremental = false;
+	}
+    }
+    /* One backup per file per session. A full save moves the old file to .bak itself, and
+       counts. */
+    static char *backed_up_path = NULL;
+    if (!backed_up_path || strcmp(backed_up_path, path) != 0) {
+	if (job->incremental) {
+	    job->backup_copy = true;
+	}
+	if (job->incremental || file_exists(path)) {
+	    free(backed_up_path);
+	    backed_up_path = strdup(path);
+	}
+    }
 
+    /* Place the blocks */
+    job->blocks = calloc(num_clips + 1, sizeof(ClipBlockJob));
+    uint64_t data_offsets[num_clips + 1];
+    uint64_t end = job->incremental ? (uint64_t)st.st_size : JDAW_HEADER_LEN;
+    for (int i=0; i<num_clips; i++) {
+	Clip *clip = clips[i];
+	if (job->incremental && clip_block_stored_in(clip, &st)) {
+	    data_offsets[i] = clip->stored.offset;
+	    continue;
+	}
+	ClipBlockJob *b = job->blocks + job->num_blocks;
+	job->num_blocks++;
+	b->clip = clip;
+	b->offset = end + (CLIP_DATA_ALIGN - end % CLIP_DATA_ALIGN) % CLIP_DATA_ALIGN;
+	b->len_sframes = clip->len_sframes;
+	b->channels = clip->channels;
+	b->fmt = clip->storage_fmt;
+	b->bufs[0] = clip->L;
+	b->bufs[1] = clip->R;
+	for (int c=0; c<clip->channels; c++) {
+	    b->ck64[c] = clip->waveform.ck64[c];
+	    b->ck512[c] = clip->waveform.ck512[c];
+	}
+	end = b->offset + clip_data_block_len(b->channels, b->len_sframes, b->fmt, &b->num_ck64, &b->num_ck512);
+	data_offsets[i] = b->offset;
+	clip->save_pending = true;
+    }
+    job->records_offset = end;
+
+    /* Serialize the project records */
+    FILE *f = open_memstream(&job->records, &job->records_len);
     if (!f) {
-	fprintf(stderr, "Error: unable to write to file at path %s: file could not be found\n", path);
+	fprintf(stderr, "Error: unable to serialize project: %s\n", strerror(errno));
+	status_set_errstr("Error saving project: %s", strerror(errno));
+	save_job_destroy(job);
 	return;
     }
-    fwrite(hdr_jdaw, 1, 4, f);
-    fwrite(hdr_version, 1, 8, f);
-    fwrite(current_file_spec_version, 1, 5, f);
     uint8_t namelen = strlen(proj->name);
     fwrite(&namelen, 1, 1, f);
     fwrite(proj->name, 1, namelen, f);
@@ -128,11 +573,8 @@ void jdaw_write_project(const char *path)
     uint32_ser_le(f, &proj->sample_rate);
     uint16_ser_le(f, &proj->chunk_size_sframes);
     uint16_ser_le(f, (uint16_t *)&proj->fmt);
-    uint16_t num_clips = 0;
-    for (uint16_t i=0; i<proj->num_clips; i++) {
-	if (proj->clips[i]->num_refs > 0) num_clips++;
-    }
-    uint16_ser_le(f, &num_clips);
+    uint16_t num_clips_16 = num_clips;
+    uint16_ser_le(f, &num_clips_16);
     
     uint16_t num_midi_clips = 0;
     for (uint16_t i=0; i<proj->num_midi_clips; i++) {
@@ -143,74 +585,33 @@ void jdaw_write_project(const char *path)
     uint8_ser(f, &proj->num_timelines);
     /* fwrite(&proj->num_timelines, 1, 1, f); */
 
-    session_loading_screen_update("Writing clip data...", 0.2);
-    /* fprintf(stderr, "Serializing %d audio clips...\n", proj->num_clips); */
-    for (uint16_t i=0; i<proj->num_clips; i++) {
-	session_loading_screen_update(NULL, 0.1 + 0.8 * (float)i/proj->num_clips);
-	if (proj->clips[i]->num_refs > 0) {
-	    jdaw_write_clip(f, proj->clips[i], i);
-	}
+    for (int i=0; i<num_clips; i++) {
+	jdaw_write_clip(f, clips[i], i, data_offsets[i]);
     }
-    session_loading_screen_update("Writing MIDI clips...", 0.2);
     for (uint16_t i=0; i<proj->num_midi_clips; i++) {
-	session_loading_screen_update(NULL, 0.1 + 0.8 * (float)i/proj->num_midi_clips);
 	if (proj->midi_clips[i]->num_refs > 0) {
 	    jdaw_write_midi_clip(f, proj->midi_clips[i]);
 	}
     }
-    session_loading_screen_update("Writing timelines...", 0.9);
     /* fprintf(stderr, "\t...done.\nSerializing %d timelines...\n", proj->num_timelines); */
     for (uint8_t i=0; i<proj->num_timelines; i++) {
 	jdaw_write_timeline(f, proj->timelines[i]);
     }
-    session_loading_screen_deinit();
-    /* fprintf(stderr, "\t...done.\n"); */
-    /* fwrite(&(proj->tl->num_tracks), 1, 1, f); */
-    /* for (uint8_t i=0; i<proj->tl->num_tracks; i++) { */
-        /* write_track_to_jdaw(f, proj->tl->tracks[i]); */
-    /* } */
-    fclose(f);
-}
-
-static void jdaw_write_clip(FILE *f, Clip *clip, int index)
-{
-    fwrite(hdr_clip, 1, 4, f);
-    uint8_t namelen = strlen(clip->name);
-    uint8_ser(f, &namelen);
-    fwrite(&clip->name, 1, namelen, f);
-    uint8_t index_8 = (uint8_t)index;
-    uint8_ser(f, &index_8);
-    uint8_ser(f, &clip->channels);
-    uint32_t len_sframes = clip->len_sframes;
-    uint32_ser_le(f, &len_sframes);
-
-    fwrite(hdr_data, 1, 4, f);
-
-    /* Write clip sample data */
-    uint32_t len_samples = clip->len_sframes * clip->channels;
-    int16_t *clip_samples = malloc(sizeof(int16_t) * len_samples);
-    if (!clip_samples) {
-        fprintf(stderr, "Error: unable to allocate space for clip_samples\n");
-        exit(1);
-    }
-    if (clip->channels == 2) {
-        for (uint32_t i=0; i<len_samples; i+=2) {
-	    clip_samples[i] = clip_float_sample(clip->L[i/2]) * INT16_MAX;
-	    clip_samples[i+1] = clip_float_sample(clip->R[i/2]) * INT16_MAX;
-        }
-    } else if (clip->channels == 1) {
-        for (uint32_t i=0; i<len_samples; i++) {
-	    clip_samples[i] = clip_float_sample(clip->L[i]) * INT16_MAX;
-        }
+    if (fclose(f) != 0) {
+	fprintf(stderr, "Error: unable to serialize project: %s\n", strerror(errno));
+	status_set_errstr("Error saving project: %s", strerror(errno));
+	save_job_destroy(job);
+	return;
     }
-    if (SYS_BYTEORDER_LE) {
-	fwrite(clip_samples, 2, len_samples, f);
-    } else {
-	for (uint32_t i=0; i<clip->len_sframes * clip->channels; i++) {
-	    int16_ser_le(f, clip_samples + i);
-	}
+
+    if (pthread_create(&job->thread, NULL, save_thread_fn, job) != 0) {
+	fprintf(stderr, "Error: unable to start save thread\n");
+	status_set_errstr("Error saving project: unable to start save thread");
+	save_job_destroy(job);
+	return;
     }
-    free(clip_samples);
+    save_job = job;
+    status_set_alertstr("Saving project to %s...", path);
 }
 
 
@@ -234,6 +635,7 @@ static void jdaw_write_midi_clip(FILE *f, MIDIClip *mclip)
 static void jdaw_write_track(FILE *f, Track *track);
 static void jdaw_write_click_track(FILE *f, ClickTrack *ct);
 static void jdaw_write_tl_audio_routes(FILE *f, Timeline *tl);
+static void jdaw_write_tl_bus_outs(FILE *f, Timeline *tl);
 static void jdaw_write_tl_automations(FILE *f, Timeline *tl);
 
 static void jdaw_write_timeline(FILE *f, Timeline *tl)
@@ -260,6 +662,7 @@ static void jdaw_write_timeline(FILE *f, Timeline *tl)
 	}
     }
     jdaw_write_tl_audio_routes(f, tl);
+    jdaw_write_tl_bus_outs(f, tl);
     jdaw_write_tl_automations(f, tl);
 }
 
@@ -305,6 +708,10 @@ static void jdaw_write_track(FILE *f, Track *track)
 	jdaw_write_effect_chain(f, &track->synth->effect_chain);
 	api_node_serialize(f, &track->synth->api_node);
     }
+    uint8_t frozen = track_is_frozen(track);
+    uint8_ser(f, &frozen);
+    uint8_t is_bus = track->is_bus;
+    uint8_ser(f, &is_bus);
 }
 
 static void jdaw_write_fir_filter(FILE *f, FIRFilter *filter);
@@ -379,6 +786,14 @@ static void jdaw_write_fir_filter(FILE *f, FIRFilter *filter)
     float_ser40_le(f, filter->cutoff_freq);
     float_ser40_le(f, filter->bandwidth);
     uint16_ser_le(f, &filter->impulse_response_len);
+    uint8_t ir_channels = !filter->loaded_ir_samples[0] ? 0 : filter->loaded_ir_samples[1] ? 2 : 1;
+    uint8_ser(f, &ir_channels);
+    if (ir_channels > 0) {
+	int32_ser_le(f, &filter->loaded_ir_len);
+	for (int c=0; c<ir_channels; c++) {
+	    write_f32_le(f, filter->loaded_ir_samples[c], filter->loaded_ir_len);
+	}
+    }
 }
 
 static void jdaw_write_delay(FILE *f, DelayLine *dl)
@@ -396,7 +811,8 @@ static void jdaw_write_saturation(FILE *f, Saturation *s)
     fwrite(&s->do_gain_comp, 1, 1, f);
     uint8_t type_byte = (uint8_t)s->type;
     uint8_ser(f, &type_byte);
-
+    uint8_t oversample_byte = (uint8_t)s->oversample;
+    uint8_ser(f, &oversample_byte);
 }
 
 static void jdaw_write_eq(FILE *f, EQ *eq)
@@ -423,6 +839,8 @@ static void jdaw_write_compressor(FILE *f, Compressor *c)
     float_ser40_le(f, c->threshold);
     float_ser40_le(f, c->m);
     float_ser40_le(f, c->makeup_gain);
+    fwrite(&c->limiter, 1, 1, f);
+    fwrite(&c->stereo_link, 1, 1, f);
 }
 
 static void jdaw_write_reverb(FILE *f, Schroeder *sch)
@@ -605,6 +1023,22 @@ static void jdaw_write_tl_audio_routes(FILE *f, Timeline *tl)
     
 }
 
+static void jdaw_write_tl_bus_outs(FILE *f, Timeline *tl)
+{
+    uint8_t num_bus_outs = 0;
+    for (int i=0; i<tl->num_tracks; i++) {
+	if (tl->tracks[i]->bus_out) num_bus_outs++;
+    }
+    uint8_ser(f, &num_bus_outs);
+    for (int i=0; i<tl->num_tracks; i++) {
+	Track *src = tl->tracks[i];
+	if (!src->bus_out) continue;
+	fwrite(hdr_bus_out, 1, 5, f);
+	uint8_ser(f, &src->tl_rank);
+	uint8_ser(f, &src->bus_out->tl_rank);
+    }
+}
+
 static void jdaw_write_tl_automations(FILE *f, Timeline *tl)
 {
     uint16_t auto_i = 0;
@@ -686,6 +1120,13 @@ int jdaw_read_file(Project *dst, const char *path)
 	/* session_to_set_proj_reading->proj_reading = NULL; */
 	return -1;
     }
+    if (read_file_version_at_or_above("00.32")) {
+	uint64_t records_offset = uint64_deser_le(f);
+	if (fseek(f, records_offset, SEEK_SET) != 0) {
+	    fprintf(stderr, "Error: project records offset %llu is invalid\n", (unsigned long long)records_offset);
+	    goto jdaw_parse_error;
+	}
+    }
 
     uint8_t proj_namelen;
     char project_name[MAX_NAMELENGTH];
@@ -796,6 +1237,83 @@ jdaw_parse_error:
     
 }
 
+/* Float32 blocks are mapped, so nothing is read from disk until it is touched. Integer blocks are
+   read and converted a chunk at a time into the clip's buffers. */
+static int jdaw_read_clip_data(FILE *f, Clip *clip, uint64_t offset)
+{
+    if (clip->channels != 1 && clip->channels != 2) {
+	fprintf(stderr, "Error: clip \"%s\" has unsupported channel count %d\n", clip->name, clip->channels);
+	return 1;
+    }
+    uint32_t len_sframes = clip->len_sframes;
+    int32_t num_ck64, num_ck512;
+    size_t block_len = clip_data_block_len(clip->channels, len_sframes, clip->storage_fmt, &num_ck64, &num_ck512);
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0 || offset + block_len > (uint64_t)st.st_size) {
+	fprintf(stderr, "Error: data for clip \"%s\" (%zu bytes at %llu) lies outside the file\n", clip->name, block_len, (unsigned long long)offset);
+	return 1;
+    }
+    clip->stored = (ClipStoredBlock){
+	.dev = st.st_dev,
+	.ino = st.st_ino,
+	.offset = offset,
+	.len_sframes = len_sframes,
+	.channels = clip->channels,
+	.fmt = clip->storage_fmt
+    };
+    if (len_sframes == 0) {
+	create_clip_buffers(clip, 1);
+	clip_init_or_update_waveform(clip);
+	return 0;
+    }
+
+    if (SYS_BYTEORDER_LE && clip->storage_fmt == CLIP_STORAGE_FLOAT32) {
+	uint64_t page_size = sysconf(_SC_PAGESIZE);
+	uint64_t map_offset = offset - offset % page_size;
+	size_t map_len = block_len + (offset - map_offset);
+	char *base = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(f), map_offset);
+	if (base != MAP_FAILED) {
+	    char *p = base + (offset - map_offset);
+	    float *L = (float *)p;
+	    float *R = NULL;
+	    if (clip->channels == 2) {
+		R = L + len_sframes;
+	    }
+	    p += clip_data_samples_len(clip->channels, len_sframes, clip->storage_fmt);
+	    WaveformChunk *ck64[2] = {NULL, NULL};
+	    WaveformChunk *ck512[2] = {NULL, NULL};
+	    for (int c=0; c<clip->channels; c++) {
+		ck64[c] = (WaveformChunk *)p;
+		p += num_ck64 * sizeof(WaveformChunk);
+	    }
+	    for (int c=0; c<clip->channels && num_ck512 > 0; c++) {
+		ck512[c] = (WaveformChunk *)p;
+		p += num_ck512 * sizeof(WaveformChunk);
+	    }
+	    clip_attach_mapped_data(clip, base, map_len, L, R, ck64, ck512);
+	    return 0;
+	}
+	log_tmp(LOG_WARN, "Unable to map data for clip \"%s\" (%s); reading it into memory\n", clip->name, strerror(errno));
+    }
+
+    /* Read the samples, and recompute the waveform */
+    long resume_pos = ftell(f);
+    fseek(f, offset, SEEK_SET);
+    create_clip_buffers(clip, len_sframes);
+    float *bufs[2] = {clip->L, clip->R};
+    for (int c=0; c<clip->channels; c++) {
+	if (clip->storage_fmt == CLIP_STORAGE_FLOAT32) {
+	    read_f32_le(f, bufs[c], len_sframes);
+	} else if (read_int_le(f, bufs[c], len_sframes, clip->storage_fmt) < len_sframes) {
+	    fprintf(stderr, "Error: short read on data for clip \"%s\"\n", clip->name);
+	    return 1;
+	}
+    }
+    fseek(f, resume_pos, SEEK_SET);
+    clip_init_or_update_waveform(clip);
+    return 0;
+}
+
 static int jdaw_read_clip(FILE *f, Project *proj)
 {
     char hdr_buffer[5];
@@ -826,13 +1344,27 @@ static int jdaw_read_clip(FILE *f, Project *proj)
     
     fread(&clip->channels, 1, 1, f);
     clip->len_sframes = uint32_deser_le(f);    
+    if (read_file_version_at_or_above("00.31")) {
+	uint8_t storage_fmt = uint8_deser(f);
+	if (storage_fmt >= CLIP_STORAGE_NUM_FMTS) {
+	    fprintf(stderr, "Error: clip \"%s\" has unknown storage format %d\n", clip->name, storage_fmt);
+	    return 1;
+	}
+	clip->storage_fmt = storage_fmt;
+    }
     fread(hdr_buffer, 1, 4, f);
     if (strncmp(hdr_buffer, hdr_data, 4) != 0) {
 	fprintf(stderr, "Error: clip 'data' indicator missing.\n");
 	return 1;
     }
+    if (read_file_version_at_or_above("00.30")) {
+	uint64_t offset = uint64_deser_le(f);
+	return jdaw_read_clip_data(f, clip, offset);
+    }
 
-    /* Read clip data */
+    /* Read clip data; older versions store interleaved int16. The clip is re-saved as float32, so
+       that the next open can map it. */
+    clip->storage_fmt = CLIP_STORAGE_FLOAT32;
     create_clip_buffers(clip, clip->len_sframes);
     uint32_t clip_len_samples = clip->len_sframes * clip->channels;
     int16_t *interleaved_clip_samples = malloc(sizeof(int16_t) * clip_len_samples);
@@ -849,14 +1381,10 @@ static int jdaw_read_clip(FILE *f, Project *proj)
     
     /* write data to clip */
     if (clip->channels == 2) {
-        for (uint32_t i=0; i<clip_len_samples; i+=2) {
-            clip->L[i/2] = (float)interleaved_clip_samples[i] / INT16_MAX;
-            clip->R[i/2] = (float)interleaved_clip_samples[i+1] / INT16_MAX;
-        }
+	int16_buf_to_float(interleaved_clip_samples, 2, clip->L, clip_len_samples / 2);
+	int16_buf_to_float(interleaved_clip_samples + 1, 2, clip->R, clip_len_samples / 2);
     } else {
-        for (uint32_t i=0; i<clip_len_samples; i++) {
-            clip->L[i] = (float)interleaved_clip_samples[i] / INT16_MAX;
-        }
+	int16_buf_to_float(interleaved_clip_samples, 1, clip->L, clip_len_samples);
     }
     free(interleaved_clip_samples);
     clip_init_or_update_waveform(clip);
@@ -968,6 +1496,7 @@ static void local_move_track_down()
 static int jdaw_read_track(FILE *f, Timeline *tl);
 static int jdaw_read_click_track(FILE *f, Timeline *tl);
 static int jdaw_read_tl_audio_routes(FILE *f, Timeline *tl);
+static int jdaw_read_tl_bus_outs(FILE *f, Timeline *tl);
 static int jdaw_read_tl_automations(FILE *f, Timeline *tl);
 static int jdaw_read_timeline(FILE *f, Project *proj_loc)
 {
@@ -1036,6 +1565,9 @@ static int jdaw_read_timeline(FILE *f, Project *proj_loc)
 	if (jdaw_read_tl_audio_routes(f, tl) != 0) {
 	    return 1;
 	}
+	if (read_file_version_at_or_above("00.28") && jdaw_read_tl_bus_outs(f, tl) != 0) {
+	    return 1;
+	}
 	if (jdaw_read_tl_automations(f, tl) != 0) {
 	    return 1;
 	}
@@ -1294,6 +1826,15 @@ static int jdaw_read_track(FILE *f, Timeline *tl)
 		    api_node_deserialize(f, &track->synth->api_node);
 		}
 	    }
+	    if (read_file_version_at_or_above("00.27")) {
+		/* Render is not stored; redo it once the project is loaded */
+		if (uint8_deser(f)) {
+		    track->freeze.render_requested = true;
+		}
+	    }
+	    if (read_file_version_at_or_above("00.28")) {
+		track->is_bus = uint8_deser(f);
+	    }
 	}	
     }
     return 0;
@@ -1407,12 +1948,32 @@ static int jdaw_read_fir_filter(FILE *f, FIRFilter *filter)
     cutoff_freq = float_deser40_le(f);
     bandwidth = float_deser40_le(f);
     impulse_response_len = uint16_deser_le(f);
-    if (impulse_response_len > proj_reading->fourier_len_sframes) {
-	impulse_response_len = proj_reading->fourier_len_sframes;
+    if (impulse_response_len > FIR_FILTER_MAX_IR_LEN) {
+	impulse_response_len = FIR_FILTER_MAX_IR_LEN;
     }
 
     filter_set_impulse_response_len(filter, impulse_response_len);
     filter_set_params(filter, type, cutoff_freq, bandwidth);
+    if (read_file_version_at_or_above("00.33")) {
+	uint8_t ir_channels = uint8_deser(f);
+	if (ir_channels > 0) {
+	    int32_t len = int32_deser_le(f);
+	    if (len <= 0 || ir_channels > 2) {
+		fprintf(stderr, "Error: invalid loaded impulse response (%d channels, len %d)\n", ir_channels, len);
+		return 1;
+	    }
+	    float *bufs[2] = {NULL, NULL};
+	    for (int c=0; c<ir_channels; c++) {
+		bufs[c] = malloc(len * sizeof(float));
+		if (!bufs[c]) {
+		    fprintf(stderr, "Fatal error: unable to allocate impulse response\n");
+		    exit(1);
+		}
+		read_f32_le(f, bufs[c], len);
+	    }
+	    filter_set_loaded_IR(filter, bufs[0], bufs[1], len);
+	}
+    }
     return 0;
 }
 static int jdaw_read_delay(FILE *f, DelayLine *dl)
@@ -1436,6 +1997,9 @@ static int jdaw_read_saturation(FILE *f, Saturation *s)
     saturation_set_gain(s, float_deser40_le(f));
     s->do_gain_comp = uint8_deser(f);
     saturation_set_type(s, uint8_deser(f));
+    if (read_file_version_at_or_above("00.29")) {
+	saturation_set_oversample(s, uint8_deser(f));
+    }
     return 0;
 }
 static int jdaw_read_eq(FILE *f, EQ *eq)
@@ -1468,6 +2032,10 @@ static int jdaw_read_compressor(FILE *f, Compressor *c)
     c->threshold = float_deser40_le(f);
     compressor_set_m(c, float_deser40_le(f));
     c->makeup_gain = float_deser40_le(f);
+    if (read_file_version_at_or_above("00.29")) {
+	c->limiter = uint8_deser(f);
+	c->stereo_link = uint8_deser(f);
+    }
     return 0;
 }
 
@@ -1767,6 +2335,27 @@ static int jdaw_read_tl_audio_routes(FILE *f, Timeline *tl)
     return 0;
 }
 
+static int jdaw_read_tl_bus_outs(FILE *f, Timeline *tl)
+{
+    uint8_t num_bus_outs = uint8_deser(f);
+    for (uint8_t i=0; i<num_bus_outs; i++) {
+	char hdr_buf[5];
+	fread(hdr_buf, 1, 5, f);
+	if (strncmp(hdr_buf, hdr_bus_out, 5) != 0) {
+	    fprintf(stderr, "Error: .jdaw parse error: \"BUSOT\" indicator not found where expected\n");
+	    return 1;
+	}
+	uint8_t src_index = uint8_deser(f);
+	uint8_t bus_index = uint8_deser(f);
+	if (src_index >= tl->num_tracks || bus_index >= tl->num_tracks) {
+	    fprintf(stderr, "Error: .jdaw parse error: bus out track index out of range\n");
+	    return 1;
+	}
+	track_set_bus_out(tl->tracks[src_index], tl->tracks[bus_index]);
+    }
+    return 0;
+}
+
 static int jdaw_read_tl_automations(FILE *f, Timeline *tl)
 {
     uint16_t total_number = uint16_deser_le(f);
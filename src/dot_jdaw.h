@@ -13,6 +13,15 @@
     dot_jdaw.h
 
     * Define the .jdaw file type and provide functions for saving and opening .jdaw files
+    * saves run in the background. The main thread serializes everything but clip audio into memory,
+      and decides where each clip's block goes; a save thread then writes the blocks and the
+      serialized project. Clip audio is not modified after recording stops, so the thread can read
+      it in place; destroying a clip waits for the save.
+    * a save to the file the project was last loaded from or saved to is incremental: blocks of
+      unchanged clips are left where they are, new blocks and the project records are appended, and
+      the pointer to the records in the file header is updated last. If the file is mostly
+      unreferenced data, or is any other file, the whole project is written to a temporary file,
+      which is then renamed into place.
  *****************************************************************************************************************/
 
 
@@ -25,8 +34,15 @@
 void jdaw_write_effect_chain_external(FILE *f, EffectChain *ec);
 int jdaw_read_effect_chain_external(FILE *f, Project *proj, EffectChain *ec, APINode *api_node, const char *obj_name, int32_t chunk_len_sframes);
     
-/* Write a .jdaw file from the current project at the directory pointed to by 'path' */
-void write_jdaw_file(const char *path);
+/* Main thread. Save the current project to 'path'; returns once the save thread is started. Waits
+   for any save already in progress. */
+void jdaw_write_project(const char *path);
+
+/* Main thread; call once per frame. Reports the result of a finished save. */
+void jdaw_save_poll();
+
+/* Main thread; block until any save in progress finishes */
+void jdaw_save_wait();
 
 /* Open a .jdaw file at the directory pointed to by 'path', and return a pointer to the built Project struct */
 /* Project *open_jdaw_file(const char *path); */
@@ -0,0 +1,947 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    dsp_kernels.c
+
+    * see dsp_kernels.h
+    * SSE2 is part of the x86-64 baseline, and NEON of the aarch64 baseline, so those are compiled
+      unconditionally on their architectures. AVX2 functions are compiled with a target attribute and
+      only called if the CPU reports support, so no special compiler flags are needed.
+    * vector kernels do the same IEEE operations, in the same order per element, as the scalar
+      ones (no fused multiply-add), which is what makes them bit-exact
+ *****************************************************************************************************************/
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dsp_kernels.h"
+#include "log.h"
+#include "test.h"
+
+#ifdef TESTBUILD
+#include <float.h>
+#include <stdio.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DSP_KERNELS_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define DSP_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+/*****************************************************************************************************************
+    Scalar reference
+ *****************************************************************************************************************/
+
+static void scalar_add(float *restrict a, float *restrict b, int len)
+{
+    for (int i=0; i<len; i++) {
+	a[i] += b[i];
+    }
+}
+
+static void scalar_add_to(float *restrict a, float *restrict b, float *restrict sum, int len)
+{
+    for (int i=0; i<len; i++) {
+	sum[i] = a[i] + b[i];
+    }
+}
+
+static void scalar_mult(float *restrict a, float *restrict b, int len)
+{
+    for (int i=0; i<len; i++) {
+	a[i] *= b[i];
+    }
+}
+
+static void scalar_mult_to(float *restrict a, float *restrict b, float *restrict product, int len)
+{
+    for (int i=0; i<len; i++) {
+	product[i] = a[i] * b[i];
+    }
+}
+
+static void scalar_mult_const(float *restrict a, float by, int len)
+{
+    for (int i=0; i<len; i++) {
+	a[i] *= by;
+    }
+}
+
+static void scalar_xfade(float *restrict dst, float *restrict from, int len)
+{
+    for (int i=0; i<len; i++) {
+	float prop = (float)i/len;
+	dst[i] = prop * dst[i] + (1 - prop) * from[i];
+    }
+}
+
+static void scalar_mix_in(float *restrict dst, float *restrict from, float amp, int len)
+{
+    for (int i=0; i<len; i++) {
+	dst[i] += from[i] * amp;
+    }
+}
+
+static float scalar_abs_sum(const float *restrict a, int len)
+{
+    float sum = 0.0f;
+    for (int i=0; i<len; i++) {
+	sum += fabsf(a[i]);
+    }
+    return sum;
+}
+
+static inline int16_t scalar_float_to_int16(float f)
+{
+    if (f > 1.0f) f = 1.0f;
+    if (f < -1.0f) f = -1.0f;
+    return (int16_t)(f * INT16_MAX);
+}
+
+static void scalar_to_int16_interleaved(const float *restrict L, const float *restrict R, int16_t *restrict dst, int len)
+{
+    for (int i=0; i<len; i++) {
+	dst[2 * i] = scalar_float_to_int16(L[i]);
+	dst[2 * i + 1] = scalar_float_to_int16(R[i]);
+    }
+}
+
+/* Rounds to nearest (lrintf, in the default rounding mode), unlike the truncating int16 conversion */
+static inline int32_t scalar_float_to_int32(float f, float scale)
+{
+    if (f > 1.0f) f = 1.0f;
+    if (f < -1.0f) f = -1.0f;
+    return (int32_t)lrintf(f * scale);
+}
+
+static void scalar_to_int32_interleaved(const float *restrict L, const float *restrict R, int32_t *restrict dst, float scale, int len)
+{
+    for (int i=0; i<len; i++) {
+	dst[2 * i] = scalar_float_to_int32(L[i], scale);
+	dst[2 * i + 1] = scalar_float_to_int32(R[i], scale);
+    }
+}
+
+static void scalar_interleave(const float *restrict L, const float *restrict R, float *restrict dst, int len)
+{
+    for (int i=0; i<len; i++) {
+	dst[2 * i] = L[i];
+	dst[2 * i + 1] = R[i];
+    }
+}
+
+static void scalar_from_int16(const int16_t *restrict src, int src_stride, float *restrict dst, int len)
+{
+    for (int i=0; i<len; i++) {
+	dst[i] = (float)src[i * src_stride] / INT16_MAX;
+    }
+}
+
+const DSPKernels dsp_kernels_scalar = {
+    "scalar",
+    scalar_add,
+    scalar_add_to,
+    scalar_mult,
+    scalar_mult_to,
+    scalar_mult_const,
+    scalar_xfade,
+    scalar_mix_in,
+    scalar_abs_sum,
+    scalar_to_int16_interleaved,
+    scalar_to_int32_interleaved,
+    scalar_interleave,
+    scalar_from_int16
+};
+
+DSPKernels dsp_kernels = {
+    "scalar",
+    scalar_add,
+    scalar_add_to,
+    scalar_mult,
+    scalar_mult_to,
+    scalar_mult_const,
+    scalar_xfade,
+    scalar_mix_in,
+    scalar_abs_sum,
+    scalar_to_int16_interleaved,
+    scalar_to_int32_interleaved,
+    scalar_interleave,
+    scalar_from_int16
+};
+
+#ifdef DSP_KERNELS_X86
+
+/*****************************************************************************************************************
+    SSE2
+ *****************************************************************************************************************/
+
+static void sse2_add(float *restrict a, float *restrict b, int len)
+{
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	_mm_storeu_ps(a + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    scalar_add(a + i, b + i, len - i);
+}
+
+static void sse2_add_to(float *restrict a, float *restrict b, float *restrict sum, int len)
+{
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	_mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    scalar_add_to(a + i, b + i, sum + i, len - i);
+}
+
+static void sse2_mult(float *restrict a, float *restrict b, int len)
+{
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	_mm_storeu_ps(a + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    scalar_mult(a + i, b + i, len - i);
+}
+
+static void sse2_mult_to(float *restrict a, float *restrict b, float *restrict product, int len)
+{
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	_mm_storeu_ps(product + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    scalar_mult_to(a + i, b + i, product + i, len - i);
+}
+
+static void sse2_mult_const(float *restrict a, float by, int len)
+{
+    __m128 by_v = _mm_set1_ps(by);
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	_mm_storeu_ps(a + i, _mm_mul_ps(_mm_loadu_ps(a + i), by_v));
+    }
+    scalar_mult_const(a + i, by, len - i);
+}
+
+static void sse2_xfade(float *restrict dst, float *restrict from, int len)
+{
+    __m128 len_v = _mm_set1_ps((float)len);
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 idx = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    __m128 step = _mm_set1_ps(4.0f);
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	__m128 prop = _mm_div_ps(idx, len_v);
+	__m128 d = _mm_mul_ps(prop, _mm_loadu_ps(dst + i));
+	__m128 f = _mm_mul_ps(_mm_sub_ps(one, prop), _mm_loadu_ps(from + i));
+	_mm_storeu_ps(dst + i, _mm_add_ps(d, f));
+	idx = _mm_add_ps(idx, step);
+    }
+    for (; i<len; i++) {
+	float prop = (float)i/len;
+	dst[i] = prop * dst[i] + (1 - prop) * from[i];
+    }
+}
+
+static void sse2_mix_in(float *restrict dst, float *restrict from, float amp, int len)
+{
+    __m128 amp_v = _mm_set1_ps(amp);
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	__m128 m = _mm_mul_ps(_mm_loadu_ps(from + i), amp_v);
+	_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), m));
+    }
+    scalar_mix_in(dst + i, from + i, amp, len - i);
+}
+
+static float sse2_abs_sum(const float *restrict a, int len)
+{
+    __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 acc = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	acc = _mm_add_ps(acc, _mm_and_ps(_mm_loadu_ps(a + i), abs_mask));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + scalar_abs_sum(a + i, len - i);
+}
+
+static inline __m128i sse2_float_to_int32(__m128 f)
+{
+    f = _mm_min_ps(_mm_max_ps(f, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+    return _mm_cvttps_epi32(_mm_mul_ps(f, _mm_set1_ps((float)INT16_MAX)));
+}
+
+static void sse2_to_int16_interleaved(const float *restrict L, const float *restrict R, int16_t *restrict dst, int len)
+{
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	__m128i l = sse2_float_to_int32(_mm_loadu_ps(L + i));
+	__m128i r = sse2_float_to_int32(_mm_loadu_ps(R + i));
+	__m128i lr = _mm_packs_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r));
+	_mm_storeu_si128((__m128i *)(dst + 2 * i), lr);
+    }
+    scalar_to_int16_interleaved(L + i, R + i, dst + 2 * i, len - i);
+}
+
+static inline __m128i sse2_float_to_int32_rounded(__m128 f, __m128 scale)
+{
+    f = _mm_min_ps(_mm_max_ps(f, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+    return _mm_cvtps_epi32(_mm_mul_ps(f, scale));
+}
+
+static void sse2_to_int32_interleaved(const float *restrict L, const float *restrict R, int32_t *restrict dst, float scale, int len)
+{
+    __m128 s = _mm_set1_ps(scale);
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	__m128i l = sse2_float_to_int32_rounded(_mm_loadu_ps(L + i), s);
+	__m128i r = sse2_float_to_int32_rounded(_mm_loadu_ps(R + i), s);
+	_mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi32(l, r));
+	_mm_storeu_si128((__m128i *)(dst + 2 * i + 4), _mm_unpackhi_epi32(l, r));
+    }
+    scalar_to_int32_interleaved(L + i, R + i, dst + 2 * i, scale, len - i);
+}
+
+static void sse2_interleave(const float *restrict L, const float *restrict R, float *restrict dst, int len)
+{
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	__m128 l = _mm_loadu_ps(L + i);
+	__m128 r = _mm_loadu_ps(R + i);
+	_mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(l, r));
+	_mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+    scalar_interleave(L + i, R + i, dst + 2 * i, len - i);
+}
+
+static void sse2_from_int16(const int16_t *restrict src, int src_stride, float *restrict dst, int len)
+{
+    __m128 scale = _mm_set1_ps((float)INT16_MAX);
+    int i = 0;
+    if (src_stride == 1) {
+	for (; i + 8 <= len; i += 8) {
+	    __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+	    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+	    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+	    _mm_storeu_ps(dst + i, _mm_div_ps(_mm_cvtepi32_ps(lo), scale));
+	    _mm_storeu_ps(dst + i + 4, _mm_div_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+    } else if (src_stride == 2) {
+	/* Loads 8 samples for 4 frames; stop early enough not to read past the last frame */
+	for (; i + 4 < len; i += 4) {
+	    __m128i s = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+	    __m128i even = _mm_srai_epi32(_mm_slli_epi32(s, 16), 16);
+	    _mm_storeu_ps(dst + i, _mm_div_ps(_mm_cvtepi32_ps(even), scale));
+	}
+    }
+    scalar_from_int16(src + i * src_stride, src_stride, dst + i, len - i);
+}
+
+static const DSPKernels dsp_kernels_sse2 = {
+    "sse2",
+    sse2_add,
+    sse2_add_to,
+    sse2_mult,
+    sse2_mult_to,
+    sse2_mult_const,
+    sse2_xfade,
+    sse2_mix_in,
+    sse2_abs_sum,
+    sse2_to_int16_interleaved,
+    sse2_to_int32_interleaved,
+    sse2_interleave,
+    sse2_from_int16
+};
+
+/*****************************************************************************************************************
+    AVX2
+ *****************************************************************************************************************/
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static void avx2_add(float *restrict a, float *restrict b, int len)
+{
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+	_mm256_storeu_ps(a + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    sse2_add(a + i, b + i, len - i);
+}
+
+AVX2 static void avx2_add_to(float *restrict a, float *restrict b, float *restrict sum, int len)
+{
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+	_mm256_storeu_ps(sum + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    sse2_add_to(a + i, b + i, sum + i, len - i);
+}
+
+AVX2 static void avx2_mult(float *restrict a, float *restrict b, int len)
+{
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+	_mm256_storeu_ps(a + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    sse2_mult(a + i, b + i, len - i);
+}
+
+AVX2 static void avx2_mult_to(float *restrict a, float *restrict b, float *restrict product, int len)
+{
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+	_mm256_storeu_ps(product + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    sse2_mult_to(a + i, b + i, product + i, len - i);
+}
+
+AVX2 static void avx2_mult_const(float *restrict a, float by, int len)
+{
+    __m256 by_v = _mm256_set1_ps(by);
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+	_mm256_storeu_ps(a + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), by_v));
+    }
+    sse2_mult_const(a + i, by, len - i);
+}
+
+AVX2 static void avx2_xfade(float *restrict dst, float *restrict from, int len)
+{
+    __m256 len_v = _mm256_set1_ps((float)len);
+    __m256 one = _mm256_set1_ps(1.0f);
+    __m256 idx = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    __m256 step = _mm256_set1_ps(8.0f);
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+	__m256 prop = _mm256_div_ps(idx, len_v);
+	__m256 d = _mm256_mul_ps(prop, _mm256_loadu_ps(dst + i));
+	__m256 f = _mm256_mul_ps(_mm256_sub_ps(one, prop), _mm256_loadu_ps(from + i));
+	_mm256_storeu_ps(dst + i, _mm256_add_ps(d, f));
+	idx = _mm256_add_ps(idx, step);
+    }
+    for (; i<len; i++) {
+	float prop = (float)i/len;
+	dst[i] = prop * dst[i] + (1 - prop) * from[i];
+    }
+}
+
+AVX2 static void avx2_mix_in(float *restrict dst, float *restrict from, float amp, int len)
+{
+    __m256 amp_v = _mm256_set1_ps(amp);
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+	__m256 m = _mm256_mul_ps(_mm256_loadu_ps(from + i), amp_v);
+	_mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), m));
+    }
+    sse2_mix_in(dst + i, from + i, amp, len - i);
+}
+
+AVX2 static float avx2_abs_sum(const float *restrict a, int len)
+{
+    __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 acc = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+	acc = _mm256_add_ps(acc, _mm256_and_ps(_mm256_loadu_ps(a + i), abs_mask));
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, acc);
+    float sum = 0.0f;
+    for (int j=0; j<8; j++) {
+	sum += lanes[j];
+    }
+    return sum + sse2_abs_sum(a + i, len - i);
+}
+
+AVX2 static inline __m256i avx2_float_to_int32(__m256 f)
+{
+    f = _mm256_min_ps(_mm256_max_ps(f, _mm256_set1_ps(-1.0f)), _mm256_set1_ps(1.0f));
+    return _mm256_cvttps_epi32(_mm256_mul_ps(f, _mm256_set1_ps((float)INT16_MAX)));
+}
+
+AVX2 static void avx2_to_int16_interleaved(const float *restrict L, const float *restrict R, int16_t *restrict dst, int len)
+{
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+	__m256i l = avx2_float_to_int32(_mm256_loadu_ps(L + i));
+	__m256i r = avx2_float_to_int32(_mm256_loadu_ps(R + i));
+	/* Unpack and pack both work within 128-bit lanes, which leaves the frames in order */
+	__m256i lr = _mm256_packs_epi32(_mm256_unpacklo_epi32(l, r), _mm256_unpackhi_epi32(l, r));
+	_mm256_storeu_si256((__m256i *)(dst + 2 * i), lr);
+    }
+    sse2_to_int16_interleaved(L + i, R + i, dst + 2 * i, len - i);
+}
+
+AVX2 static inline __m256i avx2_float_to_int32_rounded(__m256 f, __m256 scale)
+{
+    f = _mm256_min_ps(_mm256_max_ps(f, _mm256_set1_ps(-1.0f)), _mm256_set1_ps(1.0f));
+    return _mm256_cvtps_epi32(_mm256_mul_ps(f, scale));
+}
+
+AVX2 static void avx2_to_int32_interleaved(const float *restrict L, const float *restrict R, int32_t *restrict dst, float scale, int len)
+{
+    __m256 s = _mm256_set1_ps(scale);
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+	__m256i l = avx2_float_to_int32_rounded(_mm256_loadu_ps(L + i), s);
+	__m256i r = avx2_float_to_int32_rounded(_mm256_loadu_ps(R + i), s);
+	/* Unpack works within 128-bit lanes: lo holds frames 0-1 and 4-5, hi holds 2-3 and 6-7 */
+	__m256i lo = _mm256_unpacklo_epi32(l, r);
+	__m256i hi = _mm256_unpackhi_epi32(l, r);
+	_mm256_storeu_si256((__m256i *)(dst + 2 * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+	_mm256_storeu_si256((__m256i *)(dst + 2 * i + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    sse2_to_int32_interleaved(L + i, R + i, dst + 2 * i, scale, len - i);
+}
+
+AVX2 static void avx2_interleave(const float *restrict L, const float *restrict R, float *restrict dst, int len)
+{
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+	__m256 l = _mm256_loadu_ps(L + i);
+	__m256 r = _mm256_loadu_ps(R + i);
+	__m256 lo = _mm256_unpacklo_ps(l, r);
+	__m256 hi = _mm256_unpackhi_ps(l, r);
+	_mm256_storeu_ps(dst + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+	_mm256_storeu_ps(dst + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    sse2_interleave(L + i, R + i, dst + 2 * i, len - i);
+}
+
+AVX2 static void avx2_from_int16(const int16_t *restrict src, int src_stride, float *restrict dst, int len)
+{
+    if (src_stride != 1) {
+	sse2_from_int16(src, src_stride, dst, len);
+	return;
+    }
+    __m256 scale = _mm256_set1_ps((float)INT16_MAX);
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+	__m256i s = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+	_mm256_storeu_ps(dst + i, _mm256_div_ps(_mm256_cvtepi32_ps(s), scale));
+    }
+    scalar_from_int16(src + i, 1, dst + i, len - i);
+}
+
+static const DSPKernels dsp_kernels_avx2 = {
+    "avx2",
+    avx2_add,
+    avx2_add_to,
+    avx2_mult,
+    avx2_mult_to,
+    avx2_mult_const,
+    avx2_xfade,
+    avx2_mix_in,
+    avx2_abs_sum,
+    avx2_to_int16_interleaved,
+    avx2_to_int32_interleaved,
+    avx2_interleave,
+    avx2_from_int16
+};
+
+#endif /* DSP_KERNELS_X86 */
+
+#ifdef DSP_KERNELS_NEON
+
+/*****************************************************************************************************************
+    NEON
+ *****************************************************************************************************************/
+
+static void neon_add(float *restrict a, float *restrict b, int len)
+{
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	vst1q_f32(a + i, vaddq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+    }
+    scalar_add(a + i, b + i, len - i);
+}
+
+static void neon_add_to(float *restrict a, float *restrict b, float *restrict sum, int len)
+{
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	vst1q_f32(sum + i, vaddq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+    }
+    scalar_add_to(a + i, b + i, sum + i, len - i);
+}
+
+static void neon_mult(float *restrict a, float *restrict b, int len)
+{
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	vst1q_f32(a + i, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+    }
+    scalar_mult(a + i, b + i, len - i);
+}
+
+static void neon_mult_to(float *restrict a, float *restrict b, float *restrict product, int len)
+{
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	vst1q_f32(product + i, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+    }
+    scalar_mult_to(a + i, b + i, product + i, len - i);
+}
+
+static void neon_mult_const(float *restrict a, float by, int len)
+{
+    float32x4_t by_v = vdupq_n_f32(by);
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	vst1q_f32(a + i, vmulq_f32(vld1q_f32(a + i), by_v));
+    }
+    scalar_mult_const(a + i, by, len - i);
+}
+
+static void neon_xfade(float *restrict dst, float *restrict from, int len)
+{
+    static const float idx_init[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    float32x4_t len_v = vdupq_n_f32((float)len);
+    float32x4_t one = vdupq_n_f32(1.0f);
+    float32x4_t idx = vld1q_f32(idx_init);
+    float32x4_t step = vdupq_n_f32(4.0f);
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	float32x4_t prop = vdivq_f32(idx, len_v);
+	float32x4_t d = vmulq_f32(prop, vld1q_f32(dst + i));
+	float32x4_t f = vmulq_f32(vsubq_f32(one, prop), vld1q_f32(from + i));
+	vst1q_f32(dst + i, vaddq_f32(d, f));
+	idx = vaddq_f32(idx, step);
+    }
+    for (; i<len; i++) {
+	float prop = (float)i/len;
+	dst[i] = prop * dst[i] + (1 - prop) * from[i];
+    }
+}
+
+static void neon_mix_in(float *restrict dst, float *restrict from, float amp, int len)
+{
+    float32x4_t amp_v = vdupq_n_f32(amp);
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	/* Separate multiply and add (not vfmaq) to match the scalar rounding */
+	float32x4_t m = vmulq_f32(vld1q_f32(from + i), amp_v);
+	vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), m));
+    }
+    scalar_mix_in(dst + i, from + i, amp, len - i);
+}
+
+static float neon_abs_sum(const float *restrict a, int len)
+{
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	acc = vaddq_f32(acc, vabsq_f32(vld1q_f32(a + i)));
+    }
+    return vaddvq_f32(acc) + scalar_abs_sum(a + i, len - i);
+}
+
+static inline int16x4_t neon_float_to_int16(float32x4_t f)
+{
+    f = vminq_f32(vmaxq_f32(f, vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+    return vqmovn_s32(vcvtq_s32_f32(vmulq_f32(f, vdupq_n_f32((float)INT16_MAX))));
+}
+
+static void neon_to_int16_interleaved(const float *restrict L, const float *restrict R, int16_t *restrict dst, int len)
+{
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	int16x4x2_t lr;
+	lr.val[0] = neon_float_to_int16(vld1q_f32(L + i));
+	lr.val[1] = neon_float_to_int16(vld1q_f32(R + i));
+	vst2_s16(dst + 2 * i, lr);
+    }
+    scalar_to_int16_interleaved(L + i, R + i, dst + 2 * i, len - i);
+}
+
+/* Round to nearest, ties to even, matching lrintf in the default rounding mode */
+static inline int32x4_t neon_float_to_int32_rounded(float32x4_t f, float32x4_t scale)
+{
+    f = vminq_f32(vmaxq_f32(f, vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+    return vcvtnq_s32_f32(vmulq_f32(f, scale));
+}
+
+static void neon_to_int32_interleaved(const float *restrict L, const float *restrict R, int32_t *restrict dst, float scale, int len)
+{
+    float32x4_t s = vdupq_n_f32(scale);
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	int32x4x2_t lr;
+	lr.val[0] = neon_float_to_int32_rounded(vld1q_f32(L + i), s);
+	lr.val[1] = neon_float_to_int32_rounded(vld1q_f32(R + i), s);
+	vst2q_s32(dst + 2 * i, lr);
+    }
+    scalar_to_int32_interleaved(L + i, R + i, dst + 2 * i, scale, len - i);
+}
+
+static void neon_interleave(const float *restrict L, const float *restrict R, float *restrict dst, int len)
+{
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+	float32x4x2_t lr;
+	lr.val[0] = vld1q_f32(L + i);
+	lr.val[1] = vld1q_f32(R + i);
+	vst2q_f32(dst + 2 * i, lr);
+    }
+    scalar_interleave(L + i, R + i, dst + 2 * i, len - i);
+}
+
+static void neon_from_int16(const int16_t *restrict src, int src_stride, float *restrict dst, int len)
+{
+    float32x4_t scale = vdupq_n_f32((float)INT16_MAX);
+    int i = 0;
+    if (src_stride == 1) {
+	for (; i + 4 <= len; i += 4) {
+	    int32x4_t s = vmovl_s16(vld1_s16(src + i));
+	    vst1q_f32(dst + i, vdivq_f32(vcvtq_f32_s32(s), scale));
+	}
+    } else if (src_stride == 2) {
+	/* Loads 8 samples for 4 frames; stop early enough not to read past the last frame */
+	for (; i + 4 < len; i += 4) {
+	    int16x4x2_t s = vld2_s16(src + 2 * i);
+	    vst1q_f32(dst + i, vdivq_f32(vcvtq_f32_s32(vmovl_s16(s.val[0])), scale));
+	}
+    }
+    scalar_from_int16(src + i * src_stride, src_stride, dst + i, len - i);
+}
+
+static const DSPKernels dsp_kernels_neon = {
+    "neon",
+    neon_add,
+    neon_add_to,
+    neon_mult,
+    neon_mult_to,
+    neon_mult_const,
+    neon_xfade,
+    neon_mix_in,
+    neon_abs_sum,
+    neon_to_int16_interleaved,
+    neon_to_int32_interleaved,
+    neon_interleave,
+    neon_from_int16
+};
+
+#endif /* DSP_KERNELS_NEON */
+
+/*****************************************************************************************************************
+    Dispatch
+ *****************************************************************************************************************/
+
+#define MAX_DSP_KERNEL_TABLES 3
+
+/* Fill 'available' with the tables the CPU supports, scalar first and best last. Returns the count. */
+static int dsp_kernels_available(const DSPKernels *available[MAX_DSP_KERNEL_TABLES])
+{
+    int num_available = 0;
+    available[num_available++] = &dsp_kernels_scalar;
+#ifdef DSP_KERNELS_X86
+    available[num_available++] = &dsp_kernels_sse2;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+	available[num_available++] = &dsp_kernels_avx2;
+    }
+#elif defined(DSP_KERNELS_NEON)
+    available[num_available++] = &dsp_kernels_neon;
+#endif
+    return num_available;
+}
+
+void dsp_kernels_init()
+{
+    const DSPKernels *available[MAX_DSP_KERNEL_TABLES];
+    int num_available = dsp_kernels_available(available);
+    const DSPKernels *best = available[num_available - 1];
+    TEST_FN_CALL(dsp_kernels_self_check);
+    const char *requested = getenv("JACKDAW_DSP_KERNELS");
+    if (requested) {
+	bool found = false;
+	for (int i=0; i<num_available; i++) {
+	    if (strcmp(requested, available[i]->name) == 0) {
+		best = available[i];
+		found = true;
+		break;
+	    }
+	}
+	if (!found) {
+	    log_tmp(LOG_WARN, "DSP kernels \"%s\" requested but not supported; using \"%s\"\n", requested, best->name);
+	}
+    }
+    dsp_kernels = *best;
+    log_tmp(LOG_INFO, "Using %s DSP kernels\n", dsp_kernels.name);
+}
+
+#ifdef TESTBUILD
+
+/*****************************************************************************************************************
+    Self-check
+ *****************************************************************************************************************/
+
+#define SELF_CHECK_MAX_LEN 1031
+#define SELF_CHECK_MAX_OFFSET 7 /* In elements; with 4-byte floats, covers every alignment mod 32 */
+#define SELF_CHECK_BUF_LEN (2 * SELF_CHECK_MAX_LEN + SELF_CHECK_MAX_OFFSET + 1) /* Room for interleaved output */
+
+static const int self_check_lens[] = {0, 1, 3, 5, 7, 9, 15, 17, 31, 33, 63, 65, 127, 129, 255, 513, SELF_CHECK_MAX_LEN};
+
+static float sc_a[SELF_CHECK_BUF_LEN];
+static float sc_b[SELF_CHECK_BUF_LEN];
+static int16_t sc_i16[SELF_CHECK_BUF_LEN];
+
+/* Each output buffer is compared whole, so that writes outside the kernel's range are caught too */
+static float sc_ref[SELF_CHECK_BUF_LEN];
+static float sc_test[SELF_CHECK_BUF_LEN];
+static int16_t sc_ref_i16[SELF_CHECK_BUF_LEN];
+static int16_t sc_test_i16[SELF_CHECK_BUF_LEN];
+static int32_t sc_ref_i32[SELF_CHECK_BUF_LEN];
+static int32_t sc_test_i32[SELF_CHECK_BUF_LEN];
+
+/* Random samples in [-1.5, 1.5], so that the integer conversions clip some */
+static void self_check_fill(float *buf, int len)
+{
+    for (int i=0; i<len; i++) {
+	buf[i] = 3.0f * ((float)rand() / (float)RAND_MAX - 0.5f);
+    }
+}
+
+static void self_check_reset_outputs()
+{
+    self_check_fill(sc_ref, SELF_CHECK_BUF_LEN);
+    memcpy(sc_test, sc_ref, sizeof(sc_ref));
+    for (int i=0; i<SELF_CHECK_BUF_LEN; i++) {
+	sc_ref_i16[i] = sc_test_i16[i] = rand();
+	sc_ref_i32[i] = sc_test_i32[i] = rand();
+    }
+}
+
+static int self_check_cmp(const DSPKernels *k, const char *kernel, const void *test, const void *ref, size_t size, int len, int off_a, int off_b, int off_dst)
+{
+    if (memcmp(test, ref, size) == 0) return 0;
+    fprintf(stderr, "DSP kernels self-check: %s %s differs from scalar (len %d, offsets %d/%d/%d)\n", k->name, kernel, len, off_a, off_b, off_dst);
+    return 1;
+}
+
+/* Element-wise kernels must match the scalar ones exactly; abs_sum to within rounding */
+static int self_check_table(const DSPKernels *k, int len)
+{
+    const DSPKernels *s = &dsp_kernels_scalar;
+    int off_a = rand() % (SELF_CHECK_MAX_OFFSET + 1);
+    int off_b = rand() % (SELF_CHECK_MAX_OFFSET + 1);
+    int off_dst = rand() % (SELF_CHECK_MAX_OFFSET + 1);
+    float *a = sc_a + off_a;
+    float *b = sc_b + off_b;
+    float *ref = sc_ref + off_dst;
+    float *test = sc_test + off_dst;
+    float amp = 2.0f * (float)rand() / (float)RAND_MAX;
+    int fails = 0;
+
+    self_check_fill(sc_a, SELF_CHECK_BUF_LEN);
+    self_check_fill(sc_b, SELF_CHECK_BUF_LEN);
+
+#define CMP_FLOATS(kernel) fails += self_check_cmp(k, kernel, sc_test, sc_ref, sizeof(sc_ref), len, off_a, off_b, off_dst)
+
+    self_check_reset_outputs();
+    s->add(ref, b, len);
+    k->add(test, b, len);
+    CMP_FLOATS("add");
+
+    self_check_reset_outputs();
+    s->add_to(a, b, ref, len);
+    k->add_to(a, b, test, len);
+    CMP_FLOATS("add_to");
+
+    self_check_reset_outputs();
+    s->mult(ref, b, len);
+    k->mult(test, b, len);
+    CMP_FLOATS("mult");
+
+    self_check_reset_outputs();
+    s->mult_to(a, b, ref, len);
+    k->mult_to(a, b, test, len);
+    CMP_FLOATS("mult_to");
+
+    self_check_reset_outputs();
+    s->mult_const(ref, amp, len);
+    k->mult_const(test, amp, len);
+    CMP_FLOATS("mult_const");
+
+    self_check_reset_outputs();
+    s->xfade(ref, b, len);
+    k->xfade(test, b, len);
+    CMP_FLOATS("xfade");
+
+    self_check_reset_outputs();
+    s->mix_in(ref, b, amp, len);
+    k->mix_in(test, b, amp, len);
+    CMP_FLOATS("mix_in");
+
+    self_check_reset_outputs();
+    s->interleave(a, b, ref, len);
+    k->interleave(a, b, test, len);
+    CMP_FLOATS("interleave");
+
+    for (int i=0; i<SELF_CHECK_BUF_LEN; i++) {
+	sc_i16[i] = rand();
+    }
+    for (int stride=1; stride<=2; stride++) {
+	self_check_reset_outputs();
+	s->from_int16(sc_i16 + off_a, stride, ref, len);
+	k->from_int16(sc_i16 + off_a, stride, test, len);
+	CMP_FLOATS(stride == 1 ? "from_int16" : "from_int16 (stride 2)");
+    }
+
+#undef CMP_FLOATS
+
+    self_check_reset_outputs();
+    s->to_int16_interleaved(a, b, sc_ref_i16 + off_dst, len);
+    k->to_int16_interleaved(a, b, sc_test_i16 + off_dst, len);
+    fails += self_check_cmp(k, "to_int16_interleaved", sc_test_i16, sc_ref_i16, sizeof(sc_ref_i16), len, off_a, off_b, off_dst);
+
+    /* 24-bit export scale, and a small one with some samples scaled to exactly halfway between
+       integers, where the vector conversions must round to even as lrintf does */
+    static const float int32_scales[] = {8388607.0f, 2.0f};
+    for (int i=0; i<len; i+=3) {
+	a[i] = (float)(i % 5 - 2) * 0.25f;
+    }
+    for (int i=0; i<sizeof(int32_scales) / sizeof(float); i++) {
+	self_check_reset_outputs();
+	s->to_int32_interleaved(a, b, sc_ref_i32 + off_dst, int32_scales[i], len);
+	k->to_int32_interleaved(a, b, sc_test_i32 + off_dst, int32_scales[i], len);
+	fails += self_check_cmp(k, "to_int32_interleaved", sc_test_i32, sc_ref_i32, sizeof(sc_ref_i32), len, off_a, off_b, off_dst);
+    }
+
+    float sum_ref = s->abs_sum(a, len);
+    float sum_test = k->abs_sum(a, len);
+    if (fabsf(sum_test - sum_ref) > len * FLT_EPSILON * sum_ref) {
+	fprintf(stderr, "DSP kernels self-check: %s abs_sum %f differs from scalar %f (len %d, offset %d)\n", k->name, sum_test, sum_ref, len, off_a);
+	fails++;
+    }
+    return fails;
+}
+
+int dsp_kernels_self_check()
+{
+    const DSPKernels *available[MAX_DSP_KERNEL_TABLES];
+    int num_available = dsp_kernels_available(available);
+    int fails = 0;
+    for (int t=1; t<num_available; t++) {
+	for (int i=0; i<sizeof(self_check_lens) / sizeof(int); i++) {
+	    /* Twice per length, for different offsets */
+	    fails += self_check_table(available[t], self_check_lens[i]);
+	    fails += self_check_table(available[t], self_check_lens[i]);
+	}
+    }
+    return fails;
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    dsp_kernels.h
+
+    * vectorized implementations of the buffer arithmetic in dsp_utils.h
+    * one table of kernels per instruction set (scalar, SSE2, AVX2, NEON); dsp_kernels_init picks the
+      best one the CPU supports at startup. Before that, and on other architectures, the scalar table
+      is used.
+    * element-wise kernels give results identical to the scalar reference. Sums (float_buf_abs_sum)
+      are accumulated in a different order, and may differ from the scalar sum by rounding.
+    * set JACKDAW_DSP_KERNELS=scalar|sse2|avx2|neon in the environment to force a table (if supported)
+    * test builds check all supported tables against the scalar one at startup (dsp_kernels_self_check)
+*****************************************************************************************************************/
+
+#ifndef JDAW_DSP_KERNELS_H
+#define JDAW_DSP_KERNELS_H
+
+#include <stdint.h>
+
+typedef struct dsp_kernels {
+    const char *name;
+    void (*add)(float *restrict a, float *restrict b, int len);
+    void (*add_to)(float *restrict a, float *restrict b, float *restrict sum, int len);
+    void (*mult)(float *restrict a, float *restrict b, int len);
+    void (*mult_to)(float *restrict a, float *restrict b, float *restrict product, int len);
+    void (*mult_const)(float *restrict a, float by, int len);
+    void (*xfade)(float *restrict dst, float *restrict from, int len);
+    void (*mix_in)(float *restrict dst, float *restrict from, float amp, int len);
+    float (*abs_sum)(const float *restrict a, int len);
+    void (*to_int16_interleaved)(const float *restrict L, const float *restrict R, int16_t *restrict dst, int len);
+    void (*to_int32_interleaved)(const float *restrict L, const float *restrict R, int32_t *restrict dst, float scale, int len);
+    void (*interleave)(const float *restrict L, const float *restrict R, float *restrict dst, int len);
+    void (*from_int16)(const int16_t *restrict src, int src_stride, float *restrict dst, int len);
+} DSPKernels;
+
+/* The active table; only modified by dsp_kernels_init */
+extern DSPKernels dsp_kernels;
+
+/* Scalar reference implementations */
+extern const DSPKernels dsp_kernels_scalar;
+
+/* Select kernels by CPU feature detection. Called by init_dsp, before audio threads start. */
+void dsp_kernels_init();
+
+#ifdef TESTBUILD
+/* Run every table the CPU supports against the scalar reference on random input, at odd lengths
+   and unaligned offsets. Mismatches are reported to stderr; returns the number found.
+   Run by dsp_kernels_init in test builds. */
+int dsp_kernels_self_check();
+#endif
+
+#endif
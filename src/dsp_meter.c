@@ -0,0 +1,177 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    dsp_meter.c
+
+    * see dsp_meter.h
+    * audio threads only add to atomic accumulators; the main thread swaps them out for zero when it
+      publishes, so no interval's time is lost or counted twice
+    * the peak chunk load is kept in hundredths of a percent, so that it can be maxed with a
+      compare-exchange loop on an integer
+ *****************************************************************************************************************/
+
+#include <pthread.h>
+#include <time.h>
+#include "api.h"
+#include "dsp_meter.h"
+#include "effect.h"
+#include "project.h"
+
+static atomic_bool measuring = false;
+static _Atomic int64_t dsp_proc_nsec = 0;
+static _Atomic int64_t dsp_sframes = 0;
+static _Atomic int64_t dsp_sample_rate = 0;
+static atomic_int peak_centipercent = 0;
+static _Atomic uint32_t xruns = 0;
+static _Atomic uint32_t overloads = 0;
+
+static int64_t last_publish_msec = 0;
+
+int64_t dsp_meter_now_nsec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void read_only_endpoint_init(Endpoint *ep, void *val, ValType t, const char *local_id, const char *display_name, APINode *node)
+{
+    endpoint_init(
+	ep,
+	val,
+	t,
+	local_id,
+	display_name,
+	JDAW_THREAD_MAIN,
+	NULL, NULL, NULL,
+	NULL, NULL, NULL, NULL);
+    ep->read_only = true;
+    ep->automatable = false;
+    ep->do_not_serialize = true;
+    api_endpoint_register(ep, node);
+}
+
+void dsp_stats_init(DSPStats *stats, APINode *api_root)
+{
+    read_only_endpoint_init(&stats->load_ep, &stats->load, JDAW_FLOAT, "dsp_load", "DSP load", api_root);
+    read_only_endpoint_init(&stats->peak_ep, &stats->peak, JDAW_FLOAT, "dsp_peak", "DSP peak", api_root);
+    read_only_endpoint_init(&stats->xruns_ep, &stats->xruns, JDAW_INT, "dsp_xruns", "Xruns", api_root);
+    read_only_endpoint_init(&stats->overloads_ep, &stats->overloads, JDAW_INT, "dsp_overloads", "DSP overloads", api_root);
+}
+
+void dsp_meter_init(DSPMeter *m, APINode *node)
+{
+    atomic_store(&m->proc_nsec, 0);
+    m->load = 0.0f;
+    read_only_endpoint_init(&m->load_ep, &m->load, JDAW_FLOAT, "cpu_load", "CPU load", node);
+}
+
+
+/*------ audio side ----------------------------------------*/
+
+void dsp_meter_begin_measuring()
+{
+    atomic_store(&measuring, true);
+}
+
+void dsp_meter_end_measuring()
+{
+    atomic_store(&measuring, false);
+}
+
+bool dsp_meter_measuring()
+{
+    return atomic_load_explicit(&measuring, memory_order_relaxed);
+}
+
+void dsp_meter_add(DSPMeter *m, int64_t nsec)
+{
+    atomic_fetch_add_explicit(&m->proc_nsec, nsec, memory_order_relaxed);
+}
+
+void dsp_meter_chunk_done(int64_t proc_nsec, int len_sframes, int sample_rate)
+{
+    atomic_fetch_add_explicit(&dsp_proc_nsec, proc_nsec, memory_order_relaxed);
+    atomic_fetch_add_explicit(&dsp_sframes, len_sframes, memory_order_relaxed);
+    atomic_store_explicit(&dsp_sample_rate, sample_rate, memory_order_relaxed);
+
+    int64_t deadline_nsec = (int64_t)len_sframes * 1000000000 / sample_rate;
+    if (deadline_nsec <= 0) return;
+    if (proc_nsec > deadline_nsec) {
+	atomic_fetch_add_explicit(&overloads, 1, memory_order_relaxed);
+    }
+    int chunk_centipercent = proc_nsec * 10000 / deadline_nsec;
+    int peak = atomic_load_explicit(&peak_centipercent, memory_order_relaxed);
+    while (chunk_centipercent > peak && !atomic_compare_exchange_weak_explicit(&peak_centipercent, &peak, chunk_centipercent, memory_order_relaxed, memory_order_relaxed)) {}
+}
+
+void dsp_meter_xrun()
+{
+    atomic_fetch_add_explicit(&xruns, 1, memory_order_relaxed);
+}
+
+
+/*------ main thread ---------------------------------------*/
+
+/* Published values are read by the API server thread through endpoint_safe_read */
+static void publish_float(Endpoint *ep, float *dst, float val)
+{
+    pthread_mutex_lock(&ep->val_lock);
+    *dst = val;
+    pthread_mutex_unlock(&ep->val_lock);
+}
+
+static void publish_int(Endpoint *ep, int *dst, int val)
+{
+    pthread_mutex_lock(&ep->val_lock);
+    *dst = val;
+    pthread_mutex_unlock(&ep->val_lock);
+}
+
+static void meter_publish(DSPMeter *m, double audio_nsec)
+{
+    int64_t nsec = atomic_exchange_explicit(&m->proc_nsec, 0, memory_order_relaxed);
+    float load = audio_nsec > 0.0 ? 100.0 * nsec / audio_nsec : 0.0f;
+    publish_float(&m->load_ep, &m->load, load);
+}
+
+bool dsp_meter_publish(DSPStats *stats, Timeline *tl)
+{
+    int64_t now = dsp_meter_now_nsec() / 1000000;
+    if (now - last_publish_msec < DSP_METER_PUBLISH_MSEC) return false;
+    last_publish_msec = now;
+
+    int64_t sframes = atomic_exchange_explicit(&dsp_sframes, 0, memory_order_relaxed);
+    bool running = dsp_meter_measuring();
+    /* Stopped, and zeros already published */
+    if (sframes == 0 && !running && stats->load == 0.0f && stats->peak == 0.0f) return false;
+
+    int64_t proc_nsec = atomic_exchange_explicit(&dsp_proc_nsec, 0, memory_order_relaxed);
+    int peak = atomic_exchange_explicit(&peak_centipercent, 0, memory_order_relaxed);
+    int64_t sample_rate = atomic_load_explicit(&dsp_sample_rate, memory_order_relaxed);
+    double audio_nsec = sframes > 0 && sample_rate > 0 ? (double)sframes * 1e9 / sample_rate : 0.0;
+
+    publish_float(&stats->load_ep, &stats->load, audio_nsec > 0.0 ? 100.0 * proc_nsec / audio_nsec : 0.0f);
+    publish_float(&stats->peak_ep, &stats->peak, peak / 100.0f);
+    publish_int(&stats->xruns_ep, &stats->xruns, atomic_load_explicit(&xruns, memory_order_relaxed));
+    publish_int(&stats->overloads_ep, &stats->overloads, atomic_load_explicit(&overloads, memory_order_relaxed));
+
+    for (int i=0; i<tl->num_tracks; i++) {
+	Track *track = tl->tracks[i];
+	meter_publish(&track->dsp_meter, audio_nsec);
+	/* Effects are only added and removed on the main thread */
+	EffectChain *ec = &track->effect_chain;
+	for (int j=0; j<ec->num_effects; j++) {
+	    meter_publish(&ec->effects[j]->dsp_meter, audio_nsec);
+	}
+    }
+    return true;
+}
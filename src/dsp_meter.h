@@ -0,0 +1,85 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    dsp_meter.h
+
+    * how much of the real-time budget audio processing uses, for the status bar, the API, and the
+      optional meters on track rows
+    * the DSP thread times each chunk it renders, excluding time spent waiting for the playback
+      callback to free space in the ring buffer. A chunk that takes longer than the audio it produces
+      is an overload. The playback callback counts underruns (xruns): callbacks that found no rendered
+      audio ready and played silence instead.
+    * tracks and effects accumulate their own processing time from whichever audio thread renders
+      them (the DSP thread or a mixdown worker)
+    * loads are percentages: processing time over the duration of the audio processed in the same
+      interval. The main thread publishes them every DSP_METER_PUBLISH_MSEC while the DSP thread runs.
+    * published values are exposed as read-only API endpoints: "dsp_load", "dsp_peak", "dsp_xruns" and
+      "dsp_overloads" at the API root, and "cpu_load" on each track and effect. Send the route with no
+      value to query one.
+*****************************************************************************************************************/
+
+#ifndef JDAW_DSP_METER_H
+#define JDAW_DSP_METER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "endpoint.h"
+
+#define DSP_METER_PUBLISH_MSEC 500
+
+typedef struct timeline Timeline;
+
+/* Per track or effect */
+typedef struct dsp_meter {
+    _Atomic int64_t proc_nsec; /* Accumulated by audio threads */
+    float load; /* Main thread; last published value */
+    Endpoint load_ep;
+} DSPMeter;
+
+/* Whole-session; published by the main thread */
+typedef struct dsp_stats {
+    float load;
+    float peak; /* Worst single chunk in the last interval */
+    int xruns;
+    int overloads;
+    Endpoint load_ep;
+    Endpoint peak_ep;
+    Endpoint xruns_ep;
+    Endpoint overloads_ep;
+    bool show_track_meters;
+} DSPStats;
+
+/* Main thread */
+void dsp_stats_init(DSPStats *stats, APINode *api_root);
+void dsp_meter_init(DSPMeter *m, APINode *node);
+
+/* DSP thread; bracket the thread's run */
+void dsp_meter_begin_measuring();
+void dsp_meter_end_measuring();
+
+/* Audio threads. Timing is skipped unless the DSP thread is running, so that offline renders
+   (export, track freeze) don't count. */
+bool dsp_meter_measuring();
+int64_t dsp_meter_now_nsec();
+void dsp_meter_add(DSPMeter *m, int64_t nsec);
+
+/* DSP thread; one call per rendered chunk */
+void dsp_meter_chunk_done(int64_t proc_nsec, int len_sframes, int sample_rate);
+
+/* Playback thread */
+void dsp_meter_xrun();
+
+/* Main thread; call once per frame. Publishes if the interval has elapsed. Returns true if values
+   changed. */
+bool dsp_meter_publish(DSPStats *stats, Timeline *tl);
+
+#endif
@@ -8,229 +8,101 @@
 
 *****************************************************************************************************************/
 
+#include <math.h>
 #include <stdlib.h>
 #include "consts.h"
+#include "dsp_kernels.h"
 #include "dsp_utils.h"
+#include "fft.h"
 /* #include "endpoint_callbacks.h" */
 #include "session.h"
 
 
-#define ROU_MAX_DEGREE 14
-double complex *roots_of_unity[ROU_MAX_DEGREE];
-
-
 /*****************************************************************************************************************
     Buffer arithmetic
  *****************************************************************************************************************/
 
-
-static void init_roots_of_unity();
-
 void init_dsp()
 {
-    init_roots_of_unity();
+    dsp_kernels_init();
+    init_fft();
 }
 
 void float_buf_add(float *restrict a, float *restrict b, int len)
 {
-    for (int i=0; i<len; i++) {
-	a[i] += b[i];
-    }
+    dsp_kernels.add(a, b, len);
 }
 
 void float_buf_add_to(float *restrict a, float *restrict b, float *restrict sum, int len)
 {
-    for (int i=0; i<len; i++) {
-	sum[i] = a[i] + b[i];
-    }
+    dsp_kernels.add_to(a, b, sum, len);
 }
 
 void float_buf_mult(float *restrict a, float *restrict b, int len)
 {
-    for (int i=0; i<len; i++) {
-	a[i] *= b[i];
-    }    
+    dsp_kernels.mult(a, b, len);
 }
 
 void float_buf_mult_to(float *restrict a, float *restrict b, float *restrict product, int len)
 {
-    for (int i=0; i<len; i++) {
-	product[i] = a[i] * b[i];
-    }        
+    dsp_kernels.mult_to(a, b, product, len);
 }
+
 void float_buf_mult_const(float *restrict a, float by, int len)
 {
-    for (int i=0; i<len; i++) {
-	a[i] *= by;
-    }
+    dsp_kernels.mult_const(a, by, len);
 }
 
 void float_buf_xfade(float *restrict dst, float *restrict from, int len)
 {
-    for (int i=0; i<len; i++) {
-	/* fprintf(stderr, "\ti: %d %f vs %f\n", i, dst[i], from[i]); */
-	float prop = (float)i/len;
-	dst[i] = prop * dst[i] + (1 - prop) * from[i];
-    }
+    dsp_kernels.xfade(dst, from, len);
 }
 
 void float_buf_mix_in(float *restrict dst, float *restrict from, float amp, int len)
 {
-    for (int i=0; i<len; i++) {
-	dst[i] += from[i] * amp;
-    }
-}
-
-
-
-/*****************************************************************************************************************
-    FFT and helper functions
- *****************************************************************************************************************/
-
-/* 6.283185 */
-static double complex *gen_FFT_X(int n)
-{
-    double complex *X = (double complex *)malloc(sizeof(double complex) * n);
-    for (int i=0; i<n; i++) {
-	double theta = TAU * i / n;
-        X[i] = cos(theta) + I * sin(theta);
-    }
-    return X;
-}
-
-/* Generate the roots of unity to be used in FFT evaluation */
-static void init_roots_of_unity()
-{
-    for (uint8_t i=0; i<ROU_MAX_DEGREE; i++) {
-        roots_of_unity[i] = gen_FFT_X(pow(2, i));
-    }
-}
-
-
-static void FFT_inner(double *restrict A, double complex *restrict B, int n, int offset, int increment)
-{
-    if (n==1) {
-        B[0] = A[offset] + 0 * I;
-        return;
-    }
-
-    int halfn = n>>1;
-    int degree = log2(n);
-    double complex *X = roots_of_unity[degree];
-    int doubleinc = increment << 1;
-    double complex Beven[halfn];
-    double complex Bodd[halfn];
-    FFT_inner(A, Beven, halfn, offset, doubleinc);
-    FFT_inner(A, Bodd, halfn, offset + increment, doubleinc);
-    for (int k=0; k<halfn; k++) {
-        double complex odd_part_by_x = Bodd[k] * conj(X[k]);
-        B[k] = Beven[k] + odd_part_by_x;
-        B[k + halfn] = Beven[k] - odd_part_by_x;
-    }
+    dsp_kernels.mix_in(dst, from, amp, len);
 }
 
-void FFT(double *restrict A, double complex *restrict B, int n)
+float float_buf_abs_sum(const float *restrict a, int len)
 {
-
-    FFT_inner(A, B, n, 0, 1);
-
-    for (int k=0; k<n; k++) {
-        B[k]/=n;
-    }
+    return dsp_kernels.abs_sum(a, len);
 }
 
-static void FFT_innerf(float *restrict A, double complex *restrict B, int n, int offset, int increment)
+void float_buf_to_int16_interleaved(const float *restrict L, const float *restrict R, int16_t *restrict dst, int len)
 {
-    if (n==1) {
-        B[0] = A[offset] + 0 * I;
-        return;
-    }
-
-    int halfn = n>>1;
-    int degree = log2(n);
-    double complex *X = roots_of_unity[degree];
-    int doubleinc = increment << 1;
-    double complex Beven[halfn];
-    double complex Bodd[halfn];
-    FFT_innerf(A, Beven, halfn, offset, doubleinc);
-    FFT_innerf(A, Bodd, halfn, offset + increment, doubleinc);
-    for (int k=0; k<halfn; k++) {
-        double complex odd_part_by_x = Bodd[k] * conj(X[k]);
-        B[k] = Beven[k] + odd_part_by_x;
-        B[k + halfn] = Beven[k] - odd_part_by_x;
-    }
+    dsp_kernels.to_int16_interleaved(L, R, dst, len);
 }
 
-
-void FFTf(float *restrict A, double complex *restrict B, int n)
+void float_buf_to_int32_interleaved(const float *restrict L, const float *restrict R, int32_t *restrict dst, float scale, int len)
 {
-    FFT_innerf(A, B, n, 0, 1);
-
-    for (int k=0; k<n; k++) {
-        B[k]/=n;
-    }
+    dsp_kernels.to_int32_interleaved(L, R, dst, scale, len);
 }
 
-
-/* I'm not sure why using an "unscaled" version of the FFT appears to work when getting the frequency response
-for the FIR filters defined below (e.g. "bandpass_IR()"). The normal, scaled version produces values that are
-too small. */
-void FFT_unscaled(double *restrict A, double complex *restrict B, int n) 
+void float_buf_interleave(const float *restrict L, const float *restrict R, float *restrict dst, int len)
 {
-    FFT_inner(A, B, n, 0, 1);
+    dsp_kernels.interleave(L, R, dst, len);
 }
 
-static double complex *IFFT_inner(double complex *restrict A, double complex *restrict B, int n, int offset, int increment)
+void int16_buf_to_float(const int16_t *restrict src, int src_stride, float *restrict dst, int len)
 {
-    /* double complex *B = (double complex *)malloc(sizeof(double complex) * n); */
-
-    if (n==1) {
-        B[0] = A[offset];
-        return B;
-    }
-    int halfn = n>>1;
-    int degree = log2(n);
-    double complex *X = roots_of_unity[degree];
-    int doubleinc = increment << 1;
-    double complex Beven[halfn];
-    IFFT_inner(A, Beven, halfn, offset, doubleinc);
-    double complex Bodd[halfn];
-    IFFT_inner(A, Bodd, halfn, offset + increment, doubleinc);
-    for (int k=0; k<halfn; k++) {
-        double complex odd_part_by_x = Bodd[k] * X[k];
-        B[k] = Beven[k] + odd_part_by_x;
-        B[k + halfn] = Beven[k] - odd_part_by_x;
-    }
-    return B;
-
+    dsp_kernels.from_int16(src, src_stride, dst, len);
 }
 
-void IFFT(double complex *restrict A, double complex *restrict B, int n)
-{
-    IFFT_inner(A, B, n, 0, 1);
-}
 
 
-void get_magnitude(double complex *restrict A, double *restrict B, int len) 
-{
-    for (int i=0; i<len; i++) {
-        B[i] = cabs(A[i]);
-    }
-}
+/*****************************************************************************************************************
+    Windowing and frequency scaling (FFT in fft.c)
+ *****************************************************************************************************************/
 
-void get_real_component(double complex *restrict A, double *restrict B, int len)
+int32_t feedback_tail_len_sframes(double coeff, int32_t period_sframes)
 {
-    for (int i=0; i<len; i++) {
-        B[i] = creal(A[i]);
-    }
+    coeff = fabs(coeff);
+    if (coeff < CMP_EPSILON_DOUBLE) return period_sframes;
+    if (coeff >= 1.0) return INT32_MAX;
+    double passes = ceil(log(EFFECT_TAIL_FLOOR) / log(coeff)) + 1.0;
+    double len = passes * period_sframes;
+    return len > INT32_MAX ? INT32_MAX : (int32_t)len;
 }
-void get_real_componentf(double complex *restrict A, float *restrict B, int len)
-{
-    for (int i=0; i<len; i++) {
-        B[i] = creal(A[i]);
-    }
-}
-
 
 /* Hamming window function */
 double hamming(int x, int lenw)
@@ -11,8 +11,7 @@
 /*****************************************************************************************************************
     dsp_utils.h
 
-    * Fast Fourier Transform (FFT) implementation for float and double
-    * Buffer-wise arithmetic
+    * Buffer-wise arithmetic (vectorized; see dsp_kernels.h)
     * Window function(s)
 *****************************************************************************************************************/
 
@@ -24,17 +23,9 @@
 #include <stdio.h>
 #include <stdint.h>
 
-/* Initialize the dsp subsystem. All this does currently is to populate the nth roots of unity for n < ROU_MAX_DEGREE */
+/* Initialize the dsp subsystem: select buffer kernels for this CPU (see dsp_kernels.h) and build FFT plans (see fft.h) */
 void init_dsp();
 
-
-void FFT(double *restrict A, double complex *restrict B, int n);
-void FFT_unscaled(double *restrict A, double complex *restrict B, int n);
-void IFFT(double complex *restrict A, double complex *restrict B, int n);
-void FFTf(float *restrict A, double complex *restrict B, int n);
-void get_real_component(double complex *restrict A, double *restrict B, int n);
-void get_real_componentf(double complex *restrict A, float *restrict B, int len);
-void get_magnitude(double complex *restrict A, double *restrict B, int len);
 double hamming(int x, int lenw);
 
 /* Input range 0:1. Return frequency in Hz from 1 - Nyquist */
@@ -67,6 +58,25 @@ void float_buf_xfade(float *restrict dst, float *restrict from, int len);
 /* Mix some of "from" into "dst" */
 void float_buf_mix_in(float *restrict dst, float *restrict from, float amp, int len);
 
+/* Sum of absolute values */
+float float_buf_abs_sum(const float *restrict a, int len);
+
+/* Clip to [-1, 1] and convert to interleaved 16-bit stereo (2 * len samples) */
+void float_buf_to_int16_interleaved(const float *restrict L, const float *restrict R, int16_t *restrict dst, int len);
+
+/* Clip to [-1, 1], multiply by scale, and round to nearest; interleaved stereo (2 * len samples) */
+void float_buf_to_int32_interleaved(const float *restrict L, const float *restrict R, int32_t *restrict dst, float scale, int len);
+
+/* Interleave two float channels without conversion (2 * len samples) */
+void float_buf_interleave(const float *restrict L, const float *restrict R, float *restrict dst, int len);
+
+/* Convert len 16-bit samples, src_stride apart, to float */
+void int16_buf_to_float(const int16_t *restrict src, int src_stride, float *restrict dst, int len);
+
+/* Length of the tail of a recirculating delay (period_sframes long, feedback gain "coeff")
+   before it decays below EFFECT_TAIL_FLOOR. INT32_MAX if it never does. */
+int32_t feedback_tail_len_sframes(double coeff, int32_t period_sframes);
+
 /* Convert a linear pan parameter value into a multiplier, depending on channel */
 float pan_scale(float pan, int channel);
 
@@ -291,6 +291,8 @@ Effect *effect_chain_add_effect(EffectChain *ec, EffectType type)
 	int ir_len = ec->chunk_len_sframes;
 	filter_init(e->obj, LOWPASS, ir_len, ec->proj->fourier_len_sframes * 2, ec->chunk_len_sframes);
 	e->buf_apply = filter_buf_apply_stereo;
+	/* Long IRs ring out after the input stops; the convolver skips blocks once the tail is silent */
+	e->operate_on_empty_buf = true;
     }
 	break;
     case EFFECT_DELAY:
@@ -305,6 +307,7 @@ Effect *effect_chain_add_effect(EffectChain *ec, EffectType type)
 	((Saturation *)e->obj)->effect = e;
 	saturation_init(e->obj);
 	e->buf_apply = saturation_buf_apply_stereo;
+	e->operate_on_empty_buf = true; /* Oversampling filters hold a few samples */
 	break;
     case EFFECT_COMPRESSOR:
 	e->obj = calloc(1, sizeof(Compressor));
@@ -358,7 +361,8 @@ Effect *effect_chain_add_effect(EffectChain *ec, EffectType type)
 	JDAW_THREAD_MAIN,
 	page_el_gui_cb, NULL, NULL,
 	NULL, NULL, &e->page, "ch_mode_dropdown");
-    
+
+    dsp_meter_init(&e->dsp_meter, &e->api_node);
 
     user_event_push(
 	undo_add_effect, redo_add_effect,
@@ -497,6 +501,53 @@ static void mid_side_decode(float *restrict buf_L, float *restrict buf_R, int32_
 
 static void effect_silence(Effect *e);
 
+/* Sample frames for which an effect's output may be nonzero after its input goes silent */
+static int32_t effect_tail_len_sframes(Effect *e)
+{
+    switch(e->type) {
+    case EFFECT_FIR_FILTER:
+	return filter_tail_len_sframes(e->obj);
+    case EFFECT_DELAY:
+	return delay_line_tail_len_sframes(e->obj);
+    case EFFECT_COMPRESSOR:
+	return compressor_tail_len_sframes(e->obj);
+    case EFFECT_REVERB:
+	return schroeder_tail_len_sframes(e->obj);
+    case EFFECT_SATURATION:
+	return 2 * saturation_latency_sframes(e->obj);
+    default:
+	return 0;
+    }
+}
+
+int32_t effect_latency_sframes(Effect *e)
+{
+    switch(e->type) {
+    case EFFECT_FIR_FILTER:
+	return filter_latency_sframes(e->obj);
+    case EFFECT_PITCH_SHIFTER:
+	return pitch_shifter_latency_sframes(e->obj);
+    case EFFECT_VIBRATO:
+	return vibrato_latency_sframes(e->obj);
+    case EFFECT_SATURATION:
+	return saturation_latency_sframes(e->obj);
+    case EFFECT_COMPRESSOR:
+	return compressor_latency_sframes(e->obj);
+    default:
+	return 0;
+    }
+}
+
+int32_t effect_chain_latency_sframes(EffectChain *ec)
+{
+    int32_t latency = 0;
+    for (int i=0; i<ec->num_effects; i++) {
+	Effect *e = ec->effects[i];
+	if (e->active) latency += effect_latency_sframes(e);
+    }
+    return latency;
+}
+
 float effect_chain_buf_apply(EffectChain *ec, float *restrict L, float *restrict R, int len, float input_amp)
 {
     static float amp_epsilon = 1e-7f;
@@ -510,12 +561,21 @@ float effect_chain_buf_apply(EffectChain *ec, float *restrict L, float *restrict
 	return running_amp;
 	
     }
+    bool measure = dsp_meter_measuring();
     pthread_mutex_lock(&ec->effect_chain_lock);
     for (int i=0; i<ec->num_effects; i++) {
 	Effect *e = ec->effects[i];
 	bool running_amp_nonzero = fabs(running_amp) > amp_epsilon;
-	if (e->active && (e->operate_on_empty_buf || running_amp_nonzero)) {
+	bool in_tail = false;
+	if (running_amp_nonzero) {
+	    e->silent_input_sframes = 0;
+	} else if (e->operate_on_empty_buf && e->has_proc_state) {
+	    in_tail = e->silent_input_sframes < effect_tail_len_sframes(e);
+	    if (e->silent_input_sframes < INT32_MAX - len) e->silent_input_sframes += len;
+	}
+	if (e->active && (running_amp_nonzero || in_tail)) {
 	    e->has_proc_state = true;
+	    int64_t start_nsec = measure ? dsp_meter_now_nsec() : 0;
 	    if (!ec->mid_side_encoded && EFFECT_CH_MODE_DO_ENCODE(e->channel_mode)) {
 		mid_side_encode(L, R, len);
 		ec->mid_side_encoded = true;
@@ -530,6 +590,7 @@ float effect_chain_buf_apply(EffectChain *ec, float *restrict L, float *restrict
 	    } else {
 		running_amp = effect_buf_apply(e, L, R, len, running_amp);
 	    }
+	    if (measure) dsp_meter_add(&e->dsp_meter, dsp_meter_now_nsec() - start_nsec);
 	} else if (e->active && !running_amp_nonzero && e->has_proc_state) {
 	    effect_silence(e);
 	}
@@ -548,9 +609,15 @@ static void effect_silence(Effect *e)
     case EFFECT_EQ:
 	eq_clear(e->obj);
 	break;
+    case EFFECT_FIR_FILTER:
+	filter_clear(e->obj);
+	break;
     case EFFECT_DELAY:
 	delay_line_clear(e->obj);
 	break;
+    case EFFECT_COMPRESSOR:
+	compressor_clear(e->obj);
+	break;
     case EFFECT_REVERB:
 	schroeder_clear(e->obj);
 	break;
@@ -560,12 +627,30 @@ static void effect_silence(Effect *e)
     case EFFECT_VIBRATO:
 	vibrato_clear(e->obj);
 	break;
+    case EFFECT_SATURATION:
+	saturation_clear(e->obj);
+	break;
     default:
 	break;
     }
     e->has_proc_state = false;
 }
 
+bool effect_chain_is_idle(EffectChain *ec)
+{
+    bool idle = true;
+    pthread_mutex_lock(&ec->effect_chain_lock);
+    for (int i=0; i<ec->num_effects; i++) {
+	Effect *e = ec->effects[i];
+	if (e->active && e->has_proc_state) {
+	    idle = false;
+	    break;
+	}
+    }
+    pthread_mutex_unlock(&ec->effect_chain_lock);
+    return idle;
+}
+
 void effect_chain_silence(EffectChain *ec)
 {
     for (int i=0; i<ec->num_effects; i++) {
@@ -21,6 +21,7 @@
 
 #include "api.h"
 #include "compressor.h"
+#include "dsp_meter.h"
 #include "eq.h"
 #include "saturation.h"
 
@@ -73,6 +74,9 @@ typedef struct effect {
     APINode api_node;
     /* effect not silenced */
     bool has_proc_state;
+    /* Sample frames of silent input since the last nonzero block (DSP thread) */
+    int32_t silent_input_sframes;
+    DSPMeter dsp_meter;
 } Effect;
 
 typedef struct effect_chain {
@@ -104,7 +108,20 @@ Effect *track_add_effect(Track *t, EffectType type);
 /* Creates modal to select effect type before adding. obj_name used in modal header */
 void effect_add(EffectChain *ec, const char *obj_name);
 
+/* Effects that operate on empty buffers are run on silent input only until their tail (see
+   effect_tail_len_sframes) has elapsed; they are then silenced and skipped until input returns. */
 float effect_chain_buf_apply(EffectChain *ec, float *restrict L, float *restrict R, int len, float input_amp);
+
+/* True if no active effect has state left to ring out, i.e. silent input will produce silent output
+   and effect_chain_buf_apply can be skipped */
+bool effect_chain_is_idle(EffectChain *ec);
+
+/* Delay, in sample frames, between an effect's input and the corresponding output. Effects
+   that add latency report it here, so that it can be compensated (see delay_comp.h). */
+int32_t effect_latency_sframes(Effect *e);
+
+/* Sum over active effects. Main thread. */
+int32_t effect_chain_latency_sframes(EffectChain *ec);
 void effect_chain_silence(EffectChain *ec);
 void effect_delete(Effect *e, bool from_undo);
 void effect_destroy(Effect *e);
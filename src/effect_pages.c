@@ -464,7 +464,7 @@ static Page *add_fir_filter_page(FIRFilter *f, EffectChain *ec, TabView *tv)
     p.slider_p.ep = &f->impulse_response_len_ep;
 
     p.slider_p.min = (Value){.int_v = 4};
-    p.slider_p.max = (Value){.int_v = session->proj.fourier_len_sframes};
+    p.slider_p.max = (Value){.int_v = FIR_FILTER_MAX_IR_LEN};
     p.slider_p.create_label_fn = NULL;
     el = page_add_el(page, EL_SLIDER, p, "track_settings_filter_irlen_slider",  "irlen_slider");    
     Slider *sl = (Slider *)el->component;
@@ -715,6 +715,19 @@ static Page *add_saturation_page(Saturation *s, EffectChain *ec, TabView *tv)
     el = page_add_el(page, EL_RADIO, p, "track_settings_saturation_type", "type_radio");
     RadioButton *radio = el->component;
     radio_button_reset_from_endpoint(radio);
+
+    static const char *oversample_names[] = {
+	"No oversampling",
+	"2x oversampling",
+	"4x oversampling",
+	"8x oversampling"
+    };
+    p.radio_p.ep = &s->oversample_ep;
+    p.radio_p.item_names = oversample_names;
+    p.radio_p.num_items = HALFBAND_MAX_STAGES + 1;
+    el = page_add_el(page, EL_RADIO, p, "track_settings_saturation_oversample", "oversample_radio");
+    radio = el->component;
+    radio_button_reset_from_endpoint(radio);
     /* radio->selected_item = (uint8_t)0; */
 
 
@@ -748,6 +761,28 @@ static Page *add_compressor_page(Compressor *c, EffectChain *ec, TabView *tv)
     textbox_set_align(tb, CENTER_LEFT);
     textbox_reset_full(tb);
 
+    p.toggle_p.ep = &c->limiter_ep;
+    page_add_el(page, EL_TOGGLE, p, "track_settings_comp_limiter_toggle", "toggle_limiter");
+    p.textbox_p.set_str = "Lookahead limiter";
+    p.textbox_p.font = main_win->mono_bold_font;
+    p.textbox_p.text_size = LABEL_STD_FONT_SIZE;
+    p.textbox_p.win = main_win;
+    tb = (Textbox *)(page_add_el(page, EL_TEXTBOX, p, "", "toggle_limiter_label")->component);
+    textbox_set_background_color(tb, NULL);
+    textbox_set_align(tb, CENTER_LEFT);
+    textbox_reset_full(tb);
+
+    p.toggle_p.ep = &c->stereo_link_ep;
+    page_add_el(page, EL_TOGGLE, p, "track_settings_comp_stereo_link_toggle", "toggle_link");
+    p.textbox_p.set_str = "Stereo link";
+    p.textbox_p.font = main_win->mono_bold_font;
+    p.textbox_p.text_size = LABEL_STD_FONT_SIZE;
+    p.textbox_p.win = main_win;
+    tb = (Textbox *)(page_add_el(page, EL_TEXTBOX, p, "", "toggle_link_label")->component);
+    textbox_set_background_color(tb, NULL);
+    textbox_set_align(tb, CENTER_LEFT);
+    textbox_reset_full(tb);
+
     p.textbox_p.set_str = "Attack time (ms)";
     tb = (Textbox *)(page_add_el(page, EL_TEXTBOX, p, "", "attack_label")->component);
     textbox_set_background_color(tb, NULL);
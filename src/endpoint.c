@@ -54,6 +54,7 @@ int endpoint_init(
     ep->xarg4 = xarg4;
     ep->block_undo = false;
     ep->automatable = true;
+    ep->read_only = false;
     jdaw_val_set_min(&ep->min, t);
     jdaw_val_set_max(&ep->max, t);
 
@@ -97,6 +98,13 @@ void endpoint_set_label_fn(Endpoint *ep, LabelStrFn fn)
     ep->label_fn = fn;
 }
 
+void endpoint_set_block_automation(Endpoint *ep, void *buf, int buf_len)
+{
+    ep->block_vals = buf;
+    ep->block_vals_alloc_len = buf_len;
+    ep->block_vals_len = 0;
+}
+
 /* int enpoint_add_callback(Endpoint *ep, EndptCb fn, enum jdaw_thread thread) */
 /* { */
 /*     if (ep->num_callbacks == MAX_ENDPOINT_CALLBACKS) { */
@@ -228,8 +236,8 @@ int endpoint_write(
 		    dst_thread = JDAW_THREAD_PLAYBACK;
 		}
 		int ret = session_queue_callback(session, ep, ep->dsp_callback, dst_thread);
-		if (ret == 3) {
-		    log_tmp(LOG_ERROR, "Error: call to queue callback for ep \"%s\" could not be deferred.\n", ep->local_id);
+		if (ret == 1) {
+		    log_tmp(LOG_ERROR, "Error: call to queue callback for ep \"%s\" could not be queued.\n", ep->local_id);
 		}
 		async_change_will_occur = true;
 	    /* } else if (session->midi_io.monitor_synth && owner == JDAW_THREAD_PLAYBACK) { */
@@ -125,7 +125,13 @@ typedef struct endpoint {
     Automation *automation;
     LabelStrFn label_fn;
 
+    /* Sample-accurate automation (see endpoint_set_block_automation) */
+    void *block_vals;
+    int block_vals_alloc_len;
+    int block_vals_len;
+
     bool do_not_serialize;
+    bool read_only; /* Set by the program only; API writes are refused (see dsp_meter.h) */
 
     /* API */
     APINode *parent;
@@ -183,6 +189,12 @@ void endpoint_stop_continuous_change(Endpoint *ep);
 
 void endpoint_bind_automation(Endpoint *ep, Automation *a);
 void endpoint_set_label_fn(Endpoint *ep, LabelStrFn fn);
+
+/* Opt in to per-sframe automation values. While the endpoint's automation is read, mixdown fills
+   buf (up to buf_len values of the endpoint's val_type) for each chunk, before the effect chain runs,
+   and sets block_vals_len. The DSP thread consumer uses the values and resets block_vals_len to 0.
+   endpoint_write is still called once per chunk, with the first value. buf is owned by the caller. */
+void endpoint_set_block_automation(Endpoint *ep, void *buf, int buf_len);
 void api_node_set_owner(APINode *node, enum jdaw_thread thread);
 
 #endif
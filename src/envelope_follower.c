@@ -35,3 +35,24 @@ float envelope_follower_sample(EnvelopeFollower *e, float in)
     return out;
 }
 
+void envelope_follower_buf(EnvelopeFollower *e, const float *in, float *out, int len)
+{
+    const float attack = e->attack_coeff;
+    const float release = e->release_coeff;
+    float prev = e->prev_out;
+    for (int i=0; i<len; i++) {
+	float x = fabsf(in[i]);
+	float coeff = x > prev ? attack : release;
+	prev += coeff * (x - prev);
+	out[i] = prev;
+    }
+    e->prev_out = prev;
+}
+
+void envelope_follower_block_peak(EnvelopeFollower *e, float peak, int len)
+{
+    peak = fabsf(peak);
+    double coeff = peak > e->prev_out ? e->attack_coeff : e->release_coeff;
+    /* A one-pole filter with constant input closes (1 - coeff)^len of the gap */
+    e->prev_out = peak + (e->prev_out - peak) * pow(1.0 - coeff, len);
+}
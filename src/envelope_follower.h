@@ -35,5 +35,12 @@ void envelope_follower_set_times(EnvelopeFollower *e, int32_t attack_sframes, in
 void envelope_follower_set_times_msec(EnvelopeFollower *e, double attack_msec, double decay_msec, double sample_rate);
 float envelope_follower_sample(EnvelopeFollower *e, float in);
 
+/* Run over a whole buffer, writing the envelope to out. in and out may be the same buffer */
+void envelope_follower_buf(EnvelopeFollower *e, const float *in, float *out, int len);
+
+/* Advance by len samples as if every input sample were peak. For display meters updated once per
+   block instead of once per sample. */
+void envelope_follower_block_peak(EnvelopeFollower *e, float peak, int len);
+
 
 #endif
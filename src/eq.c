@@ -149,8 +149,7 @@ static void selected_filter_active_cb(Endpoint *ep)
 
 void eq_init(EQ *eq)
 {
-    eq->output_freq_mag_L = calloc(eq->effect->effect_chain->chunk_len_sframes * 2, sizeof(double));
-    eq->output_freq_mag_R = calloc(eq->effect->effect_chain->chunk_len_sframes * 2, sizeof(double));
+    eq->analyzer = spectrum_analyzer_create(2, eq->effect->effect_chain->chunk_len_sframes);
 
     double nsub1 = (double)eq->effect->effect_chain->chunk_len_sframes - 1;
     /* if (session->proj_initialized) { */
@@ -331,8 +330,6 @@ void eq_init(EQ *eq)
 
 void eq_deinit(EQ *eq)
 {
-    free(eq->output_freq_mag_L);
-    free(eq->output_freq_mag_R);
     for (int i=0; i<eq->group.num_filters; i++) {
 	EQFilterCtrl *ctrl = eq->ctrls + i;
 	label_destroy(ctrl->label);
@@ -343,6 +340,7 @@ void eq_deinit(EQ *eq)
     }
     iir_group_deinit(&eq->group);
     if (eq->fp) waveform_destroy_freq_plot(eq->fp);
+    spectrum_analyzer_destroy(eq->analyzer);
     
 }
 
@@ -536,8 +534,8 @@ bool eq_mouse_click(EQ *eq, SDL_Point mousep)
 
 void eq_create_freq_plot(EQ *eq, Layout *container)
 {
-    double *arrs[] = {eq->output_freq_mag_L, eq->output_freq_mag_R};
-    int lens[] = {eq->effect->effect_chain->chunk_len_sframes, eq->effect->effect_chain->chunk_len_sframes};
+    double *arrs[] = {eq->analyzer->mag[0], eq->analyzer->mag[1]};
+    int lens[] = {eq->analyzer->num_bins, eq->analyzer->num_bins};
     /* double *arrs[] = {proj->output_L_freq, proj->output_R_freq}; */
     SDL_Color *fcolors[] = {&colors.freq_L, &colors.freq_R};
 
@@ -550,6 +548,7 @@ void eq_create_freq_plot(EQ *eq, Layout *container)
 	fcolors, NULL,
 	40, (double)eq->effect->effect_chain->proj->sample_rate / 2,
 	container);
+    eq->fp->analyzer = eq->analyzer;
     waveform_reset_freq_plot(eq->fp);
 
     eq->group.fp = eq->fp;
@@ -586,75 +585,42 @@ void eq_destroy_freq_plot(EQ *eq)
     eq->group.fp = NULL;
 }
 
-static double eq_sample(EQ *eq, double in, int channel)
+float eq_buf_apply(void *eq_v, float *restrict buf, int len, int channel, float input_amp)
+{
+    return eq_buf_apply_stereo(eq_v, channel == 0 ? buf : NULL, channel == 0 ? NULL : buf, len, input_amp);
+}
+
+void eq_advance(EQ *eq, int channel)
 {
-    /* if (!eq->active) return in; */
     for (int i=0; i<eq->group.num_filters; i++) {
 	if (eq->ctrls[i].filter_active) {
-	    in = iir_sample(eq->group.filters + i, in, channel);
+	    iir_advance(eq->group.filters + i, channel);
 	}
     }
-    return in;
+
 }
 
-float eq_buf_apply(void *eq_v, float *restrict buf, int len, int channel, float input_amp)
+/* Filters run as a cascade over the whole buffer, both channels at once */
+float eq_buf_apply_stereo(void *eq_v, float *restrict L, float *restrict R, int len, float input_amp)
 {
-    
     static float amp_epsilon = 1e-7f;
     EQ *eq = eq_v;
 
-
-/*    if (!eq->active) {
-	return input_amp;
-	} else */
     if (input_amp < amp_epsilon) {
-	eq_advance(eq, channel);
+	if (L) eq_advance(eq, 0);
+	if (R) eq_advance(eq, 1);
 	return input_amp;
     }
-    float output_amp = 0.0;
-    for (int i=0; i<len; i++) {
-	buf[i] = eq_sample(eq, buf[i], channel);
-	output_amp += fabs(buf[i]);
-    }
-
-    /* IFF Freq Plot is onscreen, reset frequency magnitude spectrum */
-    if (eq->effect->page && eq->effect->page->onscreen) {
-	/* Zero-pad the input */
-	float fft_input[len * 2];
-	memset(fft_input + len, '\0', len * sizeof(float));
-	memcpy(fft_input, buf, len * sizeof(float));
-	/* Apply hamming window to non-zero input,
-	   scaling up to account for amplitude reduction */
-	for (int i=0; i<len; i++) {
-	    fft_input[i] *= HAMMING_SCALAR * hamming(i, len);
-	}
-	double complex freq[len * 2];
-	FFTf(fft_input, freq, len * 2);
-	double *dst = channel == 0 ? eq->output_freq_mag_L : eq->output_freq_mag_R;
-	get_magnitude(freq, dst, len * 2);
-    }
-
-    
-    return output_amp;
-}
-
-void eq_advance(EQ *eq, int channel)
-{
+    bool active[eq->group.num_filters];
     for (int i=0; i<eq->group.num_filters; i++) {
-	if (eq->ctrls[i].filter_active) {
-	    iir_advance(eq->group.filters + i, channel);
-	}
+	active[i] = eq->ctrls[i].filter_active;
     }
+    iir_group_buf_apply_stereo(&eq->group, L, R, len, active);
 
-}
-
-float eq_buf_apply_stereo(void *eq_v, float *restrict L, float *restrict R, int len, float input_amp)
-{
     float output_amp = 0.0f;
-    if (L)
-	output_amp += eq_buf_apply(eq_v, L, len, 0, input_amp);
-    if (R)
-	output_amp += eq_buf_apply(eq_v, R, len, 1, input_amp);
+    if (L) output_amp += float_buf_abs_sum(L, len);
+    if (R) output_amp += float_buf_abs_sum(R, len);
+    spectrum_analyzer_feed(eq->analyzer, L, R, len);
     return output_amp;
 }
 
@@ -21,6 +21,7 @@
 #include "api.h"
 #include "endpoint.h"
 #include "iir.h"
+#include "spectrum_analyzer.h"
 
 
 #define EQ_DEFAULT_NUM_FILTERS 6
@@ -65,8 +66,7 @@ typedef struct eq_filter_ctrl {
 typedef struct eq {
     /* bool active; */
     IIRGroup group;
-    double *output_freq_mag_L;
-    double *output_freq_mag_R;
+    SpectrumAnalyzer *analyzer; /* Output spectrum, for the freq plot */
     struct freq_plot *fp;
     EQFilterCtrl ctrls[EQ_DEFAULT_NUM_FILTERS];
     int selected_ctrl;
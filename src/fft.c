@@ -0,0 +1,192 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    fft.c
+
+    * see fft.h
+    * a real transform of length n runs as a complex transform of length N = n/2 over the even (real)
+      and odd (imaginary) samples, followed by a split step that separates the two spectra:
+          Fe[k] = (Z[k] + conj(Z[N-k])) / 2
+          Fo[k] = (Z[k] - conj(Z[N-k])) / 2i
+          X[k]  = Fe[k] + W^k Fo[k],    W = e^(-2*pi*i/n)
+      bins k and N-k are computed together, which is what lets the split run in place
+ *****************************************************************************************************************/
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "consts.h"
+#include "fft.h"
+#include "log.h"
+
+typedef struct fft_plan {
+    int n; /* complex points */
+    uint32_t *bitrev;
+    float complex *twiddles; /* e^(-2*pi*i*k/n), k < n/2 */
+    float complex *real_twiddles; /* e^(-2*pi*i*k/2n), k <= n/2; for the real-transform split */
+} FFTPlan;
+
+static _Atomic(FFTPlan *) plans[FFT_MAX_DEGREE + 1];
+static pthread_mutex_t plan_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int fft_degree(int n)
+{
+    int degree = 0;
+    while ((1 << degree) < n) degree++;
+    if ((1 << degree) != n || degree > FFT_MAX_DEGREE) {
+	fprintf(stderr, "Fatal error: FFT size %d is not a power of 2 <= 2^%d\n", n, FFT_MAX_DEGREE);
+	exit(1);
+    }
+    return degree;
+}
+
+static FFTPlan *fft_plan_create(int degree)
+{
+    FFTPlan *plan = calloc(1, sizeof(FFTPlan));
+    int n = 1 << degree;
+    plan->n = n;
+    plan->bitrev = malloc(n * sizeof(uint32_t));
+    plan->twiddles = malloc((n / 2 + 1) * sizeof(float complex));
+    plan->real_twiddles = malloc((n / 2 + 1) * sizeof(float complex));
+    if (!plan->bitrev || !plan->twiddles || !plan->real_twiddles) {
+	fprintf(stderr, "Fatal error: FFT plan allocation failed\n");
+	exit(1);
+    }
+    for (int i=0; i<n; i++) {
+	uint32_t r = 0;
+	for (int b=0; b<degree; b++) {
+	    if (i & (1 << b)) r |= 1 << (degree - 1 - b);
+	}
+	plan->bitrev[i] = r;
+    }
+    /* Computed in double to keep large transforms accurate */
+    for (int k=0; k<=n/2; k++) {
+	double theta = -TAU * k / n;
+	plan->twiddles[k] = (float)cos(theta) + I * (float)sin(theta);
+	theta = -TAU * k / (2.0 * n);
+	plan->real_twiddles[k] = (float)cos(theta) + I * (float)sin(theta);
+    }
+    return plan;
+}
+
+static const FFTPlan *fft_plan_get(int n)
+{
+    int degree = fft_degree(n);
+    FFTPlan *plan = atomic_load_explicit(&plans[degree], memory_order_acquire);
+    if (plan) return plan;
+    /* Only reached for sizes above FFT_PREALLOC_MAX_DEGREE */
+    pthread_mutex_lock(&plan_lock);
+    plan = atomic_load_explicit(&plans[degree], memory_order_relaxed);
+    if (!plan) {
+	log_tmp(LOG_INFO, "Creating FFT plan for size %d\n", n);
+	plan = fft_plan_create(degree);
+	atomic_store_explicit(&plans[degree], plan, memory_order_release);
+    }
+    pthread_mutex_unlock(&plan_lock);
+    return plan;
+}
+
+void init_fft()
+{
+    for (int d=0; d<=FFT_PREALLOC_MAX_DEGREE; d++) {
+	fft_plan_get(1 << d);
+    }
+}
+
+static void fft_complex_plan(const FFTPlan *plan, float complex *restrict buf, bool inverse)
+{
+    int n = plan->n;
+    for (int i=0; i<n; i++) {
+	uint32_t j = plan->bitrev[i];
+	if (i < j) {
+	    float complex tmp = buf[i];
+	    buf[i] = buf[j];
+	    buf[j] = tmp;
+	}
+    }
+    for (int len=2; len<=n; len <<= 1) {
+	int half = len >> 1;
+	int tw_step = n / len;
+	for (int start=0; start<n; start += len) {
+	    float complex *a = buf + start;
+	    float complex *b = a + half;
+	    for (int k=0; k<half; k++) {
+		float complex w = plan->twiddles[k * tw_step];
+		if (inverse) w = conjf(w);
+		float complex t = b[k] * w;
+		b[k] = a[k] - t;
+		a[k] += t;
+	    }
+	}
+    }
+}
+
+void fft_complex(float complex *buf, int n, bool inverse)
+{
+    fft_complex_plan(fft_plan_get(n), buf, inverse);
+}
+
+void fft_real_forward(float *buf, int n)
+{
+    int N = n / 2;
+    const FFTPlan *plan = fft_plan_get(N);
+    float complex *Z = FFT_BINS(buf);
+    fft_complex_plan(plan, Z, false);
+
+    /* Split; Z[N] is the DC/Nyquist slot */
+    float complex z0 = Z[0];
+    Z[0] = crealf(z0) + cimagf(z0);
+    Z[N] = crealf(z0) - cimagf(z0);
+    for (int k=1; k<=N/2; k++) {
+	float complex a = Z[k];
+	float complex b = conjf(Z[N - k]);
+	float complex fe = 0.5f * (a + b);
+	float complex fo = -0.5f * I * (a - b);
+	float complex wfo = plan->real_twiddles[k] * fo;
+	Z[k] = fe + wfo;
+	Z[N - k] = conjf(fe - wfo);
+    }
+}
+
+void fft_real_inverse(float *buf, int n)
+{
+    int N = n / 2;
+    const FFTPlan *plan = fft_plan_get(N);
+    float complex *X = FFT_BINS(buf);
+
+    /* Undo the split, recovering Z = Fe + i*Fo */
+    float x0 = crealf(X[0]);
+    float xn = crealf(X[N]);
+    X[0] = 0.5f * (x0 + xn) + 0.5f * I * (x0 - xn);
+    for (int k=1; k<=N/2; k++) {
+	float complex a = X[k];
+	float complex b = conjf(X[N - k]);
+	float complex fe = 0.5f * (a + b);
+	float complex fo = 0.5f * (a - b) * conjf(plan->real_twiddles[k]);
+	X[k] = fe + I * fo;
+	X[N - k] = conjf(fe) + I * conjf(fo);
+    }
+    fft_complex_plan(plan, X, true);
+    float scale = 1.0f / N;
+    for (int i=0; i<n; i++) {
+	buf[i] *= scale;
+    }
+}
+
+void fft_magnitude(const float complex *bins, double *dst, int num_bins, double scale)
+{
+    for (int i=0; i<num_bins; i++) {
+	dst[i] = cabsf(bins[i]) * scale;
+    }
+}
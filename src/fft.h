@@ -0,0 +1,52 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    fft.h
+
+    * iterative, in-place radix-2 Fast Fourier Transform over float
+    * a "plan" (bit-reversal permutation and twiddle factors) is cached per transform size; plans
+      up to FFT_PREALLOC_MAX_DEGREE are built in init_fft, larger ones on first use
+    * real transforms use a packed layout: a real signal of length n is transformed in place into
+      n/2 + 1 complex bins (DC through Nyquist), so the buffer must have room for n + 2 floats
+    * forward transforms are unscaled; inverse transforms are scaled so that inverse(forward(x)) == x
+*****************************************************************************************************************/
+
+#ifndef JDAW_FFT_H
+#define JDAW_FFT_H
+
+#include <complex.h>
+#include <stdbool.h>
+
+#define FFT_MAX_DEGREE 24
+#define FFT_PREALLOC_MAX_DEGREE 16
+
+/* Number of floats needed for an in-place real transform of length n */
+#define FFT_REAL_BUF_LEN(n) ((n) + 2)
+
+/* View a packed real-transform buffer as its n/2 + 1 complex bins */
+#define FFT_BINS(buf) ((float complex *)(buf))
+
+/* Build plans for sizes up to FFT_PREALLOC_MAX_DEGREE. Called by init_dsp. */
+void init_fft();
+
+/* Unscaled complex transform of n points, in place. n must be a power of 2. */
+void fft_complex(float complex *buf, int n, bool inverse);
+
+/* Real forward transform of n (power of 2, >= 4) samples, in place. buf must hold FFT_REAL_BUF_LEN(n) floats. */
+void fft_real_forward(float *buf, int n);
+
+/* Inverse of fft_real_forward: n/2 + 1 packed bins in, n real samples out */
+void fft_real_inverse(float *buf, int n);
+
+/* dst[i] = |bins[i]| * scale */
+void fft_magnitude(const float complex *bins, double *dst, int num_bins, double scale);
+
+#endif
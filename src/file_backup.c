@@ -8,75 +8,130 @@
 
 *****************************************************************************************************************/
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#ifdef JDAW_LINUX_BUILD
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+#ifdef JDAW_MACOS_BUILD
+#include <sys/clonefile.h>
+#endif
+#include "file_backup.h"
 
-#include "loading.h"
+#define FILE_COPY_BUF_LEN 1048576
 
 bool file_exists(const char *filepath)
 {
     return access(filepath, F_OK) == 0;
 }
 
-int file_copy(const char *read_filepath, const char *write_filepath)
+/* Copy into write_filepath, which must not exist */
+static int file_copy_new(const char *read_filepath, const char *write_filepath)
 {
-
-    if (!file_exists(read_filepath)) {
-	fprintf(stderr, "Error: file does not exist.\n");
+    #ifdef JDAW_MACOS_BUILD
+    /* Copy-on-write clone on APFS */
+    if (clonefile(read_filepath, write_filepath, 0) == 0) return 0;
+    #endif
+    int fd_r = open(read_filepath, O_RDONLY);
+    if (fd_r < 0) {
+	fprintf(stderr, "Error in file copy: unable to open read filepath \"%s\": %s\n", read_filepath, strerror(errno));
 	return 1;
     }
-    FILE *fr = fopen(read_filepath, "rb");
-    if (!fr) {
-	fprintf(stderr, "Error in file copy: unable to open read filepath \"%s\"\n",  read_filepath);
+    struct stat st;
+    if (fstat(fd_r, &st) != 0) {
+	close(fd_r);
+	return 1;
+    }
+    int fd_w = open(write_filepath, O_WRONLY | O_CREAT | O_EXCL, st.st_mode & 0777);
+    if (fd_w < 0) {
+	fprintf(stderr, "Error in file copy: unable to open write filepath \"%s\": %s\n", write_filepath, strerror(errno));
+	close(fd_r);
 	return 1;
     }
 
-    fseek(fr, 0, SEEK_END);
-    long unsigned file_size_bytes = ftell(fr);
-    rewind(fr);
-
+    #if defined(JDAW_LINUX_BUILD) && defined(FICLONE)
+    /* Share extents instead of copying data, on filesystems that support it (btrfs, XFS) */
+    if (ioctl(fd_w, FICLONE, fd_r) == 0) {
+	close(fd_r);
+	close(fd_w);
+	return 0;
+    }
+    #endif
 
-    FILE *fw = fopen(write_filepath, "wb");
-    if (!fw) {
-	fprintf(stderr, "Error in file copy: unable to open write filepath \"%s\"\n", write_filepath);
+    char *buf = malloc(FILE_COPY_BUF_LEN);
+    if (!buf) {
+	fprintf(stderr, "Fatal error: unable to allocate file copy buffer\n");
+	exit(1);
+    }
+    int err = 0;
+    ssize_t n;
+    while ((n = read(fd_r, buf, FILE_COPY_BUF_LEN)) > 0) {
+	if (write(fd_w, buf, n) != n) {
+	    err = errno ? errno : EIO;
+	    break;
+	}
+    }
+    if (n < 0) err = errno;
+    free(buf);
+    close(fd_r);
+    if (close(fd_w) != 0 && err == 0) err = errno;
+    if (err != 0) {
+	fprintf(stderr, "Error copying \"%s\" to \"%s\": %s\n", read_filepath, write_filepath, strerror(err));
 	return 1;
     }
+    return 0;
+}
 
-    long int byte_i = 0;
-    long int byte_mod = file_size_bytes / 100;
-    int c;
-    while ((c = fgetc(fr)) != EOF) {
-	/* fprintf(stderr, "Byte i: %lu, mod: %lu fs: %lu", byte_i, byte_i % byte_mod, file_size_bytes); */
-	if (byte_i % byte_mod == 0) {
-	    session_loading_screen_update(NULL, (double)byte_i / file_size_bytes);
-	}
-	byte_i++;
-	fputc(c, fw);
+/* The destination is never rewritten in place: the copy goes to a new file, which is then renamed
+   over it. Clips may be mapped from an existing file at write_filepath (e.g. a project file that
+   a full save moved to .bak), and a MAP_PRIVATE mapping of a page nobody has written to sees
+   writes to the file underneath it */
+int file_copy(const char *read_filepath, const char *write_filepath)
+{
+    int buflen = strlen(write_filepath) + 5;
+    char tmp_filepath[buflen];
+    snprintf(tmp_filepath, buflen, "%s.tmp", write_filepath);
+    unlink(tmp_filepath);
+    if (file_copy_new(read_filepath, tmp_filepath) != 0) {
+	unlink(tmp_filepath);
+	return 1;
+    }
+    if (rename(tmp_filepath, write_filepath) != 0) {
+	fprintf(stderr, "Error moving copy of \"%s\" to \"%s\": %s\n", read_filepath, write_filepath, strerror(errno));
+	unlink(tmp_filepath);
+	return 1;
     }
-    
-    fclose(fr);
-    fclose(fw);
     return 0;
 }
 
-void file_backup(const char *filepath)
+static void backup_path(const char *filepath, char *dst, int dstlen)
 {
+    snprintf(dst, dstlen, "%s.bak", filepath);
+}
 
-    session_set_loading_screen("Overwrite backup", "Backing up existing file...", false);
-    const char *bak = ".bak";
-    int buflen = strlen(filepath) + strlen(bak) + 1;
+void file_backup(const char *filepath)
+{
+    int buflen = strlen(filepath) + 5;
     char buf[buflen];
-    snprintf(buf, buflen, "%s%s\n", filepath, bak);
+    backup_path(filepath, buf, buflen);
     fprintf(stderr, "Backing up file at: %s\n", buf);
     if (rename(filepath, buf) != 0) {
 	perror("Rename error");
     }
-    
-    /* if (file_copy(filepath, (const char *)buf) != 0) { */
-    /* 	session_loading_screen_deinit(proj); */
-    /* 	fprintf(stderr, "Error: failed to backup file \"%s\".", filepath); */
-    /* } */
-    session_loading_screen_deinit();
+}
+
+int file_backup_copy(const char *filepath)
+{
+    int buflen = strlen(filepath) + 5;
+    char buf[buflen];
+    backup_path(filepath, buf, buflen);
+    fprintf(stderr, "Copying file to backup at: %s\n", buf);
+    return file_copy(filepath, buf);
 }
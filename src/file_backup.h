@@ -12,7 +12,12 @@
     file_backup.h
 
     * rudimentary interface for backing up binary files
-    * backups are executed every time a save is executed on an existing file
+    * called from the project save thread; nothing here touches the UI
+    * a full save moves the existing file to <path>.bak (file_backup). An incremental save appends to
+      the existing file, so it is copied instead (file_backup_copy), once per session per file.
+      Copies are clones where the filesystem supports them (APFS, btrfs, XFS), and otherwise use
+      large buffered reads and writes.
+    * an existing file is never overwritten in place, since clips may still be mapped from it
  *****************************************************************************************************************/
 
 
@@ -22,6 +27,13 @@
 #include <stdbool.h>
 
 bool file_exists(const char *filepath);
+/* Copy to a temporary file, then rename it over write_filepath. Returns 0 on success. */
+int file_copy(const char *read_filepath, const char *write_filepath);
+
+/* Rename to <filepath>.bak */
 void file_backup(const char *filepath);
 
+/* Copy to <filepath>.bak. Returns 0 on success. */
+int file_backup_copy(const char *filepath);
+
 #endif
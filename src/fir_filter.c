@@ -11,8 +11,8 @@
 /*****************************************************************************************************************
    Impulse response functions
 
-   Create sinc or sinc-like curves representing time-domain impulse responses. Pad with zeroes and FFT to get 
-    the frequency response of the filters.
+   Create sinc or sinc-like curves representing time-domain impulse responses. The convolver partitions
+    and transforms them to get the frequency response of the filters.
  *****************************************************************************************************************/
 
 #include <stdlib.h>
@@ -20,8 +20,13 @@
 #include "dsp_utils.h"
 #include "endpoint_callbacks.h"
 #include "fir_filter.h"
+#include "log.h"
 #include "page.h"
 #include "project.h"
+#include "session.h"
+#include "session_endpoint_ops.h"
+#include "thread_safety.h"
+#include "wav.h"
 
 static double lowpass_IR(int x, int offset, double cutoff)
 {
@@ -127,22 +132,15 @@ static void FIR_filter_alloc_buffers(FIRFilter *filter)
 {
     /* pthread_mutex_lock(&filter->lock); */
 
-    int max_irlen = filter->chunk_len;
     if (!filter->impulse_response)
-	filter->impulse_response = calloc(1, sizeof(double) * max_irlen);
+	filter->impulse_response = calloc(1, sizeof(double) * FIR_FILTER_MAX_IR_LEN);
 
-    if (!filter->frequency_response)
-	filter->frequency_response = calloc(1, sizeof(double complex) * filter->frequency_response_len);
+    if (!filter->conv)
+	filter->conv = convolver_create(filter->chunk_len, FIR_FILTER_MAX_IR_LEN, false);
 
     if (!filter->frequency_response_mag)
 	filter->frequency_response_mag = calloc(1, sizeof(double) * filter->frequency_response_len);
 
-    /* filter->overlap_len =  = 1; */
-    if (!filter->overlap_buffer_L)
-	filter->overlap_buffer_L = calloc(1, sizeof(float) * max_irlen - 1);
-    if (!filter->overlap_buffer_R)
-	filter->overlap_buffer_R = calloc(1, sizeof(float) * max_irlen - 1);
-
     if (!filter->output_freq_mag_L)
 	filter->output_freq_mag_L = calloc(filter->frequency_response_len, sizeof(double));
 
@@ -232,7 +230,7 @@ void filter_init(FIRFilter *filter, FilterType type, uint16_t impulse_response_l
     endpoint_set_allowed_range(
 	&filter->impulse_response_len_ep,
 	(Value){.uint16_v = 4},
-	(Value){.uint16_v = filter->chunk_len});
+	(Value){.uint16_v = FIR_FILTER_MAX_IR_LEN});
     /* endpoint_set_default_value(&filter->impulse_response_len_ep, (Value){.double_v = 0.1}); */
     /* endpoint_set_label_fn(&filter->impulse_response_len_ep, label_msec); */
     /* api_endpoint_register(&filter->impulse_response_len_ep, &filter->effect->api_node); */
@@ -260,14 +258,89 @@ void filter_init(FIRFilter *filter, FilterType type, uint16_t impulse_response_l
 extern pthread_t DSP_THREAD_ID;
 extern Project *proj;
 
+/* Hand a loaded IR back to the main thread. Normally the retired slot is empty, since
+   filter_load_IR_file empties it before handing off a new IR. */
+static void filter_retire_loaded_IR(FIRFilter *filter)
+{
+    if (!filter->loaded_ir) return;
+    Convolver *prev = atomic_exchange(&filter->loaded_ir_retired, filter->loaded_ir);
+    if (prev) convolver_destroy(prev);
+    filter->loaded_ir = NULL;
+    atomic_store(&filter->loaded_ir_active, false);
+}
+
+/* Main thread only */
+static void filter_free_loaded_IR_samples(FIRFilter *filter)
+{
+    for (int c=0; c<2; c++) {
+	if (filter->loaded_ir_samples[c]) {
+	    free(filter->loaded_ir_samples[c]);
+	    filter->loaded_ir_samples[c] = NULL;
+	}
+    }
+    filter->loaded_ir_len = 0;
+}
+
+/* Main thread only. Use the designed impulse response (first len values of ir) for the filter.
+   The spectra are built in the spare convolver and handed off to the DSP thread, which drops
+   any loaded IR when it picks them up. */
+static void filter_set_designed_IR(FIRFilter *filter, float *ir, int len)
+{
+    Convolver *cv = atomic_exchange(&filter->conv_spare, NULL);
+    if (!cv) {
+	/* Not yet swapped in; it is about to be replaced anyway */
+	cv = atomic_exchange(&filter->conv_pending, NULL);
+    }
+    if (!cv) {
+	cv = convolver_create(filter->chunk_len, FIR_FILTER_MAX_IR_LEN, false);
+    }
+    convolver_set_ir(cv, ir, NULL, len);
+    convolver_response_magnitude(cv, 0, filter->frequency_response_mag, filter->frequency_response_len / 2 + 1);
+
+    Convolver *old;
+    if ((old = atomic_exchange(&filter->loaded_ir_pending, NULL))) {
+	convolver_destroy(old);
+    }
+    if ((old = atomic_exchange(&filter->loaded_ir_retired, NULL))) {
+	convolver_destroy(old);
+    }
+    filter_free_loaded_IR_samples(filter);
+    if ((old = atomic_exchange(&filter->conv_pending, cv))) {
+	convolver_destroy(old);
+    }
+}
+
+static void filter_build_designed_IR(FIRFilter *filter);
+
+/* Queued to the main thread by filter_set_params */
+static void filter_rebuild_cb(Endpoint *ep)
+{
+    filter_build_designed_IR((FIRFilter *)ep->xarg1);
+}
+
 /* Bandwidth param only required for band-pass and band-cut filters */
 void filter_set_params(FIRFilter *filter, FilterType type, double cutoff, double bandwidth)
 {
-    /* DSP_THREAD_ONLY_WHEN_ACTIVE("filter_set_params"); */
-    /* pthread_mutex_lock(&filter->lock); */
     filter->type = type;
     filter->cutoff_freq = cutoff;
     filter->bandwidth = bandwidth;
+    if (on_thread(JDAW_THREAD_MAIN)) {
+	filter_build_designed_IR(filter);
+    } else {
+	/* Param changes arrive here on the DSP thread. Transforming the IR is too slow to do there,
+	   so the rebuild goes to the main thread, queued after the param writes above. Repeated
+	   changes before the main thread gets to it coalesce into one rebuild. */
+	if (session_queue_callback(session_get(), &filter->cutoff_ep, filter_rebuild_cb, JDAW_THREAD_MAIN) != 0) {
+	    log_tmp(LOG_ERROR, "Filter response rebuild could not be queued\n");
+	}
+    }
+}
+
+/* Main thread only */
+static void filter_build_designed_IR(FIRFilter *filter)
+{
+    double cutoff = filter->cutoff_freq;
+    double bandwidth = filter->bandwidth;
     double *ir = filter->impulse_response;
     uint16_t len = filter->impulse_response_len;
     uint16_t offset = len/2;
@@ -295,45 +368,93 @@ void filter_set_params(FIRFilter *filter, FilterType type, double cutoff, double
             break;
     }
 
-    /* double *IR_zero_padded = malloc(sizeof(double) * filter->frequency_response_len); */
-    double IR_zero_padded[filter->frequency_response_len];
-    for (uint16_t i=0; i<filter->frequency_response_len; i++) {
-        if (i<len) {
-            IR_zero_padded[i] = ir[i];
-        } else {
-            IR_zero_padded[i] = 0;
-        }
+    float ir_f[len];
+    for (uint16_t i=0; i<len; i++) {
+	ir_f[i] = ir[i];
     }
-    /* if (!filter->frequency_response) { */
-    /* 	fprintf(stdout, "Allocating freq response\n"); */
-    /* 	filter->frequency_response = malloc(sizeof(double complex) * filter->frequency_response_len); */
-    /* } */
-
-
-    FFT_unscaled(IR_zero_padded, filter->frequency_response, filter->frequency_response_len);
-    get_magnitude(filter->frequency_response, filter->frequency_response_mag, filter->frequency_response_len);
-    /* pthread_mutex_unlock(&filter->lock); */
-    /* free(IR_zero_padded); */
+    filter_set_designed_IR(filter, ir_f, len);
 }
 
 void filter_set_arbitrary_IR(FIRFilter *filter, float *ir_in, int ir_len)
 {
-    filter_set_impulse_response_len(filter, ir_len);
+    if (ir_len > FIR_FILTER_MAX_IR_LEN) ir_len = FIR_FILTER_MAX_IR_LEN;
+    filter->impulse_response_len = ir_len;
     /* pthread_mutex_lock(&filter->lock); */
-    double ir_zero_padded[filter->frequency_response_len];
-    for (int i=0; i<filter->frequency_response_len; i++) {
-	if (i < ir_len) {
-	    ir_zero_padded[i] = ir_in[i] * hamming(i, ir_len);
-	} else {
-	    ir_zero_padded[i] = 0;
-	}
+    float ir_windowed[ir_len];
+    for (int i=0; i<ir_len; i++) {
+	ir_windowed[i] = ir_in[i] * hamming(i, ir_len);
     }
-    FFT_unscaled(ir_zero_padded, filter->frequency_response, filter->frequency_response_len);
-    get_magnitude(filter->frequency_response, filter->frequency_response_mag, filter->frequency_response_len);
+    filter_set_designed_IR(filter, ir_windowed, ir_len);
     /* pthread_mutex_unlock(&filter->lock); */
 
 }
 
+int filter_load_IR_file(FIRFilter *filter, const char *filepath)
+{
+    float *L = NULL;
+    float *R = NULL;
+    int32_t len = wav_load(filepath, &L, &R);
+    if (len <= 0 || !L) {
+	log_tmp(LOG_ERROR, "Unable to load impulse response from %s\n", filepath);
+	return -1;
+    }
+    int32_t max_len = FIR_FILTER_MAX_LOADED_IR_S * filter->effect->effect_chain->proj->sample_rate;
+    if (len > max_len) {
+	log_tmp(LOG_WARN, "Impulse response %s truncated to %d seconds\n", filepath, FIR_FILTER_MAX_LOADED_IR_S);
+	len = max_len;
+    }
+    if (filter_set_loaded_IR(filter, L, R, len) != 0) {
+	return -1;
+    }
+    log_tmp(LOG_INFO, "Loaded impulse response %s (%d sframes)\n", filepath, len);
+    return 0;
+}
+
+int filter_set_loaded_IR(FIRFilter *filter, float *L, float *R, int32_t len)
+{
+    if (len <= 0 || !L) {
+	if (L) free(L);
+	if (R) free(R);
+	return -1;
+    }
+    Convolver *cv = convolver_create(filter->chunk_len, len, R != NULL);
+    convolver_set_ir(cv, L, R, len);
+    convolver_response_magnitude(cv, 0, filter->frequency_response_mag, filter->frequency_response_len / 2 + 1);
+    filter_free_loaded_IR_samples(filter);
+    filter->loaded_ir_samples[0] = L;
+    filter->loaded_ir_samples[1] = R;
+    filter->loaded_ir_len = len;
+
+    Convolver *old;
+    if ((old = atomic_exchange(&filter->loaded_ir_retired, NULL))) {
+	convolver_destroy(old);
+    }
+    /* If the DSP thread has not yet picked up a previous IR, it never will */
+    if ((old = atomic_exchange(&filter->loaded_ir_pending, cv))) {
+	convolver_destroy(old);
+    }
+    return 0;
+}
+
+/* DSP thread only (reads loaded_ir) */
+int32_t filter_tail_len_sframes(FIRFilter *filter)
+{
+    Convolver *cv = filter->loaded_ir ? filter->loaded_ir : filter->conv;
+    return cv->ir_len;
+}
+
+int32_t filter_latency_sframes(FIRFilter *filter)
+{
+    if (atomic_load(&filter->loaded_ir_active)) return 0;
+    return filter->impulse_response_len / 2;
+}
+
+void filter_clear(FIRFilter *filter)
+{
+    convolver_reset(filter->conv);
+    if (filter->loaded_ir) convolver_reset(filter->loaded_ir);
+}
+
 void filter_set_params_hz(FIRFilter *filter, FilterType type, double cutoff_hz, double bandwidth_hz)
 {
     double cutoff = cutoff_hz / (double)filter->effect->effect_chain->proj->sample_rate;
@@ -372,18 +493,14 @@ void filter_set_bandwidth_hz(FIRFilter *f, double bandwidth_h)
 void filter_set_impulse_response_len(FIRFilter *f, int new_len)
 {
     /* DSP_THREAD_ONLY_WHEN_ACTIVE("filter_set_params"); */
-    if (new_len > f->effect->effect_chain->chunk_len_sframes) {
-	fprintf(stderr, "RESETTING IR LEN TO MATCH EC\n");
-	new_len = f->effect->effect_chain->chunk_len_sframes;
+    if (new_len > FIR_FILTER_MAX_IR_LEN) {
+	new_len = FIR_FILTER_MAX_IR_LEN;
     }
     f->impulse_response_len = new_len;
-    f->overlap_len = new_len - 1;
     double cutoff = f->cutoff_freq;
     double bandwidth = f->bandwidth;
     FilterType t = f->type;
     filter_set_params(f, t, cutoff, bandwidth);
-    memset(f->overlap_buffer_L, '\0', f->overlap_len * sizeof(float));
-    memset(f->overlap_buffer_R, '\0', f->overlap_len * sizeof(float));
 }
 
 void filter_set_type(FIRFilter *f, FilterType t)
@@ -395,20 +512,32 @@ void filter_set_type(FIRFilter *f, FilterType t)
 
 void filter_deinit(FIRFilter *filter) 
 {
-    if (filter->frequency_response) {
-        free(filter->frequency_response);
-        filter->frequency_response = NULL;
-    }
     if (filter->impulse_response) {
         free(filter->impulse_response);
         filter->impulse_response = NULL;
     }
-    if (filter->overlap_buffer_L) {
-	free(filter->overlap_buffer_L);
+    if (filter->conv) {
+	convolver_destroy(filter->conv);
+	filter->conv = NULL;
+    }
+    if (filter->loaded_ir) {
+	convolver_destroy(filter->loaded_ir);
+	filter->loaded_ir = NULL;
+    }
+    Convolver *cv;
+    if ((cv = atomic_exchange(&filter->conv_pending, NULL))) {
+	convolver_destroy(cv);
+    }
+    if ((cv = atomic_exchange(&filter->conv_spare, NULL))) {
+	convolver_destroy(cv);
     }
-    if (filter->overlap_buffer_R) {
-	free(filter->overlap_buffer_R);
+    if ((cv = atomic_exchange(&filter->loaded_ir_pending, NULL))) {
+	convolver_destroy(cv);
     }
+    if ((cv = atomic_exchange(&filter->loaded_ir_retired, NULL))) {
+	convolver_destroy(cv);
+    }
+    filter_free_loaded_IR_samples(filter);
     if (filter->frequency_response_mag) {
 	free(filter->frequency_response_mag);
     }
@@ -428,69 +557,46 @@ void filter_deinit(FIRFilter *filter)
 
 
 
-/* Destructive; replaces values in sample_array. Legacy fn called by new standard prototype filter_buf_apply */
-static void apply_filter(FIRFilter *filter, uint8_t channel, uint16_t chunk_size, float *sample_array)
-{
-    /* pthread_mutex_lock(&filter->lock); */
-    /* SDL_LockMutex(filter->lock); */
-    float *overlap_buffer = channel == 0 ? filter->overlap_buffer_L : filter->overlap_buffer_R;
-    uint16_t padded_len = filter->frequency_response_len;
-    float padded_chunk[padded_len];
-    memset(padded_chunk + chunk_size, '\0', (padded_len - chunk_size) * sizeof(float));
-    memcpy(padded_chunk, sample_array, chunk_size * sizeof(float));
-
-    double complex freq_domain[padded_len];
-
-    FFTf(padded_chunk,freq_domain, padded_len);
-    
-    /* Apply filter via multiplication in freq domain */
-    for (uint16_t i=0; i<padded_len; i++) {
-        freq_domain[i] *= filter->frequency_response[i];
-    }
-
-    /* Populate magnitude buffers for display in freq plot.
-       To avoid slowdown, the same frequency response that is used in
-       the application of the filter is used here, without windowing or
-       compensatory scaling. This frequency plot will therefore look
-       more jagged than the one displayed on an EQ effect */
-    if (filter->effect && filter->effect->page && filter->effect->page->onscreen) {
-	double *dst = channel == 0 ? filter->output_freq_mag_L : filter->output_freq_mag_R;
-	get_magnitude(freq_domain, dst, padded_len);
-    }
-
-    double complex time_domain[padded_len];
-    IFFT(freq_domain, time_domain, padded_len);
-    float real[padded_len];
-    get_real_componentf(time_domain, real, padded_len);
-
-    memcpy(sample_array, real, chunk_size * sizeof(float));
-    for (int i=0; i<filter->overlap_len; i++) {
-        sample_array[i] += overlap_buffer[i];
-    }
-
-    memcpy(overlap_buffer, real + chunk_size, filter->overlap_len * sizeof(float));
-    /* pthread_mutex_unlock(&filter->lock); */
-}
-
 /* Apply a FIR filter to a float buffer */
 float filter_buf_apply(void *f_v, float *restrict buf, int len, int channel, float input_amp)
 {
     FIRFilter *f = f_v;
     /* if (!f->active) return input_amp; */
-    apply_filter(f, channel, len, buf);
-    float output_amp = 0.0;
-    for (int i=0; i<len; i++) {
-	output_amp += fabs(buf[i]);
-    }    
-    return output_amp;
+    Convolver *cv = f->loaded_ir ? f->loaded_ir : f->conv;
+
+    /* Populate magnitude buffers for display in freq plot.
+       To avoid slowdown, the spectrum accumulated in the convolution
+       itself is used here, without windowing or compensatory scaling.
+       This frequency plot will therefore look more jagged than the one
+       displayed on an EQ effect */
+    double *mag_dst = NULL;
+    if (f->effect && atomic_load(&f->effect->page_onscreen)) {
+	mag_dst = channel == 0 ? f->output_freq_mag_L : f->output_freq_mag_R;
+    }
+    return convolver_process(cv, channel, buf, len, mag_dst, f->frequency_response_len / 2 + 1);
 }
 
 float filter_buf_apply_stereo(void *f_v, float *restrict L, float *restrict R, int len, float input_amp)
 {
+    FIRFilter *f = f_v;
+    Convolver *designed = atomic_exchange(&f->conv_pending, NULL);
+    if (designed) {
+	convolver_swap_ir(f->conv, designed);
+	filter_retire_loaded_IR(f);
+	if ((designed = atomic_exchange(&f->conv_spare, designed))) {
+	    /* Only if the main thread had to create another while this one was pending */
+	    convolver_destroy(designed);
+	}
+    }
+    Convolver *loaded = atomic_exchange(&f->loaded_ir_pending, NULL);
+    if (loaded) {
+	filter_retire_loaded_IR(f);
+	f->loaded_ir = loaded;
+	atomic_store(&f->loaded_ir_active, true);
+    }
     if (L)
 	input_amp = filter_buf_apply(f_v, L, len, 0, input_amp);
     if (R)
 	input_amp = filter_buf_apply(f_v, R, len, 1, input_amp);
     return input_amp;
 }
-
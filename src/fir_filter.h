@@ -14,16 +14,22 @@
     * Finite Impulse Response (FIR) filters
     * lowpass, highpass, bandpass, and band-cut frequency response types available
     * frequency response implemented via windowed sinc method
-    * filters applied via block convolution
+    * alternatively, an impulse response can be loaded from a WAV file (e.g. for convolution reverb)
+    * filters applied via non-uniformly partitioned convolution (see convolver.h), so impulse responses
+      may be much longer than the chunk length without the per-chunk cost growing with them
 *****************************************************************************************************************/
 
 #include <complex.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdint.h>
+#include "convolver.h"
 #include "endpoint.h"
 
 #define DEFAULT_FILTER_LEN 128
 #define DELAY_LINE_MAX_LEN_S 1
+#define FIR_FILTER_MAX_IR_LEN 8192 /* Designed (windowed sinc) filters */
+#define FIR_FILTER_MAX_LOADED_IR_S 10
 
 
 /* typedef struct track Track; */
@@ -41,11 +47,23 @@ typedef struct fir_filter {
     double cutoff_freq; /* 0 < cutoff_freq < 0.5 */
     double bandwidth_unscaled; /* For gui components and automations */
     double bandwidth;
-    double *impulse_response;
-    double complex *frequency_response;
-    double *frequency_response_mag;
-    float *overlap_buffer_L;
-    float *overlap_buffer_R;
+    double *impulse_response; /* FIR_FILTER_MAX_IR_LEN */
+    /* Designed response. Param changes rebuild the spectra on the main thread, in a spare
+       convolver handed to the DSP thread through 'conv_pending'; the DSP thread swaps the new IR
+       into 'conv' and hands the old one back through 'conv_spare' for the next rebuild */
+    Convolver *conv; /* DSP thread only */
+    _Atomic(Convolver *) conv_pending;
+    _Atomic(Convolver *) conv_spare;
+    /* A loaded IR replaces the designed response until a filter param is changed.
+       Built on the main thread and handed off to the DSP thread through 'loaded_ir_pending';
+       replaced IRs are handed back through 'loaded_ir_retired' to be freed on the main thread */
+    Convolver *loaded_ir; /* DSP thread only */
+    _Atomic(Convolver *) loaded_ir_pending;
+    _Atomic(Convolver *) loaded_ir_retired;
+    atomic_bool loaded_ir_active; /* Written on the DSP thread; readable anywhere */
+    float *loaded_ir_samples[2]; /* Main thread only; kept to be saved with the project. [1] NULL if mono */
+    int32_t loaded_ir_len;
+    double *frequency_response_mag; /* frequency_response_len / 2 + 1 bins */
     double *output_freq_mag_L;
     double *output_freq_mag_R;
     /* float *freq_mag_L; */
@@ -55,7 +73,6 @@ typedef struct fir_filter {
     uint16_t chunk_len;
     /* uint16_t impulse_response_len_internal; */
     uint16_t frequency_response_len;
-    uint16_t overlap_len;
     /* pthread_mutex_t lock; */
 
     /* float *buf_L_freq */
@@ -76,7 +93,8 @@ typedef struct fir_filter {
 /* void filter_init(FIRFilter *filter, Track *track, FilterType type, uint16_t impulse_response_len, uint16_t frequency_response_len); */
 void filter_init(FIRFilter *filter, FilterType type, uint16_t impulse_response_len, uint16_t frequency_response_len, uint16_t chunk_len);
 
-/* Bandwidth param only required for band-pass and band-cut filters */
+/* Bandwidth param only required for band-pass and band-cut filters. The response is rebuilt
+   immediately on the main thread; from any other thread, the rebuild is queued to the main thread */
 void filter_set_params(FIRFilter *filter, FilterType type,  double cutoff, double bandwidth);
 void filter_set_params_hz(FIRFilter *filter, FilterType type, double cutoff_hz, double bandwidth_hz);
 
@@ -90,6 +108,21 @@ void filter_set_impulse_response_len(FIRFilter *f, int new_len);
 
 void filter_set_arbitrary_IR(FIRFilter *filter, float *ir_in, int ir_len);
 
+/* Main thread only. Load a WAV file as the filter's impulse response. Returns 0 on success. */
+int filter_load_IR_file(FIRFilter *filter, const char *filepath);
+
+/* Main thread only. Use len samples of L (and R, if not NULL) as the filter's impulse response.
+   Takes ownership of the buffers, which must be malloc'd. Returns 0 on success. */
+int filter_set_loaded_IR(FIRFilter *filter, float *L, float *R, int32_t len);
+
+/* Clear convolution history; DSP thread */
+void filter_clear(FIRFilter *filter);
+int32_t filter_tail_len_sframes(FIRFilter *filter);
+
+/* Group delay of the designed (linear-phase) response; a loaded IR is taken to have none.
+   Safe to call from any thread. */
+int32_t filter_latency_sframes(FIRFilter *filter);
+
 /* Destry a FIRFilter and associated memory */
 void filter_deinit(FIRFilter *filter);
 
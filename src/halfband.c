@@ -0,0 +1,143 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    halfband.c
+
+    * see halfband.h
+    * the full filter is h[d] = sin(pi * d / 2) / (pi * d) * kaiser(d / 2K) for d = -(2K - 1) .. 2K - 1,
+      with h[0] = 0.5. Only odd d are nonzero; coeffs[m] holds h[2m + 1], normalized so that the
+      filter has unity gain at DC.
+    * upsampling: for input x[n], output 2n is x[n - K] and output 2n + 1 is
+      2 * sum over m of coeffs[m] * (x[n - K - m] + x[n - K + 1 + m])
+    * downsampling input v, split into even samples e and odd samples o:
+      y[n] = 0.5 * o[n - K] + sum over m of coeffs[m] * (e[n - K - m] + e[n - K + 1 + m])
+ *****************************************************************************************************************/
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include "halfband.h"
+
+#define HALFBAND_KAISER_BETA 8.0
+
+static const int stage_k[HALFBAND_MAX_STAGES] = {16, 8, 4};
+static float stage_coeffs[HALFBAND_MAX_STAGES][HALFBAND_MAX_K];
+static pthread_once_t stage_coeffs_once = PTHREAD_ONCE_INIT;
+
+static double bessel_i0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    double half_x_sq = x * x / 4.0;
+    for (int k=1; k<50; k++) {
+	term *= half_x_sq / ((double)k * k);
+	sum += term;
+	if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+static void stage_coeffs_init()
+{
+    double i0_beta = bessel_i0(HALFBAND_KAISER_BETA);
+    for (int s=0; s<HALFBAND_MAX_STAGES; s++) {
+	int k = stage_k[s];
+	double c[k];
+	double sum = 0.0;
+	for (int m=0; m<k; m++) {
+	    int d = 2 * m + 1;
+	    double x = (double)d / (2 * k);
+	    double window = bessel_i0(HALFBAND_KAISER_BETA * sqrt(1.0 - x * x)) / i0_beta;
+	    c[m] = sin(M_PI * d / 2.0) / (M_PI * d) * window;
+	    sum += c[m];
+	}
+	/* Side taps come in pairs, so 0.5 + 2 * sum must be 1 */
+	for (int m=0; m<k; m++) {
+	    stage_coeffs[s][m] = c[m] * 0.25 / sum;
+	}
+    }
+}
+
+void halfband_init(Halfband *hb, int stage)
+{
+    pthread_once(&stage_coeffs_once, stage_coeffs_init);
+    hb->stage = stage;
+    hb->k = stage_k[stage];
+    hb->coeffs = stage_coeffs[stage];
+    halfband_clear(hb);
+}
+
+void halfband_clear(Halfband *hb)
+{
+    memset(hb->up_hist, '\0', sizeof(hb->up_hist));
+    memset(hb->down_even_hist, '\0', sizeof(hb->down_even_hist));
+    memset(hb->down_odd_hist, '\0', sizeof(hb->down_odd_hist));
+}
+
+void halfband_upsample(Halfband *hb, const float *restrict in, float *restrict out, int in_len)
+{
+    const int k = hb->k;
+    const int hist_len = 2 * k - 1;
+    const float *restrict c = hb->coeffs;
+    float ext[hist_len + in_len];
+    memcpy(ext, hb->up_hist, hist_len * sizeof(float));
+    memcpy(ext + hist_len, in, in_len * sizeof(float));
+    /* Loop over taps outside, samples inside, so that the inner loop runs over contiguous input */
+    float sum[in_len];
+    memset(sum, '\0', sizeof(sum));
+    for (int m=0; m<k; m++) {
+	const float *restrict a = ext + k - 1 - m; /* a[n] is x[n - K - m] */
+	const float *restrict b = ext + k + m; /* b[n] is x[n - K + 1 + m] */
+	const float cm = 2.0f * c[m];
+	for (int n=0; n<in_len; n++) {
+	    sum[n] += cm * (a[n] + b[n]);
+	}
+    }
+    for (int n=0; n<in_len; n++) {
+	out[2 * n] = ext[n + k - 1];
+	out[2 * n + 1] = sum[n];
+    }
+    memcpy(hb->up_hist, ext + in_len, hist_len * sizeof(float));
+}
+
+void halfband_downsample(Halfband *hb, const float *restrict in, float *restrict out, int out_len)
+{
+    const int k = hb->k;
+    const int even_hist_len = 2 * k - 1;
+    const float *restrict c = hb->coeffs;
+    float even[even_hist_len + out_len];
+    float odd[k + out_len];
+    memcpy(even, hb->down_even_hist, even_hist_len * sizeof(float));
+    memcpy(odd, hb->down_odd_hist, k * sizeof(float));
+    for (int n=0; n<out_len; n++) {
+	even[even_hist_len + n] = in[2 * n];
+	odd[k + n] = in[2 * n + 1];
+    }
+    for (int n=0; n<out_len; n++) {
+	out[n] = 0.5f * odd[n];
+    }
+    for (int m=0; m<k; m++) {
+	const float *restrict a = even + k - 1 - m; /* a[n] is e[n - K - m] */
+	const float *restrict b = even + k + m; /* b[n] is e[n - K + 1 + m] */
+	const float cm = c[m];
+	for (int n=0; n<out_len; n++) {
+	    out[n] += cm * (a[n] + b[n]);
+	}
+    }
+    memcpy(hb->down_even_hist, even + out_len, even_hist_len * sizeof(float));
+    memcpy(hb->down_odd_hist, odd + out_len, k * sizeof(float));
+}
+
+double halfband_round_trip_latency(int stage)
+{
+    int k = stage_k[stage];
+    return k + (2.0 * k - 1.0) / 2.0;
+}
@@ -0,0 +1,49 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    halfband.h
+
+    * polyphase half-band FIR filters, for 2x upsampling and downsampling
+    * every other tap of a half-band filter is zero except the center tap (0.5), so each direction
+      splits into a pure delay and a short symmetric branch of HALFBAND_K distinct coefficients
+    * cascade stages to oversample by 4 or 8. Stage 0, which runs at the lowest rate and must reject
+      everything just above the original Nyquist frequency, has the longest kernel; later stages only
+      need to reject images far from the audio band, and are shorter.
+*****************************************************************************************************************/
+
+#ifndef JDAW_HALFBAND_H
+#define JDAW_HALFBAND_H
+
+#define HALFBAND_MAX_STAGES 3
+#define HALFBAND_MAX_K 16
+
+typedef struct halfband {
+    int stage;
+    int k; /* Number of distinct nonzero side coefficients */
+    const float *coeffs;
+    float up_hist[2 * HALFBAND_MAX_K];
+    float down_even_hist[2 * HALFBAND_MAX_K];
+    float down_odd_hist[HALFBAND_MAX_K];
+} Halfband;
+
+void halfband_init(Halfband *hb, int stage);
+void halfband_clear(Halfband *hb);
+
+/* Write 2 * in_len samples to out */
+void halfband_upsample(Halfband *hb, const float *restrict in, float *restrict out, int in_len);
+
+/* Read 2 * out_len samples from in */
+void halfband_downsample(Halfband *hb, const float *restrict in, float *restrict out, int out_len);
+
+/* Combined delay of one upsample and one downsample, in samples at the stage's lower rate */
+double halfband_round_trip_latency(int stage);
+
+#endif
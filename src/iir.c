@@ -22,6 +22,16 @@
 
 extern Window *main_win;
 
+static void iir_sync_biquad_coeffs(IIRFilter *f)
+{
+    if (f->degree != 2) return;
+    f->bq_coeffs[0] = f->A[0];
+    f->bq_coeffs[1] = f->A[1];
+    f->bq_coeffs[2] = f->A[2];
+    f->bq_coeffs[3] = f->B[0];
+    f->bq_coeffs[4] = f->B[1];
+}
+
 void iir_init(IIRFilter *f, int degree, int num_channels)
 {
     f->degree = degree;
@@ -40,6 +50,8 @@ void iir_init(IIRFilter *f, int degree, int num_channels)
 	f->mem_out[i] = calloc(degree, sizeof(double));
     }
     f->A[0] = 1;
+    memset(f->bq_state, '\0', sizeof(f->bq_state));
+    iir_sync_biquad_coeffs(f);
 }
 
 void iir_add_freqplot(IIRFilter *f, struct freq_plot *fp)
@@ -82,13 +94,44 @@ void iir_set_coeffs(IIRFilter *f, double *A_in, double *B_in)
 {
     memcpy(f->A, A_in, (f->degree + 1) * sizeof(double));
     memcpy(f->B, B_in, f->degree * sizeof(double));
+    iir_sync_biquad_coeffs(f);
 }
 
 
 /* Apply the filter */
 void breakfn();
+
+#define IIR_MAX_STATE 5000.0f
+#define IIR_FLUSH_STATE 1e-20f
+
+/* Returns false if the state has blown up. Tiny values are flushed to zero
+   before they decay into the (slow) subnormal range. */
+static inline bool biquad_state_ok(float *s)
+{
+    for (int i=0; i<2; i++) {
+	if (!isfinite(s[i]) || fabsf(s[i]) > IIR_MAX_STATE) return false;
+	if (fabsf(s[i]) < IIR_FLUSH_STATE) s[i] = 0.0f;
+    }
+    return true;
+}
+
 double iir_sample(IIRFilter *f, double in, int channel)
 {
+    if (f->degree == 2) {
+	const float *c = f->bq_coeffs;
+	float *s = f->bq_state[channel];
+	float x = in;
+	float y = c[0] * x + s[0];
+	s[0] = c[1] * x + c[3] * y + s[1];
+	s[1] = c[2] * x + c[4] * y;
+	if (!biquad_state_ok(s)) {
+	    iir_clear(f);
+	    breakfn();
+	    fprintf(stderr, "IIR cleared! outsample: %f\n", y);
+	    return 0.0;
+	}
+	return y;
+    }
     double out = in * f->A[0];
     for (int i=0; i<f->degree; i++) {
 	int mem_index = (f->mem_index[channel] + i) % f->degree;
@@ -120,8 +163,74 @@ double iir_sample(IIRFilter *f, double in, int channel)
     return out;
 }
 
+static void biquad_run(const float *restrict c, float *restrict s, float *restrict buf, int len)
+{
+    float b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+    float s1 = s[0], s2 = s[1];
+    for (int i=0; i<len; i++) {
+	float x = buf[i];
+	float y = b0 * x + s1;
+	s1 = b1 * x + a1 * y + s2;
+	s2 = b2 * x + a2 * y;
+	buf[i] = y;
+    }
+    s[0] = s1;
+    s[1] = s2;
+}
+
+/* Two independent recursions in one loop, so that each hides the other's latency */
+static void biquad_run_stereo(const float *restrict c, float *restrict sL, float *restrict sR, float *restrict L, float *restrict R, int len)
+{
+    float b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+    float l1 = sL[0], l2 = sL[1];
+    float r1 = sR[0], r2 = sR[1];
+    for (int i=0; i<len; i++) {
+	float xl = L[i];
+	float xr = R[i];
+	float yl = b0 * xl + l1;
+	float yr = b0 * xr + r1;
+	l1 = b1 * xl + a1 * yl + l2;
+	r1 = b1 * xr + a1 * yr + r2;
+	l2 = b2 * xl + a2 * yl;
+	r2 = b2 * xr + a2 * yr;
+	L[i] = yl;
+	R[i] = yr;
+    }
+    sL[0] = l1;
+    sL[1] = l2;
+    sR[0] = r1;
+    sR[1] = r2;
+}
+
+void iir_buf_apply_stereo(IIRFilter *f, float *L, float *R, int len)
+{
+    if (f->degree != 2) {
+	if (L) iir_buf_apply(f, L, len, 0);
+	if (R) iir_buf_apply(f, R, len, 1);
+	return;
+    }
+    if (L && R) {
+	biquad_run_stereo(f->bq_coeffs, f->bq_state[0], f->bq_state[1], L, R, len);
+    } else if (L) {
+	biquad_run(f->bq_coeffs, f->bq_state[0], L, len);
+    } else if (R) {
+	biquad_run(f->bq_coeffs, f->bq_state[1], R, len);
+    }
+    if (!biquad_state_ok(f->bq_state[0]) || !biquad_state_ok(f->bq_state[1])) {
+	iir_clear(f);
+	if (L) memset(L, '\0', len * sizeof(float));
+	if (R) memset(R, '\0', len * sizeof(float));
+	breakfn();
+	fprintf(stderr, "IIR cleared! (buffer of %d)\n", len);
+    }
+}
+
 void iir_buf_apply(IIRFilter *f, float *buf, int len, int channel)
 {
+    if (f->degree == 2) {
+	iir_buf_apply_stereo(f, channel == 0 ? buf : NULL, channel == 0 ? NULL : buf, len);
+	return;
+    }
     for (int i=0; i<len; i++) {
 	buf[i] = iir_sample(f, buf[i], channel);
     }
@@ -142,6 +251,7 @@ void iir_clear(IIRFilter *f)
 	memset(f->mem_in[i], '\0', f->degree * sizeof(double));
 	memset(f->mem_out[i], '\0', f->degree * sizeof(double));
     }
+    memset(f->bq_state, '\0', sizeof(f->bq_state));
 }
 
 
@@ -334,6 +444,7 @@ void biquad_normalize_and_set_coeffs(IIRFilter *iir, double complex norm_freq, d
 
     iir->B[0] = 2 * creal(iir->poles[0]);
     iir->B[1] = -1 * pow(cabs(iir->poles[0]), 2);
+    iir_sync_biquad_coeffs(iir);
 }
 
 int iir_set_coeffs_lowpass(IIRFilter *iir, double freq)
@@ -690,6 +801,14 @@ double iir_group_sample(IIRGroup *group, double in, int channel)
     return in;
 }
 
+void iir_group_buf_apply_stereo(IIRGroup *group, float *L, float *R, int len, const bool *active)
+{
+    for (int i=0; i<group->num_filters; i++) {
+	if (active && !active[i]) continue;
+	iir_buf_apply_stereo(group->filters + i, L, R, len);
+    }
+}
+
 void iir_group_add_freqplot(IIRGroup *group, struct freq_plot *fp)
 {
     for (int i=0; i<group->num_filters; i++) {
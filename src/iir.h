@@ -14,6 +14,14 @@
 
     * Infinite Impulse Response (IIR) filters
     * interface for parameter adjustment and sample- or buffer-wise application
+    * coefficients are computed in double. Biquads (degree 2) also keep a float copy, and run as
+      transposed direct form II in float:
+          y  = b0*x + s1
+          s1 = b1*x + a1*y + s2
+          s2 = b2*x + a2*y
+      (with a1 = B[0], a2 = B[1], following the sign convention of B). Other degrees run in double.
+    * the buf_apply functions process whole buffers, both channels in the same loop, and check the
+      filter state for denormals, NaN and runaway output once per buffer rather than per sample
  *****************************************************************************************************************/
 
 #ifndef JDAW_IIR_H
@@ -42,6 +50,10 @@ typedef struct iir_filter {
     double **mem_out;
     int mem_index[2];
 
+    /* Degree 2 only */
+    float bq_coeffs[5]; /* b0, b1, b2, a1, a2 */
+    float bq_state[2][2]; /* s1, s2 per channel */
+
     bool bypass;
     /* int memOut_index; */
 
@@ -74,6 +86,7 @@ void iir_set_neutral_freq_resp(IIRFilter *iir);
 void iir_set_coeffs(IIRFilter *f, double *A_in, double *B_in);
 double iir_sample(IIRFilter *f, double in, int channel);
 void iir_buf_apply(IIRFilter *f, float *buf, int len, int channel);
+void iir_buf_apply_stereo(IIRFilter *f, float *L, float *R, int len);
 /* void iir_set_coeffs_peaknotch(IIRFilter *iir, double freq, double amp, double bandwidth); */
 int iir_set_coeffs_peaknotch(IIRFilter *iir, double freq, double amp, double bandwidth, double *legal_bandwidth_scalar);
 /* int iir_set_coeffs_lowpass(IIRFilter *iir, double freq); */
@@ -87,6 +100,9 @@ int iir_set_coeffs_highshelf_double(IIRFilter *iir1, IIRFilter *iir2, double fre
 void iir_group_init(IIRGroup *group, int num_filters, int degree, int num_channels);
 void iir_group_deinit(IIRGroup *group);
 double iir_group_sample(IIRGroup *group, double in, int channel);
+/* Cascade all filters for which active[i] is true (or all filters, if active is NULL).
+   Either channel may be NULL. */
+void iir_group_buf_apply_stereo(IIRGroup *group, float *L, float *R, int len, const bool *active);
 void iir_group_update_freq_resp(IIRGroup *group);
 void iir_group_clear(IIRGroup *group);
 void iir_group_add_freqplot(IIRGroup *group, struct freq_plot *fp);
@@ -734,13 +734,14 @@ static void session_init_source_area(Page *source_area, Session *session)
 static void session_init_output_spectrum(Page *output_spectrum, Session *session)
 {
     
+    SpectrumAnalyzer *an = session->proj.output_analyzer;
     double *arrays[] = {
-	session->proj.output_L_freq,
-	session->proj.output_R_freq
+	an->mag[0],
+	an->mag[1]
     };
     int lens[] = {
-	session->proj.fourier_len_sframes,
-	session->proj.fourier_len_sframes
+	an->num_bins,
+	an->num_bins
     };
 
     SDL_Color *plot_colors[] = {&colors.freq_L, &colors.freq_R, &colors.white};
@@ -762,12 +763,13 @@ static void session_init_output_spectrum(Page *output_spectrum, Session *session
     /* p.freqplot_p.colors = plot_colors; */
     /* Project *saved_glob_proj = proj; */
     /* proj = proj_loc; /\* Not great *\/ */
-    page_add_el(
+    PageEl *el = page_add_el(
 	output_spectrum,
 	EL_FREQ_PLOT,
 	p,
 	"panel_output_freqplot",
 	"freqplot");
+    ((struct freq_plot *)el->component)->analyzer = an;
     /* proj=saved_glob_proj; /\* Not great *\/ */
 }
 PageEl *page_add_keybutton(
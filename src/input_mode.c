@@ -245,6 +245,12 @@ static void mode_load_global()
 	"Write main layout to file (debug only)",
 	user_global_debug_write_main_layout);
     mode_subcat_add_fn(mc, fn);
+
+    fn = create_user_fn(
+	"resampler_benchmark",
+	"Benchmark resampler (debug only)",
+	user_global_debug_resampler_benchmark);
+    mode_subcat_add_fn(mc, fn);
     #endif
 
     fn = create_user_fn(
@@ -557,6 +563,36 @@ static void mode_load_timeline()
 	user_tl_lock_view_to_playhead);
     mode_subcat_add_fn(sc, fn);
 
+    fn = create_user_fn(
+	"tl_toggle_record_to_disk",
+	"Toggle record to disk",
+	user_tl_toggle_record_to_disk);
+    mode_subcat_add_fn(sc, fn);
+
+    fn = create_user_fn(
+	"tl_cycle_resample_quality",
+	"Cycle varispeed resampling quality",
+	user_tl_cycle_resample_quality);
+    mode_subcat_add_fn(sc, fn);
+
+    fn = create_user_fn(
+	"tl_cycle_spectrum_resolution",
+	"Cycle output spectrum resolution",
+	user_tl_cycle_spectrum_resolution);
+    mode_subcat_add_fn(sc, fn);
+
+    fn = create_user_fn(
+	"tl_cycle_spectrum_rate",
+	"Cycle output spectrum refresh rate",
+	user_tl_cycle_spectrum_rate);
+    mode_subcat_add_fn(sc, fn);
+
+    fn = create_user_fn(
+	"tl_toggle_dsp_meters",
+	"Toggle track DSP meters",
+	user_tl_toggle_dsp_meters);
+    mode_subcat_add_fn(sc, fn);
+
     /* fn = create_user_fn( */
     /* 	"tl_play_drag", */
     /* 	"Play and drag grabbed clips", */
@@ -691,6 +727,12 @@ static void mode_load_timeline()
         user_tl_add_track);
     mode_subcat_add_fn(sc, fn);
 
+    fn = create_user_fn(
+	"tl_bus_add",
+	"Add bus track",
+	user_tl_add_bus);
+    mode_subcat_add_fn(sc, fn);
+
     fn = create_user_fn(
 	"tl_track_activate_selected",
 	"Activate/deactivate selected track",
@@ -797,6 +839,12 @@ static void mode_load_timeline()
 	"Add effect to track",
 	user_tl_track_add_effect);
     mode_subcat_add_fn(sc, fn);
+
+    fn = create_user_fn(
+	"tl_track_load_impulse_response",
+	"Load impulse response into FIR filter",
+	user_tl_track_load_impulse_response);
+    mode_subcat_add_fn(sc, fn);
     
     fn = create_user_fn(
 	"tl_track_open_settings",
@@ -810,6 +858,12 @@ static void mode_load_timeline()
 	user_tl_track_open_synth);
     mode_subcat_add_fn(sc, fn);
 
+    fn = create_user_fn(
+	"tl_track_freeze",
+	"Freeze or unfreeze selected track",
+	user_tl_track_freeze);
+    mode_subcat_add_fn(sc, fn);
+
     fn = create_user_fn(
 	"tl_mute",
 	"Mute or unmute selected track(s)",
@@ -974,6 +1028,12 @@ static void mode_load_timeline()
 	user_tl_split_stereo_clipref);
     mode_subcat_add_fn(sc, fn);
 
+    fn = create_user_fn(
+	"tl_cycle_clip_storage_fmt",
+	"Cycle storage format (float32, int24, int16) of clip at cursor",
+	user_tl_cycle_clip_storage_fmt);
+    mode_subcat_add_fn(sc, fn);
+
     fn = create_user_fn(
 	"tl_rename_clip_at_cursor",
 	"Rename clip at cursor",
@@ -1014,6 +1074,12 @@ static void mode_load_timeline()
 	user_tl_audio_route_in_quick_add);
     mode_subcat_add_fn(sc, fn);
 
+    fn = create_user_fn(
+	"tl_track_set_bus_out",
+	"Set track output (bus or master)",
+	user_tl_track_set_bus_out);
+    mode_subcat_add_fn(sc, fn);
+
     
     /* Piano roll / MIDI */
 
@@ -11,18 +11,23 @@
 #include <stdlib.h>
 #include <math.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include "audio_clip.h"
 #include "automation.h"
 #include "clipref.h"
 #include "consts.h"
+#include "delay_comp.h"
+#include "dsp_meter.h"
 #include "dsp_utils.h"
 #include "effect.h"
 #include "midi_io.h"
 #include "project.h"
+#include "resampler.h"
 #include "session.h"
 #include "synth.h"
-
-#define AMP_EPSILON 1e-7f
+#include "thread_safety.h"
+#include "track_freeze.h"
+#include "worker_pool.h"
 
 static void make_pan_chunk(float *pan_vals, int32_t len_sframes, uint8_t channel) 
 {
@@ -37,72 +42,43 @@ static void make_pan_chunk(float *pan_vals, int32_t len_sframes, uint8_t channel
     }
 }
 
+/* Write automation values to their endpoints for the chunk. A frozen track's render already
+   includes everything but vol and pan. */
+static void track_read_automations(Track *track, int32_t start_pos_sframes, uint32_t output_chunk_len_sframes, float step, bool vol_pan_only)
+{
+    for (int i=0; i<track->num_automations; i++) {
+	Automation *a = track->automations[i];
+	Endpoint *ep = a->endpoint;
+	if (!ep) continue;
+	if (vol_pan_only && ep != &track->vol_ep && ep != &track->pan_ep) continue;
+	if (!a->read || a->write) {
+	    ep->block_vals_len = 0;
+	    continue;
+	}
+	Value val;
+	if (ep->block_vals && ep->block_vals_alloc_len >= output_chunk_len_sframes) {
+	    automation_get_range(a, ep->block_vals, output_chunk_len_sframes, start_pos_sframes, step);
+	    ep->block_vals_len = output_chunk_len_sframes;
+	    val = jdaw_val_from_ptr(ep->block_vals, a->val_type);
+	} else {
+	    val = automation_get_value(a, start_pos_sframes, step);
+	}
+	/* endpoint_write would return EP_WRITE_NO_CHANGE; skip its locking and range checks */
+	if (ep->write_has_occurred && jdaw_val_equal(ep->last_write_val, val, ep->val_type)) continue;
+	endpoint_write(ep, val, true, true, true, false);
+    }
+}
+
 /* double timespec_elapsed_ms(const struct timespec *start, const struct timespec *end); */
-static float get_track_mixdown_chunk(Track *track, float *restrict L, float *restrict R, int32_t start_pos_sframes, uint32_t output_chunk_len_sframes, float step)
+float mixdown_track_prefader_chunk(Track *track, float *restrict L, float *restrict R, int32_t start_pos_sframes, uint32_t output_chunk_len_sframes, float step)
 {
     Session *session = session_get();
     uint32_t chunk_bytelen = sizeof(float) * output_chunk_len_sframes;
     memset(L, '\0', chunk_bytelen);
     if (R)
 	memset(R, '\0', chunk_bytelen);
-    if (track->muted || track->solo_muted) {
-	return 0.0f;
-    }
-
-    /************************* VOL/PAN AUTOMATION *************************/
-    Automation *vol_auto = NULL;
-    Automation *pan_auto = NULL;
-    
-    for (uint8_t i=0; i<track->num_automations; i++) {
-	Automation *a = track->automations[i];
-	if (a->type == AUTO_VOL) vol_auto = a;
-	else if (a->type == AUTO_PAN) pan_auto = a;
-	if (a->endpoint == &track->vol_ep) vol_auto = a;
-	else if (a->endpoint == &track->pan_ep) pan_auto = a;
-    }
-
-    for (int i=0; i<track->num_automations; i++) {
-	Automation *a = track->automations[i];
-	if (a->read && !a->write && a->endpoint) {
-	    Value val = automation_get_value(a, start_pos_sframes, step);	    
-	    endpoint_write(a->endpoint, val, true, true, true, false);
-	}
-    }
-
-    float vol_vals[output_chunk_len_sframes];
-    float pan_vals[2][output_chunk_len_sframes];
 
-    /* Construct volume buffer for linear scaling */
-    if (vol_auto && !vol_auto->write && vol_auto->read) {
-	automation_get_range(vol_auto, vol_vals, output_chunk_len_sframes, start_pos_sframes, step);
-	for (int i=0; i<output_chunk_len_sframes; i++) {
-	    vol_vals[i] = pow(vol_vals[i], VOL_EXP);
-	}
-    } else {
-	/* Value vol_val = endpoint_safe_read(&track->vol_ep, NULL); */
-	/* float vol_val = track-> */
-	for (int i=0; i<output_chunk_len_sframes; i++) {
-	    vol_vals[i] = pow(track->vol, VOL_EXP);
-	}
-    }
-
-    /* Construct pan buffer for linear scaling */
-    if (pan_auto && !pan_auto->write && pan_auto->read) {
-	automation_get_range(pan_auto, pan_vals[0], output_chunk_len_sframes, start_pos_sframes, step);
-	memcpy(pan_vals[1], pan_vals[0], output_chunk_len_sframes * sizeof(float));
-	make_pan_chunk(pan_vals[0], output_chunk_len_sframes, 0);
-	make_pan_chunk(pan_vals[1], output_chunk_len_sframes, 1);
-    } else {
-	Value pan_val = endpoint_safe_read(&track->pan_ep, NULL);
-	float pan_scale[2] = {pan_val.float_v, pan_val.float_v};
-	pan_scale[0] = pan_scale[0] <= 0.5 ? 1.0 : (1.0f - pan_scale[0]) * 2;
-	pan_scale[1] = pan_scale[1] >= 0.5 ? 1.0 : pan_scale[1] * 2;    
-	    
-	for (int i=0; i<output_chunk_len_sframes; i++) {
-	    pan_vals[0][i] = pan_scale[0];
-	    pan_vals[1][i] = pan_scale[1];
-	}
-    }
+    track_read_automations(track, start_pos_sframes, output_chunk_len_sframes, step, false);
 
     /* float total_amp = 0.0f; */
 
@@ -176,7 +152,19 @@ static float get_track_mixdown_chunk(Track *track, float *restrict L, float *res
 		}
 	    }
 	}
-	if (clip) {
+	if (clip && fabs(step) != 1.0f) {
+	    /* Read only within the clipref's bounds, so the interpolation kernel doesn't reach trimmed audio */
+	    int32_t src_len = clip->len_sframes - cr->start_in_clip;
+	    if (src_len > cr_len) src_len = cr_len;
+	    const ResamplerBank *bank = resampler_playback_bank(session->playback.resample_quality, step);
+	    for (int channel=0; channel<2; channel++) {
+		float *clip_buf = channel == 0 ? clip->L : clip->R;
+		if (clip->channels < 2 && channel == 1) clip_buf = clip->L; 
+		float *restrict chunk = channel == 0 ? L : R;
+		if (!chunk) continue;
+		resampler_mix(bank, clip_buf + cr->start_in_clip, src_len, pos_in_clip_sframes, step, chunk, output_chunk_len_sframes, cr->gain);
+	    }
+	} else if (clip) {
 	    /* Get clip audio data */
 	    double start_pos_in_clip_sframes = pos_in_clip_sframes;
 	    for (int channel=0; channel<2; channel++) {
@@ -187,22 +175,12 @@ static float get_track_mixdown_chunk(Track *track, float *restrict L, float *res
 		float *restrict chunk = channel == 0 ? L : R;
 		while (chunk_i < output_chunk_len_sframes) {
 		    if (pos_in_clip_sframes > 0 && pos_in_clip_sframes < cr_len - 1) { /* Truncate last sample to allow for interpolation */
-			float sample;
 			double clip_index_f = pos_in_clip_sframes + (double)cr->start_in_clip;
                         if ((int)clip_index_f >= clip->len_sframes) {
                             chunk_i++;
                             continue;
                         } 
- 			if (fabs(step) != 1.0f) {
-			    int index_left = (int)floor(clip_index_f);
-			    double diff_left = clip_index_f - (double)index_left;
-			    double diff = clip_buf[index_left + 1] - clip_buf[index_left];
-			    sample = clip_buf[index_left] + diff_left * diff;
-			} else {
-			    sample = clip_buf[(int)clip_index_f];
-			}
-			sample *= cr->gain;
-			chunk[chunk_i] += sample;
+			chunk[chunk_i] += clip_buf[(int)clip_index_f] * cr->gain;
 			/* total_amp += fabs(chunk[chunk_i]); */
 		    }
 		    pos_in_clip_sframes += step;
@@ -213,11 +191,6 @@ static float get_track_mixdown_chunk(Track *track, float *restrict L, float *res
 	pthread_mutex_unlock(&cr->lock);
     }
 
-    for (int i=0; i<track->num_route_ins; i++) {
-	AudioRoute *r = track->route_ins[i];	
-	float_buf_mix_in(track->buf_L, r->src->buf_L, r->amp, output_chunk_len_sframes);
-	float_buf_mix_in(track->buf_R, r->src->buf_R, r->amp, output_chunk_len_sframes);
-    }
     /* clock_gettime(CLOCK_REALTIME, &tspec_end); */
     /* double elapsed_ms = timespec_elapsed_ms(&tspec_start, &tspec_end); */
     /* if (elapsed_ms > 0.04) { */
@@ -245,25 +218,94 @@ static float get_track_mixdown_chunk(Track *track, float *restrict L, float *res
     /* 	fprintf(stderr, "\tSynth %f\n", elapsed_ms); */
     /* } */
 
+    /* Line up the track's own audio with its latest-arriving input; then mix in the inputs, each
+       delayed to arrive at the same time */
+    comp_delay_apply(&track->delay_comp.content, L, R, output_chunk_len_sframes);
+    for (int i=0; i<track->num_route_ins; i++) {
+	AudioRoute *r = track->route_ins[i];	
+	comp_delay_mix_in(&r->delay, L, R, r->src->buf_L, r->src->buf_R, r->amp, output_chunk_len_sframes);
+    }
+    for (int i=0; i<track->num_bus_ins; i++) {
+	Track *in = track->bus_ins[i];
+	if (!in->send_to_out) continue;
+	comp_delay_mix_in(&in->delay_comp.out, L, R, in->buf_L, in->buf_R, 1.0f, output_chunk_len_sframes);
+    }
 
-
-    /* TODO: buses */
-    /* float bus_buf[output_chunk_len_sframes]; */
-    /* for (uint8_t i=0; i<track->num_bus_ins; i++) { */
-    /* 	Track *bus_in = track->bus_ins[i]; */
-    /* 	float amp = get_track_mixdown_chunk(bus_in, bus_buf, channel, start_pos_sframes, output_chunk_len_sframes, step); */
-    /* 	if (amp > 0.0) { */
-    /* 	    float_buf_add(chunk, bus_buf, output_chunk_len_sframes); */
-    /* 	    total_amp += amp; */
-    /* 	} */
-    /* } */
-    float total_amp = 0.0f;
-    for (int32_t i=0; i<output_chunk_len_sframes; i++) {
-	total_amp += fabs(track->buf_L[i]) + fabs(track->buf_R[i]);
+    float total_amp = float_buf_abs_sum(track->buf_L, output_chunk_len_sframes)
+	+ float_buf_abs_sum(track->buf_R, output_chunk_len_sframes);
+    /* Nothing in, and no effect tails left to ring out: the whole track is silent */
+    if (total_amp <= AMP_EPSILON && effect_chain_is_idle(&track->effect_chain)) {
+	return 0.0f;
     }
     total_amp += effect_chain_buf_apply(&track->effect_chain, L, R, output_chunk_len_sframes, total_amp);
     /* total_amp = effect_chain_buf_apply(track->effects, track->num_effects, chunk, output_chunk_len_sframes, channel, total_amp); */
+    return total_amp;
+}
+
+static float track_mixdown_chunk_unmetered(Track *track, float *restrict L, float *restrict R, int32_t start_pos_sframes, uint32_t output_chunk_len_sframes, float step)
+{
+    if (track->muted || track->solo_muted) {
+	memset(L, '\0', sizeof(float) * output_chunk_len_sframes);
+	if (R)
+	    memset(R, '\0', sizeof(float) * output_chunk_len_sframes);
+	return 0.0f;
+    }
+
+    /************************* VOL/PAN AUTOMATION *************************/
+    Automation *vol_auto = NULL;
+    Automation *pan_auto = NULL;
+    
+    for (uint8_t i=0; i<track->num_automations; i++) {
+	Automation *a = track->automations[i];
+	if (a->type == AUTO_VOL) vol_auto = a;
+	else if (a->type == AUTO_PAN) pan_auto = a;
+	if (a->endpoint == &track->vol_ep) vol_auto = a;
+	else if (a->endpoint == &track->pan_ep) pan_auto = a;
+    }
+
+    float total_amp;
+    if (track_freeze_read(track, L, R, start_pos_sframes, output_chunk_len_sframes, step, &total_amp)) {
+	track_read_automations(track, start_pos_sframes, output_chunk_len_sframes, step, true);
+    } else {
+	total_amp = mixdown_track_prefader_chunk(track, L, R, start_pos_sframes, output_chunk_len_sframes, step);
+    }
     if (total_amp > AMP_EPSILON) {
+	float vol_vals[output_chunk_len_sframes];
+	float pan_vals[2][output_chunk_len_sframes];
+
+	/* Construct volume buffer for linear scaling */
+	if (vol_auto && !vol_auto->write && vol_auto->read) {
+	    automation_get_range(vol_auto, vol_vals, output_chunk_len_sframes, start_pos_sframes, step);
+	    for (int i=0; i<output_chunk_len_sframes; i++) {
+		vol_vals[i] = pow(vol_vals[i], VOL_EXP);
+	    }
+	} else {
+	    /* Value vol_val = endpoint_safe_read(&track->vol_ep, NULL); */
+	    /* float vol_val = track-> */
+	    float vol = pow(track->vol, VOL_EXP);
+	    for (int i=0; i<output_chunk_len_sframes; i++) {
+		vol_vals[i] = vol;
+	    }
+	}
+
+	/* Construct pan buffer for linear scaling */
+	if (pan_auto && !pan_auto->write && pan_auto->read) {
+	    automation_get_range(pan_auto, pan_vals[0], output_chunk_len_sframes, start_pos_sframes, step);
+	    memcpy(pan_vals[1], pan_vals[0], output_chunk_len_sframes * sizeof(float));
+	    make_pan_chunk(pan_vals[0], output_chunk_len_sframes, 0);
+	    make_pan_chunk(pan_vals[1], output_chunk_len_sframes, 1);
+	} else {
+	    Value pan_val = endpoint_safe_read(&track->pan_ep, NULL);
+	    float pan_scale[2] = {pan_val.float_v, pan_val.float_v};
+	    pan_scale[0] = pan_scale[0] <= 0.5 ? 1.0 : (1.0f - pan_scale[0]) * 2;
+	    pan_scale[1] = pan_scale[1] >= 0.5 ? 1.0 : pan_scale[1] * 2;    
+	    
+	    for (int i=0; i<output_chunk_len_sframes; i++) {
+		pan_vals[0][i] = pan_scale[0];
+		pan_vals[1][i] = pan_scale[1];
+	    }
+	}
+
 	float_buf_mult(L, vol_vals, output_chunk_len_sframes);
 	float_buf_mult(R, vol_vals, output_chunk_len_sframes);
 	float_buf_mult(L, pan_vals[0], output_chunk_len_sframes);
@@ -272,6 +314,144 @@ static float get_track_mixdown_chunk(Track *track, float *restrict L, float *res
     return total_amp;
 }
 
+/* Times the track for its DSP meter (see dsp_meter.h) while the DSP thread is running */
+static float get_track_mixdown_chunk(Track *track, float *restrict L, float *restrict R, int32_t start_pos_sframes, uint32_t output_chunk_len_sframes, float step)
+{
+    if (!dsp_meter_measuring()) {
+	return track_mixdown_chunk_unmetered(track, L, R, start_pos_sframes, output_chunk_len_sframes, step);
+    }
+    int64_t start_nsec = dsp_meter_now_nsec();
+    float amp = track_mixdown_chunk_unmetered(track, L, R, start_pos_sframes, output_chunk_len_sframes, step);
+    dsp_meter_add(&track->dsp_meter, dsp_meter_now_nsec() - start_nsec);
+    return amp;
+}
+
+
+/*****************************************************************************************************************
+    Parallel track scheduling
+
+    * the route graph (track->routes, plus each track's bus_out) is snapshotted into a DAG at the
+      start of each chunk
+    * tracks with no pending route ins are "ready"; a fixed number of identical jobs run on the
+      mixdown worker pool, each repeatedly popping a ready track, rendering it, and decrementing
+      the pending count of each of its route dsts. A dst becomes ready when its count hits zero,
+      so its route_ins and bus_ins are only mixed after all of its sources have finished for the
+      chunk.
+    * only edges pointing forward in tracks_proc_order are kept. Routes are edited on the main
+      thread while this runs; dropping out-of-order edges guarantees the snapshot is acyclic
+      (and therefore that every track becomes ready) even if it observes a half-applied edit
+ *****************************************************************************************************************/
+
+struct mixdown_sched {
+    Timeline *tl;
+    int num_tracks;
+    int32_t start_pos_sframes;
+    uint32_t len_sframes;
+    float step;
+    enum jdaw_thread delegate_for;
+    float *track_amps;
+
+    int *dsts_start; /* Track i's dsts are dsts[dsts_start[i]] ... dsts[dsts_start[i + 1] - 1] */
+    int *dsts;
+    atomic_int *pending;
+    atomic_int *ready; /* Indices of ready tracks, in order they became ready; -1 if unfilled */
+    atomic_int ready_write;
+    atomic_int ready_read;
+};
+
+static void mixdown_sched_push_ready(struct mixdown_sched *ms, int track_i)
+{
+    int slot = atomic_fetch_add_explicit(&ms->ready_write, 1, memory_order_relaxed);
+    atomic_store_explicit(ms->ready + slot, track_i, memory_order_release);
+}
+
+static void mixdown_sched_job(void *arg)
+{
+    struct mixdown_sched *ms = arg;
+    thread_delegate_begin(ms->delegate_for);
+    while (1) {
+	int slot = atomic_fetch_add_explicit(&ms->ready_read, 1, memory_order_relaxed);
+	if (slot >= ms->num_tracks) break;
+	int t;
+	while ((t = atomic_load_explicit(ms->ready + slot, memory_order_acquire)) < 0) {
+	    CPU_RELAX();
+	}
+	Track *track = ms->tl->tracks_proc_order[t];
+	ms->track_amps[t] = get_track_mixdown_chunk(track, track->buf_L, track->buf_R, ms->start_pos_sframes, ms->len_sframes, ms->step);
+	for (int i=ms->dsts_start[t]; i<ms->dsts_start[t + 1]; i++) {
+	    int dst = ms->dsts[i];
+	    if (atomic_fetch_sub_explicit(ms->pending + dst, 1, memory_order_acq_rel) == 1) {
+		mixdown_sched_push_ready(ms, dst);
+	    }
+	}
+    }
+    thread_delegate_end();
+}
+
+static void get_track_mixdown_chunks_parallel(Timeline *tl, WorkerPool *pool, float *track_amps, int32_t start_pos_sframes, uint32_t len_sframes, float step)
+{
+    int num_tracks = tl->num_tracks;
+    int num_edges = 0;
+    for (int t=0; t<num_tracks; t++) {
+	num_edges += tl->tracks_proc_order[t]->num_routes + 1;
+    }
+    int dsts_start[num_tracks + 1];
+    int dsts[num_edges + 1];
+    atomic_int pending[num_tracks];
+    atomic_int ready[num_tracks];
+
+    struct mixdown_sched ms;
+    ms.tl = tl;
+    ms.num_tracks = num_tracks;
+    ms.start_pos_sframes = start_pos_sframes;
+    ms.len_sframes = len_sframes;
+    ms.step = step;
+    ms.delegate_for = current_thread();
+    ms.track_amps = track_amps;
+    ms.dsts_start = dsts_start;
+    ms.dsts = dsts;
+    ms.pending = pending;
+    ms.ready = ready;
+    atomic_init(&ms.ready_write, 0);
+    atomic_init(&ms.ready_read, 0);
+
+    /* Build the DAG */
+    int num_route_ins[num_tracks];
+    memset(num_route_ins, 0, sizeof(num_route_ins));
+    int edge_i = 0;
+    for (int t=0; t<num_tracks; t++) {
+	Track *track = tl->tracks_proc_order[t];
+	dsts_start[t] = edge_i;
+	int num_routes = track->num_routes;
+	Track *bus_out = track->bus_out;
+	for (int r=0; r<=num_routes && edge_i < num_edges; r++) {
+	    Track *dst = r < num_routes ? track->routes[r]->dst : bus_out;
+	    if (!dst) continue;
+	    for (int d=t+1; d<num_tracks; d++) {
+		if (tl->tracks_proc_order[d] == dst) {
+		    dsts[edge_i] = d;
+		    edge_i++;
+		    num_route_ins[d]++;
+		    break;
+		}
+	    }
+	}
+    }
+    dsts_start[num_tracks] = edge_i;
+    for (int t=0; t<num_tracks; t++) {
+	atomic_init(pending + t, num_route_ins[t]);
+	atomic_init(ready + t, -1);
+    }
+    for (int t=0; t<num_tracks; t++) {
+	if (num_route_ins[t] == 0) {
+	    mixdown_sched_push_ready(&ms, t);
+	}
+    }
+
+    int num_jobs = worker_pool_num_workers(pool) + 1;
+    if (num_jobs > num_tracks) num_jobs = num_tracks;
+    worker_pool_run(pool, mixdown_sched_job, &ms, 0, num_jobs);
+}
 
 /* clock_t start; */
 /* double pre_track; */
@@ -297,12 +477,16 @@ void get_mixdown_chunk(Timeline* tl, float *restrict mixdown_L, float *restrict
     if (mixdown_R)
 	memset(mixdown_R, '\0', chunk_len_bytes);
 
+    /* Read ahead by the latency at master, so that compensated output lines up with start_pos */
+    start_pos_sframes += atomic_load(&tl->delay_comp_sframes) * step;
+
     int32_t end_pos_sframes = start_pos_sframes + len_sframes * step;
     for (uint8_t i=0; i<tl->num_click_tracks; i++) {
 	ClickTrack *tt = tl->click_tracks[i];
 	click_track_mix_metronome(tt, mixdown_L, len_sframes, start_pos_sframes, end_pos_sframes, step, 0);
 	click_track_mix_metronome(tt, mixdown_R, len_sframes, start_pos_sframes, end_pos_sframes, step, 1);
     }
+    comp_delay_apply(&tl->click_delay, mixdown_L, mixdown_R, len_sframes);
 
     
     /* static AllpassGroup diffuser[2]; */
@@ -320,26 +504,26 @@ void get_mixdown_chunk(Timeline* tl, float *restrict mixdown_L, float *restrict
     /* 	lop_delay_init(lop_delay + 1, 20000, 0.99, 0.2); */
     /* } */
     
+    float track_amps[tl->num_tracks];
+    WorkerPool *pool = session_get()->sys.mixdown_pool;
+    if (tl->num_tracks > 1 && worker_pool_num_workers(pool) > 0) {
+	get_track_mixdown_chunks_parallel(tl, pool, track_amps, start_pos_sframes, len_sframes, step);
+    } else {
+	for (uint8_t t=0; t<tl->num_tracks; t++) {
+	    Track *track = tl->tracks_proc_order[t];
+	    track_amps[t] = get_track_mixdown_chunk(track, track->buf_L, track->buf_R, start_pos_sframes, len_sframes, step);
+	}
+    }
+
+    /* Sum in proc order regardless of how tracks were scheduled, so output is deterministic */
     for (uint8_t t=0; t<tl->num_tracks; t++) {
-	bool audio_in_track = false;
         Track *track = tl->tracks_proc_order[t];
-
-	/* Track will be processed as a bus in */
-	/* if (track->bus_out) { */
-	/*     continue; */
-	/* } */
-	
-	/* float track_chunk_L[len_sframes]; */
-	/* float track_chunk_R[len_sframes]; */
-
-        float track_chunk_amp = get_track_mixdown_chunk(track, track->buf_L, track->buf_R, start_pos_sframes, len_sframes, step);
-	    	
-	if (track_chunk_amp > AMP_EPSILON) { /* Checks if any clip audio available */
-	    audio_in_track = true;
-	}
-	if (audio_in_track && track->send_to_out) {
-	    float_buf_add(mixdown_L, track->buf_L, len_sframes);
-	    float_buf_add(mixdown_R, track->buf_R, len_sframes);
+	bool audio_in_track = track_amps[t] > AMP_EPSILON; /* Checks if any clip audio available */
+	if (track->send_to_out && !track->bus_out) {
+	    /* A delayed track must run through its delay even when silent, to keep its history current */
+	    if (audio_in_track || atomic_load_explicit(&track->delay_comp.out.buf, memory_order_relaxed)) {
+		comp_delay_mix_in(&track->delay_comp.out, mixdown_L, mixdown_R, track->buf_L, track->buf_R, 1.0f, len_sframes);
+	    }
 	}
     }
 
@@ -378,3 +562,18 @@ void get_mixdown_chunk(Timeline* tl, float *restrict mixdown_L, float *restrict
 
     /* return mixdown; */
 }
+
+void mixdown_preroll_delay_comp(Timeline *tl, int32_t start_pos_sframes, uint32_t chunk_len_sframes, float step)
+{
+    int32_t remaining = atomic_load(&tl->delay_comp_sframes);
+    if (remaining <= 0) return;
+    float L[chunk_len_sframes];
+    float R[chunk_len_sframes];
+    int32_t pos = start_pos_sframes - remaining * step;
+    while (remaining > 0) {
+	uint32_t n = (uint32_t)remaining < chunk_len_sframes ? (uint32_t)remaining : chunk_len_sframes;
+	get_mixdown_chunk(tl, L, R, n, pos, step);
+	pos += n * step;
+	remaining -= n;
+    }
+}
@@ -21,3 +21,13 @@
 
 /* float *get_mixdown_chunk(Timeline* tl, float *mixdown, uint8_t channel, uint32_t len_sframes, int32_t start_pos_sframes, float step); */
 void get_mixdown_chunk(Timeline* tl, float *restrict mixdown_L, float *restrict mixdown_R, uint32_t len_sframes, int32_t start_pos_sframes, float step);
+
+/* get_mixdown_chunk reads ahead by the latency at master, and the compensating delays start empty
+   after timeline_full_pause. Render the chunks that would have ended at start_pos_sframes and discard
+   the output, so that the first real chunk isn't preceded by that much silence. Call before the
+   first get_mixdown_chunk of a playback or render. */
+void mixdown_preroll_delay_comp(Timeline *tl, int32_t start_pos_sframes, uint32_t chunk_len_sframes, float step);
+
+/* A track's output before volume and pan: clips, routes in, synth, and effects, with automations read.
+   L and R must be the track's own buffers (track->buf_L, track->buf_R). */
+float mixdown_track_prefader_chunk(Track *track, float *restrict L, float *restrict R, int32_t start_pos_sframes, uint32_t output_chunk_len_sframes, float step);
@@ -130,6 +130,12 @@ void mod_delay_init(ModDelay *md, int32_t max_len, double init_amp, double init_
     md->phase_incr = init_freq * TAU / session_get_sample_rate();
 }
 
+int32_t mod_delay_latency_sframes(ModDelay *md)
+{
+    /* Taps read MD_SPACER_SAMPLES + center_samples * (1 + osc) behind the write head; osc averages 0 */
+    return MD_SPACER_SAMPLES + (int32_t)(md->amp * md->max_len / 2.0);
+}
+
 void mod_delay_set_amp(ModDelay *md, double new_amp)
 {
 
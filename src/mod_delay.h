@@ -52,6 +52,9 @@ void mod_delay_init(ModDelay *md, int32_t max_len, double init_amp, double init_
 void mod_delay_set_amp(ModDelay *md, double new_amp);
 void mod_delay_set_freq(ModDelay *md, double new_freq_hz);
 
+/* Mean delay of the taps, at the current amp. Approximate if read outside the DSP thread. */
+int32_t mod_delay_latency_sframes(ModDelay *md);
+
 void mod_delay_clear(ModDelay *md);
 void mod_delay_deinit(ModDelay *md);
 #endif
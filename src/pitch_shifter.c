@@ -44,6 +44,11 @@ float pitch_shifter_buf_apply(void *ps_v, float *restrict L, float *restrict R,
     return input_amp;   
 }
 
+int32_t pitch_shifter_latency_sframes(PitchShifter *ps)
+{
+    return mod_delay_latency_sframes(&ps->mdL);
+}
+
 void pitch_shifter_clear(PitchShifter *ps)
 {
     mod_delay_clear(&ps->mdL);
@@ -31,6 +31,7 @@ void pitch_shifter_set_quality(PitchShifter *ps, double quality);
 void pitch_shifter_set_shift_amt(PitchShifter *ps, double shift_cents);
 float pitch_shifter_buf_apply(void *ps_v, float *restrict L, float *restrict R, int len, float input_amp);
 void pitch_shifter_clear(PitchShifter *ps);
+int32_t pitch_shifter_latency_sframes(PitchShifter *ps);
 void pitch_shifter_deinit(PitchShifter *ps);
 
 
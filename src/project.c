@@ -23,6 +23,7 @@
 #include "components.h"
 /* #include "dsp.h" */
 #include "dir.h"
+#include "dot_jdaw.h"
 #include "endpoint_callbacks.h"
 #include "endpoint.h"
 #include "endpoint_callbacks.h"
@@ -337,6 +338,7 @@ static void timeline_destroy(Timeline *tl, bool displace_in_proj)
     }
     if (tl->buf_L) free(tl->buf_L);
     if (tl->buf_R) free(tl->buf_R);
+    comp_delay_deinit(&tl->click_delay);
 
     /* if (tl->timecode_tb) textbox_destroy(tl->timecode_tb); */
     /* if (tl->loop_play_lemniscate) textbox_destroy(tl->loop_play_lemniscate); */
@@ -369,6 +371,7 @@ static void timeline_destroy(Timeline *tl, bool displace_in_proj)
 
 void project_deinit(Project *proj)
 {
+    jdaw_save_wait();
     /* fprintf(stdout, "PROJECT_DESTROY num tracks: %d\n", proj->timelines[0]->num_tracks); */
     for (uint16_t i=0; i<proj->num_clips; i++) {
 	clip_destroy_no_displace(proj->clips[i]);
@@ -383,8 +386,7 @@ void project_deinit(Project *proj)
 
     free(proj->output_L);
     free(proj->output_R);
-    free(proj->output_L_freq);
-    free(proj->output_R_freq);
+    spectrum_analyzer_destroy(proj->output_analyzer);
 }
 
 void project_reset_tl_label(Project *proj)
@@ -452,8 +454,7 @@ int project_init(
 
     proj->output_L = malloc(sizeof(float) * fourier_len_sframes);
     proj->output_R = malloc(sizeof(float) * fourier_len_sframes);
-    proj->output_L_freq = malloc(sizeof(double) * fourier_len_sframes);
-    proj->output_R_freq  = malloc(sizeof(double) * fourier_len_sframes);
+    proj->output_analyzer = spectrum_analyzer_create(2, fourier_len_sframes);
     memset(proj->output_L, '\0', sizeof(float) * fourier_len_sframes);
     memset(proj->output_R, '\0', sizeof(float) * fourier_len_sframes);
 
@@ -830,6 +831,8 @@ Track *timeline_add_track_with_name(Timeline *tl, const char *track_name, int at
     endpoint_set_label_fn(&track->pan_ep, label_pan);
     api_endpoint_register(&track->pan_ep, &track->api_node);
 
+    dsp_meter_init(&track->dsp_meter, &track->api_node);
+
 
     endpoint_init(
 	&track->send_to_out_ep,
@@ -1111,6 +1114,20 @@ Track *timeline_add_track(Timeline *tl, int at)
     return timeline_add_track_with_name(tl, name, at);
 }
 
+Track *timeline_add_bus(Timeline *tl, int at)
+{
+    if (tl->num_tracks == MAX_TRACKS) return NULL;
+    int num_buses = 0;
+    for (int i=0; i<tl->num_tracks; i++) {
+	if (tl->tracks[i]->is_bus) num_buses++;
+    }
+    char name[MAX_NAMELENGTH];
+    snprintf(name, sizeof(name), "Bus %d", num_buses + 1);
+    Track *track = timeline_add_track_with_name(tl, name, at);
+    if (track) track->is_bus = true;
+    return track;
+}
+
 
 void project_clear_active_clips()
 {
@@ -1415,13 +1432,35 @@ void track_unsolomute(Track *track)
 
 
 
+/* A bus carrying a soloed track must stay audible */
+static bool bus_has_solo_in(Track *bus)
+{
+    for (int i=0; i<bus->num_bus_ins; i++) {
+	Track *in = bus->bus_ins[i];
+	if (in->solo || bus_has_solo_in(in)) return true;
+    }
+    return false;
+}
+
+/* So must the inputs of a soloed bus, direct or through other buses */
+static bool track_feeds_solo_bus(Track *track)
+{
+    for (Track *bus = track->bus_out; bus; bus = bus->bus_out) {
+	if (bus->solo) return true;
+    }
+    return false;
+}
+
 static void rectify_solomute(Timeline *tl, int solo_count)
 {
     Track *track;
     if (solo_count > 0) {
 	for (uint8_t i=0; i<tl->num_tracks; i++) {
 	    track = tl->tracks[i];
-	    if (!track->solo) {
+	    if (track->solo) continue;
+	    if (bus_has_solo_in(track) || track_feeds_solo_bus(track)) {
+		track_unsolomute(track);
+	    } else {
 		track_solomute(track);
 	    }
 	}
@@ -1435,6 +1474,15 @@ static void rectify_solomute(Timeline *tl, int solo_count)
     }
 }
 
+void timeline_rectify_solomute(Timeline *tl)
+{
+    int solo_count = 0;
+    for (uint8_t i=0; i<tl->num_tracks; i++) {
+	if (tl->tracks[i]->solo) solo_count++;
+    }
+    rectify_solomute(tl, solo_count);
+}
+
 
 static NEW_EVENT_FN(undo_redo_tracks_mute, "undo/redo mute track")
     Track **tracks = (Track **)obj1;
@@ -2115,6 +2163,8 @@ void track_destroy(Track *track, bool displace)
     }
 
     effect_chain_deinit(&track->effect_chain);
+    track_freeze_deinit(track);
+    track_delay_comp_deinit(track);
 
     free(track->buf_L);
     free(track->buf_R);
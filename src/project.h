@@ -27,6 +27,8 @@
 #include "api.h"
 #include "automation.h"
 #include "components.h"
+#include "delay_comp.h"
+#include "dsp_meter.h"
 #include "effect.h"
 #include "eq.h"
 #include "endpoint.h"
@@ -36,8 +38,10 @@
 #include "tempo.h"
 #include "timeview.h"
 #include "saturation.h"
+#include "spectrum_analyzer.h"
 #include "synth.h"
 #include "textbox.h"
+#include "track_freeze.h"
 
 #define MAX_TRACKS 255
 #define MAX_TRACK_CLIPS 2048
@@ -216,12 +220,19 @@ typedef struct track {
     Endpoint vol_ep;
     Endpoint pan_ep;
 
+    /* Offline render played in place of live DSP (see track_freeze.h) */
+    TrackFreeze freeze;
+
+    TrackDelayComp delay_comp;
+
+    DSPMeter dsp_meter; /* Time spent in get_track_mixdown_chunk, including effects */
+
 
     /* Routing */
-    /* Track *bus_out; */
-    /* Track **bus_ins; */
-    /* uint8_t bus_ins_arrlen; */
-    /* uint8_t num_bus_ins; */
+    bool is_bus; /* No clips; input is the summed output of bus_ins */
+    Track *bus_out; /* Post-fader output goes here instead of master if non-NULL */
+    Track *bus_ins[MAX_TRACK_BUS_INS]; /* foreign ptrs */
+    uint8_t num_bus_ins;
 
     const char* added_from_midi_filepath;
 } Track;
@@ -383,6 +394,10 @@ typedef struct timeline {
     bool needs_redraw;
     bool needs_reset; /* trigger reset from another thread */
 
+    /* Delay compensation (see delay_comp.h) */
+    atomic_int delay_comp_sframes; /* Total latency at master; the mixdown reads this far ahead */
+    CompDelay click_delay;
+
     /* API */
 
     APINode api_node;
@@ -416,8 +431,7 @@ typedef struct project {
     /* Output buffers */
     float *output_L;
     float *output_R;
-    double *output_L_freq;
-    double *output_R_freq;
+    SpectrumAnalyzer *output_analyzer;
     EnvelopeFollower output_L_ef;
     EnvelopeFollower output_R_ef;
 } Project;
@@ -439,6 +453,7 @@ void project_reset_tl_label(Project *proj);
 void project_set_chunk_size(uint16_t new_chunk_size);
 Track *timeline_add_track(Timeline *tl, int at);
 Track *timeline_add_track_with_name(Timeline *tl, const char *track_name, int at);
+Track *timeline_add_bus(Timeline *tl, int at);
 
 Track *timeline_selected_track(Timeline *tl);
 void timeline_select_track(Track *track);
@@ -469,6 +484,8 @@ bool track_mute(Track *track);
 bool track_solo(Track *track);
 void track_solomute(Track *track);
 void track_unsolomute(Track *track);
+/* Re-derive solo mutes from the current solos and bus routing */
+void timeline_rectify_solomute(Timeline *tl);
 
 /* Explicitly provide an audio connection or MIDI device */
 void track_set_input_to(Track *track, enum track_in_type type, void *obj);
@@ -478,7 +495,6 @@ void track_set_input(Track *track);
 void track_set_out_builtin_synth(Track *track);
 void track_set_midi_out(Track *track);
 void track_rename(Track *track);
-/* void track_set_bus_out(Track *track, Track *bus_out); */
 void track_delete(Track *track);
 void track_undelete(Track *track);
 void track_destroy(Track *track, bool displace);
@@ -32,6 +32,8 @@
 #define CURSOR_W_PIX (10 * main_win->dpi_scale_factor + 1)
 /* #define CURSOR_W_PIX (40 * main_win->dpi_scale_factor) */
 #define CURSOR_CORNER_R (2 * main_win->dpi_scale_factor)
+#define TRACK_DSP_METER_H (3 * main_win->dpi_scale_factor)
+#define TRACK_DSP_METER_WARN_PROP 0.5f
 
 #define CURSOR_V_PAD (4 * main_win->dpi_scale_factor)
 /* #define CURSOR_DIAG (3 * main_win->dpi_scale_factor) */
@@ -296,6 +298,27 @@ static void draw_selected_track_rect(Layout *selected_layout)
     geom_draw_rect_thick(main_win->rend, &selected_layout->rect, 1 * main_win->dpi_scale_factor);
 }
 
+/* Share of the real-time budget the track used in the last interval, as a bar along the bottom of the console */
+static void track_dsp_meter_draw(Track *track)
+{
+    float prop = track->dsp_meter.load / 100.0f;
+    if (prop > 1.0f) prop = 1.0f;
+    int h = TRACK_DSP_METER_H;
+    SDL_Rect bar = {
+	track->console_rect->x,
+	track->console_rect->y + track->console_rect->h - h,
+	prop * track->console_rect->w,
+	h
+    };
+    if (bar.w < 1) bar.w = 1;
+    if (prop >= TRACK_DSP_METER_WARN_PROP) {
+	SDL_SetRenderDrawColor(main_win->rend, sdl_color_expand(colors.alert_orange));
+    } else {
+	SDL_SetRenderDrawColor(main_win->rend, sdl_color_expand(colors.green));
+    }
+    SDL_RenderFillRect(main_win->rend, &bar);
+}
+
 static void track_draw(Track *track)
 {
     Session *session = session_get();
@@ -346,6 +369,10 @@ static void track_draw(Track *track)
     SDL_SetRenderDrawColor(main_win->rend, sdl_color_expand(track->color));
     SDL_RenderFillRect(main_win->rend, track->colorbar);
 
+    if (session->dsp_stats.show_track_meters && track->dsp_meter.load > 0.0f) {
+	track_dsp_meter_draw(track);
+    }
+
     textbox_draw(track->tb_mute_button);
     textbox_draw(track->tb_solo_button);
     textentry_draw(track->tb_name);
@@ -566,7 +593,7 @@ void clipref_draw_waveform(ClipRef *cr)
 	uint8_t num_channels = clip->channels;
 	float *channels[num_channels];
 	/* uint32_t cr_len_sframes = clipref_len(cr); */
-	if (!clip->L) {
+	if (!clip->L && !clip->segments.segs[0]) {
 	    goto unlock_and_exit;
 	}
 	channels[0] = clip->L + start_in_clip;
@@ -581,6 +608,10 @@ void clipref_draw_waveform(ClipRef *cr)
 	} else if (clip->recording && wf_len + start_in_clip > clip->write_bufpos_sframes) {
 	    wf_len = clip->write_bufpos_sframes - start_in_clip;
 	}
+	/* Record threads may be ahead of the waveform data */
+	if (clip->recording && wf_len + start_in_clip > clip->waveform.init_len) {
+	    wf_len = clip->waveform.init_len - start_in_clip;
+	}
 	
 	/* SDL_Rect waveform_container = {onscreen_rect.x, onscreen_rect.y, onscreen_rect.w, onscreen_rect.h}; */
 
@@ -985,6 +1016,9 @@ void project_draw()
 	textbox_draw(session->status_bar.dragstat);
     }
     textbox_draw(session->status_bar.call);
+    if (session->status_bar.dspstr[0] != '\0') {
+	textbox_draw(session->status_bar.dsp_load);
+    }
     window_draw_modals(main_win);
     window_draw_menus(main_win);
 
@@ -24,6 +24,8 @@
 #include "automation.h"
 #include "clipref.h"
 #include "consts.h"
+#include "dot_jdaw.h"
+#include "dsp_meter.h"
 #include "eq.h"
 #include "fir_filter.h"
 #include "function_lookup.h"
@@ -615,6 +617,7 @@ void loop_project_main()
 	if (session->playback.playing && !session->source_mode.source_mode) {
 	    timeline_catchup(tl);
 	    timeline_set_timecode(tl);
+	    transport_prefetch_ahead(tl, false);
 	    /* Set click track clock displays */
 	    for (int i=0; i<tl->num_click_tracks; i++) {
 		click_track_set_readout(tl->click_tracks[i], tl->play_pos_sframes);
@@ -749,6 +752,15 @@ void loop_project_main()
 	}
 
     end_frame:
+	/* Keyframe edits this frame reach the audio threads */
+	automation_publish_snapshots(tl);
+	track_freeze_check_all(tl);
+	timeline_update_delay_comp(tl);
+	jdaw_save_poll();
+	if (dsp_meter_publish(&session->dsp_stats, tl)) {
+	    status_stat_dsp_load();
+	    if (session->dsp_stats.show_track_meters) tl->needs_redraw = true;
+	}
 
 	if (!session->playback.playing && !session->midi_io.monitoring && frames_since_event >= IDLE_AFTER_N_FRAMES) {
 	    SDL_Delay(100);
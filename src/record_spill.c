@@ -0,0 +1,343 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    record_spill.c
+
+    * see record_spill.h
+    * the writer thread only reads clip segments at or after spilled_sframes, and the main thread
+      only frees segments that end before it, so the two never touch the same segment
+    * each channel goes to its own mono file, so that when recording stops the samples can be
+      mapped straight into the clip's L and R buffers
+ *****************************************************************************************************************/
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "audio_clip.h"
+#include "dir.h"
+#include "log.h"
+#include "record_spill.h"
+#include "session.h"
+#include "tmp.h"
+#include "type_serialize.h"
+
+#define SPILL_WAV_HDR_LEN 44
+#define SPILL_CK_LEN_SFRAMES 4096
+#define SPILL_INTERVAL_USEC 20000
+
+extern char DIRPATH_SAVED_PROJ[MAX_PATHLEN];
+extern bool SYS_BYTEORDER_LE;
+
+static pthread_t spill_thread;
+static atomic_bool spill_thread_running = false;
+static atomic_bool spill_thread_quit = false;
+static Clip **spill_clips = NULL;
+static int num_spill_clips = 0;
+
+/* Mono 32-bit float WAV; sizes are rewritten after each pass */
+static void spill_write_header(FILE *f, uint32_t len_sframes)
+{
+    uint32_t sample_rate = session_get_sample_rate();
+    uint16_t num_channels = 1;
+    uint16_t bits_per_sample = 32;
+    uint16_t fmt_type = 3; /* WAVE_FORMAT_IEEE_FLOAT */
+    uint32_t fmt_len = 16;
+    uint16_t block_align = num_channels * bits_per_sample / 8;
+    uint32_t bytes_per_sec = sample_rate * block_align;
+    /* Takes past 4GB keep growing on disk, but the header saturates */
+    uint64_t data_len_full = (uint64_t)len_sframes * block_align;
+    uint32_t data_len = data_len_full > UINT32_MAX - SPILL_WAV_HDR_LEN ? UINT32_MAX - SPILL_WAV_HDR_LEN : data_len_full;
+    uint32_t riff_len = SPILL_WAV_HDR_LEN - 8 + data_len;
+
+    fseek(f, 0, SEEK_SET);
+    fwrite("RIFF", 1, 4, f);
+    uint32_ser_le(f, &riff_len);
+    fwrite("WAVE", 1, 4, f);
+    fwrite("fmt ", 1, 4, f);
+    uint32_ser_le(f, &fmt_len);
+    uint16_ser_le(f, &fmt_type);
+    uint16_ser_le(f, &num_channels);
+    uint32_ser_le(f, &sample_rate);
+    uint32_ser_le(f, &bytes_per_sec);
+    uint16_ser_le(f, &block_align);
+    uint16_ser_le(f, &bits_per_sample);
+    fwrite("data", 1, 4, f);
+    uint32_ser_le(f, &data_len);
+    fseek(f, 0, SEEK_END);
+}
+
+const char *record_spill_dir()
+{
+    static char dirpath[MAX_PATHLEN + 16];
+    const char *configured = getenv("JACKDAW_RECORDINGS_DIR");
+    if (configured && configured[0] != '\0') {
+	snprintf(dirpath, sizeof(dirpath), "%s", configured);
+    } else {
+	snprintf(dirpath, sizeof(dirpath), "%s/recordings", DIRPATH_SAVED_PROJ);
+    }
+    if (mkdir(dirpath, 0755) != 0 && errno != EEXIST) {
+	log_tmp(LOG_WARN, "Unable to create recordings directory %s (%s); recording to %s\n", dirpath, strerror(errno), system_tmp_dir());
+	return system_tmp_dir();
+    }
+    return dirpath;
+}
+
+static int spill_num_channels(Clip *clip)
+{
+    return clip->channels > 1 ? 2 : 1;
+}
+
+static void spill_close_channel(ClipSegments *s, int c, bool remove_file)
+{
+    if (s->spill_f[c]) fclose(s->spill_f[c]);
+    s->spill_f[c] = NULL;
+    if (s->spill_read_fd[c] >= 0) close(s->spill_read_fd[c]);
+    s->spill_read_fd[c] = -1;
+    if (s->spill_path[c]) {
+	if (remove_file) remove(s->spill_path[c]);
+	free(s->spill_path[c]);
+	s->spill_path[c] = NULL;
+    }
+}
+
+static int spill_open_channel(ClipSegments *s, int c, const char *filepath)
+{
+    s->spill_path[c] = strdup(filepath);
+    s->spill_read_fd[c] = -1;
+    s->spill_f[c] = fopen(filepath, "w+b");
+    if (!s->spill_f[c]) {
+	log_tmp(LOG_ERROR, "Unable to open record spill file at %s\n", filepath);
+	return -1;
+    }
+    s->spill_read_fd[c] = open(filepath, O_RDONLY);
+    if (s->spill_read_fd[c] < 0) {
+	log_tmp(LOG_ERROR, "Unable to open record spill file for reading at %s\n", filepath);
+	return -1;
+    }
+    spill_write_header(s->spill_f[c], 0);
+    fflush(s->spill_f[c]);
+    return 0;
+}
+
+int record_spill_open(Clip *clip)
+{
+    ClipSegments *s = &clip->segments;
+    int channels = spill_num_channels(clip);
+    const char *dirpath = record_spill_dir();
+    char filepath[MAX_PATHLEN + MAX_NAMELENGTH + 64];
+    int offset = snprintf(filepath, sizeof(filepath), "%s/", dirpath);
+    for (int i=0; clip->name[i] != '\0' && offset < (int)sizeof(filepath) - 40; i++) {
+	filepath[offset++] = isalnum((unsigned char)clip->name[i]) ? clip->name[i] : '_';
+    }
+    /* Spill files outlive the session, so never overwrite an earlier take */
+    time_t now = time(NULL);
+    offset += strftime(filepath + offset, sizeof(filepath) - offset, "_%Y%m%d-%H%M%S", localtime(&now));
+    const char *suffix[2] = {channels == 2 ? "_L.wav" : ".wav", "_R.wav"};
+    snprintf(filepath + offset, sizeof(filepath) - offset, "%s", suffix[0]);
+    for (int n=2; access(filepath, F_OK) == 0; n++) {
+	snprintf(filepath + offset, sizeof(filepath) - offset, "_%d%s", n, suffix[0]);
+    }
+    offset = strlen(filepath) - strlen(suffix[0]);
+    for (int c=0; c<channels; c++) {
+	snprintf(filepath + offset, sizeof(filepath) - offset, "%s", suffix[c]);
+	if (spill_open_channel(s, c, filepath) != 0) {
+	    for (int i=0; i<=c; i++) {
+		spill_close_channel(s, i, true);
+	    }
+	    return -1;
+	}
+    }
+    atomic_store(&s->spilled_sframes, 0);
+    atomic_store(&s->num_released, 0);
+    s->spill_error = false;
+    log_tmp(LOG_INFO, "Recording clip \"%s\" to disk at %s\n", clip->name, s->spill_path[0]);
+    return 0;
+}
+
+/* Append all frames recorded since the last pass to the spill files */
+static void spill_clip(Clip *clip)
+{
+    ClipSegments *s = &clip->segments;
+    if (!s->spill_f[0] || s->spill_error) return;
+    uint32_t len = atomic_load_explicit(&clip->len_sframes, memory_order_acquire);
+    uint32_t pos = atomic_load_explicit(&s->spilled_sframes, memory_order_relaxed);
+    if (len <= pos) return;
+
+    int channels = spill_num_channels(clip);
+    float buf[SPILL_CK_LEN_SFRAMES];
+    for (int c=0; c<channels; c++) {
+	uint32_t ch_pos = pos;
+	while (ch_pos < len) {
+	    uint32_t n = len - ch_pos < SPILL_CK_LEN_SFRAMES ? len - ch_pos : SPILL_CK_LEN_SFRAMES;
+	    clip_read(clip, c, ch_pos, n, buf);
+	    if (fwrite(buf, sizeof(float), n, s->spill_f[c]) != n) {
+		log_tmp(LOG_ERROR, "Error writing record spill file %s; take will be kept in memory\n", s->spill_path[c]);
+		s->spill_error = true;
+		return;
+	    }
+	    ch_pos += n;
+	}
+	spill_write_header(s->spill_f[c], len);
+	if (fflush(s->spill_f[c]) != 0) {
+	    log_tmp(LOG_ERROR, "Error flushing record spill file %s; take will be kept in memory\n", s->spill_path[c]);
+	    s->spill_error = true;
+	    return;
+	}
+    }
+    /* Frames below len are now readable through spill_read_fd */
+    atomic_store_explicit(&s->spilled_sframes, len, memory_order_release);
+}
+
+static void *spill_threadfn(void *arg)
+{
+    while (!atomic_load(&spill_thread_quit)) {
+	for (int i=0; i<num_spill_clips; i++) {
+	    spill_clip(spill_clips[i]);
+	}
+	usleep(SPILL_INTERVAL_USEC);
+    }
+    return NULL;
+}
+
+void record_spill_start()
+{
+    if (atomic_load(&spill_thread_running)) return;
+    Session *session = session_get();
+    Project *proj = &session->proj;
+    spill_clips = calloc(proj->num_clips + 1, sizeof(Clip *));
+    num_spill_clips = 0;
+    for (int i=proj->active_clip_index; i<proj->num_clips; i++) {
+	Clip *clip = proj->clips[i];
+	if (clip->recording && clip->segments.spill_f[0]) {
+	    spill_clips[num_spill_clips] = clip;
+	    num_spill_clips++;
+	}
+    }
+    if (num_spill_clips == 0) {
+	free(spill_clips);
+	spill_clips = NULL;
+	return;
+    }
+    atomic_store(&spill_thread_quit, false);
+    int err;
+    if ((err = pthread_create(&spill_thread, NULL, spill_threadfn, NULL)) != 0) {
+	log_tmp(LOG_ERROR, "Unable to start record spill thread: %s\n", strerror(err));
+	free(spill_clips);
+	spill_clips = NULL;
+	num_spill_clips = 0;
+	return;
+    }
+    atomic_store(&spill_thread_running, true);
+}
+
+void record_spill_stop()
+{
+    if (!atomic_load(&spill_thread_running)) return;
+    atomic_store(&spill_thread_quit, true);
+    pthread_join(spill_thread, NULL);
+    atomic_store(&spill_thread_running, false);
+    free(spill_clips);
+    spill_clips = NULL;
+    num_spill_clips = 0;
+}
+
+void record_spill_release_segments(Clip *clip)
+{
+    ClipSegments *s = &clip->segments;
+    if (!s->spill_f[0] || !s->segs[0]) return;
+    uint32_t limit = atomic_load_explicit(&s->spilled_sframes, memory_order_acquire);
+    if (clip->waveform.init_len < (int32_t)limit) {
+	limit = clip->waveform.init_len;
+    }
+    uint32_t num_released = atomic_load_explicit(&s->num_released, memory_order_relaxed);
+    while ((uint64_t)(num_released + 1) * CLIP_SEG_LEN_SFRAMES <= limit) {
+	/* Readers go to the file before the segment is freed; its slot is then free for reuse */
+	atomic_store_explicit(&s->num_released, num_released + 1, memory_order_release);
+	uint32_t slot = num_released % CLIP_SEG_MAX;
+	for (int c=0; c<2; c++) {
+	    if (!s->segs[c]) continue;
+	    free(s->segs[c][slot]);
+	    s->segs[c][slot] = NULL;
+	}
+	num_released++;
+    }
+}
+
+void record_spill_close(Clip *clip)
+{
+    ClipSegments *s = &clip->segments;
+    if (!s->spill_f[0]) return;
+    spill_clip(clip);
+    bool empty = atomic_load(&s->spilled_sframes) == 0;
+    if (!empty) {
+	log_tmp(LOG_INFO, "Take \"%s\" written to %s\n", clip->name, s->spill_path[0]);
+    }
+    for (int c=0; c<2; c++) {
+	spill_close_channel(s, c, empty);
+    }
+}
+
+int record_spill_map(Clip *clip, void **map_base, size_t *map_len, float **L, float **R)
+{
+    ClipSegments *s = &clip->segments;
+    if (!s->spill_f[0]) return -1;
+    spill_clip(clip);
+    uint32_t len_sframes = clip->len_sframes;
+    if (s->spill_error || !SYS_BYTEORDER_LE || len_sframes == 0) return -1;
+    if (atomic_load(&s->spilled_sframes) != len_sframes) return -1;
+
+    int channels = spill_num_channels(clip);
+    uint64_t page_size = sysconf(_SC_PAGESIZE);
+    size_t file_len = SPILL_WAV_HDR_LEN + (size_t)len_sframes * sizeof(float);
+    size_t ch_map_len = (file_len + page_size - 1) / page_size * page_size;
+    /* Reserve one region and map each channel's file into its own part of it, so that the clip
+       owns a single mapping (see clip_free_buffers) */
+    char *base = mmap(NULL, ch_map_len * channels, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+	log_tmp(LOG_WARN, "Unable to map take \"%s\" (%s); reading it into memory\n", clip->name, strerror(errno));
+	return -1;
+    }
+    for (int c=0; c<channels; c++) {
+	if (mmap(base + c * ch_map_len, file_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, s->spill_read_fd[c], 0) == MAP_FAILED) {
+	    log_tmp(LOG_WARN, "Unable to map take \"%s\" (%s); reading it into memory\n", clip->name, strerror(errno));
+	    munmap(base, ch_map_len * channels);
+	    return -1;
+	}
+    }
+    *map_base = base;
+    *map_len = ch_map_len * channels;
+    *L = (float *)(base + SPILL_WAV_HDR_LEN);
+    *R = channels == 2 ? (float *)(base + ch_map_len + SPILL_WAV_HDR_LEN) : NULL;
+    /* The mapping outlives the descriptors */
+    record_spill_close(clip);
+    return 0;
+}
+
+void record_spill_read(Clip *clip, int channel, int32_t start_in_clip, int32_t len, float *dst)
+{
+    ClipSegments *s = &clip->segments;
+    if (channel >= spill_num_channels(clip)) channel = 0;
+    off_t offset = SPILL_WAV_HDR_LEN + (off_t)start_in_clip * sizeof(float);
+    ssize_t bytes = pread(s->spill_read_fd[channel], dst, len * sizeof(float), offset);
+    int32_t frames = bytes > 0 ? bytes / sizeof(float) : 0;
+    if (frames < len) {
+	log_tmp(LOG_ERROR, "Short read from record spill file %s\n", s->spill_path[channel]);
+	memset(dst + frames, 0, (len - frames) * sizeof(float));
+    }
+}
@@ -0,0 +1,61 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    record_spill.h
+
+    * optional record-to-disk mode (session->playback.record_to_disk)
+    * while recording, a background writer thread drains newly recorded frames from each clip's
+      segmented store (see audio_clip.h) to mono 32-bit float WAV files (one per channel) in the
+      recordings directory: $JACKDAW_RECORDINGS_DIR if set, else "recordings" next to the project file
+    * the WAV header is rewritten after every pass, so the file on disk is always a playable take,
+      even if jackdaw crashes mid-recording
+    * once frames are on disk and summarized in the clip's waveform data, the main thread frees their
+      segments, so memory use during a long take stays bounded; clip_read falls back to the file.
+      Freed slots in the segment table are reused, so take length is limited only by the disk.
+    * when recording stops, the files are mapped as the clip's sample buffers, rather than read back
+      into memory
+*****************************************************************************************************************/
+
+#ifndef JDAW_RECORD_SPILL_H
+#define JDAW_RECORD_SPILL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct clip Clip;
+
+/* Main thread; the directory takes are written to, created if needed. Falls back to the system
+   tmp dir if it cannot be created. */
+const char *record_spill_dir();
+
+/* Main thread; call after clip_segments_init. Returns 0 on success. */
+int record_spill_open(Clip *clip);
+
+/* Main thread; start the writer thread for all recording clips with open spill files */
+void record_spill_start();
+
+/* Main thread; stop and join the writer thread. Spill files stay open until record_spill_close. */
+void record_spill_stop();
+
+/* Main thread; free segments that are on disk and no longer needed for waveform data */
+void record_spill_release_segments(Clip *clip);
+
+/* Write any frames not yet on disk, finalize the WAV header, and close the spill file */
+void record_spill_close(Clip *clip);
+
+/* Main thread; write any frames not yet on disk, close the spill files, and map them. On success
+   (returns 0), *L and *R point into a private mapping at *map_base for the clip to own. */
+int record_spill_map(Clip *clip, void **map_base, size_t *map_len, float **L, float **R);
+
+/* Read len frames of channel from the spill file into dst */
+void record_spill_read(Clip *clip, int channel, int32_t start_in_clip, int32_t len, float *dst);
+
+#endif
@@ -0,0 +1,283 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    resampler.c
+
+    * see resampler.h
+    * the kernel for fractional position f is h(k - f) for taps k = -(N/2 - 1) .. N/2, where
+      h(t) = cutoff * sinc(cutoff * t) * kaiser(t / (N/2)). Each row is normalized to unity gain at DC.
+ *****************************************************************************************************************/
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "resampler.h"
+
+#ifdef TESTBUILD
+#include <time.h>
+#endif
+
+#define FX_ONE ((int64_t)1 << 32)
+#define FX_PHASE_SHIFT (32 - RESAMPLER_PHASE_BITS)
+#define FX_PHASE_FRAC_SCALE (1.0f / (float)(1 << FX_PHASE_SHIFT))
+
+struct quality_params {
+    int num_taps;
+    double kaiser_beta;
+    double rolloff; /* Cutoff at unity speed, leaving a transition band below Nyquist */
+};
+
+static const struct quality_params quality_params[NUM_RESAMPLE_QUALITIES] = {
+    {0, 0.0, 1.0},
+    {8, 6.0, 0.85},
+    {16, 8.0, 0.91},
+    {32, 10.0, 0.95}
+};
+
+static ResamplerBank *playback_banks[NUM_RESAMPLE_QUALITIES][RESAMPLER_NUM_PLAYBACK_BANKS];
+static pthread_once_t playback_banks_once = PTHREAD_ONCE_INIT;
+
+/* Zeroth-order modified Bessel function of the first kind */
+static double bessel_i0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    double half_x_sq = x * x / 4.0;
+    for (int k=1; k<50; k++) {
+	term *= half_x_sq / ((double)k * k);
+	sum += term;
+	if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+ResamplerBank *resampler_bank_create(enum resample_quality q, double cutoff)
+{
+    if (q == RESAMPLE_LINEAR) return NULL;
+    const struct quality_params *qp = quality_params + q;
+    ResamplerBank *bank = calloc(1, sizeof(ResamplerBank));
+    if (!bank) {
+	fprintf(stderr, "Fatal error: unable to allocate resampler bank\n");
+	exit(1);
+    }
+    int num_taps = (int)ceil(qp->num_taps / cutoff);
+    num_taps += num_taps % 2;
+    bank->num_taps = num_taps;
+    bank->cutoff = cutoff;
+    bank->coeffs = malloc((RESAMPLER_NUM_PHASES + 1) * num_taps * sizeof(float));
+    if (!bank->coeffs) {
+	fprintf(stderr, "Fatal error: unable to allocate resampler bank\n");
+	exit(1);
+    }
+    double half_width = num_taps / 2;
+    double i0_beta = bessel_i0(qp->kaiser_beta);
+    for (int p=0; p<=RESAMPLER_NUM_PHASES; p++) {
+	float *row = bank->coeffs + p * num_taps;
+	double frac = (double)p / RESAMPLER_NUM_PHASES;
+	double row_sum = 0.0;
+	double row_d[num_taps];
+	for (int j=0; j<num_taps; j++) {
+	    double t = (double)(j - (num_taps / 2 - 1)) - frac;
+	    double x = t / half_width;
+	    double window = fabs(x) >= 1.0 ? 0.0 : bessel_i0(qp->kaiser_beta * sqrt(1.0 - x * x)) / i0_beta;
+	    double arg = M_PI * cutoff * t;
+	    double sinc = fabs(arg) < 1e-9 ? 1.0 : sin(arg) / arg;
+	    row_d[j] = cutoff * sinc * window;
+	    row_sum += row_d[j];
+	}
+	for (int j=0; j<num_taps; j++) {
+	    row[j] = row_d[j] / row_sum;
+	}
+    }
+    return bank;
+}
+
+void resampler_bank_destroy(ResamplerBank *bank)
+{
+    free(bank->coeffs);
+    free(bank);
+}
+
+static double playback_bank_step(int index)
+{
+    return 1.0 + (double)index / RESAMPLER_STEP_DIVS;
+}
+
+static void playback_banks_init()
+{
+    for (int q=RESAMPLE_FAST; q<NUM_RESAMPLE_QUALITIES; q++) {
+	for (int i=0; i<RESAMPLER_NUM_PLAYBACK_BANKS; i++) {
+	    playback_banks[q][i] = resampler_bank_create(q, quality_params[q].rolloff / playback_bank_step(i));
+	}
+    }
+}
+
+void resampler_init()
+{
+    pthread_once(&playback_banks_once, playback_banks_init);
+}
+
+const ResamplerBank *resampler_playback_bank(enum resample_quality q, double step)
+{
+    step = fabs(step);
+    if (q == RESAMPLE_LINEAR || step > RESAMPLER_MAX_STEP) return NULL;
+    int index = 0;
+    if (step > 1.0) {
+	index = (int)ceil((step - 1.0) * RESAMPLER_STEP_DIVS - 1e-9);
+    }
+    return playback_banks[q][index];
+}
+
+static void linear_mix(const float *restrict src, int32_t src_len, int64_t pos, int64_t step, float *restrict dst, int dst_len, float gain)
+{
+    int64_t max_pos = (int64_t)(src_len - 1) * FX_ONE;
+    for (int i=0; i<dst_len; i++, pos += step) {
+	if (pos < 0 || pos > max_pos) continue;
+	int32_t index = (int32_t)(pos >> 32);
+	float frac = (float)(uint32_t)pos * (1.0f / 4294967296.0f);
+	float next = index + 1 < src_len ? src[index + 1] : 0.0f;
+	dst[i] += gain * (src[index] + frac * (next - src[index]));
+    }
+}
+
+void resampler_mix(const ResamplerBank *bank, const float *restrict src, int32_t src_len, double pos, double step, float *restrict dst, int dst_len, float gain)
+{
+    int64_t pos_fx = (int64_t)llround(pos * FX_ONE);
+    int64_t step_fx = (int64_t)llround(step * FX_ONE);
+    if (!bank) {
+	linear_mix(src, src_len, pos_fx, step_fx, dst, dst_len, gain);
+	return;
+    }
+    const int num_taps = bank->num_taps;
+    const int32_t back = num_taps / 2 - 1;
+    int64_t max_pos = (int64_t)(src_len - 1) * FX_ONE;
+    for (int i=0; i<dst_len; i++, pos_fx += step_fx) {
+	if (pos_fx < 0 || pos_fx > max_pos) continue;
+	int32_t index = (int32_t)(pos_fx >> 32);
+	uint32_t frac_fx = (uint32_t)pos_fx;
+	int phase = frac_fx >> FX_PHASE_SHIFT;
+	float a = (float)(frac_fx & ((1u << FX_PHASE_SHIFT) - 1)) * FX_PHASE_FRAC_SCALE;
+	const float *restrict c0 = bank->coeffs + phase * num_taps;
+	const float *restrict c1 = c0 + num_taps;
+	int32_t first = index - back;
+	float sum = 0.0f;
+	if (first >= 0 && first + num_taps <= src_len) {
+	    const float *restrict s = src + first;
+	    for (int j=0; j<num_taps; j++) {
+		sum += s[j] * (c0[j] + a * (c1[j] - c0[j]));
+	    }
+	} else {
+	    for (int j=0; j<num_taps; j++) {
+		int32_t si = first + j;
+		if (si < 0 || si >= src_len) continue;
+		sum += src[si] * (c0[j] + a * (c1[j] - c0[j]));
+	    }
+	}
+	dst[i] += gain * sum;
+    }
+}
+
+float *resampler_convert(const float *src, int32_t src_len, uint32_t src_rate, uint32_t dst_rate, int32_t *dst_len)
+{
+    double step = (double)src_rate / dst_rate;
+    double cutoff = quality_params[RESAMPLE_HIGH].rolloff;
+    if (step > 1.0) cutoff /= step;
+    ResamplerBank *bank = resampler_bank_create(RESAMPLE_HIGH, cutoff);
+    int32_t len = src_len < 1 ? 0 : (int32_t)floor((src_len - 1) / step) + 1;
+    float *dst = calloc(len > 0 ? len : 1, sizeof(float));
+    if (!dst) {
+	fprintf(stderr, "Fatal error: unable to allocate resampler output buffer\n");
+	exit(1);
+    }
+    resampler_mix(bank, src, src_len, 0.0, step, dst, len, 1.0f);
+    resampler_bank_destroy(bank);
+    *dst_len = len;
+    return dst;
+}
+
+const char *resample_quality_str(enum resample_quality q)
+{
+    switch (q) {
+    case RESAMPLE_LINEAR:
+	return "linear";
+    case RESAMPLE_FAST:
+	return "fast";
+    case RESAMPLE_MEDIUM:
+	return "medium";
+    case RESAMPLE_HIGH:
+	return "high";
+    }
+    return "unknown";
+}
+
+#ifdef TESTBUILD
+
+#define BENCHMARK_SRC_LEN 480000
+#define BENCHMARK_CHUNK_LEN 512
+
+/* The per-sample double-precision loop formerly used for clip playback, for comparison */
+static void legacy_linear_mix(const float *src, int32_t src_len, double pos, double step, float *dst, int dst_len)
+{
+    for (int i=0; i<dst_len; i++) {
+	if (pos > 0 && pos < src_len - 1) {
+	    int index_left = (int)floor(pos);
+	    double diff_left = pos - (double)index_left;
+	    double diff = src[index_left + 1] - src[index_left];
+	    dst[i] += src[index_left] + diff_left * diff;
+	}
+	pos += step;
+    }
+}
+
+static double elapsed_ns(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+void resampler_benchmark()
+{
+    resampler_init();
+    float *src = malloc(BENCHMARK_SRC_LEN * sizeof(float));
+    for (int i=0; i<BENCHMARK_SRC_LEN; i++) {
+	src[i] = 0.5f * sinf(i * 0.031f) + 0.1f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+    float dst[BENCHMARK_CHUNK_LEN];
+    static const double steps[] = {0.73, 1.0 + 1.0 / 3.0, 2.9};
+    fprintf(stderr, "Resampler benchmark (ns per output sample):\n");
+    for (int s=0; s<sizeof(steps) / sizeof(double); s++) {
+	double step = steps[s];
+	int num_chunks = (int)((BENCHMARK_SRC_LEN - 64) / step / BENCHMARK_CHUNK_LEN);
+	int num_out = num_chunks * BENCHMARK_CHUNK_LEN;
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int c=0; c<num_chunks; c++) {
+	    memset(dst, '\0', sizeof(dst));
+	    legacy_linear_mix(src, BENCHMARK_SRC_LEN, c * BENCHMARK_CHUNK_LEN * step, step, dst, BENCHMARK_CHUNK_LEN);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	fprintf(stderr, "\tstep %.3f\tlegacy linear: %.2f\n", step, elapsed_ns(&start, &end) / num_out);
+	for (int q=RESAMPLE_LINEAR; q<NUM_RESAMPLE_QUALITIES; q++) {
+	    const ResamplerBank *bank = resampler_playback_bank(q, step);
+	    clock_gettime(CLOCK_MONOTONIC, &start);
+	    for (int c=0; c<num_chunks; c++) {
+		memset(dst, '\0', sizeof(dst));
+		resampler_mix(bank, src, BENCHMARK_SRC_LEN, c * BENCHMARK_CHUNK_LEN * step, step, dst, BENCHMARK_CHUNK_LEN, 1.0f);
+	    }
+	    clock_gettime(CLOCK_MONOTONIC, &end);
+	    fprintf(stderr, "\tstep %.3f\t%s (%d taps): %.2f\n", step, resample_quality_str(q), bank ? bank->num_taps : 2, elapsed_ns(&start, &end) / num_out);
+	}
+    }
+    free(src);
+}
+
+#endif
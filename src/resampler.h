@@ -0,0 +1,75 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    resampler.h
+
+    * polyphase windowed-sinc interpolation, for clip playback at non-unity speed (including scrubbing)
+      and for sample rate conversion on import
+    * a bank holds a Kaiser-windowed sinc kernel precomputed at RESAMPLER_NUM_PHASES fractional offsets;
+      a read interpolates between the two nearest phases
+    * when reading faster than unity speed, the kernel cutoff must drop with the speed to avoid
+      aliasing. Playback banks are prebuilt for steps up to RESAMPLER_MAX_STEP, in increments of
+      1 / RESAMPLER_STEP_DIVS; beyond that, reads fall back to linear interpolation.
+    * read positions advance in 32.32 fixed point rather than per-sample double math
+    * banks are read-only once built, and can be shared between threads
+*****************************************************************************************************************/
+
+#ifndef JDAW_RESAMPLER_H
+#define JDAW_RESAMPLER_H
+
+#include <stdint.h>
+
+#define RESAMPLER_PHASE_BITS 8
+#define RESAMPLER_NUM_PHASES (1 << RESAMPLER_PHASE_BITS)
+#define RESAMPLER_MAX_STEP 4
+#define RESAMPLER_STEP_DIVS 4
+#define RESAMPLER_NUM_PLAYBACK_BANKS (1 + (RESAMPLER_MAX_STEP - 1) * RESAMPLER_STEP_DIVS)
+
+enum resample_quality {
+    RESAMPLE_LINEAR=0,
+    RESAMPLE_FAST=1, /* 10 taps at unity speed */
+    RESAMPLE_MEDIUM=2, /* 18 taps */
+    RESAMPLE_HIGH=3, /* 34 taps */
+};
+#define NUM_RESAMPLE_QUALITIES 4
+
+typedef struct resampler_bank {
+    int num_taps; /* Even. Output at position p reads src[floor(p) - num_taps/2 + 1] .. src[floor(p) + num_taps/2] */
+    double cutoff; /* Relative to the source Nyquist frequency */
+    float *coeffs; /* RESAMPLER_NUM_PHASES + 1 rows of num_taps; row p is the kernel at fractional position p / RESAMPLER_NUM_PHASES */
+} ResamplerBank;
+
+ResamplerBank *resampler_bank_create(enum resample_quality q, double cutoff);
+void resampler_bank_destroy(ResamplerBank *bank);
+
+/* Build the shared playback banks. Main thread, before playback; safe to call more than once */
+void resampler_init();
+
+/* Bank to read with for a given step, or NULL for linear interpolation */
+const ResamplerBank *resampler_playback_bank(enum resample_quality q, double step);
+
+/* Add gain * src, read at positions pos, pos + step, ..., into dst. Positions outside [0, src_len - 1]
+   produce no output; samples outside [0, src_len) are treated as zero. Pass a NULL bank for linear
+   interpolation. */
+void resampler_mix(const ResamplerBank *bank, const float *restrict src, int32_t src_len, double pos, double step, float *restrict dst, int dst_len, float gain);
+
+/* Convert a whole buffer between sample rates at RESAMPLE_HIGH quality. Returns a malloc'd buffer
+   and sets *dst_len. */
+float *resampler_convert(const float *src, int32_t src_len, uint32_t src_rate, uint32_t dst_rate, int32_t *dst_len);
+
+const char *resample_quality_str(enum resample_quality q);
+
+#ifdef TESTBUILD
+/* Print timings for each quality against the linear path to stderr */
+void resampler_benchmark();
+#endif
+
+#endif
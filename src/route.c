@@ -69,18 +69,25 @@ void timeline_resort_tracks_proc_order(Timeline *tl)
 
 static void track_reset_proc_order(Track *track)
 {
-    if (track->num_routes == 0) track->proc_order = 0;
+    track->proc_order = 0;
     for (int i=0; i<track->num_routes; i++) {
 	int order = track->routes[i]->dst->proc_order + 1;
 	if (order > track->proc_order) {
 	    track->proc_order = order;
 	}
     }
+    if (track->bus_out && track->bus_out->proc_order + 1 > track->proc_order) {
+	track->proc_order = track->bus_out->proc_order + 1;
+    }
     for (int i=0; i<track->num_route_ins; i++) {
 	track_reset_proc_order(track->route_ins[i]->src);
     }
+    for (int i=0; i<track->num_bus_ins; i++) {
+	track_reset_proc_order(track->bus_ins[i]);
+    }
 }
 
+/* Follows both audio routes and bus outs */
 static bool proposed_route_has_feedback(Track *og_src, Track *src, Track *dst)
 {
     if (dst == og_src) return true;
@@ -88,6 +95,9 @@ static bool proposed_route_has_feedback(Track *og_src, Track *src, Track *dst)
 	bool childret = proposed_route_has_feedback(og_src, dst, dst->routes[i]->dst);
 	if (childret) return true;
     }
+    if (dst->bus_out && proposed_route_has_feedback(og_src, dst, dst->bus_out)) {
+	return true;
+    }
     return false;
 }
 
@@ -95,6 +105,7 @@ static void audio_route_remove(AudioRoute *rt);
 
 void audio_route_destroy(AudioRoute *rt)
 {
+    comp_delay_deinit(&rt->delay);
     if (rt->tl_gui.out_tb) {
 	textbox_destroy(rt->tl_gui.out_tb);
     }
@@ -181,6 +192,28 @@ static void audio_route_reinsert(AudioRoute *rt)
 }
 
 
+/*------ bus in/out, one-sided; no TL resorting ----------------------*/
+
+static void bus_remove_in(Track *bus, Track *src)
+{
+    bool displace = false;
+    for (int i=0; i<bus->num_bus_ins - 1; i++) {
+	if (bus->bus_ins[i] == src) {
+	    displace = true;
+	}
+	if (displace) {
+	    bus->bus_ins[i] = bus->bus_ins[i + 1];
+	}
+    }
+    bus->num_bus_ins--;
+}
+
+static void bus_insert_in(Track *bus, Track *src)
+{
+    bus->bus_ins[bus->num_bus_ins] = src;
+    bus->num_bus_ins++;
+}
+
 /*------ track deletion management -----------------------------------*/
 
 void audio_route_track_deleted(Track *track)
@@ -195,6 +228,16 @@ void audio_route_track_deleted(Track *track)
 	track_reset_proc_order(track->route_ins[i]->src);
     }
 
+    /* A deleted track keeps its bus_out and bus_ins, so that undelete can restore them */
+    if (track->bus_out) {
+	bus_remove_in(track->bus_out, track);
+	track_reset_proc_order(track->bus_out);
+    }
+    for (int i=0; i<track->num_bus_ins; i++) {
+	Track *src = track->bus_ins[i];
+	src->bus_out = NULL;
+	track_reset_proc_order(src);
+    }
 }
 
 /* Call at a high-level (e.g. in response to single user action)
@@ -210,6 +253,24 @@ void audio_route_track_undeleted(Track *track)
 	audio_route_reinsert_on_src(track->route_ins[i]);
 	track_reset_proc_order(track->route_ins[i]->src);
     }
+    if (track->bus_out) {
+	if (track->bus_out->deleted) {
+	    track->bus_out = NULL;
+	} else {
+	    bus_insert_in(track->bus_out, track);
+	}
+	track_reset_proc_order(track);
+    }
+    /* Inputs reassigned while the bus was deleted stay where they are */
+    int num_bus_ins = track->num_bus_ins;
+    track->num_bus_ins = 0;
+    for (int i=0; i<num_bus_ins; i++) {
+	Track *src = track->bus_ins[i];
+	if (src->deleted || src->bus_out) continue;
+	src->bus_out = track;
+	bus_insert_in(track, src);
+	track_reset_proc_order(src);
+    }
     /* timeline_resort_tracks_proc_order(track->tl); */
 }
 
@@ -424,3 +485,58 @@ void audio_route_delete(AudioRoute *rt)
     TEST_FN_CALL(timeline_track_array_integrity, rt->src->tl);
 
 }
+
+
+/*------ buses -------------------------------------------------------*/
+
+static void track_bus_out_reassign(Track *track, Track *bus)
+{
+    if (track->bus_out) {
+	bus_remove_in(track->bus_out, track);
+    }
+    track->bus_out = bus;
+    if (bus) {
+	bus_insert_in(bus, track);
+	/* The bus replaces master as the track's output, so the track must send */
+	endpoint_write(&track->send_to_out_ep, (Value){.bool_v = true}, true, true, true, false);
+    }
+    track_reset_proc_order(track);
+    timeline_resort_tracks_proc_order(track->tl);
+    /* Routing to or from a soloed bus changes what the solo keeps audible */
+    timeline_rectify_solomute(track->tl);
+    track->tl->needs_redraw = true;
+}
+
+NEW_EVENT_FN(undo_redo_set_bus_out, "undo/redo set bus out")
+{
+    Track *track = obj1;
+    track_bus_out_reassign(track, val1.ptr_v);
+}}
+
+int track_set_bus_out(Track *track, Track *bus)
+{
+    if (bus == track->bus_out) return 0;
+    if (bus) {
+	if (!bus->is_bus) {
+	    status_set_errstr("\"%s\" is not a bus\n", bus->name);
+	    return 1;
+	}
+	if (proposed_route_has_feedback(track, track, bus)) {
+	    status_set_errstr("No feedback audio routes\n");
+	    return 1;
+	}
+    }
+    Track *prev = track->bus_out;
+    track_bus_out_reassign(track, bus);
+    status_set_alertstr("Output: %s => %s\n", track->name, bus ? bus->name : "master");
+    user_event_push(
+	undo_redo_set_bus_out,
+	undo_redo_set_bus_out,
+	NULL, NULL,
+	track, NULL,
+	(Value){.ptr_v = prev}, (Value){0},
+	(Value){.ptr_v = bus}, (Value){0},
+	0, 0, false, false);
+    TEST_FN_CALL(timeline_track_array_integrity, track->tl);
+    return 0;
+}
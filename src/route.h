@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include "api.h"
+#include "delay_comp.h"
 #include "endpoint.h"
 #include "textbox.h"
 
@@ -19,6 +20,7 @@ typedef struct audio_route {
     float amp;
     float amp_raw;
     Endpoint amp_ep;
+    CompDelay delay; /* Aligns src with dst's other inputs (see delay_comp.h) */
     /* bool pre_fader; */
     struct route_tl_gui tl_gui;
 
@@ -42,6 +44,12 @@ void audio_route_track_deleted(Track *track);
 void audio_route_track_undeleted(Track *track);
 
 
+/*------ buses -------------------------------------------------------*/
+
+/* Send the track's post-fader output to a bus track instead of master (NULL: master).
+   Returns nonzero and sets the status error if the assignment would create feedback. */
+int track_set_bus_out(Track *track, Track *bus);
+
 void timeline_resort_tracks_proc_order(Timeline *tl);
 
 #endif
@@ -5,6 +5,7 @@
 #include "page.h"
 #include "route.h"
 #include "session.h"
+#include "status.h"
 #include "symbol.h"
 #include "window.h"
 
@@ -123,6 +124,73 @@ void route_quick_add(Track *trck, bool trck_is_dst)
     add_route_internal(trck, trck_is_dst);
 }
 
+static ComponentFnDef(set_bus_out_buttonfn)
+{
+    Modal *modal = self;
+    Track *trck = target;
+    Dropdown *dd = NULL;
+    for (int i=0; i<modal->num_els; i++) {
+	if (modal->els[i]->type == MODAL_EL_DROPDOWN) {
+	    dd = modal->els[i]->obj;
+	    break;
+	}
+    }
+    if (!dd) {
+	fprintf(stderr, "Critical error: no dropdown on set bus out modal\n");
+	exit(1);
+    }
+    Track *bus = dd->item_args[dd->selected_item];
+    if (track_set_bus_out(trck, bus) == 0) {
+	window_pop_modal(main_win);
+    }
+    return 0;
+}
+
+void route_bus_out_select(Track *trck)
+{
+    const char *options[trck->tl->num_tracks + 1];
+    void *args[trck->tl->num_tracks + 1];
+    options[0] = "Master";
+    args[0] = NULL;
+    int num_options = 1;
+    for (int i=0; i<trck->tl->num_tracks; i++) {
+	Track *bus = trck->tl->tracks[i];
+	if (bus == trck || !bus->is_bus) continue;
+	options[num_options] = bus->name;
+	args[num_options] = bus;
+	num_options++;
+    }
+    if (num_options == 1 && !trck->bus_out) {
+	status_set_errstr("No bus tracks to output to");
+	return;
+    }
+
+    Layout *mod_lt = layout_add_child(main_win->layout);
+    layout_set_default_dims(mod_lt);
+    layout_reset(mod_lt);
+    Modal *modal = modal_create(mod_lt);
+    modal_add_header(modal, "Set track output", &colors.white, 3);
+    static char from_str[256];
+    snprintf(from_str, 256, "from %s", trck->name);
+    modal_add_header(modal, from_str, &colors.white, 5);
+    modal_add_dropdown(
+	modal,
+	"Output to:",
+	options,
+	NULL,
+	args,
+	num_options,
+	NULL,
+	NULL);
+    modal->stashed_obj = trck;
+    modal_add_button(modal, "Set", set_bus_out_buttonfn);
+    modal->submit_form = set_bus_out_buttonfn;
+
+    window_push_modal(main_win, modal);
+    modal_reset(modal);
+    modal_move_onto(modal);
+}
+
 static ComponentFnDef(add_route_plus_buttonfn)
 {
     Track *src = target;
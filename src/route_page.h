@@ -5,6 +5,9 @@
 typedef struct track Track;
 
 void route_quick_add(Track *trck, bool trck_is_dst);
+
+/* Modal to choose the bus (or master) that receives the track's output */
+void route_bus_out_select(Track *trck);
 void route_page_open(Track *track, bool select_outs_tab);
 
 #endif
@@ -8,6 +8,7 @@
 
 *****************************************************************************************************************/
 
+#include "dsp_utils.h"
 #include "endpoint_callbacks.h"
 #include "saturation.h"
 
@@ -30,11 +31,24 @@ static void saturation_do_gain_comp_cb(Endpoint *ep)
     saturation_set_type(s, s->type);
 }
 
+static void saturation_oversample_cb(Endpoint *ep)
+{
+    Saturation *s = (Saturation *)ep->xarg1;
+    saturation_set_oversample(s, s->oversample);
+}
+
 void saturation_init(Saturation *s)
 {
     s->do_gain_comp = true;
     saturation_set_gain(s, 1.0);
     saturation_set_type(s, SAT_TANH);
+    for (int c=0; c<2; c++) {
+	for (int st=0; st<HALFBAND_MAX_STAGES; st++) {
+	    halfband_init(&s->up[c][st], st);
+	    halfband_init(&s->down[c][st], st);
+	}
+    }
+    saturation_set_oversample(s, SATURATION_DEFAULT_OVERSAMPLE);
 
     endpoint_init(
 	&s->gain_ep,
@@ -86,51 +100,69 @@ void saturation_init(Saturation *s)
 	JDAW_THREAD_DSP,
 	page_el_gui_cb, NULL, saturation_type_cb,
 	(void *)s, NULL, &s->effect->page, "track_settings_saturation_type");
+
+    endpoint_init(
+	&s->oversample_ep,
+	&s->oversample,
+	JDAW_INT,
+	"oversample",
+	"Oversampling",
+	JDAW_THREAD_DSP,
+	page_el_gui_cb, NULL, saturation_oversample_cb,
+	(void *)s, NULL, &s->effect->page, "track_settings_saturation_oversample");
+    endpoint_set_allowed_range(&s->oversample_ep, (Value){.int_v = 0}, (Value){.int_v = HALFBAND_MAX_STAGES});
+    endpoint_set_default_value(&s->oversample_ep, (Value){.int_v = SATURATION_DEFAULT_OVERSAMPLE});
+    api_endpoint_register(&s->oversample_ep, &s->effect->api_node);
 }
 
-static double saturation_sample_tanh(Saturation *s, double in)
+/* Lambert continued fraction for tanh, truncated at x^7 / x^6. Reaches 1 at about 4.97;
+   max error about 1e-4 */
+static inline float fast_tanhf(float x)
 {
-    int sign_in = in / fabs(in);
-    int symmetry = s->symmetry / fabs(s->symmetry);
-    int shared_sign = symmetry * sign_in;
-    if (shared_sign >= 0) {
-	return tanh(in * s->gain) * s->gain_comp_val;
-    }
-    return tanh(in * s->gain * (1.0 - fabs(s->symmetry))) * s->gain_comp_val;
+    x = x > 4.97f ? 4.97f : x < -4.97f ? -4.97f : x;
+    float x2 = x * x;
+    return x * (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2)))
+	/ (135135.0f + x2 * (62370.0f + x2 * (3150.0f + x2 * 28.0f)));
 }
 
-static double saturation_sample_tanh_no_gain_comp(Saturation *s, double in)
+/* exp(-a) for a >= 0, as 2^(-a * log2(e)): integer part in the exponent bits, fractional part by
+   polynomial. Relative error about 2e-7 */
+static inline float fast_exp_neg(float a)
 {
-    int sign_in = in / fabs(in);
-    int symmetry = s->symmetry / fabs(s->symmetry);
-    int shared_sign = symmetry * sign_in;
-    if (shared_sign >= 0) {
-	return tanh(in * s->gain);
-    }
-    return tanh(in * s->gain * (1.0 - fabs(s->symmetry)));
+    float t = -a * 1.44269504f;
+    t = t < -126.0f ? -126.0f : t;
+    int i = (int)t; /* Truncates toward zero; f in (-1, 0] */
+    float f = t - i;
+    float p = 1.0f + f * (0.69314718f + f * (0.24022651f + f * (0.05550411f + f * (0.00961813f + f * 0.00133336f))));
+    union { int32_t i; float f; } scale = {.i = (i + 127) << 23};
+    return p * scale.f;
 }
 
-static double saturation_sample_exponential_no_gain_comp(Saturation *s, double in)
+/* In place, at whatever rate buf is running at */
+static void saturation_shape(Saturation *s, float *restrict buf, int len)
 {
-    /* return tanh(2 * in * s->gain - pow(in * s->gain, 3.0) / 3.0); */
-    int sign = in < 0 ? -1 : 1;
-    int symmetry = s->symmetry / fabs(s->symmetry);
-    int shared_sign = symmetry * sign;
-    if (shared_sign >= 0) {
-	return sign * (1.0-exp(-1 * fabs(in * s->gain)));
+    /* Inputs with the opposite sign to the symmetry param get less gain */
+    const float sym = s->symmetry;
+    const float gain = s->gain;
+    const float gain_opp = s->gain * (1.0 - fabs(s->symmetry));
+    const float out_scale = s->do_gain_comp ? s->gain_comp_val : 1.0f;
+    switch (s->type) {
+    case SAT_TANH:
+	for (int i=0; i<len; i++) {
+	    float g = buf[i] * sym < 0.0f ? gain_opp : gain;
+	    buf[i] = fast_tanhf(buf[i] * g) * out_scale;
+	}
+	break;
+    case SAT_EXPONENTIAL:
+	for (int i=0; i<len; i++) {
+	    float g = buf[i] * sym < 0.0f ? gain_opp : gain;
+	    float sat = 1.0f - fast_exp_neg(fabsf(buf[i] * g));
+	    buf[i] = (buf[i] < 0.0f ? -sat : sat) * out_scale;
+	}
+	break;
     }
-    in = in * s->gain * (1.0 - fabs(s->symmetry));
-    return sign * (1.0-exp(-1 * fabs(in)));
-
-    /* return 2.0 / (1 + exp(in * -2 * s->gain)) - 1; */
-}
-static double saturation_sample_exponential(Saturation *s, double in)
-{
-    return saturation_sample_exponential_no_gain_comp(s, in) * s->gain_comp_val;
 }
 
-
-
 void saturation_set_gain(Saturation *s, double gain)
 {
     s->gain = gain;
@@ -139,44 +171,82 @@ void saturation_set_gain(Saturation *s, double gain)
 
 void saturation_set_type(Saturation *s, SaturationType t)
 {
-    switch(t) {
-    case SAT_TANH:
-	s->sample_fn = s->do_gain_comp ? saturation_sample_tanh : saturation_sample_tanh_no_gain_comp;
-	break;
-    case SAT_EXPONENTIAL:
-	s->sample_fn = s->do_gain_comp ? saturation_sample_exponential : saturation_sample_exponential_no_gain_comp;
-	break;
-    default:
-	break;
+    if (t == SAT_TANH || t == SAT_EXPONENTIAL) {
+	s->type = t;
+    }
+}
+
+void saturation_set_oversample(Saturation *s, int oversample)
+{
+    if (oversample < 0) oversample = 0;
+    if (oversample > HALFBAND_MAX_STAGES) oversample = HALFBAND_MAX_STAGES;
+    s->oversample = oversample;
+    saturation_clear(s);
+}
+
+void saturation_clear(Saturation *s)
+{
+    for (int c=0; c<2; c++) {
+	for (int st=0; st<HALFBAND_MAX_STAGES; st++) {
+	    halfband_clear(&s->up[c][st]);
+	    halfband_clear(&s->down[c][st]);
+	}
     }
 }
 
-static double saturation_sample(Saturation *s, double in)
+int32_t saturation_latency_sframes(Saturation *s)
 {
-    /* if (!s->active) return in; */
-    return s->sample_fn(s, in);
-    /* return tanh(in * s->amp); */
+    double latency = 0.0;
+    for (int st=0; st<s->oversample; st++) {
+	latency += halfband_round_trip_latency(st) / (1 << st);
+    }
+    return (int32_t)round(latency);
+}
+
+static void saturation_oversampled_block(Saturation *s, float *restrict buf, int len, int channel, int stages)
+{
+    float work[2][SATURATION_BLOCK_LEN << HALFBAND_MAX_STAGES];
+    int w = 0;
+    int cur_len = len;
+    halfband_upsample(&s->up[channel][0], buf, work[w], cur_len);
+    cur_len *= 2;
+    for (int st=1; st<stages; st++) {
+	halfband_upsample(&s->up[channel][st], work[w], work[!w], cur_len);
+	w = !w;
+	cur_len *= 2;
+    }
+    saturation_shape(s, work[w], cur_len);
+    for (int st=stages - 1; st>0; st--) {
+	cur_len /= 2;
+	halfband_downsample(&s->down[channel][st], work[w], work[!w], cur_len);
+	w = !w;
+    }
+    halfband_downsample(&s->down[channel][0], work[w], buf, len);
 }
 
-float saturation_buf_apply(void *saturation_v, float *restrict buf, int len, int channel_unused, float input_amp)
+float saturation_buf_apply(void *saturation_v, float *restrict buf, int len, int channel, float input_amp)
 {
     Saturation *s = saturation_v;
-    /* if (!s->active) return input_amp; */
-    float output_amp = 0.0f;
-    for (int i=0; i<len; i++) {
-	buf[i] = saturation_sample(s, buf[i]);
-	output_amp += fabs(buf[i]);
+    int stages = s->oversample;
+    if (stages == 0) {
+	saturation_shape(s, buf, len);
+    } else {
+	for (int i=0; i<len; i+=SATURATION_BLOCK_LEN) {
+	    int block_len = len - i < SATURATION_BLOCK_LEN ? len - i : SATURATION_BLOCK_LEN;
+	    saturation_oversampled_block(s, buf + i, block_len, channel, stages);
+	}
     }
-    return output_amp;
+    return float_buf_abs_sum(buf, len);
 }
 
 float saturation_buf_apply_stereo(void *saturation_v, float *restrict L, float *restrict R, int len, float input_amp)
 {
+    float output_amp = 0.0f;
     if (L)
-	input_amp = saturation_buf_apply(saturation_v, L, len, 0, input_amp);
+	output_amp += saturation_buf_apply(saturation_v, L, len, 0, input_amp);
     if (R)
-	input_amp = saturation_buf_apply(saturation_v, R, len, 1, input_amp);
-    return input_amp;
+	output_amp += saturation_buf_apply(saturation_v, R, len, 1, input_amp);
+    return output_amp;
 }
 
 
@@ -189,7 +259,6 @@ float saturation_buf_apply_stereo(void *saturation_v, float *restrict L, float *
 
 /* TODO:
    - calculate gain comp whenever amp is set
-   - fn pointer for sample calc, modified when type is changed
    - gain comp on by default. Maybe rename "disable gain comp"
 
  */
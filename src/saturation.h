@@ -12,6 +12,10 @@
     saturation.h
 
     * tanh waveshaping saturator effect
+    * optional 2x, 4x, or 8x oversampling through cascaded half-band filters (see halfband.h), so that
+      harmonics generated above the original Nyquist frequency are filtered out rather than aliased
+    * the shaping curves are fast rational and polynomial approximations in float, applied to whole
+      blocks, so the inner loops can be vectorized
  *****************************************************************************************************************/
 
 
@@ -20,9 +24,13 @@
 
 #include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "endpoint.h"
+#include "halfband.h"
 
 #define SATURATION_MAX_GAIN 40.0
+#define SATURATION_BLOCK_LEN 256 /* Process in blocks of this many sframes, before oversampling */
+#define SATURATION_DEFAULT_OVERSAMPLE 1 /* 2x */
 
 typedef enum saturation_type {
     SAT_TANH=0,
@@ -44,7 +52,10 @@ typedef struct saturation {
     Endpoint symmetry_ep;
     Endpoint gain_comp_ep;
     Endpoint type_ep;
-    double (*sample_fn)(Saturation *s, double in);
+    int oversample; /* Number of half-band stages; oversample by 2^oversample */
+    Endpoint oversample_ep;
+    Halfband up[2][HALFBAND_MAX_STAGES];
+    Halfband down[2][HALFBAND_MAX_STAGES];
     Track *track;
 
     Effect *effect;
@@ -54,8 +65,11 @@ typedef struct saturation {
 void saturation_init(Saturation *s);
 void saturation_set_gain(Saturation *s, double gain);
 void saturation_set_type(Saturation *s, SaturationType t);
+void saturation_set_oversample(Saturation *s, int oversample);
+void saturation_clear(Saturation *s);
+int32_t saturation_latency_sframes(Saturation *s);
 /* double saturation_sample(Saturation *s, double in); */
-float saturation_buf_apply(void *saturation_v, float *restrict buf, int len, int channel_unused, float input_amp);
+float saturation_buf_apply(void *saturation_v, float *restrict buf, int len, int channel, float input_amp);
 float saturation_buf_apply_stereo(void *saturation_v, float *restrict L, float *restrict R, int len, float input_amp);
 /* void saturation_buf_apply(Saturation *s, float *buf, int len, int channel_unused); */
 
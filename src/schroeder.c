@@ -4,6 +4,7 @@
 #include "endpoint.h"
 #include "schroeder.h"
 #include "allpass.h"
+#include "dsp_utils.h"
 #include "endpoint_callbacks.h"
 #include "session.h"
 
@@ -476,6 +477,28 @@ void schroeder_clear(Schroeder *sch)
     memset(sch->predelay_buf, 0, sizeof(float) * MAX_PREDELAY_SFRAMES * 2);
 }
 
+/* Predelay, then the longest parallel comb, then the series allpasses */
+int32_t schroeder_tail_len_sframes(Schroeder *sch)
+{
+    int64_t tail = 0;
+    for (int c=0; c<2; c++) {
+	int64_t comb_tail = 0;
+	for (int i=0; i<SCHROEDER_NUM_PARALLEL_LOP_DELAYS; i++) {
+	    LopDelay *ld = sch->parallel_lop_delays[c] + i;
+	    int32_t t = feedback_tail_len_sframes(ld->delay_coeff, ld->len);
+	    if (t > comb_tail) comb_tail = t;
+	}
+	int64_t ap_tail = 0;
+	AllpassGroup *ag = sch->series_aps + c;
+	for (int i=0; i<ag->num_filters; i++) {
+	    ap_tail += feedback_tail_len_sframes(ag->filters[i].coeff, ag->filters[i].len);
+	}
+	if (comb_tail + ap_tail > tail) tail = comb_tail + ap_tail;
+    }
+    tail += sch->predelay_len;
+    return tail > INT32_MAX ? INT32_MAX : (int32_t)tail;
+}
+
 void schroeder_deinit(Schroeder *sch)
 {
     allpass_group_deinit(&sch->series_aps[0]);
@@ -20,6 +20,7 @@
 #include "layout_xml.h"
 #include "log.h"
 #include "session.h"
+#include "session_endpoint_ops.h"
 #include "timeline.h"
 #include "transport.h"
 /* #include "window.h" */
@@ -47,6 +48,17 @@ Session *session_create()
 
     session->sys.cores = SDL_GetCPUCount();
     log_tmp(LOG_INFO, "System has %d cores\n", session->sys.cores);
+
+    /* Voice jobs are dispatched from the DSP thread, which also runs jobs; leave one core for main */
+    session->sys.synth_voice_pool = worker_pool_create(session->sys.cores - 2, "synth voices");
+    session->sys.mixdown_pool = worker_pool_create(session->sys.cores - 2, "mixdown");
+    session_init_worker_producers(
+	session,
+	worker_pool_num_workers(session->sys.synth_voice_pool) + worker_pool_num_workers(session->sys.mixdown_pool));
+
+    resampler_init();
+    session->playback.resample_quality = RESAMPLE_MEDIUM;
+    spectrum_analysis_start();
     
     window_set_layout(main_win, layout_create_from_window(main_win));
     layout_read_xml_to_lt(main_win->layout, MAIN_LT_PATH);
@@ -97,12 +109,8 @@ Session *session_create()
 
     int err;
 
-    if ((err = pthread_mutex_init(&session->queued_ops.queued_val_changes_lock, NULL)) != 0) {
-	fprintf(stderr, "Error initializing queued val changes mutex: %s\n", strerror(err));
-	exit(1);
-    }
-    if ((err = pthread_mutex_init(&session->queued_ops.queued_callback_lock, NULL)) != 0) {
-	fprintf(stderr, "Error initializing queued callback mutex: %s\n", strerror(err));
+    if ((err = pthread_mutex_init(&session->queued_ops.other_producer_lock, NULL)) != 0) {
+	fprintf(stderr, "Error initializing other producer mutex: %s\n", strerror(err));
 	exit(1);
     }
     if ((err = pthread_mutex_init(&session->queued_ops.ongoing_changes_lock, NULL)) != 0) {
@@ -140,6 +148,7 @@ Session *session_create()
     endpoint_set_default_value(&session->playback.output_vol_ep, (Value){.float_v = 1.0f});
     endpoint_set_label_fn(&session->playback.output_vol_ep, label_amp_to_dbstr);
     api_endpoint_register(&session->playback.output_vol_ep, &session->server.api_root);
+    dsp_stats_init(&session->dsp_stats, &session->server.api_root);
     session_init_status_bar(session);
 
 	
@@ -172,6 +181,7 @@ static void session_init_status_bar(Session *session)
     Layout *status_bar_lt = layout_get_child_by_name_recursive(session->gui.layout, "status_bar");
     Layout *draglt = layout_add_child(status_bar_lt);
     Layout *calllt = layout_add_child(status_bar_lt);
+    Layout *dsplt = layout_add_child(status_bar_lt);
     Layout *errlt = layout_add_child(status_bar_lt);
     session->status_bar.layout = status_bar_lt;
 
@@ -197,6 +207,13 @@ static void session_init_status_bar(Session *session)
     errlt->x.value = STATUS_BAR_H_PAD;
     errlt->w.value = 500.0f;
 
+    dsplt->h.type = SCALE;
+    dsplt->h.value = 1.0f;
+    dsplt->y.value = 0.0f;
+    dsplt->x.type = STACK;
+    dsplt->x.value = STATUS_BAR_H_PAD;
+    dsplt->w.value = 300.0f;
+
     session->status_bar.call = textbox_create_from_str(session->status_bar.callstr, calllt, main_win->mono_bold_font, 14, main_win);
     textbox_set_trunc(session->status_bar.call, false);
     textbox_set_text_color(session->status_bar.call, &colors.light_grey);
@@ -214,11 +231,18 @@ static void session_init_status_bar(Session *session)
     textbox_set_text_color(session->status_bar.error, &colors.red);
     textbox_set_background_color(session->status_bar.error, &colors.clear);
     textbox_set_align(session->status_bar.error, CENTER_LEFT);
+
+    session->status_bar.dsp_load = textbox_create_from_str(session->status_bar.dspstr, dsplt, main_win->mono_bold_font, 14, main_win);
+    textbox_set_trunc(session->status_bar.dsp_load, false);
+    textbox_set_text_color(session->status_bar.dsp_load, &colors.light_grey);
+    textbox_set_background_color(session->status_bar.dsp_load, &colors.clear);
+    textbox_set_align(session->status_bar.dsp_load, CENTER_LEFT);
     /* textbox_size_to_fit(session->status_bar.call, 0, 0); */
     /* textbox_size_to_fit(session->status_bar.error, 0, 0); */
     textbox_reset_full(session->status_bar.error);
     textbox_reset_full(session->status_bar.dragstat);
     textbox_reset_full(session->status_bar.call);
+    textbox_reset_full(session->status_bar.dsp_load);
 
 }
 
@@ -228,6 +252,7 @@ static void session_deinit_status_bar(Session *session)
     if (session->status_bar.call) textbox_destroy(session->status_bar.call);
     if (session->status_bar.dragstat) textbox_destroy(session->status_bar.dragstat);
     if (session->status_bar.error) textbox_destroy(session->status_bar.error);
+    if (session->status_bar.dsp_load) textbox_destroy(session->status_bar.dsp_load);
 
 }
 
@@ -281,6 +306,11 @@ void session_destroy()
     if (session->proj_initialized) {
 	project_deinit(&session->proj);
     }
+    spectrum_analysis_stop();
+    worker_pool_destroy(session->sys.synth_voice_pool);
+    worker_pool_destroy(session->sys.mixdown_pool);
+    free(session->queued_ops.worker_val_changes);
+    free(session->queued_ops.worker_callbacks);
 
     free(session);
     session = NULL;
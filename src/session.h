@@ -21,18 +21,22 @@
 #ifndef JDAW_SESSION_H
 #define JDAW_SESSION_H
 
+#include <stdatomic.h>
 #include "audio_connection.h"
 #include "clipref.h"
+#include "dsp_meter.h"
 #include "loading.h"
 #include "midi_io.h"
 #include "panel.h"
 #include "project.h"
+#include "resampler.h"
 #include "status.h"
 /* #include "synth.h" */
 #include "tempo.h"
 #include "timeview.h"
 #include "transport.h"
 #include "user_event.h"
+#include "worker_pool.h"
 
 #define MAX_SESSION_AUDIO_CONNS 32
 #define MAX_SESSION_AUDIO_DEVICES 32
@@ -110,21 +114,37 @@ struct drop_save {
     int32_t out;
 };
 
-struct queued_val_change {
+/* Endpoint val changes and callbacks are passed between threads in bounded lock-free
+   rings, one per (producer thread, consumer thread) pair. See session_endpoint_ops.c */
+#define EP_OP_QUEUE_LEN 256 /* Must be power of 2 */
+#define EP_OP_OTHER_PRODUCER NUM_JDAW_THREADS /* Any thread that is not main, dsp, playback, or a pool worker */
+
+struct ep_op {
+    atomic_int state;
     Endpoint *ep;
+    EndptCb cb; /* NULL for val changes */
     Value new_val;
     bool run_gui_cb;
 };
 
+typedef struct ep_op_queue {
+    struct ep_op ops[EP_OP_QUEUE_LEN];
+    _Atomic uint32_t head; /* Written by consumer only */
+    _Atomic uint32_t tail; /* Written by producer only */
+    uint32_t coalesce_pos[EP_OP_QUEUE_LEN]; /* Producer only; hash(ep, cb) -> pos of last enqueue */
+} EPOpQueue;
+
 struct status_bar {
     pthread_mutex_t errstr_lock;
     Layout *layout;
     char errstr[MAX_STATUS_STRLEN];
     char callstr[MAX_STATUS_STRLEN];
     char dragstr[MAX_STATUS_STRLEN];
+    char dspstr[MAX_STATUS_STRLEN];
     Textbox *error;
     Textbox *call;
     Textbox *dragstat;
+    Textbox *dsp_load;
     int stat_timer;
     int call_timer;
     int err_timer;
@@ -134,15 +154,16 @@ struct status_bar {
 
 struct queued_ops {
     
-    /* Endpoint-related */
-    struct queued_val_change queued_val_changes[NUM_JDAW_THREADS][MAX_QUEUED_OPS];
-    uint8_t num_queued_val_changes[NUM_JDAW_THREADS];
-    pthread_mutex_t queued_val_changes_lock;
-    
-    EndptCb queued_callbacks[NUM_JDAW_THREADS][MAX_QUEUED_OPS];
-    Endpoint *queued_callback_args[NUM_JDAW_THREADS][MAX_QUEUED_OPS];
-    uint8_t num_queued_callbacks[NUM_JDAW_THREADS];
-    pthread_mutex_t queued_callback_lock;
+    /* Endpoint-related; indexed [producer][consumer] */
+    EPOpQueue queued_val_changes[NUM_JDAW_THREADS + 1][NUM_JDAW_THREADS];
+    EPOpQueue queued_callbacks[NUM_JDAW_THREADS + 1][NUM_JDAW_THREADS];
+    pthread_mutex_t other_producer_lock; /* Serializes EP_OP_OTHER_PRODUCER threads; never taken by consumers */
+
+    /* Worker pool threads each claim their own producer rings on first use; indexed [worker][consumer] */
+    EPOpQueue (*worker_val_changes)[NUM_JDAW_THREADS];
+    EPOpQueue (*worker_callbacks)[NUM_JDAW_THREADS];
+    int num_worker_producers;
+    atomic_int num_worker_producers_claimed;
 
     Endpoint *ongoing_changes[NUM_JDAW_THREADS][MAX_QUEUED_OPS];
     uint8_t num_ongoing_changes[NUM_JDAW_THREADS];
@@ -182,6 +203,8 @@ struct playback {
     bool new_cliprefs_repositioned;
     bool playing;
     bool lock_view_to_playhead;
+    bool record_to_disk; /* see record_spill.h */
+    enum resample_quality resample_quality; /* For clips played at non-unity speed */
     float output_vol;
     Endpoint output_vol_ep;
 };
@@ -196,6 +219,8 @@ struct playback {
 
 struct system {
     int cores;
+    WorkerPool *synth_voice_pool; /* Shared by all synths; see synth_add_buf */
+    WorkerPool *mixdown_pool; /* Renders independent tracks concurrently; see get_mixdown_chunk */
 };
 
 /* All persistent "global" data not related to a Project or Window */
@@ -213,6 +238,7 @@ typedef struct session {
     int num_metronome_buffers;
     /* Metronome metronomes[SESSION_NUM_METRONOMES]; */
     struct status_bar status_bar;
+    DSPStats dsp_stats;
     LoadingScreen loading_screen;
     Animation *animations;
     struct api_server server;
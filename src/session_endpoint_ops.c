@@ -12,172 +12,206 @@
 #include "endpoint.h"
 #include "log.h"
 #include "timeline.h"
+#include "worker_pool.h"
 
-/* CALLBACKS */
+/*****************************************************************************************************************
+    Cross-thread endpoint ops
 
-/* Returns 0 on success, 1 if maximum number of callbacks reached */
-int session_queue_val_change(Session *session, Endpoint *ep, Value new_val, bool run_gui_cb)
+    * val changes and callbacks bound for another thread go into a bounded ring, one per
+      (producer, consumer) pair, so each ring has a single producer and a single consumer and
+      neither side takes a lock. Worker pool threads (which render audio for the DSP thread) each
+      claim their own rings the first time they enqueue; the claim is an atomic increment into
+      rings allocated at startup. Any other thread (e.g. the API server) shares the
+      EP_OP_OTHER_PRODUCER rings and serializes on other_producer_lock; consumers never touch that
+      lock, and neither does the audio path.
+    * coalescing: the producer remembers (in a direct-mapped table keyed by ep/cb) where it last
+      enqueued each op. If that op is still unconsumed, the producer overwrites it in place
+      rather than appending. Ownership of a slot is arbitrated with a CAS on its state, so a slot
+      is never rewritten while the consumer is reading it.
+    * if the consumer finds the next slot mid-rewrite, it stops draining; the rest of the ring is
+      drained on the next flush
+ *****************************************************************************************************************/
+
+enum ep_op_state {
+    EP_OP_EMPTY,
+    EP_OP_READY,
+    EP_OP_WRITING,
+    EP_OP_CONSUMED
+};
+
+#define EP_OP_QUEUE_MASK (EP_OP_QUEUE_LEN - 1)
+
+static inline uint32_t ep_op_hash(Endpoint *ep, EndptCb cb)
 {
-    /* fprintf(stderr, "SESSION QUEUE VAL CHANGE!\n"); */
-    pthread_mutex_lock(&session->queued_ops.queued_val_changes_lock);
-    enum jdaw_thread thread = endpoint_get_owner(ep);
-    struct queued_val_change qvc = {
-	ep,
-	new_val,
-	run_gui_cb
-    };
-    int num_queued = session->queued_ops.num_queued_val_changes[thread];
-    bool overwritten = false;
-    for (int i=0; i<num_queued; i++) {
-	struct queued_val_change *qvc_check = session->queued_ops.queued_val_changes[thread] + i;
-	if (qvc_check->ep == ep) {
-	    /* fprintf(stderr, "already writing to endpoint! resetting value\n"); */
-	    memcpy(qvc_check, &qvc, sizeof(struct queued_val_change));
-	    overwritten = true;
-	    break;
+    uintptr_t key = (uintptr_t)ep ^ ((uintptr_t)cb >> 4);
+    key ^= key >> 17;
+    key *= 0x9E3779B1u;
+    return (uint32_t)(key >> 8) & EP_OP_QUEUE_MASK;
+}
+
+/* Producer side. Returns 0 on success, 1 if the queue is full */
+static int ep_op_enqueue(EPOpQueue *q, Endpoint *ep, EndptCb cb, Value new_val, bool run_gui_cb)
+{
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    uint32_t hash = ep_op_hash(ep, cb);
+    uint32_t pos = q->coalesce_pos[hash];
+
+    /* Coalesce with an unconsumed op on the same ep/cb */
+    if (pos - head < tail - head) {
+	struct ep_op *op = q->ops + (pos & EP_OP_QUEUE_MASK);
+	int expected = EP_OP_READY;
+	if (op->ep == ep && op->cb == cb
+	    && atomic_compare_exchange_strong_explicit(&op->state, &expected, EP_OP_WRITING, memory_order_acq_rel, memory_order_relaxed)) {
+	    op->new_val = new_val;
+	    op->run_gui_cb = op->run_gui_cb || run_gui_cb;
+	    atomic_store_explicit(&op->state, EP_OP_READY, memory_order_release);
+	    return 0;
 	}
     }
-    if (!overwritten) {
-	if (num_queued == MAX_QUEUED_OPS) {
-	    pthread_mutex_unlock(&session->queued_ops.queued_val_changes_lock);
-	    return 1;
-	}
-	/* fprintf(stderr, "adding new!\n"); */
-	memcpy(session->queued_ops.queued_val_changes[thread] + num_queued, &qvc, sizeof(struct queued_val_change));
-	session->queued_ops.num_queued_val_changes[thread]++;
+    
+    if (tail - head == EP_OP_QUEUE_LEN) return 1;
+    struct ep_op *op = q->ops + (tail & EP_OP_QUEUE_MASK);
+    op->ep = ep;
+    op->cb = cb;
+    op->new_val = new_val;
+    op->run_gui_cb = run_gui_cb;
+    atomic_store_explicit(&op->state, EP_OP_READY, memory_order_relaxed);
+    q->coalesce_pos[hash] = tail;
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return 0;
+}
 
+/* Consumer side. Copy the next op to dst; return false if the queue is empty up to
+   "end" or the next op is being rewritten */
+static bool ep_op_dequeue(EPOpQueue *q, uint32_t end, struct ep_op *dst)
+{
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if (head == end) return false;
+    struct ep_op *op = q->ops + (head & EP_OP_QUEUE_MASK);
+    int expected = EP_OP_READY;
+    if (!atomic_compare_exchange_strong_explicit(&op->state, &expected, EP_OP_CONSUMED, memory_order_acq_rel, memory_order_relaxed)) {
+	return false;
     }
-    /* struct queued_val_change *qvc = &session->queued_ops.queued_val_changes[thread][session->queued_ops.num_queued_val_changes[thread]]; */
-    /* qvc->ep = ep; */
-    /* qvc->new_val = new_val; */
-    /* qvc->run_gui_cb = run_gui_cb; */
-    /* for (int i=0; i<session->queued_ops.num_queued_val_changes[thread]; i++) { */
-    /* 	if (memcmp(qvc, session->queued_ops.queued_val_changes[thread] + i, sizeof(struct queued_val_change)) == 0) { */
-    /* 	    memcpy(session->queued_ops.queued_val_changes[thread] */
-    /* 	} */
-
-    /* session->queued_ops.num_queued_val_changes[thread]++; */
-    pthread_mutex_unlock(&session->queued_ops.queued_val_changes_lock);
-    return 0;
+    dst->ep = op->ep;
+    dst->cb = op->cb;
+    dst->new_val = op->new_val;
+    dst->run_gui_cb = op->run_gui_cb;
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return true;
 }
 
-#define MAX_DEFERRED 256
-/* static JDAW_THREAD_LOCAL int MAX_DEFERRED = 256; */
-static JDAW_THREAD_LOCAL int num_deferred = 0;
-static JDAW_THREAD_LOCAL Endpoint *deferred_eps[256];
-static JDAW_THREAD_LOCAL EndptCb deferred_cbs[256];
-static JDAW_THREAD_LOCAL enum jdaw_thread deferred_threads[256];
+void session_init_worker_producers(Session *session, int num_workers)
+{
+    struct queued_ops *qo = &session->queued_ops;
+    qo->num_worker_producers = num_workers;
+    atomic_store(&qo->num_worker_producers_claimed, 0);
+    if (num_workers <= 0) return;
+    qo->worker_val_changes = calloc(num_workers, sizeof(*qo->worker_val_changes));
+    qo->worker_callbacks = calloc(num_workers, sizeof(*qo->worker_callbacks));
+    if (!qo->worker_val_changes || !qo->worker_callbacks) {
+	fprintf(stderr, "Fatal error: unable to allocate endpoint op queues\n");
+	exit(1);
+    }
+}
 
-static int session_queue_callback_internal(Session *session, Endpoint *ep, EndptCb cb, enum jdaw_thread thread, bool allow_defer);
+/* Index of the current worker thread's rings, or -1 if it is not a worker (or all are claimed) */
+static JDAW_THREAD_LOCAL int worker_producer_i = -2; /* -2: not yet checked */
 
-void session_flush_val_changes(Session *session, enum jdaw_thread thread)
+static int current_worker_producer(Session *session)
 {
-    Timeline *tl = ACTIVE_TL;
-    int32_t tl_now = timeline_get_play_pos_now(tl);
-    pthread_mutex_lock(&session->queued_ops.queued_val_changes_lock);
-    /* if (session->queued_ops.num_queued_val_changes[thread] > 0) { */
-    /* 	fprintf(stderr, "Flush %d val changes on thread %s\n", session->queued_ops.num_queued_val_changes[thread], get_current_thread_name()); */
-    /* } */
-    for (int i=0; i<session->queued_ops.num_queued_val_changes[thread]; i++) {
-	/* if (i==0)     fprintf(stderr, "FLUSHING THREAD %s\n", get_thread_name()); */
-	struct queued_val_change *qvc = &session->queued_ops.queued_val_changes[thread][i];
-	Endpoint *ep = qvc->ep;	
-	/* Protected write */
-	pthread_mutex_lock(&ep->val_lock);
-	jdaw_val_set_ptr(ep->val, ep->val_type, qvc->new_val);
-	pthread_mutex_unlock(&ep->val_lock);
-	if (ep->automation && ep->automation->write) {
-	    automation_endpoint_write(ep, qvc->new_val, tl_now);
-	}
-	if (thread != JDAW_THREAD_MAIN && qvc->run_gui_cb && ep->gui_callback) {
-	    session_queue_callback(session, ep, ep->gui_callback, JDAW_THREAD_MAIN);
+    if (worker_producer_i == -2) {
+	worker_producer_i = -1;
+	if (worker_pool_on_worker_thread()) {
+	    int i = atomic_fetch_add(&session->queued_ops.num_worker_producers_claimed, 1);
+	    if (i < session->queued_ops.num_worker_producers) {
+		worker_producer_i = i;
+	    }
 	}
     }
-    session->queued_ops.num_queued_val_changes[thread] = 0;
-    pthread_mutex_unlock(&session->queued_ops.queued_val_changes_lock);
-    for (int i=0; i<num_deferred; i++) {
-	int ret = session_queue_callback_internal(session, deferred_eps[i], deferred_cbs[i], deferred_threads[i], false);
-	if (ret != 0) {
-	    log_tmp(LOG_ERROR, "Could not queue callback; return %d\n", ret);
-	}
-    }
-    num_deferred = 0;
+    return worker_producer_i;
 }
 
-/*
-  Return values:
-   0: sucessfully queued
-   1: could not be queued; reached maximum num queued
-   2: lock could not be obtained; deferred (for execution on next flush val changes)
-*/
-static int session_queue_callback_internal(Session *session, Endpoint *ep, EndptCb cb, enum jdaw_thread thread, bool allow_defer)
+/* Number of worker rings a consumer must drain */
+static int worker_producers_claimed(Session *session)
 {
-    int ret = 0;
-    if (allow_defer) {
-	if ((ret = pthread_mutex_trylock(&session->queued_ops.queued_callback_lock)) != 0) {
-	    if (num_deferred == MAX_DEFERRED) return 3;
-	    deferred_eps[num_deferred] = ep;
-	    deferred_cbs[num_deferred] = cb;
-	    deferred_threads[num_deferred] = thread;
-	    num_deferred++;
-	    return 2;
-	}
+    int n = atomic_load_explicit(&session->queued_ops.num_worker_producers_claimed, memory_order_acquire);
+    return n < session->queued_ops.num_worker_producers ? n : session->queued_ops.num_worker_producers;
+}
+
+static int ep_op_enqueue_from_current_thread(Session *session, EPOpQueue queues[][NUM_JDAW_THREADS], EPOpQueue worker_queues[][NUM_JDAW_THREADS], enum jdaw_thread consumer, Endpoint *ep, EndptCb cb, Value new_val, bool run_gui_cb)
+{
+    enum jdaw_thread producer = current_thread_actual();
+    int ret;
+    int worker_i;
+    if (producer == EP_OP_OTHER_PRODUCER && (worker_i = current_worker_producer(session)) >= 0) {
+	ret = ep_op_enqueue(&worker_queues[worker_i][consumer], ep, cb, new_val, run_gui_cb);
+    } else if (producer == EP_OP_OTHER_PRODUCER) {
+	pthread_mutex_lock(&session->queued_ops.other_producer_lock);
+	ret = ep_op_enqueue(&queues[producer][consumer], ep, cb, new_val, run_gui_cb);
+	pthread_mutex_unlock(&session->queued_ops.other_producer_lock);
     } else {
-	pthread_mutex_lock(&session->queued_ops.queued_callback_lock);
+	ret = ep_op_enqueue(&queues[producer][consumer], ep, cb, new_val, run_gui_cb);
     }
-    int num_queued = session->queued_ops.num_queued_callbacks[thread];
-    /* bool already_queued = false; */
-    for (int i=0; i<num_queued; i++) {
-	if (session->queued_ops.queued_callbacks[thread][i] == cb
-	    && session->queued_ops.queued_callback_args[thread][i] == ep) {
-	    goto unlock_and_exit;
+    return ret;
+}
+
+/* Returns 0 on success, 1 if maximum number of queued val changes reached */
+int session_queue_val_change(Session *session, Endpoint *ep, Value new_val, bool run_gui_cb)
+{
+    enum jdaw_thread thread = endpoint_get_owner(ep);
+    return ep_op_enqueue_from_current_thread(session, session->queued_ops.queued_val_changes, session->queued_ops.worker_val_changes, thread, ep, NULL, new_val, run_gui_cb);
+}
+
+void session_flush_val_changes(Session *session, enum jdaw_thread thread)
+{
+    Timeline *tl = ACTIVE_TL;
+    int32_t tl_now = timeline_get_play_pos_now(tl);
+    int num_workers = worker_producers_claimed(session);
+    for (int producer=0; producer<=EP_OP_OTHER_PRODUCER + num_workers; producer++) {
+	EPOpQueue *q = producer <= EP_OP_OTHER_PRODUCER
+	    ? &session->queued_ops.queued_val_changes[producer][thread]
+	    : &session->queued_ops.worker_val_changes[producer - EP_OP_OTHER_PRODUCER - 1][thread];
+	uint32_t end = atomic_load_explicit(&q->tail, memory_order_acquire);
+	struct ep_op qvc;
+	while (ep_op_dequeue(q, end, &qvc)) {
+	    Endpoint *ep = qvc.ep;
+	    /* Protected write */
+	    pthread_mutex_lock(&ep->val_lock);
+	    jdaw_val_set_ptr(ep->val, ep->val_type, qvc.new_val);
+	    pthread_mutex_unlock(&ep->val_lock);
+	    if (ep->automation && ep->automation->write) {
+		automation_endpoint_write(ep, qvc.new_val, tl_now);
+	    }
+	    if (thread != JDAW_THREAD_MAIN && qvc.run_gui_cb && ep->gui_callback) {
+		session_queue_callback(session, ep, ep->gui_callback, JDAW_THREAD_MAIN);
+	    }
 	}
     }
-    if (session->queued_ops.num_queued_callbacks[thread] == MAX_QUEUED_OPS) {
-	ret = 1;
-	goto unlock_and_exit;
-    }
-    session->queued_ops.queued_callbacks[thread][session->queued_ops.num_queued_callbacks[thread]] = cb;
-    session->queued_ops.queued_callback_args[thread][session->queued_ops.num_queued_callbacks[thread]] = ep;
-    session->queued_ops.num_queued_callbacks[thread]++;
-unlock_and_exit:
-    if ((ret = pthread_mutex_unlock(&session->queued_ops.queued_callback_lock)) != 0) {
-	fprintf(stderr, "Error in session_queue_callback unlock: %s\n", strerror(ret));
-    }
-    /* fprintf(stderr, "\t->completing queue on thread %s\n", get_thread_name()); */
-    return ret;
-    
 }
 
 /* Return values:
-   0: sucessfully queued
+   0: sucessfully queued (or already queued)
    1: could not be queued; reached maximum num queued
-   2: lock could not be obtained; deferred (for execution on next flush val changes)
 */
 int session_queue_callback(Session *session, Endpoint *ep, EndptCb cb, enum jdaw_thread thread)
 {
-    return session_queue_callback_internal(session, ep, cb, thread, true);
+    return ep_op_enqueue_from_current_thread(session, session->queued_ops.queued_callbacks, session->queued_ops.worker_callbacks, thread, ep, cb, (Value){0}, false);
 }
 
 void session_flush_callbacks(Session *session, enum jdaw_thread thread)
 {
-    int ret;
-    if ((ret=pthread_mutex_lock(&session->queued_ops.queued_callback_lock)) != 0) {
-	fprintf(stderr, "Error in session_flush_callbacks lock: %s\n", strerror(ret));
-    }
-    EndptCb *cb_arr = session->queued_ops.queued_callbacks[thread];
-    Endpoint **arg_arr = session->queued_ops.queued_callback_args[thread];
-    uint8_t num = session->queued_ops.num_queued_callbacks[thread];
-    /* if (num > 0) { */
-    /* 	fprintf(stderr, "Flush %d callbacks on thread %s\n", session->queued_ops.num_queued_callbacks[thread], get_current_thread_name()); */
-    /* } */
-    for (int i=0; i<num; i++) {
-	/* if (i==0)     fprintf(stderr, "FLUSHING %d Callbacks thread %s\n", num, get_thread_name()); */
-	/* fprintf(stderr, "\tCB flush \"%s\"\n", arg_arr[i]->local_id); */
-	cb_arr[i](arg_arr[i]);
+    int num_workers = worker_producers_claimed(session);
+    for (int producer=0; producer<=EP_OP_OTHER_PRODUCER + num_workers; producer++) {
+	EPOpQueue *q = producer <= EP_OP_OTHER_PRODUCER
+	    ? &session->queued_ops.queued_callbacks[producer][thread]
+	    : &session->queued_ops.worker_callbacks[producer - EP_OP_OTHER_PRODUCER - 1][thread];
+	uint32_t end = atomic_load_explicit(&q->tail, memory_order_acquire);
+	struct ep_op qcb;
+	while (ep_op_dequeue(q, end, &qcb)) {
+	    qcb.cb(qcb.ep);
+	}
     }
-    session->queued_ops.num_queued_callbacks[thread] = 0;
-    pthread_mutex_unlock(&session->queued_ops.queued_callback_lock);
 }
 
 int session_add_ongoing_change(Session *session, Endpoint *ep, enum jdaw_thread thread)
@@ -19,6 +19,9 @@
 
 #include "session.h"
 
+/* Allocate producer rings for num_workers pool threads; call before the workers can enqueue ops */
+void session_init_worker_producers(Session *session, int num_workers);
+
 int session_queue_val_change(Session *session, Endpoint *ep, Value new_val, bool run_gui_cb);
 void session_flush_val_changes(Session *session, enum jdaw_thread thread);
 
@@ -0,0 +1,315 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    spectrum_analyzer.c
+
+    * see spectrum_analyzer.h
+    * the analysis thread copies the newest window_len frames out of the tap, then re-reads the write
+      count; if the producer has since lapped the copied region, the copy is discarded
+    * the registry of analyzers is guarded by analyzers_lock, which the analysis thread holds for a
+      whole pass, so an analyzer is never in use once spectrum_analyzer_destroy has unregistered it
+ *****************************************************************************************************************/
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "consts.h"
+#include "dsp_utils.h"
+#include "fft.h"
+#include "log.h"
+#include "spectrum_analyzer.h"
+
+#ifdef JDAW_LINUX_BUILD
+#include <sys/resource.h>
+#endif
+
+#define TAP_MASK (SPECTRUM_TAP_LEN - 1)
+#define MAX_ANALYZERS 256
+#define ANALYSIS_THREAD_NICE 10
+#define ANALYSIS_MIN_SLEEP_MSEC 2
+
+static SpectrumAnalyzer *analyzers[MAX_ANALYZERS];
+static int num_analyzers = 0;
+static pthread_mutex_t analyzers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t analysis_thread;
+static bool analysis_thread_running = false;
+static atomic_bool analysis_thread_quit = false;
+static pthread_mutex_t wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+
+static int64_t now_msec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int window_len_clamp(int window_len)
+{
+    if (window_len < SPECTRUM_MIN_WINDOW_LEN) return SPECTRUM_MIN_WINDOW_LEN;
+    if (window_len > SPECTRUM_MAX_WINDOW_LEN) return SPECTRUM_MAX_WINDOW_LEN;
+    int p = SPECTRUM_MIN_WINDOW_LEN;
+    while (p * 2 <= window_len) p *= 2;
+    return p;
+}
+
+
+/*------ audio side ----------------------------------------*/
+
+void spectrum_analyzer_feed(SpectrumAnalyzer *an, const float *L, const float *R, int len)
+{
+    if (!atomic_load_explicit(&an->active, memory_order_relaxed)) return;
+    uint64_t written = atomic_load_explicit(&an->tap_written, memory_order_relaxed);
+    if (len > SPECTRUM_TAP_LEN) {
+	if (L) L += len - SPECTRUM_TAP_LEN;
+	if (R) R += len - SPECTRUM_TAP_LEN;
+	written += len - SPECTRUM_TAP_LEN;
+	len = SPECTRUM_TAP_LEN;
+    }
+    int pos = written & TAP_MASK;
+    int first = SPECTRUM_TAP_LEN - pos;
+    if (first > len) first = len;
+    const float *src[] = {L, R};
+    for (int c=0; c<an->num_channels; c++) {
+	if (!src[c]) continue;
+	memcpy(an->tap[c] + pos, src[c], first * sizeof(float));
+	memcpy(an->tap[c], src[c] + first, (len - first) * sizeof(float));
+    }
+    atomic_store_explicit(&an->tap_written, written + len, memory_order_release);
+}
+
+
+/*------ analysis thread ----------------------------------------*/
+
+/* Hamming window, scaled up to account for its amplitude reduction */
+static void analyzer_compute_window(SpectrumAnalyzer *an, int window_len)
+{
+    for (int i=0; i<window_len; i++) {
+	an->window[i] = HAMMING_SCALAR * hamming(i, window_len);
+    }
+    an->window_computed_len = window_len;
+}
+
+/* Returns false if the tap did not hold a full, consistent window */
+static bool analyzer_run(SpectrumAnalyzer *an, uint64_t written)
+{
+    int w = atomic_load(&an->window_len);
+    if (w != an->window_computed_len) {
+	analyzer_compute_window(an, w);
+    }
+    if (written < (uint64_t)w) return false;
+    int start = (written - w) & TAP_MASK;
+    int first = SPECTRUM_TAP_LEN - start;
+    if (first > w) first = w;
+
+    /* Zero-pad to twice the window length */
+    float buf[an->num_channels][FFT_REAL_BUF_LEN(w * 2)];
+    for (int c=0; c<an->num_channels; c++) {
+	memcpy(buf[c], an->tap[c] + start, first * sizeof(float));
+	memcpy(buf[c] + first, an->tap[c], (w - first) * sizeof(float));
+    }
+    uint64_t written_after = atomic_load_explicit(&an->tap_written, memory_order_acquire);
+    if (written_after - written > SPECTRUM_TAP_LEN - w) return false;
+
+    for (int c=0; c<an->num_channels; c++) {
+	float *b = buf[c];
+	for (int i=0; i<w; i++) {
+	    b[i] *= an->window[i];
+	}
+	memset(b + w, '\0', w * sizeof(float));
+	fft_real_forward(b, w * 2);
+	fft_magnitude(FFT_BINS(b), an->mag[c], w, 1.0 / (w * 2));
+    }
+    atomic_store(&an->num_bins, w);
+    return true;
+}
+
+/* Returns the number of msec until some active analyzer is next due, or -1 if none is active */
+static int64_t analysis_pass()
+{
+    int64_t now = now_msec();
+    int64_t next_due = -1;
+    pthread_mutex_lock(&analyzers_lock);
+    for (int i=0; i<num_analyzers; i++) {
+	SpectrumAnalyzer *an = analyzers[i];
+	if (!atomic_load(&an->active)) continue;
+	if (now - atomic_load(&an->last_shown_msec) > SPECTRUM_SHOWN_TIMEOUT_MSEC) {
+	    atomic_store(&an->active, false);
+	    continue;
+	}
+	int64_t interval = 1000 / atomic_load(&an->rate_hz);
+	int64_t due_in = an->last_run_msec + interval - now;
+	if (due_in <= 0) {
+	    uint64_t written = atomic_load_explicit(&an->tap_written, memory_order_acquire);
+	    if (written != an->last_analyzed && analyzer_run(an, written)) {
+		an->last_analyzed = written;
+	    }
+	    an->last_run_msec = now;
+	    due_in = interval;
+	}
+	if (next_due < 0 || due_in < next_due) next_due = due_in;
+    }
+    pthread_mutex_unlock(&analyzers_lock);
+    return next_due;
+}
+
+static void analysis_thread_lower_priority()
+{
+#ifdef JDAW_LINUX_BUILD
+    /* On Linux, PRIO_PROCESS with who == 0 applies to the calling thread only */
+    if (setpriority(PRIO_PROCESS, 0, ANALYSIS_THREAD_NICE) != 0) {
+	log_tmp(LOG_WARN, "Unable to lower spectrum analysis thread priority\n");
+    }
+#else
+    struct sched_param sp;
+    sp.sched_priority = sched_get_priority_min(SCHED_OTHER);
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &sp);
+#endif
+}
+
+static void *analysis_threadfn(void *arg)
+{
+    analysis_thread_lower_priority();
+    while (!atomic_load(&analysis_thread_quit)) {
+	int64_t sleep_msec = analysis_pass();
+	if (sleep_msec < 0) {
+	    /* Nothing is on screen; wait to be woken by spectrum_analyzer_shown */
+	    pthread_mutex_lock(&wake_lock);
+	    bool any_active = false;
+	    pthread_mutex_lock(&analyzers_lock);
+	    for (int i=0; i<num_analyzers; i++) {
+		if (atomic_load(&analyzers[i]->active)) any_active = true;
+	    }
+	    pthread_mutex_unlock(&analyzers_lock);
+	    if (!any_active && !atomic_load(&analysis_thread_quit)) {
+		pthread_cond_wait(&wake, &wake_lock);
+	    }
+	    pthread_mutex_unlock(&wake_lock);
+	} else {
+	    if (sleep_msec < ANALYSIS_MIN_SLEEP_MSEC) sleep_msec = ANALYSIS_MIN_SLEEP_MSEC;
+	    struct timespec ts = {sleep_msec / 1000, (sleep_msec % 1000) * 1000000};
+	    nanosleep(&ts, NULL);
+	}
+    }
+    return NULL;
+}
+
+void spectrum_analysis_start()
+{
+    if (analysis_thread_running) return;
+    atomic_store(&analysis_thread_quit, false);
+    int err;
+    if ((err = pthread_create(&analysis_thread, NULL, analysis_threadfn, NULL)) != 0) {
+	log_tmp(LOG_ERROR, "Unable to start spectrum analysis thread: %s\n", strerror(err));
+	return;
+    }
+    analysis_thread_running = true;
+}
+
+void spectrum_analysis_stop()
+{
+    if (!analysis_thread_running) return;
+    pthread_mutex_lock(&wake_lock);
+    atomic_store(&analysis_thread_quit, true);
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&wake_lock);
+    pthread_join(analysis_thread, NULL);
+    analysis_thread_running = false;
+}
+
+
+/*------ main thread ----------------------------------------*/
+
+SpectrumAnalyzer *spectrum_analyzer_create(int num_channels, int window_len)
+{
+    SpectrumAnalyzer *an = calloc(1, sizeof(SpectrumAnalyzer));
+    if (!an) {
+	fprintf(stderr, "Fatal error: unable to allocate spectrum analyzer\n");
+	exit(1);
+    }
+    an->num_channels = num_channels > 1 ? 2 : 1;
+    for (int c=0; c<an->num_channels; c++) {
+	an->tap[c] = calloc(SPECTRUM_TAP_LEN, sizeof(float));
+	an->mag[c] = calloc(SPECTRUM_MAX_WINDOW_LEN, sizeof(double));
+	if (!an->tap[c] || !an->mag[c]) {
+	    fprintf(stderr, "Fatal error: unable to allocate spectrum analyzer\n");
+	    exit(1);
+	}
+    }
+    an->window = malloc(SPECTRUM_MAX_WINDOW_LEN * sizeof(float));
+    if (!an->window) {
+	fprintf(stderr, "Fatal error: unable to allocate spectrum analyzer\n");
+	exit(1);
+    }
+    window_len = window_len_clamp(window_len);
+    atomic_init(&an->window_len, window_len);
+    atomic_init(&an->num_bins, window_len);
+    atomic_init(&an->rate_hz, SPECTRUM_DEFAULT_RATE_HZ);
+    atomic_init(&an->tap_written, 0);
+    atomic_init(&an->active, false);
+    atomic_init(&an->last_shown_msec, 0);
+
+    pthread_mutex_lock(&analyzers_lock);
+    if (num_analyzers == MAX_ANALYZERS) {
+	log_tmp(LOG_WARN, "Max number of spectrum analyzers reached; analyzer will not update\n");
+    } else {
+	analyzers[num_analyzers] = an;
+	num_analyzers++;
+    }
+    pthread_mutex_unlock(&analyzers_lock);
+    return an;
+}
+
+void spectrum_analyzer_destroy(SpectrumAnalyzer *an)
+{
+    pthread_mutex_lock(&analyzers_lock);
+    for (int i=0; i<num_analyzers; i++) {
+	if (analyzers[i] == an) {
+	    analyzers[i] = analyzers[num_analyzers - 1];
+	    num_analyzers--;
+	    break;
+	}
+    }
+    pthread_mutex_unlock(&analyzers_lock);
+    for (int c=0; c<an->num_channels; c++) {
+	free(an->tap[c]);
+	free(an->mag[c]);
+    }
+    free(an->window);
+    free(an);
+}
+
+void spectrum_analyzer_shown(SpectrumAnalyzer *an)
+{
+    atomic_store(&an->last_shown_msec, now_msec());
+    if (!atomic_load(&an->active)) {
+	pthread_mutex_lock(&wake_lock);
+	atomic_store(&an->active, true);
+	pthread_cond_signal(&wake);
+	pthread_mutex_unlock(&wake_lock);
+    }
+}
+
+void spectrum_analyzer_set_window_len(SpectrumAnalyzer *an, int window_len)
+{
+    atomic_store(&an->window_len, window_len_clamp(window_len));
+}
+
+void spectrum_analyzer_set_rate(SpectrumAnalyzer *an, int rate_hz)
+{
+    if (rate_hz < 1) rate_hz = 1;
+    if (rate_hz > SPECTRUM_MAX_RATE_HZ) rate_hz = SPECTRUM_MAX_RATE_HZ;
+    atomic_store(&an->rate_hz, rate_hz);
+}
@@ -0,0 +1,82 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    spectrum_analyzer.h
+
+    * magnitude spectra for display (the output spectrum panel, the EQ page), computed off the audio
+      thread
+    * the audio side only copies samples into a lock-free tap ring (single producer, single consumer).
+      A low-priority analysis thread windows the newest window_len samples, runs the FFT, and writes
+      magnitudes into the analyzer's output arrays at up to rate_hz updates per second.
+    * an analyzer is active only while it is being drawn: drawing code calls spectrum_analyzer_shown
+      each frame, and the analyzer goes inactive SPECTRUM_SHOWN_TIMEOUT_MSEC after the last call.
+      While inactive, feeding it returns immediately, and if no analyzer is active, the analysis
+      thread sleeps until one is shown.
+*****************************************************************************************************************/
+
+#ifndef JDAW_SPECTRUM_ANALYZER_H
+#define JDAW_SPECTRUM_ANALYZER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SPECTRUM_TAP_LEN 16384 /* power of 2 */
+#define SPECTRUM_MIN_WINDOW_LEN 256
+#define SPECTRUM_MAX_WINDOW_LEN 8192
+#define SPECTRUM_DEFAULT_RATE_HZ 30
+#define SPECTRUM_MAX_RATE_HZ 120
+#define SPECTRUM_SHOWN_TIMEOUT_MSEC 250
+
+typedef struct spectrum_analyzer {
+    int num_channels;
+
+    /* Written by the audio producer */
+    float *tap[2];
+    _Atomic uint64_t tap_written; /* Total sample frames ever written */
+    atomic_bool active;
+    _Atomic int64_t last_shown_msec;
+
+    /* Set from any thread; picked up by the analysis thread before its next pass */
+    _Atomic int window_len; /* Power of 2; resolution is sample_rate / (2 * window_len) */
+    _Atomic int rate_hz;
+
+    /* Written by the analysis thread; read for drawing. Each array holds SPECTRUM_MAX_WINDOW_LEN
+       bins, of which the first num_bins span 0 Hz to Nyquist. */
+    double *mag[2];
+    _Atomic int num_bins;
+
+    /* Analysis thread only */
+    float *window;
+    int window_computed_len;
+    uint64_t last_analyzed;
+    int64_t last_run_msec;
+} SpectrumAnalyzer;
+
+/* Main thread; start and stop the analysis thread */
+void spectrum_analysis_start();
+void spectrum_analysis_stop();
+
+/* Main thread */
+SpectrumAnalyzer *spectrum_analyzer_create(int num_channels, int window_len);
+void spectrum_analyzer_destroy(SpectrumAnalyzer *an);
+
+/* Audio thread (DSP or a mixdown worker, one at a time). Either channel may be NULL. */
+void spectrum_analyzer_feed(SpectrumAnalyzer *an, const float *L, const float *R, int len);
+
+/* Main thread; call each frame the analyzer's output is drawn */
+void spectrum_analyzer_shown(SpectrumAnalyzer *an);
+
+/* window_len is rounded down to a power of 2 and clamped to the supported range */
+void spectrum_analyzer_set_window_len(SpectrumAnalyzer *an, int window_len);
+void spectrum_analyzer_set_rate(SpectrumAnalyzer *an, int rate_hz);
+
+#endif
@@ -233,3 +233,25 @@ void status_stat_drag()
     status_set_dragstr(buf);
 }
 
+
+#define DSP_LOAD_WARN_PERCENT 80.0f
+
+void status_stat_dsp_load()
+{
+    Session *session = session_get();
+    DSPStats *stats = &session->dsp_stats;
+    if (stats->load == 0.0f && stats->peak == 0.0f) {
+	session->status_bar.dspstr[0] = '\0';
+    } else {
+	int n = snprintf(session->status_bar.dspstr, MAX_STATUS_STRLEN, "DSP %.0f%% (peak %.0f%%)", stats->load, stats->peak);
+	if (stats->xruns > 0 && n < MAX_STATUS_STRLEN) {
+	    n += snprintf(session->status_bar.dspstr + n, MAX_STATUS_STRLEN - n, "  xruns %d", stats->xruns);
+	}
+	if (stats->overloads > 0 && n < MAX_STATUS_STRLEN) {
+	    snprintf(session->status_bar.dspstr + n, MAX_STATUS_STRLEN - n, "  overloads %d", stats->overloads);
+	}
+    }
+    bool warn = stats->load >= DSP_LOAD_WARN_PERCENT || stats->peak >= 100.0f;
+    textbox_set_text_color(session->status_bar.dsp_load, warn ? &colors.alert_orange : &colors.light_grey);
+    textbox_reset_full(session->status_bar.dsp_load);
+}
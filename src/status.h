@@ -19,6 +19,7 @@
         - undo/redos (undostr)
         - playback speed changes
         - clip drag state (clipref.h)
+        - DSP load and xruns while playing (dsp_meter.h)
 *****************************************************************************************************************/
 
 #ifndef JDAW_STATUS_H
@@ -37,5 +38,6 @@ void status_set_alertstr(const char *fmt, ...);
 void status_set_sticky_alert_str(const char *fmt, ...);
 void status_stat_playspeed();
 void status_stat_drag();
+void status_stat_dsp_load();
 
 #endif
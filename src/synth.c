@@ -21,6 +21,8 @@
 #include "time.h"
 #include "tmp.h"
 #include "user_event.h"
+#include "wavetable.h"
+#include "worker_pool.h"
 
 extern double MTOF[];
 
@@ -357,6 +359,36 @@ void synth_parallelism_enable()
 }
 static bool parallelism_initialized = false;
 
+/* Band-limited tables for each WaveShape (NULL for WS_OTHER); built once, shared by all synths */
+static Wavetable *osc_wavetables[NUM_WAVE_SHAPES];
+static pthread_once_t osc_wavetables_once = PTHREAD_ONCE_INIT;
+
+static void osc_wavetables_init()
+{
+    double amps[WAVETABLE_MAX_HARMONIC];
+    memset(amps, '\0', sizeof(amps));
+    amps[0] = 1.0;
+    osc_wavetables[WS_SINE] = wavetable_create(amps, 1);
+
+    /* Square: 1 in the first half cycle, -1 in the second */
+    for (int k=1; k<=WAVETABLE_MAX_HARMONIC; k++) {
+	amps[k - 1] = k % 2 ? 4.0 / (PI * k) : 0.0;
+    }
+    osc_wavetables[WS_SQUARE] = wavetable_create(amps, WAVETABLE_MAX_HARMONIC);
+
+    /* Triangle: rising from 0 to 1 at phase 0.25 */
+    for (int k=1; k<=WAVETABLE_MAX_HARMONIC; k++) {
+	amps[k - 1] = k % 2 ? 8.0 / (PI * PI * k * k) * ((k / 2) % 2 ? -1.0 : 1.0) : 0.0;
+    }
+    osc_wavetables[WS_TRI] = wavetable_create(amps, WAVETABLE_MAX_HARMONIC);
+
+    /* Saw: rising from -1 to 1 over the cycle */
+    for (int k=1; k<=WAVETABLE_MAX_HARMONIC; k++) {
+	amps[k - 1] = -2.0 / (PI * k);
+    }
+    osc_wavetables[WS_SAW] = wavetable_create(amps, WAVETABLE_MAX_HARMONIC);
+}
+
 Synth *synth_create(Track *track)
 {
     if (!parallelism_initialized) {
@@ -364,6 +396,7 @@ Synth *synth_create(Track *track)
 	    synth_parallelism_allowed = false;
 	}
     }
+    pthread_once(&osc_wavetables_once, osc_wavetables_init);
     Synth *s = calloc(1, sizeof(Synth));
     
     snprintf(s->preset_name, MAX_NAMELENGTH, "preset.jsynth");
@@ -1100,22 +1133,7 @@ Synth *synth_create(Track *track)
 /* }; */
 
 
-/* From Paul Batchelor, https://pbat.ch/sndkit/blep/ */
-static float polyblep(float incr, float phase)
-{
-    if (phase < incr) {
-        phase /= incr;
-        return phase + phase - phase * phase - 1.0;
-    } else if(phase > 1.0 - incr) {
-        phase = (phase - 1.0) / incr;
-        return phase * phase + phase + phase + 1.0;
-    }
-
-    return 0.0;
-}
-
 static void osc_set_freq(Osc *osc, double freq_hz);
-static bool do_blep = true;
 
 static void osc_reset_params(Osc *osc, int32_t chunk_len)
 {
@@ -1149,135 +1167,81 @@ static void osc_reset_params(Osc *osc, int32_t chunk_len)
     }
 }
 
-static void osc_get_buf_preamp(Osc *osc, float step, int len, int after)
+static inline double osc_phase_wrap(double phase)
 {
-    if (len > MAX_OSC_BUF_LEN) {
-	fprintf(stderr, "Error: Synth Oscs cannot support buf size > %d (req size %d)\n", MAX_OSC_BUF_LEN, len);
-	#ifdef TESTBUILD
-	exit(1);
-	#endif
-	len = MAX_OSC_BUF_LEN;
+    if (phase >= 1.0 || phase < 0.0) {
+	phase -= floor(phase);
+	if (phase >= 1.0) phase = 0.0;
     }
-    float *fmod_samples;
-    float *amod_samples;
-    float fmod_amp;
+    return phase;
+}
+
+/* Read len samples from a table, advancing phase by incr per sample. If fmod is not NULL,
+   the increment is scaled by (1 - fmod[i]) */
+static void osc_render_table(const float *restrict table, double *phase_p, double incr, const float *restrict fmod, float *restrict dst, int len)
+{
+    double phase = *phase_p;
+    if (fmod) {
+	for (int i=0; i<len; i++) {
+	    dst[i] = wavetable_read(table, phase);
+	    phase = osc_phase_wrap(phase + incr * (1.0 - fmod[i]));
+	}
+    } else {
+	for (int i=0; i<len; i++) {
+	    dst[i] = wavetable_read(table, phase);
+	    phase += incr;
+	    if (phase >= 1.0) phase -= 1.0;
+	}
+	phase = osc_phase_wrap(phase);
+    }
+    *phase_p = phase;
+}
+
+/* Fill dst with the oscillator's output, before amp and pan. Modulators are rendered into
+   scratch buffers on the stack. Samples before "after" are zero. */
+static void osc_get_buf_preamp(Osc *osc, float *restrict dst, float step, int len, int after)
+{
+    if (after > len) after = len;
+    memset(dst, '\0', after * sizeof(float));
+
+    float fmod_samples[osc->freq_modulator ? len : 1];
+    float amod_samples[osc->amp_modulator ? len : 1];
     if (osc->freq_modulator) {
-	fmod_samples = osc->freq_modulator->buf;
-	osc_get_buf_preamp(osc->freq_modulator, step, len, after);
-	fmod_amp = powf(osc->freq_modulator->cfg->amp, 3.0f);
+	osc_get_buf_preamp(osc->freq_modulator, fmod_samples, step, len, after);
+	/* Raise fmod amp to 3 to get fmod values in more useful range */
+	float fmod_amp = powf(osc->freq_modulator->cfg->amp, 3.0f);
 	float_buf_mult_const(fmod_samples, fmod_amp, len);
     }
     if (osc->amp_modulator) {
-	amod_samples = osc->amp_modulator->buf;
-	osc_get_buf_preamp(osc->amp_modulator, step, len, after);
+	osc_get_buf_preamp(osc->amp_modulator, amod_samples, step, len, after);
 	float amp = osc->amp_modulator->cfg->amp;
 	float_buf_mult_const(amod_samples, amp, len);
-	
     }
+
     double phase_incr = osc->sample_phase_incr + osc->sample_phase_incr_addtl;
-    double phase = osc->phase;
-    /* int unison_i = (long)((osc - osc->voice->oscs) - (osc->cfg - osc->voice->synth->base_oscs)) / SYNTH_NUM_BASE_OSCS; */
-    size_t zeroset_len = after > len ? len * sizeof(int) : after * sizeof(int);
-    memset(osc->buf, '\0', zeroset_len);
-    bool do_unison_compensation = false;
-    float unison_compensation = 1.0f;
-    if (osc->cfg->unison.num_voices > 0 && !osc->cfg->mod_freq_of && !osc->cfg->mod_amp_of) {
-	unison_compensation =  1.0 / (0.2 * osc->cfg->unison.num_voices * osc->cfg->unison.relative_amp + 1.0);
-	do_unison_compensation = true;
-    }
-
-    if (phase_incr > 0.4) { /* Nearing nyquist */
-	memset(osc->buf, '\0', sizeof(float) * len);
-    } else {
-	for (int i=after; i<len; i++) {
-	    float sample;
-	    if (osc->cfg->fix_freq && i % 93 == 0) {
-		/* fprintf(stderr, "resetting %d\n", i); */
-		osc_reset_params(osc, 0);
-	    }
-	    /* double phase_incr = osc->sample_phase_incr + osc->sample_phase_incr_addtl; */
-	    switch(osc->type) {
-	    case WS_SINE:
-		sample = sinf(TAU * phase);
-		break;
-	    case WS_SQUARE:
-		sample = phase < 0.5 ? 1.0 : -1.0;
-		sample += polyblep(phase_incr, phase);
-		sample -= polyblep(phase_incr, fmod(phase + 0.5, 1.0)); 
-		break;
-	    case WS_TRI:
-		/* if (do_blep) { */
-		/*     sample = phase < 0.5 ? 1.0 : -1.0; */
-		/*     sample += polyblep(phase_incr, phase); */
-		/*     sample -= polyblep(phase_incr, fmod(phase + 0.5, 1.0));  */
-
-		/*     sample *= 4.0 * phase_incr; */
-		/*     sample += osc->last_out_tri; */
-		/*     osc->last_out_tri = sample; */
-		/*     sample = iir_sample(&osc->tri_dc_blocker, sample, 0); */
-		/* } else { */
-		    sample =
-			phase <= 0.25 ?
-			phase * 4.0f :
-			phase <= 0.5f ?
-			(0.5f - phase) * 4.0 :
-			phase <= 0.75f ?
-			(phase - 0.5f) * -4.0 :
-			(1.0f - phase) * -4.0;
-		/* } */
+    Wavetable *wt = osc_wavetables[osc->type];
+    if (phase_incr > 0.4 || !wt) { /* Nearing nyquist */
+	memset(dst, '\0', len * sizeof(float));
+	return;
+    }
 
-		break;
-	    case WS_SAW:
-		sample = 2.0f * phase - 1.0;
-		if (do_blep) {
-		    /* BLEP */
-		    sample -= polyblep(phase_incr, phase);
-		}
-		break;
-	    default:
-		sample = 0.0;
-	    }
-	    if (osc->freq_modulator) {
-		/* Raise fmod sample to 3 to get fmod values in more useful range */
-		/* float fmod_sample = pow(osc_sample(osc->freq_modulator, channel, num_channels, step, chunk_index), 3.0); */
-		/* fprintf(stderr, "fmod sample in osc %p: %f\n", osc, fmod_sample); */
-		phase += phase_incr * step * (1.0 - fmod_samples[i]);
-	    } else {
-		phase += phase_incr * step;
-	    }
-	    if (osc->amp_modulator) {
-		sample *= 1.0 + amod_samples[i];
-		/* sample *= 1.0 + osc_sample(osc->amp_modulator, channel, num_channels, step, chunk_index); */
-	    }
-	    if (phase > 1.0) {
-		phase = phase - floor(phase);
-	    } else if (phase < 0.0) {
-		phase = 1.0 + phase + ceil(phase);
-	    }
-	    /* Reverse polarity on some voices:
-	       ignore for now */
-	    /* if (!osc->cfg->mod_freq_of && !osc->cfg->mod_amp_of && unison_i != 0 && unison_i % 3 == 0) { */
-		/* sample *= -1; */
-	    /* } */
-	    osc->buf[i] = sample;
+    /* Fixed-frequency oscs are re-tuned every 93 samples; others in one segment */
+    int seg_len = osc->cfg->fix_freq ? 93 : len;
+    for (int i=after; i<len; i+=seg_len) {
+	if (osc->cfg->fix_freq && i > after) {
+	    osc_reset_params(osc, 0);
+	    phase_incr = osc->sample_phase_incr + osc->sample_phase_incr_addtl;
 	}
-	if (do_unison_compensation) {
-	    float_buf_mult_const(osc->buf + after, unison_compensation, len - after);
+	int n = len - i < seg_len ? len - i : seg_len;
+	double incr = phase_incr * step;
+	const float *table = wavetable_level(wt, incr);
+	osc_render_table(table, &osc->phase, incr, osc->freq_modulator ? fmod_samples + i : NULL, dst + i, n);
+    }
+    if (osc->amp_modulator) {
+	for (int i=after; i<len; i++) {
+	    dst[i] *= 1.0f + amod_samples[i];
 	}
-	osc->phase = phase;
-    }
-    /* osc->phase_incr =  */
-    /* apply_amp_and_pan: */
-    /* 	(void)0; */
-    /* 	float bottom_sample; */
-    /* 	if (channel == 0) { */
-    /* 	    osc->saved_L_out[chunk_index] = sample; */
-    /* 	    bottom_sample = sample; */
-    /* 	} else { */
-    /* 	    bottom_sample = osc->saved_L_out[chunk_index]; */
-    /* 	} */
-    /* 	return bottom_sample * osc->amp * pan_scale(osc->pan, channel); */
-    /* } */
+    }
 }
 
 
@@ -1399,13 +1363,11 @@ struct synthvoice_arg {
     int32_t len;
     float step;
 };
-static void *synth_voice_add_buf_threadfn(void *userdata)
+/* Worker pool job; see synth_add_buf */
+static void synth_voice_job(void *userdata)
 {
     struct synthvoice_arg *arg = userdata;
-    /* fprintf(stderr, "Adding buf %p...\n", arg->buf); */
     synth_voice_add_buf(arg->v, arg->L, arg->R, arg->len, arg->step, true);
-    /* fprintf(stderr, "\tbuf %p done...\n", arg->buf); */
-    return NULL;
 }
 
 static void synth_voice_add_buf(SynthVoice *v, float *restrict L, float *restrict R, int32_t len, float step, bool set_not_add)
@@ -1418,52 +1380,33 @@ static void synth_voice_add_buf(SynthVoice *v, float *restrict L, float *restric
 	osc_reset_params(v->oscs + i, len);
     }
     int after = v->amp_env.current_stage == ADSR_UNINIT ? v->amp_env.env_remaining : 0;
+
+    /* Gather sounding oscillators (carriers and their unison voices), structure-of-arrays */
+    Osc *oscs[SYNTHVOICE_NUM_OSCS];
+    float amps_L[SYNTHVOICE_NUM_OSCS];
+    float amps_R[SYNTHVOICE_NUM_OSCS];
+    int num_oscs = 0;
     for (int i=0; i<SYNTH_NUM_BASE_OSCS; i++) {
 	OscCfg *cfg = v->synth->base_oscs + i;
-	/* fprintf(stderr, "\t\tvoice %ld osc %d\n", v - v->synth->voices, i); */
-	Osc *osc = v->oscs + i;
-	/* osc_reset_params(osc); */
 	if (!cfg->active) continue;
 	if (cfg->mod_freq_of || cfg->mod_amp_of) continue;
-
-	/* if (osc->freq_modulator) */
-	/*     osc_reset_params(osc->freq_modulator); */
-	/* if (osc->amp_modulator) */
-	/*     osc_reset_params(osc->amp_modulator); */
-	float ind_osc_buf[2][len];
-	osc_get_buf_preamp(osc, step, len, after);
-	memcpy(ind_osc_buf[0], osc->buf, len * sizeof(float));
-	memcpy(ind_osc_buf[1], osc->buf, len * sizeof(float));
-	float amp_L = osc->amp * pan_scale(osc->pan, 0);
-	float amp_R = osc->amp * pan_scale(osc->pan, 1);
-        float_buf_mult_const(ind_osc_buf[0], amp_L, len);
-	float_buf_mult_const(ind_osc_buf[1], amp_R, len);
-	float_buf_add(osc_buf[0], ind_osc_buf[0], len);
-	float_buf_add(osc_buf[1], ind_osc_buf[1], len);
-	
-	/* for (int i=0; i<len; i++) { */
-	/*     osc_buf[i] += osc_sample(osc, channel, 2, step, i); */
-	/* } */
-	for (int j=0; j<cfg->unison.num_voices; j++) {
-	    osc = v->oscs + i + SYNTH_NUM_BASE_OSCS * (j + 1);
-	    /* osc_reset_params(osc); */
-	    /* if (osc->freq_modulator) */
-	    /* 	osc_reset_params(osc->freq_modulator); */
-	    /* if (osc->amp_modulator) */
-	    /* 	osc_reset_params(osc->amp_modulator); */
-
-	    /* if (channel == 0) { */
-	    osc_get_buf_preamp(osc, step, len, after);
-	    /* } */
-	    memcpy(ind_osc_buf[0], osc->buf, len * sizeof(float));
-	    memcpy(ind_osc_buf[1], osc->buf, len * sizeof(float));
-	    amp_L = osc->amp * pan_scale(osc->pan, 0);
-	    amp_R = osc->amp * pan_scale(osc->pan, 1);
-	    float_buf_mult_const(ind_osc_buf[0], amp_L, len);
-	    float_buf_mult_const(ind_osc_buf[1], amp_R, len);
-	    float_buf_add(osc_buf[0], ind_osc_buf[0], len);
-	    float_buf_add(osc_buf[1], ind_osc_buf[1], len);
+	float unison_compensation = 1.0f;
+	if (cfg->unison.num_voices > 0) {
+	    unison_compensation =  1.0 / (0.2 * cfg->unison.num_voices * cfg->unison.relative_amp + 1.0);
 	}
+	for (int j=0; j<=cfg->unison.num_voices; j++) {
+	    Osc *osc = v->oscs + i + SYNTH_NUM_BASE_OSCS * j;
+	    oscs[num_oscs] = osc;
+	    amps_L[num_oscs] = osc->amp * pan_scale(osc->pan, 0) * unison_compensation;
+	    amps_R[num_oscs] = osc->amp * pan_scale(osc->pan, 1) * unison_compensation;
+	    num_oscs++;
+	}
+    }
+    float ind_osc_buf[len];
+    for (int i=0; i<num_oscs; i++) {
+	osc_get_buf_preamp(oscs[i], ind_osc_buf, step, len, after);
+	float_buf_mix_in(osc_buf[0], ind_osc_buf, amps_L[i], len);
+	float_buf_mix_in(osc_buf[1], ind_osc_buf, amps_R[i], len);
     }
 
     float amp_env[len];
@@ -1490,8 +1433,8 @@ static void synth_voice_add_buf(SynthVoice *v, float *restrict L, float *restric
 	    adsr_get_chunk(&v->noise_amt_env, noise_env, len, NULL);
 	}
     }
-    for (int i=0; i<len; i++) {
-	if (do_noise) {
+    if (do_noise) {
+	for (int i=0; i<len; i++) {
 	    float env = 1.0;
 	    if (v->synth->noise_apply_env) {
 		env = noise_env[i];
@@ -1499,43 +1442,34 @@ static void synth_voice_add_buf(SynthVoice *v, float *restrict L, float *restric
 	    osc_buf[0][i] += env * (((float)(rand() % INT16_MAX) / INT16_MAX) - 0.5) * 2.0 * v->synth->noise_amt;
 	    osc_buf[1][i] += env * (((float)(rand() % INT16_MAX) / INT16_MAX) - 0.5) * 2.0 * v->synth->noise_amt;
 	}
-	if (v->synth->filter_active) {
-	    if (i%37 == 0) { /* Update filter every 37 sample frames */
-		    
-		    /* + v->synth->vel_amt * (v->velocity / 127.0); */
-		float note;
-		if (v->do_portamento && v->portamento_len_sframes > 0) {
-		    /* float portamento_incr = (float)(osc->voice->note_val - osc->voice->portamento_from) / osc->voice->portamento_len_bufs; */
-		    note = (float)v->portamento_from + ((double)v->portamento_elapsed_sframes * (v->note_val - v->portamento_from) / v->portamento_len_sframes);
-		} else {
-		    note = v->note_val;
-		}
-	    
-		double freq =
-		    (v->synth->base_cutoff
-		     + v->synth->pitch_amt * mtof_calc(note) / (float)session_get_sample_rate()
-			)
-		    * (1.0f + (v->synth->env_amt * filter_env_p[i]))
-		    * (1.0f - (v->synth->vel_amt * (1.0 - (float)v->velocity / 127.0f)));
-		if (freq > 0.99f) freq = 0.99f;
-		if (freq < 1e-3) freq = 1e-3;
-		/* if (freq > 1e-3) { */
-		/* fprintf(stderr, "SET filter freq %f (env %f, stage %d), res %f\n", freq, filter_env_p[i], v->filter_env[channel].current_stage, v->synth->resonance); */
-		iir_set_coeffs_lowpass_chebyshev(f, freq, v->synth->resonance);
-		/* } */
+    }
+    if (v->synth->filter_active) {
+	/* Update filter every 37 sample frames; filter the segment in between as a block */
+	for (int i=0; i<len; i+=37) {
+	    /* + v->synth->vel_amt * (v->velocity / 127.0); */
+	    float note;
+	    if (v->do_portamento && v->portamento_len_sframes > 0) {
+		/* float portamento_incr = (float)(osc->voice->note_val - osc->voice->portamento_from) / osc->voice->portamento_len_bufs; */
+		note = (float)v->portamento_from + ((double)v->portamento_elapsed_sframes * (v->note_val - v->portamento_from) / v->portamento_len_sframes);
+	    } else {
+		note = v->note_val;
 	    }
-	    /* float pre_filter = osc_buf[i]; */
-	    osc_buf[0][i] = iir_sample(f, osc_buf[0][i], 0);
-	    osc_buf[1][i] = iir_sample(f, osc_buf[1][i], 1);
-	    /* if (fabs(osc_buf[i]) > 5.0) { */
-	    /* 	fprintf(stderr, "Err post filter %f (pre %f)\n", osc_buf[i], pre_filter); */
-	    /* 	fprintf(stderr, "\tLast set freq: %f (%fHz), coeffs A: %f %f %f, B: %f %f\n", last_set_freq, dsp_scale_freq_to_hz(last_set_freq),   f->A[0], f->A[1], f->A[2], f->B[0], f->B[1]); */
-	    /* 	fprintf(stderr, "\tPol loc %f+%fi, rad %f\n", creal(f->poles[0]), cimag(f->poles[0]), cabs(f->poles[0])); */
-	    /* 	exit(0); */
-	    /* } */
+	    
+	    double freq =
+		(v->synth->base_cutoff
+		 + v->synth->pitch_amt * mtof_calc(note) / (float)session_get_sample_rate()
+		    )
+		* (1.0f + (v->synth->env_amt * filter_env_p[i]))
+		* (1.0f - (v->synth->vel_amt * (1.0 - (float)v->velocity / 127.0f)));
+	    if (freq > 0.99f) freq = 0.99f;
+	    if (freq < 1e-3) freq = 1e-3;
+	    /* fprintf(stderr, "SET filter freq %f (env %f, stage %d), res %f\n", freq, filter_env_p[i], v->filter_env[channel].current_stage, v->synth->resonance); */
+	    iir_set_coeffs_lowpass_chebyshev(f, freq, v->synth->resonance);
+	    int seg_len = len - i < 37 ? len - i : 37;
+	    iir_buf_apply_stereo(f, osc_buf[0] + i, osc_buf[1] + i, seg_len);
 	}
-	/* buf[i] += osc_buf[i] * (float)v->velocity / 127.0f; */
     }
+    /* buf[i] += osc_buf[i] * (float)v->velocity / 127.0f; */
     float_buf_mult(osc_buf[0], amp_env, len);
     float_buf_mult(osc_buf[1], amp_env, len);
 
@@ -2162,44 +2096,39 @@ void synth_add_buf(Synth *s, float *restrict L, float *restrict R, int32_t len,
     float bufs[SYNTH_NUM_VOICES][2][len];
     /* memset(bufs, 0, sizeof(bufs)); */
     struct synthvoice_arg args[SYNTH_NUM_VOICES];
-    pthread_t threads[SYNTH_NUM_VOICES];
-    bool thread_exists[SYNTH_NUM_VOICES] = {0};
     int active_voices = 0;
+    WorkerPool *pool = session_get()->sys.synth_voice_pool;
     bool synth_parallelism =
 	!on_thread(JDAW_THREAD_PLAYBACK)
-	&& synth_parallelism_allowed;
+	&& synth_parallelism_allowed
+	&& worker_pool_num_workers(pool) > 0;
     if (synth_parallelism) {
 	for (int i=0; i<SYNTH_NUM_VOICES; i++) {
 	    SynthVoice *v = s->voices + i;
 	    if (!v->available) {
+		struct synthvoice_arg *arg = args + active_voices;
+		arg->v = v;
+		arg->L = bufs[active_voices][0];
+		arg->R = bufs[active_voices][1];
+		arg->len = len;
+		arg->step = step;
 		active_voices++;
-		args[i].v = v;
-		args[i].L = bufs[i][0];
-		args[i].R = bufs[i][1];
-		args[i].len = len;
-		/* args[i].channel = channel; */
-		args[i].step = step;
-		pthread_create(threads + i, NULL, synth_voice_add_buf_threadfn, args + i);
-		thread_exists[i] = true;
 	    }
 	}
+	worker_pool_run(pool, synth_voice_job, args, sizeof(struct synthvoice_arg), active_voices);
+	for (int i=0; i<active_voices; i++) {
+	    float_buf_add(internal_buf[0], bufs[i][0], len);
+	    float_buf_add(internal_buf[1], bufs[i][1], len);
+	}
     } else {
     	for (int i=0; i<SYNTH_NUM_VOICES; i++) {
 	    SynthVoice *v = s->voices + i;
 	    if (!v->available) {
+		active_voices++;
 		synth_voice_add_buf(v, internal_buf[0], internal_buf[1], len, step, false);
 	    }
 	}
     }
-    if (synth_parallelism) {
-	for (int i=0; i<SYNTH_NUM_VOICES; i++) {
-	    if (thread_exists[i]) {
-		pthread_join(threads[i], NULL);
-		float_buf_add(internal_buf[0], bufs[i][0], len);
-		float_buf_add(internal_buf[1], bufs[i][1], len);
-	    }
-	}
-    }
     if (has_timeout) {
 	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
 	double elapsed_msec = timespec_elapsed_ms(&start, &end);
@@ -2242,7 +2171,12 @@ void synth_add_buf(Synth *s, float *restrict L, float *restrict R, int32_t len,
     /* } */
 
     /* if (!timed_out) { */
-    effect_chain_buf_apply(&s->effect_chain, internal_buf[0], internal_buf[1], len, 1.0);
+    /* No voices sounding, and nothing left ringing in the effects */
+    if (active_voices == 0 && effect_chain_is_idle(&s->effect_chain)) {
+	pthread_mutex_unlock(&s->audio_proc_lock);
+	return;
+    }
+    effect_chain_buf_apply(&s->effect_chain, internal_buf[0], internal_buf[1], len, active_voices > 0 ? 1.0 : 0.0);
 
     float pan_scale_L = pan_scale(s->pan, 0);
     float pan_scale_R = pan_scale(s->pan, 1);
@@ -2357,6 +2291,14 @@ void synth_silence(Synth *s)
     }
     effect_chain_silence(&s->effect_chain);
 }
+bool synth_is_idle(Synth *s)
+{
+    for (int i=0; i<SYNTH_NUM_VOICES; i++) {
+	if (!s->voices[i].available) return false;
+    }
+    return effect_chain_is_idle(&s->effect_chain);
+}
+
 void synth_clear_all(Synth *s)
 {
     for (int i=0; i<SYNTH_NUM_VOICES; i++) {
@@ -20,6 +20,9 @@
     * base oscs can point at eachother for frequency or amplitude modulation
     * (in which case unison voices are ignored)
     * ADSR envelopes described in adsr.h
+    * oscillators read mipmapped band-limited wavetables (see wavetable.h), shared by all synths. Each
+      block, a voice gathers its sounding oscillators into arrays and renders them one at a time
+      into a single scratch buffer on the stack.
  *****************************************************************************************************************/
 
 
@@ -39,7 +42,6 @@
 #define SYNTH_NUM_BASE_OSCS 4
 #define SYNTH_MAX_UNISON_OSCS 7
 #define SYNTHVOICE_NUM_OSCS (SYNTH_NUM_BASE_OSCS * SYNTH_MAX_UNISON_OSCS) /* 4 base oscillators, up to 5 per base for detune */
-#define MAX_OSC_BUF_LEN 8192
 
 /* #define SYNTH_EVENT_BUF_SIZE 512 */
 
@@ -58,7 +60,6 @@ typedef struct osc Osc;
 typedef struct osc_cfg OscCfg;
 typedef struct synth_voice SynthVoice;
 typedef struct osc {
-    float buf[MAX_OSC_BUF_LEN];
     bool active;
     OscCfg *cfg;
     SynthVoice *voice;
@@ -285,6 +286,8 @@ void synth_add_buf(Synth *s, float *restrict L, float *restrict R, int32_t len,
 void synth_close_all_notes(Synth *s);
 void synth_clear_all(Synth *s);
 void synth_silence(Synth *s);
+/* No voices sounding, and no synth effect tails left to ring out */
+bool synth_is_idle(Synth *s);
 
 /* Return 0 for success, 1 for unset (carrier NULL), < 0 for error */
 int synth_set_freq_mod_pair(Synth *s, OscCfg *carrier_cfg, OscCfg *modulator_cfg);
@@ -19,6 +19,19 @@ static pthread_t PLAYBACK_THREAD_ID = 0;
 
 static JDAW_THREAD_LOCAL pthread_t CURRENT_THREAD_ID = 0;
 
+/* Set on worker threads while they run a job on behalf of one of the standard threads */
+static JDAW_THREAD_LOCAL enum jdaw_thread DELEGATE_FOR = NUM_JDAW_THREADS;
+
+void thread_delegate_begin(enum jdaw_thread index)
+{
+    DELEGATE_FOR = index;
+}
+
+void thread_delegate_end()
+{
+    DELEGATE_FOR = NUM_JDAW_THREADS;
+}
+
 void set_thread_id(enum jdaw_thread index)
 {
     pthread_t self = pthread_self();
@@ -116,6 +129,7 @@ const char *get_current_thread_name()
 
 bool on_thread(enum jdaw_thread thread_index)
 {
+    if (DELEGATE_FOR != NUM_JDAW_THREADS) return DELEGATE_FOR == thread_index;
     pthread_t id = pthread_self();
     if (thread_index == JDAW_THREAD_MAIN && id == MAIN_THREAD_ID)
 	return true;
@@ -126,6 +140,12 @@ bool on_thread(enum jdaw_thread thread_index)
 }
 
 enum jdaw_thread current_thread()
+{
+    if (DELEGATE_FOR != NUM_JDAW_THREADS) return DELEGATE_FOR;
+    return current_thread_actual();
+}
+
+enum jdaw_thread current_thread_actual()
 {
     pthread_t id = pthread_self();
     if (id == MAIN_THREAD_ID) {
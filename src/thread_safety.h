@@ -106,7 +106,15 @@ enum jdaw_thread {
 void set_thread_id(enum jdaw_thread index);
 pthread_t *get_thread_addr(enum jdaw_thread index);
 enum jdaw_thread current_thread();
+
+/* Like current_thread(), but ignores delegation; NUM_JDAW_THREADS for any non-standard thread */
+enum jdaw_thread current_thread_actual();
 const char *get_current_thread_name();
 const char *get_thread_name(enum jdaw_thread thread);
 bool on_thread(enum jdaw_thread thread_index);
+
+/* Make the calling (worker) thread report itself as "index" to on_thread() and
+   current_thread() until thread_delegate_end() is called */
+void thread_delegate_begin(enum jdaw_thread index);
+void thread_delegate_end();
 #endif
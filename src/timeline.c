@@ -253,6 +253,7 @@ void timeline_full_pause(Timeline *tl)
     for (uint8_t i=0; i<tl->num_tracks; i++) {
 	track_full_pause(tl->tracks[i]);
     }    
+    timeline_clear_delay_comp(tl);
 }
 
 void timeline_handle_playhead_jump(Timeline *tl)
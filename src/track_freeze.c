@@ -0,0 +1,365 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    track_freeze.c
+
+    * see track_freeze.h
+    * the render is handed to audio threads through track->freeze.render. To unfreeze, the main thread
+      swaps it out and waits for dsp_reading to clear before freeing it; an audio thread sets
+      dsp_reading before loading the pointer, so it either sees NULL or is waited for.
+ *****************************************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "audio_clip.h"
+#include "automation.h"
+#include "clipref.h"
+#include "consts.h"
+#include "dsp_utils.h"
+#include "effect.h"
+#include "endpoint.h"
+#include "loading.h"
+#include "midi_clip.h"
+#include "mixdown.h"
+#include "project.h"
+#include "resampler.h"
+#include "session.h"
+#include "status.h"
+#include "synth.h"
+#include "thread_safety.h"
+#include "timeline.h"
+#include "track_freeze.h"
+#include "transport.h"
+#include "value.h"
+#include "worker_pool.h"
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t len)
+{
+    const uint8_t *bytes = data;
+    for (size_t i=0; i<len; i++) {
+	h ^= bytes[i];
+	h *= FNV_PRIME;
+    }
+    return h;
+}
+
+#define HASH_FIELD(h, field) hash_bytes((h), &(field), sizeof(field))
+
+/* Values of all saved endpoints at or below node */
+static uint64_t hash_api_node(uint64_t h, APINode *node)
+{
+    for (int i=0; i<node->num_endpoints; i++) {
+	Endpoint *ep = node->endpoints[i];
+	if (!ep->val || ep->val_type == JDAW_PTR || ep->do_not_serialize) continue;
+	h = hash_bytes(h, ep->val, jdaw_val_type_size(ep->val_type));
+    }
+    for (int i=0; i<node->num_children; i++) {
+	h = hash_api_node(h, node->children[i]);
+    }
+    return h;
+}
+
+static uint64_t hash_effect_chain(uint64_t h, EffectChain *ec)
+{
+    h = HASH_FIELD(h, ec->num_effects);
+    for (int i=0; i<ec->num_effects; i++) {
+	Effect *e = ec->effects[i];
+	h = HASH_FIELD(h, e);
+	h = HASH_FIELD(h, e->active);
+	h = HASH_FIELD(h, e->channel_mode);
+    }
+    return hash_api_node(h, &ec->api_node);
+}
+
+static uint64_t hash_midi_clip(uint64_t h, MIDIClip *mclip)
+{
+    h = HASH_FIELD(h, mclip->num_notes);
+    for (uint32_t i=0; i<mclip->num_notes; i++) {
+	Note *n = mclip->notes + i;
+	h = HASH_FIELD(h, n->channel);
+	h = HASH_FIELD(h, n->key);
+	h = HASH_FIELD(h, n->velocity);
+	h = HASH_FIELD(h, n->start_rel);
+	h = HASH_FIELD(h, n->end_rel);
+    }
+    h = HASH_FIELD(h, mclip->pitch_bend.num_changes);
+    for (int i=0; i<mclip->pitch_bend.num_changes; i++) {
+	h = HASH_FIELD(h, mclip->pitch_bend.changes[i].pos_rel);
+	h = HASH_FIELD(h, mclip->pitch_bend.changes[i].value);
+    }
+    for (int c=0; c<MIDI_NUM_CONTROLLERS; c++) {
+	Controller *ctrl = mclip->controllers + c;
+	if (!ctrl->in_use) continue;
+	h = HASH_FIELD(h, c);
+	h = HASH_FIELD(h, ctrl->num_changes);
+	for (int i=0; i<ctrl->num_changes; i++) {
+	    h = HASH_FIELD(h, ctrl->changes[i].pos_rel);
+	    h = HASH_FIELD(h, ctrl->changes[i].value);
+	}
+    }
+    return h;
+}
+
+/* Everything that goes into a track's render */
+static uint64_t track_freeze_signature(Track *track)
+{
+    uint64_t h = FNV_OFFSET_BASIS;
+    h = HASH_FIELD(h, track->tl->proj->sample_rate);
+    h = HASH_FIELD(h, track->num_route_ins);
+    h = HASH_FIELD(h, track->midi_out);
+    h = HASH_FIELD(h, track->midi_out_type);
+
+    h = HASH_FIELD(h, track->num_clips);
+    for (uint16_t i=0; i<track->num_clips; i++) {
+	ClipRef *cr = track->clips[i];
+	h = HASH_FIELD(h, cr);
+	if (!cr) continue;
+	h = HASH_FIELD(h, cr->source_clip);
+	h = HASH_FIELD(h, cr->deleted);
+	h = HASH_FIELD(h, cr->tl_pos);
+	h = HASH_FIELD(h, cr->start_in_clip);
+	h = HASH_FIELD(h, cr->end_in_clip);
+	h = HASH_FIELD(h, cr->gain);
+	if (cr->type == CLIP_AUDIO) {
+	    Clip *clip = cr->source_clip;
+	    h = HASH_FIELD(h, clip->len_sframes);
+	    h = HASH_FIELD(h, clip->L);
+	    h = HASH_FIELD(h, clip->R);
+	} else if (cr->type == CLIP_MIDI) {
+	    h = hash_midi_clip(h, cr->source_clip);
+	}
+    }
+
+    h = hash_effect_chain(h, &track->effect_chain);
+    if (track->midi_out_type == MIDI_OUT_SYNTH && track->midi_out) {
+	Synth *synth = track->midi_out;
+	h = hash_effect_chain(h, &synth->effect_chain);
+	h = hash_api_node(h, &synth->api_node);
+    }
+
+    /* Vol and pan are applied live */
+    for (int i=0; i<track->num_automations; i++) {
+	Automation *a = track->automations[i];
+	if (a->endpoint == &track->vol_ep || a->endpoint == &track->pan_ep) continue;
+	h = HASH_FIELD(h, a);
+	h = HASH_FIELD(h, a->read);
+	h = HASH_FIELD(h, a->write);
+	h = HASH_FIELD(h, a->num_keyframes);
+	size_t val_size = jdaw_val_type_size(a->val_type);
+	for (int k=0; k<a->num_keyframes; k++) {
+	    h = HASH_FIELD(h, a->keyframes[k].pos);
+	    h = hash_bytes(h, &a->keyframes[k].value, val_size);
+	}
+    }
+    return h;
+}
+
+bool track_is_frozen(Track *track)
+{
+    return atomic_load(&track->freeze.render) != NULL;
+}
+
+static void freeze_render_destroy(FreezeRender *r)
+{
+    free(r->L);
+    free(r->R);
+    free(r);
+}
+
+/* Clear synth voices and effect tails, so that the render (or live playback after it) starts clean */
+static void track_freeze_reset_dsp(Track *track)
+{
+    effect_chain_silence(&track->effect_chain);
+    if (track->midi_out_type == MIDI_OUT_SYNTH && track->midi_out) {
+	synth_silence(track->midi_out);
+    }
+}
+
+static bool track_freeze_dsp_idle(Track *track)
+{
+    if (!effect_chain_is_idle(&track->effect_chain)) return false;
+    if (track->midi_out_type == MIDI_OUT_SYNTH && track->midi_out) {
+	return synth_is_idle(track->midi_out);
+    }
+    return true;
+}
+
+/* Main thread, with playback stopped. Returns NULL if there is nothing to render, or on abort. */
+static FreezeRender *track_freeze_render(Track *track)
+{
+    if (track->num_route_ins > 0) {
+	status_set_errstr("Can't freeze \"%s\": track has audio routed in", track->name);
+	return NULL;
+    }
+    if (track->is_bus) {
+	status_set_errstr("Can't freeze \"%s\": track is a bus", track->name);
+	return NULL;
+    }
+    int32_t start_pos = 0;
+    int32_t end_pos = 0;
+    bool has_clips = false;
+    for (uint16_t i=0; i<track->num_clips; i++) {
+	ClipRef *cr = track->clips[i];
+	if (!cr || cr->deleted) continue;
+	int32_t cr_end = cr->tl_pos + clipref_len(cr);
+	if (!has_clips || cr->tl_pos < start_pos) start_pos = cr->tl_pos;
+	if (!has_clips || cr_end > end_pos) end_pos = cr_end;
+	has_clips = true;
+    }
+    if (!has_clips) {
+	status_set_errstr("Can't freeze \"%s\": track has no clips", track->name);
+	return NULL;
+    }
+
+    Project *proj = track->tl->proj;
+    int chunk_len = proj->fourier_len_sframes;
+    int32_t max_len = end_pos - start_pos + TRACK_FREEZE_MAX_TAIL_S * proj->sample_rate;
+    max_len = (max_len / chunk_len + 1) * chunk_len;
+    FreezeRender *r = calloc(1, sizeof(FreezeRender));
+    r->L = malloc(max_len * sizeof(float));
+    r->R = malloc(max_len * sizeof(float));
+    if (!r->L || !r->R) {
+	fprintf(stderr, "Fatal error: unable to allocate track freeze buffers\n");
+	exit(1);
+    }
+    r->start_pos = start_pos;
+
+    track_freeze_reset_dsp(track);
+    session_set_loading_screen("Freezing track...", track->name, true);
+    int32_t pos = start_pos;
+    int32_t done = 0;
+    int chunk_i = 0;
+    while (done + chunk_len <= max_len) {
+	if (chunk_i % 64 == 0) {
+	    float progress = pos < end_pos ? (float)(pos - start_pos) / (end_pos - start_pos) : 1.0f;
+	    if (session_loading_screen_update(NULL, progress) != 0) {
+		session_loading_screen_deinit();
+		track_freeze_reset_dsp(track);
+		freeze_render_destroy(r);
+		status_set_errstr("Track freeze aborted");
+		return NULL;
+	    }
+	}
+	float amp = mixdown_track_prefader_chunk(track, track->buf_L, track->buf_R, pos, chunk_len, 1.0f);
+	memcpy(r->L + done, track->buf_L, chunk_len * sizeof(float));
+	memcpy(r->R + done, track->buf_R, chunk_len * sizeof(float));
+	done += chunk_len;
+	pos += chunk_len;
+	chunk_i++;
+	if (pos >= end_pos && amp <= AMP_EPSILON && track_freeze_dsp_idle(track)) {
+	    break;
+	}
+    }
+    session_loading_screen_deinit();
+    track_freeze_reset_dsp(track);
+
+    r->len_sframes = done;
+    float *L = realloc(r->L, done * sizeof(float));
+    float *R = realloc(r->R, done * sizeof(float));
+    if (L) r->L = L;
+    if (R) r->R = R;
+    return r;
+}
+
+static void track_freeze_publish(Track *track, FreezeRender *r)
+{
+    track->freeze.signature = track_freeze_signature(track);
+    FreezeRender *old = atomic_exchange(&track->freeze.render, r);
+    if (old) {
+	while (atomic_load(&track->freeze.dsp_reading)) {
+	    CPU_RELAX();
+	}
+	freeze_render_destroy(old);
+    }
+    track->tl->needs_redraw = true;
+}
+
+int track_freeze(Track *track)
+{
+    MAIN_THREAD_ONLY(track_freeze);
+    track->freeze.render_requested = false;
+    transport_stop_playback();
+    timeline_full_pause(track->tl);
+    timeline_force_stop_midi_monitoring();
+    FreezeRender *r = track_freeze_render(track);
+    if (!r) return -1;
+    track_freeze_publish(track, r);
+    status_set_alertstr("Froze \"%s\" (%.1fs rendered)", track->name, (double)r->len_sframes / track->tl->proj->sample_rate);
+    return 0;
+}
+
+void track_unfreeze(Track *track)
+{
+    MAIN_THREAD_ONLY(track_unfreeze);
+    track->freeze.render_requested = false;
+    FreezeRender *r = atomic_exchange(&track->freeze.render, NULL);
+    if (!r) return;
+    while (atomic_load(&track->freeze.dsp_reading)) {
+	CPU_RELAX();
+    }
+    freeze_render_destroy(r);
+    track->tl->needs_redraw = true;
+}
+
+void track_freeze_check_all(Timeline *tl)
+{
+    for (int i=0; i<tl->num_tracks; i++) {
+	Track *track = tl->tracks[i];
+	if (track->freeze.render_requested) {
+	    track_freeze(track);
+	} else if (track_is_frozen(track) && track_freeze_signature(track) != track->freeze.signature) {
+	    track_unfreeze(track);
+	    status_set_alertstr("Unfroze \"%s\" (track changed)", track->name);
+	}
+    }
+}
+
+bool track_freeze_read(Track *track, float *L, float *R, int32_t start_pos_sframes, int len, float step, float *amp_dst)
+{
+    TrackFreeze *fz = &track->freeze;
+    atomic_store(&fz->dsp_reading, true);
+    FreezeRender *r = atomic_load(&fz->render);
+    if (!r) {
+	atomic_store(&fz->dsp_reading, false);
+	return false;
+    }
+    float amp = 0.0f;
+    int32_t offset = start_pos_sframes - r->start_pos; /* Render index of dst[0] */
+    for (int c=0; c<2; c++) {
+	float *dst = c == 0 ? L : R;
+	const float *src = c == 0 ? r->L : r->R;
+	if (!dst) continue;
+	memset(dst, '\0', len * sizeof(float));
+	if (step == 1.0f) {
+	    int first = offset < 0 ? -offset : 0;
+	    int last = r->len_sframes - offset < len ? r->len_sframes - offset : len;
+	    if (first < last) {
+		memcpy(dst + first, src + offset + first, (last - first) * sizeof(float));
+	    }
+	} else {
+	    const ResamplerBank *bank = resampler_playback_bank(session_get()->playback.resample_quality, step);
+	    resampler_mix(bank, src, r->len_sframes, offset, step, dst, len, 1.0f);
+	}
+	amp += float_buf_abs_sum(dst, len);
+    }
+    atomic_store(&fz->dsp_reading, false);
+    *amp_dst = amp;
+    return true;
+}
+
+void track_freeze_deinit(Track *track)
+{
+    FreezeRender *r = atomic_exchange(&track->freeze.render, NULL);
+    if (r) freeze_render_destroy(r);
+}
@@ -0,0 +1,67 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    track_freeze.h
+
+    * render a track's output once, offline, and play back the render instead of running its DSP
+    * the render covers clip audio, MIDI through the track's synth, the effect chain, and automations
+      on effect and synth parameters. It stops before track volume and pan, which remain live.
+    * tracks with audio routed in can't be frozen, since their input is rendered live elsewhere
+    * a freeze is dropped automatically when anything that went into the render changes: checked
+      once per main loop frame by comparing a hash of the track's clips, notes, effects, endpoint
+      values, and keyframes with the hash taken at render time
+    * the render is kept in memory. Project files store only whether the track is frozen; the
+      render is redone after the project loads.
+*****************************************************************************************************************/
+
+#ifndef JDAW_TRACK_FREEZE_H
+#define JDAW_TRACK_FREEZE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Maximum render length after the end of the last clip, for synth releases and effect tails */
+#define TRACK_FREEZE_MAX_TAIL_S 30
+
+typedef struct track Track;
+typedef struct timeline Timeline;
+
+typedef struct freeze_render {
+    int32_t start_pos; /* Timeline position of the first sframe */
+    int32_t len_sframes;
+    float *L;
+    float *R;
+} FreezeRender;
+
+typedef struct track_freeze {
+    _Atomic(FreezeRender *) render; /* NULL if not frozen */
+    atomic_bool dsp_reading; /* Set while an audio thread may hold a pointer to render */
+    uint64_t signature; /* Main thread only */
+    bool render_requested; /* Main thread only; render on the next frame (e.g. after project load) */
+} TrackFreeze;
+
+bool track_is_frozen(Track *track);
+
+/* Main thread only. Stops playback; returns 0 on success */
+int track_freeze(Track *track);
+void track_unfreeze(Track *track);
+
+/* Main thread, once per frame. Drops stale freezes and does requested renders. */
+void track_freeze_check_all(Timeline *tl);
+
+/* Audio thread. If the track is frozen, fill L and R from the render and set *amp_dst to the chunk's
+   summed absolute amplitude, and return true. Return false if the track is not frozen. */
+bool track_freeze_read(Track *track, float *L, float *R, int32_t start_pos_sframes, int len, float step, float *amp_dst);
+
+void track_freeze_deinit(Track *track);
+
+#endif
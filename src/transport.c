@@ -23,6 +23,7 @@
 #include "clipref.h"
 #include "color.h"
 #include "consts.h"
+#include "dsp_meter.h"
 #include "dsp_utils.h"
 #include "error.h"
 #include "log.h"
@@ -34,6 +35,7 @@
 #include "piano_roll.h"
 #include "project.h"
 #include "pure_data.h"
+#include "record_spill.h"
 #include "session.h"
 #include "session_endpoint_ops.h"
 #include "timeline.h"
@@ -43,6 +45,7 @@
 #define JDAW_TRANSPORT_PRINT_ALL
 
 #define TRANSPORT_PERFORMANCE_LOG_TICKS_PER 10
+#define TRANSPORT_PREFETCH_SECONDS 10
 static bool transport_performance_logging = false;
 static int transport_performance_log_elapsed_ticks = 0;
 static double dur_proc = 0.0;
@@ -106,7 +109,7 @@ void transport_record_callback(void* user_data, uint8_t *stream, int len)
     AudioDevice *dev = user_data;    
     uint32_t stream_len_samples = len / sizeof(int16_t);
 
-    /* Simple latency compensation */
+    /* Simple latency compensation; superseded by the shift in transport_stop_recording */
     /* if (!session->playback.new_cliprefs_repositioned) { */
     /* 	/\* TODO: real latency compensation (probably with PortAudio *\/ */
     /* 	int32_t playback_latency_sframes = session->proj.chunk_size_sframes * 5; */
@@ -149,7 +152,7 @@ static void get_source_mode_chunk(float *restrict dst_L, float *restrict dst_R,
      } else {
 	 return; /* TODO: source mode for MIDI */
      }
-     if (!clip) return; /* band-aid for a rare bug */
+     if (!clip || !clip->L) return; /* band-aid for a rare bug; L is NULL while recording */
 
 
      for (uint32_t i=0; i<len_sframes; i++) {
@@ -282,6 +285,7 @@ void transport_playback_callback(void* user_data, uint8_t* stream, int len)
 		wait_count++;
 		if (wait_count > 100) {
 		    transport_log("Playback callback early exit (can't wait on readable chunks)\n");
+		    if (dsp_meter_measuring()) dsp_meter_xrun();
 		    return;
 		}
 	    }
@@ -323,16 +327,11 @@ void transport_playback_callback(void* user_data, uint8_t* stream, int len)
 
     float_buf_mult_const(chunk_L, session->playback.output_vol, len_sframes);
     float_buf_mult_const(chunk_R, session->playback.output_vol, len_sframes);
-    int16_t *stream_fmt = (int16_t *)stream;
-    for (uint32_t i=0; i<stream_len_samples; i+=2)
-    {
-	float val_L = chunk_L[i/2];
-	float val_R = chunk_R[i/2];
-	envelope_follower_sample(&session->proj.output_L_ef, val_L);
-	envelope_follower_sample(&session->proj.output_R_ef, val_R);
-	stream_fmt[i] = (int16_t)(clip_float_sample(val_L) * INT16_MAX);
-	stream_fmt[i+1] = (int16_t)(clip_float_sample(val_R) * INT16_MAX);
+    for (uint32_t i=0; i<len_sframes; i++) {
+	envelope_follower_sample(&session->proj.output_L_ef, chunk_L[i]);
+	envelope_follower_sample(&session->proj.output_R_ef, chunk_R[i]);
     }
+    float_buf_to_int16_interleaved(chunk_L, chunk_R, (int16_t *)stream, len_sframes);
 
     if (session->source_mode.source_mode && session->source_mode.src_clip_type == CLIP_AUDIO) {
 	Clip *clip = session->source_mode.src_clip;
@@ -428,16 +427,12 @@ static void *transport_dsp_thread_fn(void *arg)
     }
     
     cancel_dsp_thread = false;
+    mixdown_preroll_delay_comp(tl, tl->read_pos_sframes, len, session->playback.play_speed);
+    dsp_meter_begin_measuring();
     while (!cancel_dsp_thread) {
 	/* transport_log("Loop iter\n"); */
-	/* Performance timer */
-	struct timespec tspec_start;
-	struct timespec tspec_end;
-	/* double dur_proc = 0.0; */
-	/* double dur_wait = 0.0; */
-	if (transport_performance_logging) {
-	    clock_gettime(CLOCK_REALTIME, &tspec_start);
-	}
+	/* Performance timer; time spent waiting for the playback callback is not processing time */
+	int64_t chunk_start_nsec = dsp_meter_now_nsec();
 
 	/* pthread_testcancel(); */
 	float play_speed = session->playback.play_speed;
@@ -450,31 +445,12 @@ static void *transport_dsp_thread_fn(void *arg)
 	/* get_mixdown_chunk(tl, buf_R, 1, len, tl->read_pos_sframes, play_speed); */
 	
 
-	/* DSP */
-	float dL[len * 2];
-	float dR[len * 2];
-	for (int i=0; i<len; i++) {
-	    float hamming_v = HAMMING_SCALAR * hamming(i, len);
-	    dL[i] = hamming_v * buf_L[i];
-	    dR[i] = hamming_v * buf_R[i];
-	}
-	memset(dL + len, 0, sizeof(float) * len);
-	memset(dR + len, 0, sizeof(float) * len);
-	double complex lfreq[len * 2];
-	double complex rfreq[len * 2];
-
-	FFTf(dL, lfreq, len * 2);
-	FFTf(dR, rfreq, len * 2);
-
-	get_magnitude(lfreq, tl->proj->output_L_freq, len);
-	get_magnitude(rfreq, tl->proj->output_R_freq, len);
+	/* Output spectrum is computed on the analysis thread, if on screen */
+	spectrum_analyzer_feed(tl->proj->output_analyzer, buf_L, buf_R, len);
 
 	/* End processing */
-	if (transport_performance_logging) {
-	    clock_gettime(CLOCK_REALTIME, &tspec_end);
-	    dur_proc += timespec_elapsed_ms(&tspec_start, &tspec_end);
-	    clock_gettime(CLOCK_REALTIME, &tspec_start);
-	}
+	int64_t wait_start_nsec = dsp_meter_now_nsec();
+	int64_t proc_nsec = wait_start_nsec - chunk_start_nsec;
 
 	/* Copy buffer */
 	
@@ -482,11 +458,8 @@ static void *transport_dsp_thread_fn(void *arg)
 	    sem_wait(tl->writable_chunks);
 	}
 
-	if (transport_performance_logging) {
-	    clock_gettime(CLOCK_REALTIME, &tspec_end);
-	    dur_wait += timespec_elapsed_ms(&tspec_start, &tspec_end);
-	    clock_gettime(CLOCK_REALTIME, &tspec_start);
-	}
+	int64_t resume_nsec = dsp_meter_now_nsec();
+	int64_t wait_nsec = resume_nsec - wait_start_nsec;
 
 	memcpy(tl->buf_L + tl->buf_write_pos, buf_L, sizeof(float) * len);
 	memcpy(tl->buf_R + tl->buf_write_pos, buf_R, sizeof(float) * len);
@@ -555,10 +528,12 @@ static void *transport_dsp_thread_fn(void *arg)
 	session_flush_val_changes(session, JDAW_THREAD_DSP);
 	session_flush_callbacks(session, JDAW_THREAD_DSP);
 
-	if (transport_performance_logging) {
-	    clock_gettime(CLOCK_REALTIME, &tspec_end);
-	    dur_proc += timespec_elapsed_ms(&tspec_start, &tspec_end);
+	proc_nsec += dsp_meter_now_nsec() - resume_nsec;
+	dsp_meter_chunk_done(proc_nsec, len, session_get_sample_rate());
 
+	if (transport_performance_logging) {
+	    dur_proc += proc_nsec * 1e-6;
+	    dur_wait += wait_nsec * 1e-6;
 	    if (transport_performance_log_elapsed_ticks < TRANSPORT_PERFORMANCE_LOG_TICKS_PER) {
 		transport_performance_log_elapsed_ticks++;
 	    } else {
@@ -574,6 +549,7 @@ static void *transport_dsp_thread_fn(void *arg)
 	    }
 	}
     }
+    dsp_meter_end_measuring();
     log_tmp(LOG_INFO, "DSP thread exit\n");
     sem_post(tl->unpause_sem);
 
@@ -581,6 +557,36 @@ static void *transport_dsp_thread_fn(void *arg)
 }
 
 
+/* Clips loaded from a project file are read from disk on first touch; start reading the audio
+   ahead of the playhead (in the direction of play) so the DSP thread doesn't have to wait on it */
+static int32_t prefetch_pos_sframes = 0;
+void transport_prefetch_ahead(Timeline *tl, bool force)
+{
+    Session *session = session_get();
+    float speed = session->playback.play_speed;
+    int32_t window = TRANSPORT_PREFETCH_SECONDS * session_get_sample_rate() * (fabs(speed) > 1.0f ? fabs(speed) : 1.0f);
+    /* Reissue once the playhead has used up half the window, or has jumped */
+    if (!force && abs(tl->play_pos_sframes - prefetch_pos_sframes) < window / 2) return;
+    prefetch_pos_sframes = tl->play_pos_sframes;
+    int32_t win_start = speed < 0.0f ? tl->play_pos_sframes - window : tl->play_pos_sframes;
+    for (int i=0; i<tl->num_tracks; i++) {
+	Track *track = tl->tracks[i];
+	for (uint16_t c=0; c<track->num_clips; c++) {
+	    ClipRef *cr = track->clips[c];
+	    if (cr->type != CLIP_AUDIO) continue;
+	    int32_t start_in_clip = cr->start_in_clip + win_start - cr->tl_pos;
+	    int32_t len = window;
+	    if (start_in_clip < cr->start_in_clip) {
+		len -= cr->start_in_clip - start_in_clip;
+		start_in_clip = cr->start_in_clip;
+	    }
+	    if (start_in_clip + len > cr->end_in_clip) len = cr->end_in_clip - start_in_clip;
+	    if (len <= 0) continue;
+	    clip_prefetch(cr->source_clip, start_in_clip, len);
+	}
+    }
+}
+
 /* extern double *del_line_l, *del_line_r; */
 /* extern int16_t del_line_len; */
 void transport_start_playback()
@@ -598,7 +604,8 @@ void transport_start_playback()
 	    automation_clear_cache(track->automations[a]);
 	}
     }
-    
+    transport_prefetch_ahead(tl, true);
+
     pthread_attr_t attr;
     int sched_policy = SCHED_RR;
     int ret;
@@ -771,7 +778,7 @@ void transport_start_recording()
 	Track *track = tl->tracks[i];
 	/* Clip *clip = NULL; */
 	/* bool home = false; */
-	if (track->active) {
+	if (track->active && !track->is_bus) {
 	    no_tracks_active = false;
 	    if (track->input_type == AUDIO_CONN) {
 		Clip *clip = NULL;
@@ -789,6 +796,8 @@ void transport_start_recording()
 
 		    clip = clip_create(conn, track); /* Sets clip num channels */
 		    clip->recording = true;
+		    clip_segments_init(clip);
+		    if (session->playback.record_to_disk) record_spill_open(clip);
 		    conn->current_clip = clip;
 		    conn->current_clip_repositioned = false;
 		} else {
@@ -818,6 +827,10 @@ void transport_start_recording()
 	if (!track) {
 	    return;
 	}
+	if (track->is_bus) {
+	    status_set_errstr("Can't record to a bus track");
+	    return;
+	}
 	/* Clip *clip = NULL; */
 	/* bool home = false; */
 	if (track->input_type == AUDIO_CONN) {
@@ -834,6 +847,8 @@ void transport_start_recording()
 		num_conns_to_activate++;
 		clip = clip_create(conn, track);
 		clip->recording = true;
+		clip_segments_init(clip);
+		if (session->playback.record_to_disk) record_spill_open(clip);
 		/* home = true; */
 		conn->current_clip = clip;
 		conn->current_clip_repositioned = false;
@@ -874,6 +889,9 @@ end_get_conns:
 	audioconn_start_recording(conn);
     }
     session->playback.recording = true;
+    if (session->playback.record_to_disk) {
+	record_spill_start();
+    }
 
     if (activate_mqwert) {
 	mqwert_activate();
@@ -933,48 +951,45 @@ void create_clip_buffers(Clip *clip, uint32_t len_sframes)
 /*     memcpy(clip->R + clip->write_bufpos_sframes, clip->recorded_from->c.pd.rec_buffer_R, clip->recorded_from->c.pd.write_bufpos_sframes * sizeof(float)); */
 /*     clip->write_bufpos_sframes = clip->len_sframes; */
 /* } */
+/* Called on the device record thread. Clip segments are preallocated on the main thread
+   (transport_recording_update_cliprects), so this only copies. */
 static void copy_device_buf_to_clips(AudioDevice *dev)
 {
     Clip *clips[dev->spec.channels];
-    float *buffers[dev->spec.channels];
-    memset(clips, 0, sizeof(clips));
-    memset(buffers, 0, sizeof(buffers));
-    /* int32_t read_pos = ACTIVE_TL->read_pos_sframes; */
+    bool clip_redundant[dev->spec.channels];
+    uint32_t len_sframes[dev->spec.channels];
+    int32_t dev_len_sframes = dev->write_bufpos_samples / dev->spec.channels;
     for (int c=0; c<dev->spec.channels; c++) {
 	clips[c] = dev->channel_dsts[c].conn->current_clip;
-	bool clip_redundant = false;
+	clip_redundant[c] = false;
 	for (int j=0; j<c; j++) {
 	    if (clips[j] == clips[c]) {
-		clip_redundant = true;
+		clip_redundant[c] = true;
+		len_sframes[c] = len_sframes[j];
 		break;
 	    }
 	}
-	if (!clip_redundant && clips[c]) {
-	    clips[c]->len_sframes = clips[c]->write_bufpos_sframes + dev->write_bufpos_samples / dev->spec.channels;
-	    create_clip_buffers(clips[c], clips[c]->len_sframes);
+	if (!clip_redundant[c] && clips[c]) {
+	    len_sframes[c] = clip_segments_writable(clips[c], dev_len_sframes);
 	}
-
     }
     for (int c=0; c<dev->spec.channels; c++) {
 	if (!clips[c]) continue;
-	if (dev->channel_dsts[c].channel == 0) {
-	    clips[c] = dev->channel_dsts[c].conn->current_clip;
-	    buffers[c] = clips[c]->L + clips[c]->write_bufpos_sframes;
-	} else {
-	    clips[c] = dev->channel_dsts[c].conn->current_clip;
-	    buffers[c] = dev->channel_dsts[c].conn->current_clip->R + clips[c]->write_bufpos_sframes;
-	}
-
-    }
-    for (int i=0; i<dev->write_bufpos_samples; i++) {
-	if (buffers[i % dev->spec.channels]) {
-	    buffers[i % dev->spec.channels][i / dev->spec.channels] = (double)dev->rec_buffer[i] / INT16_MAX;
+	int clip_channel = dev->channel_dsts[c].channel == 0 ? 0 : 1;
+	uint32_t pos = clips[c]->write_bufpos_sframes;
+	uint32_t written = 0;
+	while (written < len_sframes[c]) {
+	    uint32_t run;
+	    float *dst = clip_segments_ptr(clips[c], clip_channel, pos + written, &run);
+	    if (run > len_sframes[c] - written) run = len_sframes[c] - written;
+	    const int16_t *src = dev->rec_buffer + written * dev->spec.channels + c;
+	    int16_buf_to_float(src, dev->spec.channels, dst, run);
+	    written += run;
 	}
     }
     for (int c=0; c<dev->spec.channels; c++) {
-	if (clips[c]) {
-	    clips[c]->write_bufpos_sframes = clips[c]->len_sframes;
-	    clip_init_or_update_waveform(clips[c]);
+	if (clips[c] && !clip_redundant[c]) {
+	    clip_segments_advance(clips[c], len_sframes[c]);
 	}
     }
 }
@@ -988,24 +1003,14 @@ void copy_conn_buf_to_clip(Clip *clip, enum audio_conn_type type)
 	break;
     case PURE_DATA: {
 	PdConn *pdconn = clip->recorded_from->obj;
-	clip->len_sframes = clip->write_bufpos_sframes + pdconn->write_bufpos_sframes;
-	create_clip_buffers(clip, clip->len_sframes);
-	memcpy(clip->L + clip->write_bufpos_sframes, pdconn->rec_buffer_L, pdconn->write_bufpos_sframes * sizeof(float));
-	memcpy(clip->R + clip->write_bufpos_sframes, pdconn->rec_buffer_R, pdconn->write_bufpos_sframes * sizeof(float));
-	clip->write_bufpos_sframes = clip->len_sframes;
-	clip_init_or_update_waveform(clip);
+	clip_segments_append(clip, pdconn->rec_buffer_L, pdconn->rec_buffer_R, pdconn->write_bufpos_sframes);
     }
 	break;
     case JACKDAW: {
 	/* OUROBOROS */
 	JDAWConn *jconn = clip->recorded_from->obj;
-	clip->len_sframes = clip->write_bufpos_sframes + jconn->write_bufpos_sframes;
-	create_clip_buffers(clip, clip->len_sframes);
-	memcpy(clip->L + clip->write_bufpos_sframes, jconn->rec_buffer_L, jconn->write_bufpos_sframes * sizeof(float));
-	memcpy(clip->R + clip->write_bufpos_sframes, jconn->rec_buffer_R, jconn->write_bufpos_sframes * sizeof(float));
-	clip->write_bufpos_sframes = clip->len_sframes;
+	clip_segments_append(clip, jconn->rec_buffer_L, jconn->rec_buffer_R, jconn->write_bufpos_sframes);
 	jconn->write_bufpos_sframes = 0;
-	clip_init_or_update_waveform(clip);
     }
 	break;
     default:
@@ -1087,6 +1092,8 @@ void transport_stop_recording()
     for (int i=0; i<num_devices_to_dump; i++) {
 	copy_device_buf_to_clips(devices_to_dump[i]);
     }
+    /* Remaining frames are written to spill files when clips are consolidated, below */
+    record_spill_stop();
     session->playback.recording = false;
 
     while (num_conns_to_close > 0) {
@@ -1109,8 +1116,16 @@ void transport_stop_recording()
 	    }
 	    clip_destroy(clip);
 	} else {
+	    /* Recorded audio arrives one output buffer (what the performer heard) plus one input buffer
+	       late; move it back by that much. Effect latency is already compensated in playback. */
+	    int32_t rec_latency_sframes = 0;
+	    if (clip->recorded_from && clip->recorded_from->type == DEVICE) {
+		AudioDevice *dev = clip->recorded_from->obj;
+		rec_latency_sframes = session->proj.chunk_size_sframes + dev->spec.samples;
+	    }
 	    for (uint16_t j=0; j<clip->num_refs; j++) {
 		ClipRef *ref = clip->refs[j];
+		ref->tl_pos -= rec_latency_sframes;
 		if (num_created >= tl->num_tracks * 2 - 1) {
 		    created_clips = realloc(created_clips, num_created * 2 * sizeof(ClipRef *));
 		}
@@ -1143,6 +1158,8 @@ void transport_stop_recording()
 	    break;
 	    
 	}
+	clip_segments_consolidate(clip);
+	clip_init_or_update_waveform(clip);
 	/* fprintf(stderr, "SETTING %s rec to false\n", clip->name); */
 	clip->recording = false;
 	for (int i=0; i<clip->num_refs; i++) {
@@ -1245,7 +1262,7 @@ void transport_goto_mark(Timeline *tl, bool in)
     }
 }
 
-/* Called in main thread to update clipref GUIs */
+/* Called in main thread to update clipref GUIs and keep record segments allocated */
 void transport_recording_update_cliprects()
 {
     Session *session = session_get();
@@ -1271,6 +1288,13 @@ void transport_recording_update_cliprects()
 	    break;
 	}
 
+	/* Keep segments allocated ahead of the record threads, and waveform data up to date */
+	clip_segments_prealloc(clip);
+	if ((int32_t)clip->len_sframes > clip->waveform.init_len) {
+	    clip_init_or_update_waveform(clip);
+	}
+	record_spill_release_segments(clip);
+
 	for (uint16_t j=0; j<clip->num_refs; j++) {
 	    ClipRef *cr = clip->refs[j];
 	    cr->end_in_clip = clipref_len;
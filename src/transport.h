@@ -21,6 +21,9 @@ typedef struct queued_buf {
 void transport_record_callback(void* user_data, uint8_t *stream, int len);
 void transport_playback_callback(void* user_data, uint8_t* stream, int len);
 void transport_start_playback();
+/* Main thread; page in the audio ahead of the playhead. Without force, only reissued once the
+   playhead has moved through half of the last window. */
+void transport_prefetch_ahead(Timeline *tl, bool force);
 void transport_stop_playback();
 void transport_start_recording();
 void transport_stop_recording();
@@ -26,6 +26,8 @@
 #include "panel.h"
 #include "piano_roll.h"
 #include "project.h"
+#include "record_spill.h"
+#include "resampler.h"
 #include "session.h"
 #include "settings.h"
 #include "status.h"
@@ -34,6 +36,7 @@
 #include "text.h"
 #include "textbox.h"
 #include "effect_pages.h"
+#include "fir_filter.h"
 #include "timeview.h"
 #include "transport.h"
 #include "timeline.h"
@@ -575,6 +578,11 @@ void user_global_debug_write_main_layout(void *nullarg)
     fclose(f);
     fprintf(stderr, "Wrote main window layout to %s\n", filename);
 }
+
+void user_global_debug_resampler_benchmark(void *nullarg)
+{
+    resampler_benchmark();
+}
 #endif
 
 void api_node_print_all_routes(APINode *node);
@@ -1288,6 +1296,26 @@ void user_tl_add_track(void *nullarg)
 	
 }
 
+void user_tl_add_bus(void *nullarg)
+{
+    Session *session = session_get();
+    Timeline *tl = ACTIVE_TL;
+    Track *track = timeline_add_bus(tl, tl->layout_selector + 1);
+    if (!track) return;
+    timeline_select_track(track);
+    tl->needs_redraw = true;
+
+    Value nullval = {.int_v = 0};
+    user_event_push(
+	add_track_undo,
+	add_track_redo,
+	NULL, add_track_dispose_forward,
+	(void *)track,
+	NULL,
+	nullval, nullval, nullval, nullval,
+	0,0,false,false);
+}
+
 static void track_select_n(int n)
 {
     Session *session = session_get();
@@ -1447,7 +1475,7 @@ void user_tl_track_selector_up(void *nullarg)
 	    for (uint8_t i=0; i<tl->num_grabbed_clips; i++) {
 		int offset = tl->grabbed_clip_info_cache[i].track_offset;
 		int new_index = tl->track_selector + offset;
-		if (new_index >=0 && new_index < tl->num_tracks) {
+		if (new_index >=0 && new_index < tl->num_tracks && !tl->tracks[new_index]->is_bus) {
 		    some_clip_moved = true;
 		    ClipRef *cr = tl->grabbed_clips[i];
 		    clipref_move_to_track(cr, tl->tracks[new_index]);
@@ -1551,7 +1579,7 @@ void user_tl_track_selector_down(void *nullarg)
 	    for (uint8_t i=0; i<tl->num_grabbed_clips; i++) {
 		int offset = tl->grabbed_clip_info_cache[i].track_offset;
 		int new_index = tl->track_selector + offset;
-		if (new_index >=0 && new_index < tl->num_tracks) {
+		if (new_index >=0 && new_index < tl->num_tracks && !tl->tracks[new_index]->is_bus) {
 		    ClipRef *cr = tl->grabbed_clips[i];
 		    clipref_move_to_track(cr, tl->tracks[new_index]);
 		}
@@ -1938,6 +1966,74 @@ void user_tl_track_add_effect(void *nullarg)
     }
 }
 
+static int dir_to_tline_filter_wav(void *dp_v, void *dn_v)
+{
+    DirPath *dp = *(DirPath **)dp_v;
+    if (dp->hidden) return 0;
+    if (dp->type != DT_DIR) {
+	char *dotpos = strrchr(dp->path, '.');
+	if (!dotpos) {
+	    return 0;
+	}
+	char *ext = dotpos + 1;
+	return strcmp(ext, "wav") == 0 || strcmp(ext, "WAV") == 0;
+    }
+    return 1;
+}
+
+static FIRFilter *load_ir_target = NULL;
+
+static void load_ir_file_select_action(DirNav *dn, DirPath *dp)
+{
+    Session *session = session_get();
+    window_pop_modal(main_win);
+    if (!load_ir_target) return;
+    if (filter_load_IR_file(load_ir_target, dp->path) == 0) {
+	status_set_alertstr("Loaded impulse response into \"%s\"", load_ir_target->effect->name);
+    } else {
+	status_set_errstr("Error loading impulse response");
+    }
+    load_ir_target = NULL;
+    ACTIVE_TL->needs_redraw = true;
+}
+
+/* Load a WAV impulse response into the FIR filter on the open effect page, or else
+   the first FIR filter on the selected track */
+void user_tl_track_load_impulse_response(void *nullarg)
+{
+    Session *session = session_get();
+    Timeline *tl = ACTIVE_TL;
+    FIRFilter *target = NULL;
+    TabView *tv;
+    if ((tv = main_win->active_tabview) && strncmp(tv->title, "Effects", 7) == 0) {
+	Effect *e = tv->tabs[tv->current_tab]->linked_obj;
+	if (e && e->type == EFFECT_FIR_FILTER) target = e->obj;
+    }
+    Track *track = timeline_selected_track(tl);
+    if (!target && track) {
+	for (int i=0; i<track->effect_chain.num_effects; i++) {
+	    Effect *e = track->effect_chain.effects[i];
+	    if (e->type == EFFECT_FIR_FILTER) {
+		target = e->obj;
+		break;
+	    }
+	}
+    }
+    if (!target) {
+	status_set_errstr(track ? "Add an FIR filter effect to load an impulse response" : NO_TRACK_ERRSTR);
+	return;
+    }
+    load_ir_target = target;
+    Layout *mod_lt = layout_add_child(main_win->layout);
+    layout_set_default_dims(mod_lt);
+    Modal *m = modal_create(mod_lt);
+    modal_add_header(m, "Load impulse response:", &colors.light_grey, 3);
+    ModalEl *dirnav_el = modal_add_dirnav(m, DIRPATH_OPEN_FILE, dir_to_tline_filter_wav);
+    DirNav *dn = (DirNav *)dirnav_el->obj;
+    dn->file_select_action = load_ir_file_select_action;
+    window_push_modal(main_win, m);
+    modal_reset(m);
+}
 
 void user_tl_track_open_settings(void *nullarg)
 {
@@ -1987,6 +2083,20 @@ void user_tl_track_open_synth(void *nullarg)
     }
 }
 
+void user_tl_track_freeze(void *nullarg)
+{
+    Session *session = session_get();
+    Timeline *tl = ACTIVE_TL;
+    Track *track = timeline_selected_track(tl);
+    if (!track) return;
+    if (track_is_frozen(track)) {
+	track_unfreeze(track);
+	status_set_alertstr("Unfroze \"%s\"", track->name);
+    } else {
+	track_freeze(track);
+    }
+}
+
 
 
 void user_tl_track_add_automation(void *nullarg)
@@ -2289,6 +2399,18 @@ void user_tl_split_stereo_clipref(void *nullarg)
     }
 }
 
+void user_tl_cycle_clip_storage_fmt(void *nullarg)
+{
+    ClipRef *cr = clipref_at_cursor();
+    if (!cr || cr->type != CLIP_AUDIO) {
+	status_set_errstr("No audio clip at cursor.");
+	return;
+    }
+    Clip *clip = cr->source_clip;
+    clip->storage_fmt = (clip->storage_fmt + 1) % CLIP_STORAGE_NUM_FMTS;
+    status_set_alertstr("Clip \"%s\" will be saved as %s", clip->name, clip_storage_fmt_str(clip->storage_fmt));
+}
+
 void user_tl_edit_clip_at_cursor(void *nullarg)
 {
 
@@ -2644,6 +2766,17 @@ void user_tl_delete_timeline(void *nullarg)
 /*     modal_move_onto(save_as); */
 /* } */
 
+static int export_fmt = WAV_EXPORT_INT16;
+static bool export_noise_shaping = false;
+static Endpoint export_fmt_ep = {0};
+static Endpoint export_noise_shaping_ep = {0};
+
+static const char *export_fmt_radio_options[] = {
+    "16-bit (dithered)",
+    "24-bit",
+    "32-bit float"
+};
+
 static int submit_save_wav_form(void *mod_v, void *target)
 {
     Session *session = session_get();
@@ -2672,7 +2805,7 @@ static int submit_save_wav_form(void *mod_v, void *target)
     strcat(buf, "/");
     strcat(buf, name);
     fprintf(stdout, "SAVE WAV: %s\n", buf);
-    wav_write_mixdown(buf);
+    wav_write_mixdown(buf, export_fmt, export_noise_shaping);
     /* jdaw_write_project(buf); */
     char *last_slash_pos = strrchr(buf, '/');
     if (last_slash_pos) {
@@ -2728,6 +2861,36 @@ void user_tl_write_mixdown_to_wav(void *nullarg)
     /* modal_add_op(save_wav, "\t\t(type <ret> to accept name)", &colors.light_grey); */
     modal_add_header(save_wav, "Location:", &colors.light_grey, 5);
     modal_add_dirnav(save_wav, DIRPATH_EXPORT, dir_to_tline_filter_save);
+
+    if (export_fmt_ep.local_id == NULL) {
+	endpoint_init(
+	    &export_fmt_ep,
+	    &export_fmt,
+	    JDAW_INT,
+	    "",
+	    "",
+	    JDAW_THREAD_MAIN,
+	    NULL, NULL, NULL,
+	    NULL, NULL, NULL, NULL);
+	export_fmt_ep.block_undo = true;
+    }
+    if (export_noise_shaping_ep.local_id == NULL) {
+	endpoint_init(
+	    &export_noise_shaping_ep,
+	    &export_noise_shaping,
+	    JDAW_BOOL,
+	    "",
+	    "",
+	    JDAW_THREAD_MAIN,
+	    NULL, NULL, NULL,
+	    NULL, NULL, NULL, NULL);
+	export_noise_shaping_ep.block_undo = true;
+    }
+    modal_add_header(save_wav, "Format:", &colors.light_grey, 5);
+    modal_add_radio(save_wav, &colors.light_grey, &export_fmt_ep, export_fmt_radio_options, WAV_EXPORT_NUM_FMTS);
+    modal_add_header(save_wav, "Noise shaping (16-bit):", &colors.light_grey, 5);
+    modal_add_toggle(save_wav, &export_noise_shaping_ep);
+
     modal_add_button(save_wav, "Save .wav file", submit_save_wav_form);
     /* save_as->submit_form = submit_save_as_form; */
     save_wav->submit_form = submit_save_wav_form;
@@ -2830,6 +2993,14 @@ void user_tl_audio_route_in_quick_add(void *nullarg)
 }
 
 
+void user_tl_track_set_bus_out(void *nullarg)
+{
+    Session *session = session_get();
+    Track *track = timeline_selected_track(ACTIVE_TL);
+    if (track)
+	route_bus_out_select(track);
+}
+
 void user_tl_activate_mqwert(void *nullarg)
 {
     mqwert_activate();
@@ -2845,6 +3016,59 @@ void user_tl_lock_view_to_playhead(void *nullarg)
     session->playback.lock_view_to_playhead = !session->playback.lock_view_to_playhead;
 }
 
+void user_tl_toggle_record_to_disk(void *nullarg)
+{
+    Session *session = session_get();
+    session->playback.record_to_disk = !session->playback.record_to_disk;
+    if (session->playback.record_to_disk) {
+	status_set_alertstr("Record to disk ON (takes will be written to %s)", record_spill_dir());
+    } else {
+	status_set_alertstr("Record to disk OFF");
+    }
+}
+
+void user_tl_cycle_resample_quality(void *nullarg)
+{
+    Session *session = session_get();
+    session->playback.resample_quality = (session->playback.resample_quality + 1) % NUM_RESAMPLE_QUALITIES;
+    status_set_alertstr("Varispeed resampling quality: %s", resample_quality_str(session->playback.resample_quality));
+}
+
+void user_tl_cycle_spectrum_resolution(void *nullarg)
+{
+    Session *session = session_get();
+    SpectrumAnalyzer *an = session->proj.output_analyzer;
+    int window_len = atomic_load(&an->window_len) * 2;
+    if (window_len > SPECTRUM_MAX_WINDOW_LEN) window_len = SPECTRUM_MIN_WINDOW_LEN;
+    spectrum_analyzer_set_window_len(an, window_len);
+    status_set_alertstr("Output spectrum resolution: %.1f Hz (%d-sample window)", (double)session_get_sample_rate() / (2 * window_len), window_len);
+}
+
+void user_tl_cycle_spectrum_rate(void *nullarg)
+{
+    static const int rates[] = {15, 30, 60};
+    Session *session = session_get();
+    SpectrumAnalyzer *an = session->proj.output_analyzer;
+    int current = atomic_load(&an->rate_hz);
+    int i = 0;
+    while (i < 3 && rates[i] <= current) i++;
+    int rate = rates[i % 3];
+    spectrum_analyzer_set_rate(an, rate);
+    status_set_alertstr("Output spectrum refresh rate: %d Hz", rate);
+}
+
+void user_tl_toggle_dsp_meters(void *nullarg)
+{
+    Session *session = session_get();
+    session->dsp_stats.show_track_meters = !session->dsp_stats.show_track_meters;
+    ACTIVE_TL->needs_redraw = true;
+    if (session->dsp_stats.show_track_meters) {
+	status_set_alertstr("Track DSP meters ON");
+    } else {
+	status_set_alertstr("Track DSP meters OFF");
+    }
+}
+
 /* END TL */
 
 /* source mode */
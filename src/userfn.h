@@ -15,6 +15,7 @@ void user_global_start_or_stop_screenrecording(void *nullarg);
 void user_global_chaotic_user_test(void *nullarg);
 void user_global_debug_toggle_transport_performance_logging(void *nullarg);
 void user_global_debug_write_main_layout(void *nullarg);
+void user_global_debug_resampler_benchmark(void *nullarg);
 void user_global_api_print_all_routes(void *nullarg);
 void user_global_dump_logs(void *nullarg);
 void user_global_enable_synth_parallelism(void *nullarg);
@@ -58,6 +59,11 @@ void user_tl_one_sample_right(void *nullarg);
 void user_tl_move_right(void *nullarg);
 void user_tl_move_left(void *nullarg);
 void user_tl_lock_view_to_playhead(void *nullarg);
+void user_tl_toggle_record_to_disk(void *nullarg);
+void user_tl_cycle_resample_quality(void *nullarg);
+void user_tl_cycle_spectrum_resolution(void *nullarg);
+void user_tl_cycle_spectrum_rate(void *nullarg);
+void user_tl_toggle_dsp_meters(void *nullarg);
 void user_tl_zoom_in(void *nullarg);
 void user_tl_zoom_out(void *nullarg);
 void user_tl_set_mark_out(void *nullarg);
@@ -87,6 +93,7 @@ void user_tl_cut_clipref(void *nullarg);
 void user_tl_cut_clipref_and_grab_edges(void *nullarg);
 void user_tl_set_default_out(void *nullarg);
 void user_tl_add_track(void *nullarg);
+void user_tl_add_bus(void *nullarg);
 
 void user_tl_track_select_1(void *nullarg);
 void user_tl_track_select_2(void *nullarg);
@@ -115,6 +122,7 @@ void user_tl_track_delete(void *nullarg);
 void user_tl_click_track_add(void *nullarg);
 void user_tl_click_track_cut(void *nullarg);
 void user_tl_split_stereo_clipref(void *nullarg);
+void user_tl_cycle_clip_storage_fmt(void *nullarg);
 void user_tl_click_track_set_tempo(void *nullarg);
 
 
@@ -125,7 +133,9 @@ void user_tl_track_automation_toggle_read(void *nullarg);
 
 void user_tl_track_open_settings(void *nullarg);
 void user_tl_track_add_effect(void *nullarg);
+void user_tl_track_load_impulse_response(void *nullarg);
 void user_tl_track_open_synth(void *nullarg);
+void user_tl_track_freeze(void *nullarg);
 void user_tl_mute(void *nullarg);
 void user_tl_solo(void *nullarg);
 void user_tl_track_vol_up(void *nullarg);
@@ -156,6 +166,7 @@ void user_tl_audio_routes_out_open_page(void *nullarg);
 void user_tl_audio_routes_in_open_page(void *nullarg);
 void user_tl_audio_route_out_quick_add(void *nullarg);
 void user_tl_audio_route_in_quick_add(void *nullarg);
+void user_tl_track_set_bus_out(void *nullarg);
 
 void user_tl_quantize_notes(void *nullarg);
 void user_tl_adj_quantize_amt(void *nullarg);
@@ -158,6 +158,11 @@ float vibrato_buf_apply(void *vib_v, float *restrict L, float *restrict R, int l
     return input_amp;
 
 }
+int32_t vibrato_latency_sframes(Vibrato *vib)
+{
+    return mod_delay_latency_sframes(&vib->mdL);
+}
+
 void vibrato_clear(Vibrato *vib)
 {
     mod_delay_clear(&vib->mdL);
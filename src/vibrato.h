@@ -23,6 +23,7 @@ typedef struct vibrato {
 void vibrato_init(Vibrato *vib);
 float vibrato_buf_apply(void *vib_v, float *restrict L, float *restrict R, int len, float input_amp);
 void vibrato_clear(Vibrato *vib);
+int32_t vibrato_latency_sframes(Vibrato *vib);
 void vibrato_deinit(Vibrato *vib);
 
 #endif
@@ -12,6 +12,10 @@
     wav.c
 
     * create and save wav files
+    * mixdown export streams to disk; see "streaming export" below
+    * exports are 16-bit PCM (TPDF dithered, optionally noise shaped), 24-bit PCM, or 32-bit float.
+      24-bit and float files use WAVE_FORMAT_EXTENSIBLE. Exports whose data won't fit in the 32-bit
+      RIFF sizes are written as RF64 (EBU Tech 3306), with the 64-bit sizes in a "ds64" chunk.
  *****************************************************************************************************************/
 
 /****************************** WAV File Specification ******************************
@@ -32,6 +36,10 @@ Positions	Sample Value	    Description
 41-44	File size (data)	Size of the data section.
 *************************************************************************************/
 
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -41,73 +49,395 @@ Positions	Sample Value	    Description
 #include "dir.h"
 #include "dsp_utils.h"
 #include "project.h"
+#include "resampler.h"
 #include "mixdown.h"
 #include "timeline.h"
 #include "transport.h"
 #include "session.h"
 #include "status.h"
+#include "type_serialize.h"
+#include "wav.h"
 
 
 #define WAV_READ_CK_LEN_BYTES 1000000
+#define WAV_CONVERT_CK_LEN_SFRAMES 2500000
+
+extern bool SYS_BYTEORDER_LE;
+
+#define WAV_FORMAT_PCM 0x0001
+#define WAV_FORMAT_IEEE_FLOAT 0x0003
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+#define WAV_DS64_LEN 28
+
+/* Tail of the KSDATAFORMAT_SUBTYPE GUIDs; the first two bytes are the format code */
+static const uint8_t wav_subformat_guid_tail[14] = {
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+};
+
+typedef struct wav_fmt {
+    uint16_t format; /* WAV_FORMAT_PCM or WAV_FORMAT_IEEE_FLOAT */
+    uint16_t bits_per_sample;
+    uint16_t channels;
+    uint32_t sample_rate;
+    bool extensible;
+    bool rf64;
+} WavFmt;
+
+static uint32_t wav_header_len(const WavFmt *fmt)
+{
+    uint32_t len = 12; /* "RIFF", size, "WAVE" */
+    if (fmt->rf64) len += 8 + WAV_DS64_LEN;
+    len += 8 + (fmt->extensible ? 40 : 16);
+    if (fmt->format != WAV_FORMAT_PCM) len += 8 + 4; /* "fact" */
+    len += 8; /* "data", size */
+    return len;
+}
 
-//TODO: Endianness!
-static void write_wav_header(FILE *f, uint32_t num_samples, uint16_t bits_per_sample, uint8_t channels)
+/* The header length depends only on fmt, so it can be written with zero sizes and rewritten in
+   place when the data length is known. data_len_bytes excludes the pad byte. */
+static void write_wav_header(FILE *f, const WavFmt *fmt, uint64_t data_len_bytes)
 {
-    // int bps = 16;
+    uint16_t block_align = fmt->channels * fmt->bits_per_sample / 8;
+    uint32_t bytes_per_sec = fmt->sample_rate * block_align;
+    uint64_t num_sframes = data_len_bytes / block_align;
+    uint64_t riff_len = wav_header_len(fmt) - 8 + data_len_bytes + (data_len_bytes & 1);
+
+    uint32_t riff_len_32 = riff_len;
+    uint32_t data_len_32 = data_len_bytes;
+    uint32_t num_sframes_32 = num_sframes;
+    if (fmt->rf64) {
+	riff_len_32 = data_len_32 = num_sframes_32 = UINT32_MAX;
+    }
 
-    /* RIFF chunk descriptor */
-    Session *session = session_get();
-    Project *proj = &session->proj;
-    const static char spec[] = {'R','I','F','F'};
-    uint32_t file_size = 44 + num_samples * (bits_per_sample / 8);
-    const static char ftype[] = {'W','A','V','E'};
-
-    /* fmt sub-chunk */
-    const static char fmt_chunk_mk[] = {'f', 'm', 't', ' '};
-    uint32_t fmt_data_len = 16;
-    const static uint16_t fmt_type = 1;
-    uint16_t num_channels = channels;
-    uint32_t sample_rate = proj->sample_rate;
-    uint32_t bytes_per_sec = (sample_rate * bits_per_sample * num_channels) / 8;
-    uint16_t block_align = num_channels * fmt_data_len / 8;
-    /* bits per sample goes here */
-
-    /* data sub-chunk */
-    char chunk_id[] = {'d','a','t','a'};
-    uint32_t chunk_size = num_samples * (bits_per_sample / 8);
-
-    fwrite(spec, 1, 4, f);
-    fwrite(&file_size, 4, 1, f);
-    fwrite(ftype, 1, 4, f);
-    fwrite(fmt_chunk_mk, 1, 4, f);
-    fwrite(&fmt_data_len, 4, 1, f);
-    fwrite(&fmt_type, 2, 1, f);
-    fwrite(&num_channels, 2, 1, f);
-    fwrite(&sample_rate, 4, 1, f);
-    fwrite(&bytes_per_sec, 4, 1, f);
-    fwrite(&block_align, 2, 1, f);
-    fwrite(&bits_per_sample, 2, 1, f);
-    fwrite(chunk_id, 1, 4, f);
-    fwrite(&chunk_size, 4, 1, f);
-    
+    fwrite(fmt->rf64 ? "RF64" : "RIFF", 1, 4, f);
+    uint32_ser_le(f, &riff_len_32);
+    fwrite("WAVE", 1, 4, f);
+    if (fmt->rf64) {
+	uint32_t ds64_len = WAV_DS64_LEN;
+	uint32_t table_len = 0;
+	fwrite("ds64", 1, 4, f);
+	uint32_ser_le(f, &ds64_len);
+	uint64_ser_le(f, &riff_len);
+	uint64_ser_le(f, &data_len_bytes);
+	uint64_ser_le(f, &num_sframes);
+	uint32_ser_le(f, &table_len);
+    }
+
+    uint32_t fmt_len = fmt->extensible ? 40 : 16;
+    uint16_t fmt_type = fmt->extensible ? WAV_FORMAT_EXTENSIBLE : fmt->format;
+    uint16_t num_channels = fmt->channels;
+    uint32_t sample_rate = fmt->sample_rate;
+    uint16_t bits_per_sample = fmt->bits_per_sample;
+    fwrite("fmt ", 1, 4, f);
+    uint32_ser_le(f, &fmt_len);
+    uint16_ser_le(f, &fmt_type);
+    uint16_ser_le(f, &num_channels);
+    uint32_ser_le(f, &sample_rate);
+    uint32_ser_le(f, &bytes_per_sec);
+    uint16_ser_le(f, &block_align);
+    uint16_ser_le(f, &bits_per_sample);
+    if (fmt->extensible) {
+	uint16_t ext_len = 22;
+	uint16_t valid_bits = fmt->bits_per_sample;
+	uint32_t channel_mask = fmt->channels == 1 ? 0x4 : 0x3; /* Front center; front left and right */
+	uint16_t subformat = fmt->format;
+	uint16_ser_le(f, &ext_len);
+	uint16_ser_le(f, &valid_bits);
+	uint32_ser_le(f, &channel_mask);
+	uint16_ser_le(f, &subformat);
+	fwrite(wav_subformat_guid_tail, 1, sizeof(wav_subformat_guid_tail), f);
+    }
+    if (fmt->format != WAV_FORMAT_PCM) {
+	uint32_t fact_len = 4;
+	fwrite("fact", 1, 4, f);
+	uint32_ser_le(f, &fact_len);
+	uint32_ser_le(f, &num_sframes_32);
+    }
+    fwrite("data", 1, 4, f);
+    uint32_ser_le(f, &data_len_32);
 }
 
-static void write_wav(const char *fname, int16_t *samples, uint32_t num_samples, uint16_t bits_per_sample, uint8_t channels)
+
+/*------ streaming export ------------------------------------------------------
+
+   The main thread renders mixdown chunks (tracks in parallel on the mixdown worker
+   pool) into a ring of EXPORT_QUEUE_LEN slots; a writer thread converts filled slots
+   and appends them to the file, so rendering never waits on the disk unless the
+   ring is full. Memory use is independent of the export length.
+------------------------------------------------------------------------------*/
+
+#define EXPORT_QUEUE_LEN 8
+
+typedef struct export_queue {
+    FILE *f;
+    uint8_t channels;
+    enum wav_export_fmt fmt;
+    bool noise_shaping;
+    uint32_t chunk_len_sframes;
+    float *bufs[EXPORT_QUEUE_LEN][2];
+    uint32_t lens[EXPORT_QUEUE_LEN];
+    int write_i; /* Next slot to render into */
+    int read_i; /* Next slot to write to disk */
+    int num_filled;
+    bool closing;
+    atomic_int err; /* errno value from the writer thread */
+    uint64_t data_len_bytes;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+
+    /* Writer thread only */
+    uint32_t dither_pos;
+    float shaping_err[2][2]; /* Last two quantization errors per channel, in LSBs */
+} ExportQueue;
+
+static uint32_t export_bytes_per_sample(enum wav_export_fmt fmt)
 {
-    Session *session = session_get();
-    Project *proj = &session->proj;
-    
-    fprintf(stderr, "Write wav, num_samples: %d, chanels: %d, bitspsamle: %d\n", num_samples, channels, bits_per_sample);
-    FILE* f = fopen(fname, "wb");
-    if (!f) {
-        fprintf(stderr, "Error: failed to open file at %s\n", fname);
+    switch (fmt) {
+    case WAV_EXPORT_INT16:
+	return 2;
+    case WAV_EXPORT_INT24:
+	return 3;
+    case WAV_EXPORT_FLOAT32:
+	return 4;
+    }
+    return 2;
+}
+
+static WavFmt export_wav_fmt(enum wav_export_fmt fmt, uint8_t channels, uint32_t sample_rate)
+{
+    WavFmt wf = {0};
+    wf.format = fmt == WAV_EXPORT_FLOAT32 ? WAV_FORMAT_IEEE_FLOAT : WAV_FORMAT_PCM;
+    wf.bits_per_sample = export_bytes_per_sample(fmt) * 8;
+    wf.channels = channels;
+    wf.sample_rate = sample_rate;
+    wf.extensible = fmt != WAV_EXPORT_INT16;
+    return wf;
+}
+
+/* TPDF noise in (-1, 1) LSB, from a hash of the sample's position in the export (lowbias32), so
+   that there is no state carried between samples and the loops that use it can be vectorized. The
+   sum of two 16-bit uniform values has a triangular distribution. */
+static inline float tpdf_noise(uint32_t pos)
+{
+    uint32_t h = pos;
+    h ^= h >> 16;
+    h *= 0x7feb352d;
+    h ^= h >> 15;
+    h *= 0x846ca68b;
+    h ^= h >> 16;
+    return ((float)(h & 0xFFFF) + (float)(h >> 16) - 65535.0f) * (1.0f / 65536.0f);
+}
+
+/* Add dither to a channel in place. The queue slot belongs to the writer until it is released. */
+static void export_dither(ExportQueue *q, float *buf, int channel, uint32_t len)
+{
+    const float lsb = 1.0f / INT16_MAX;
+    uint32_t pos = q->dither_pos + channel;
+    for (uint32_t i=0; i<len; i++) {
+	buf[i] += tpdf_noise(pos + i * q->channels) * lsb;
+    }
+}
+
+/* Dither and quantize with the error fed back through (1 - z^-1)^2, which moves the noise from
+   the low and mid frequencies toward Nyquist. The feedback makes each sample depend on the
+   last, so this runs serially. */
+static void export_dither_shaped(ExportQueue *q, const float *buf, int16_t *dst, int channel, uint32_t len)
+{
+    float e1 = q->shaping_err[channel][0];
+    float e2 = q->shaping_err[channel][1];
+    uint32_t pos = q->dither_pos + channel;
+    for (uint32_t i=0; i<len; i++) {
+	float shaped = clip_float_sample(buf[i]) * INT16_MAX - 2.0f * e1 + e2;
+	float quantized = rintf(shaped + tpdf_noise(pos + i * q->channels));
+	e2 = e1;
+	e1 = quantized - shaped;
+	if (quantized > INT16_MAX) quantized = INT16_MAX;
+	if (quantized < INT16_MIN) quantized = INT16_MIN;
+	dst[i * q->channels] = (int16_t)quantized;
+    }
+    q->shaping_err[channel][0] = e1;
+    q->shaping_err[channel][1] = e2;
+}
+
+static void export_to_int32(ExportQueue *q, float *L, float *R, int32_t *dst, float scale, uint32_t len)
+{
+    if (q->channels == 2) {
+	float_buf_to_int32_interleaved(L, R, dst, scale, len);
     } else {
-	fprintf(stderr, "Writing %lu samples (or %f minutes) to wav\n", (long unsigned) num_samples, (double)num_samples / 2.0f / 2.0f / proj->sample_rate / 60.0f);
-        write_wav_header(f, num_samples, bits_per_sample, channels);
-        fwrite(samples, bits_per_sample / 8, num_samples, f);
+	for (uint32_t i=0; i<len; i++) {
+	    dst[i] = lrintf(clip_float_sample(L[i]) * scale);
+	}
+    }
+}
+
+/* Convert a slot to interleaved little-endian samples. "ints" is scratch space for len * channels
+   samples. */
+static void export_convert(ExportQueue *q, float *L, float *R, void *dst, int32_t *ints, uint32_t len)
+{
+    uint32_t num_samples = len * q->channels;
+    switch (q->fmt) {
+    case WAV_EXPORT_INT16: {
+	int16_t *dst16 = dst;
+	if (q->noise_shaping) {
+	    export_dither_shaped(q, L, dst16, 0, len);
+	    if (q->channels == 2) export_dither_shaped(q, R, dst16 + 1, 1, len);
+	} else {
+	    export_dither(q, L, 0, len);
+	    if (q->channels == 2) export_dither(q, R, 1, len);
+	    export_to_int32(q, L, R, ints, INT16_MAX, len);
+	    for (uint32_t i=0; i<num_samples; i++) {
+		dst16[i] = ints[i];
+	    }
+	}
+	q->dither_pos += num_samples;
+	if (!SYS_BYTEORDER_LE) {
+	    for (uint32_t i=0; i<num_samples; i++) {
+		uint16_t u = dst16[i];
+		dst16[i] = (int16_t)(u >> 8 | u << 8);
+	    }
+	}
+	break;
+    }
+    case WAV_EXPORT_INT24: {
+	uint8_t *dst8 = dst;
+	export_to_int32(q, L, R, ints, 8388607.0f, len);
+	for (uint32_t i=0; i<num_samples; i++) {
+	    uint32_t u = ints[i];
+	    dst8[3 * i] = u;
+	    dst8[3 * i + 1] = u >> 8;
+	    dst8[3 * i + 2] = u >> 16;
+	}
+	break;
+    }
+    case WAV_EXPORT_FLOAT32: {
+	float *dstf = dst;
+	if (q->channels == 2) {
+	    float_buf_interleave(L, R, dstf, len);
+	} else {
+	    memcpy(dstf, L, len * sizeof(float));
+	}
+	if (!SYS_BYTEORDER_LE) {
+	    uint32_t *dst32 = dst;
+	    for (uint32_t i=0; i<num_samples; i++) {
+		dst32[i] = __builtin_bswap32(dst32[i]);
+	    }
+	}
+	break;
+    }
     }
-    fclose(f);
-    fprintf(stderr, "\t-> Done writing wav.\n");
+}
+
+static void *export_writer_threadfn(void *arg)
+{
+    ExportQueue *q = arg;
+    uint32_t frame_bytes = export_bytes_per_sample(q->fmt) * q->channels;
+    void *interleaved = malloc(frame_bytes * q->chunk_len_sframes);
+    int32_t *ints = malloc(sizeof(int32_t) * q->chunk_len_sframes * q->channels);
+    if (!interleaved || !ints) {
+	fprintf(stderr, "Fatal error: unable to allocate export buffer\n");
+	exit(1);
+    }
+    while (1) {
+	pthread_mutex_lock(&q->lock);
+	while (q->num_filled == 0 && !q->closing) {
+	    pthread_cond_wait(&q->cond, &q->lock);
+	}
+	if (q->num_filled == 0) {
+	    pthread_mutex_unlock(&q->lock);
+	    break;
+	}
+	int slot = q->read_i;
+	pthread_mutex_unlock(&q->lock);
+
+	uint32_t len = q->lens[slot];
+	if (q->err == 0) {
+	    export_convert(q, q->bufs[slot][0], q->bufs[slot][1], interleaved, ints, len);
+	    if (fwrite(interleaved, frame_bytes, len, q->f) != len) {
+		q->err = errno ? errno : EIO;
+	    }
+	    q->data_len_bytes += (uint64_t)len * frame_bytes;
+	}
+
+	pthread_mutex_lock(&q->lock);
+	q->read_i = (q->read_i + 1) % EXPORT_QUEUE_LEN;
+	q->num_filled--;
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->lock);
+    }
+    free(interleaved);
+    free(ints);
+    return NULL;
+}
+
+/* Main thread; wait for a free slot and return its buffers */
+static float **export_queue_acquire(ExportQueue *q)
+{
+    pthread_mutex_lock(&q->lock);
+    while (q->num_filled == EXPORT_QUEUE_LEN) {
+	pthread_cond_wait(&q->cond, &q->lock);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return q->bufs[q->write_i];
+}
+
+/* Main thread; hand the slot returned by the last acquire to the writer */
+static void export_queue_submit(ExportQueue *q, uint32_t len_sframes)
+{
+    pthread_mutex_lock(&q->lock);
+    q->lens[q->write_i] = len_sframes;
+    q->write_i = (q->write_i + 1) % EXPORT_QUEUE_LEN;
+    q->num_filled++;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* Main thread; let the writer drain the queue, and join it */
+static void export_queue_close(ExportQueue *q)
+{
+    pthread_mutex_lock(&q->lock);
+    q->closing = true;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+    pthread_join(q->thread, NULL);
+    for (int i=0; i<EXPORT_QUEUE_LEN; i++) {
+	free(q->bufs[i][0]);
+	free(q->bufs[i][1]);
+    }
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->cond);
+}
+
+static int export_queue_open(ExportQueue *q, FILE *f, uint8_t channels, enum wav_export_fmt fmt, bool noise_shaping, uint32_t chunk_len_sframes)
+{
+    memset(q, '\0', sizeof(ExportQueue));
+    q->f = f;
+    q->channels = channels;
+    q->fmt = fmt;
+    q->noise_shaping = noise_shaping;
+    q->chunk_len_sframes = chunk_len_sframes;
+    for (int i=0; i<EXPORT_QUEUE_LEN; i++) {
+	q->bufs[i][0] = malloc(sizeof(float) * chunk_len_sframes);
+	q->bufs[i][1] = malloc(sizeof(float) * chunk_len_sframes);
+	if (!q->bufs[i][0] || !q->bufs[i][1]) {
+	    fprintf(stderr, "Fatal error: unable to allocate export buffers\n");
+	    exit(1);
+	}
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    int err;
+    if ((err = pthread_create(&q->thread, NULL, export_writer_threadfn, q)) != 0) {
+	fprintf(stderr, "Error: unable to start export writer thread: %s\n", strerror(err));
+	for (int i=0; i<EXPORT_QUEUE_LEN; i++) {
+	    free(q->bufs[i][0]);
+	    free(q->bufs[i][1]);
+	}
+	pthread_mutex_destroy(&q->lock);
+	pthread_cond_destroy(&q->cond);
+	return err;
+    }
+    return 0;
 }
 
 const char *get_fmt_str(SDL_AudioFormat f)
@@ -150,7 +480,9 @@ const char *get_fmt_str(SDL_AudioFormat f)
 
 /* extern double update, events, draw_start_and_end, draw_box, draw_prog, render_copy, render_present; */
 
-void wav_write_mixdown(const char *filepath)
+/* Render from the in-mark to the out-mark, streaming to disk as chunks are rendered. The live playback
+   device is stopped like any other transport stop, and is not used to clock or route the render. */
+void wav_write_mixdown(const char *filepath, enum wav_export_fmt fmt, bool noise_shaping)
 {
     Session *session = session_get();
     Project *proj = &session->proj;
@@ -162,63 +494,81 @@ void wav_write_mixdown(const char *filepath)
     /* reset_overlap_buffers(); */
     /* fprintf(stdout, "Chunk size sframes: %d, chan: %d, sr: %d\n", proj->chunk_size_sframes, proj->channels, proj->sample_rate); */
     uint16_t chunk_len_sframes = proj->fourier_len_sframes;
-    uint16_t chunk_len_samples = chunk_len_sframes * proj->channels;
+    if (tl->out_mark_sframes <= tl->in_mark_sframes) {
+	status_set_errstr("Cannot export: out mark must be after in mark");
+	return;
+    }
     uint32_t len_sframes = tl->out_mark_sframes - tl->in_mark_sframes;
-    uint32_t len_samples = proj->channels * len_sframes;
-    /* fprintf(stderr, "len_sframes: %d, chunk len sframes: %d, chunks d: %f\n", len_sframes, chunk_len_sframes, (double)len_sframes / chunk_len_sframes); */
-    uint32_t chunks = len_sframes / chunk_len_sframes;
-    uint32_t remainder_sframes = len_sframes - chunks * chunk_len_sframes;
-    int16_t *samples = malloc(sizeof(int16_t) * len_samples);
-
+    uint32_t chunks = (len_sframes + chunk_len_sframes - 1) / chunk_len_sframes;
 
-    float *samples_L = malloc(sizeof(float) * chunk_len_sframes);
-    float *samples_R = malloc(sizeof(float) * chunk_len_sframes);
+    FILE *f = fopen(filepath, "wb");
+    if (!f) {
+	fprintf(stderr, "Error: failed to open file at %s: %s\n", filepath, strerror(errno));
+	status_set_errstr("Error exporting WAV: %s", strerror(errno));
+	return;
+    }
+    WavFmt wav_fmt = export_wav_fmt(fmt, proj->channels, proj->sample_rate);
+    uint64_t expected_data_len = (uint64_t)len_sframes * proj->channels * export_bytes_per_sample(fmt);
+    wav_fmt.rf64 = wav_header_len(&wav_fmt) - 8 + expected_data_len + 1 > UINT32_MAX;
+
+    /* Sizes are filled in when the export finishes */
+    write_wav_header(f, &wav_fmt, 0);
+
+    ExportQueue q;
+    if (export_queue_open(&q, f, proj->channels, fmt, noise_shaping, chunk_len_sframes) != 0) {
+	fclose(f);
+	remove(filepath);
+	status_set_errstr("Error exporting WAV: unable to start writer thread");
+	return;
+    }
 
     session_set_loading_screen("Exporting WAV file...", "Creating mixdown and applying effects...", true);
     uint32_t loading_screen_modulus = chunks / 100;
     if (loading_screen_modulus <= 0) loading_screen_modulus = 1;
+    bool aborted = false;
+    mixdown_preroll_delay_comp(tl, tl->in_mark_sframes, chunk_len_sframes, 1.0f);
     for (uint32_t c=0; c<chunks; c++) {
 	if (c % loading_screen_modulus == 0) {
-	    if (session_loading_screen_update(NULL, 0.9 * (float)c/chunks) != 0) {
-		free(samples);
-		free(samples_L);
-		free(samples_R);
-		status_set_errstr("WAV export aborted");
-		fprintf(stderr, "WAV export aborted\n");
-		return;
+	    if (session_loading_screen_update(NULL, (float)c / chunks) != 0) {
+		aborted = true;
+		break;
 	    }
 	}
-	get_mixdown_chunk(tl, samples_L, samples_R, chunk_len_sframes, tl->in_mark_sframes + (c * chunk_len_sframes), 1);
-	/* get_mixdown_chunk(tl, samples_L, 0, chunk_len_sframes, tl->in_mark_sframes + (c * chunk_len_sframes), 1); */
-        /* get_mixdown_chunk(tl, samples_R, 1, chunk_len_sframes, tl->in_mark_sframes + (c * chunk_len_sframes), 1); */
-        for (uint32_t i=0; i<chunk_len_samples; i+=2) {
-            samples[c * chunk_len_samples + i] = clip_float_sample(samples_L[i/2]) * INT16_MAX;
-            samples[c * chunk_len_samples + i + 1] = clip_float_sample(samples_R[i/2]) * INT16_MAX;
-        }
-    }
-
-    if (remainder_sframes > 0) {
-	uint32_t done_len_sframes = chunk_len_sframes * chunks;
-	uint32_t done_len_samples = chunk_len_samples * chunks;
-	get_mixdown_chunk(tl, samples_L, samples_R, remainder_sframes, tl->in_mark_sframes + done_len_sframes, 1);
-	/* get_mixdown_chunk(tl, samples_L, 0, remainder_sframes, tl->in_mark_sframes + done_len_sframes, 1); */
-	/* get_mixdown_chunk(tl, samples_R, 1, remainder_sframes, tl->in_mark_sframes + done_len_sframes, 1); */
-	for (uint32_t i=0; i<remainder_sframes * proj->channels; i+=2) {
-	    samples[done_len_samples + i] = clip_float_sample(samples_L[i/2]) * INT16_MAX;
-	    samples[done_len_samples + i + 1] = clip_float_sample(samples_R[i/2]) * INT16_MAX;
-	}
+	if (q.err != 0) break;
+	uint32_t done_len_sframes = c * chunk_len_sframes;
+	uint32_t n = len_sframes - done_len_sframes < chunk_len_sframes ? len_sframes - done_len_sframes : chunk_len_sframes;
+	float **bufs = export_queue_acquire(&q);
+	get_mixdown_chunk(tl, bufs[0], bufs[1], n, tl->in_mark_sframes + done_len_sframes, 1);
+	export_queue_submit(&q, n);
     }
-    
-    free(samples_L);
-    free(samples_R);
-
-    session_loading_screen_update("Writing file...", 0.95);
+    export_queue_close(&q);
 
-    write_wav(filepath, samples, len_samples, 16, proj->channels);
-    free(samples);
     timeline_full_pause(tl);
     timeline_play_speed_set(0.0);
+
+    int err = q.err;
+    if (!aborted && err == 0) {
+	/* Chunks are word-aligned; odd-length data (24-bit mono) gets a pad byte */
+	if (q.data_len_bytes & 1) fputc('\0', f);
+	fseek(f, 0, SEEK_SET);
+	write_wav_header(f, &wav_fmt, q.data_len_bytes);
+	if (ferror(f)) err = errno ? errno : EIO;
+    }
+    if (fclose(f) != 0 && err == 0) err = errno;
     session_loading_screen_deinit();
+    if (aborted || err != 0) {
+	remove(filepath);
+	if (aborted) {
+	    status_set_errstr("WAV export aborted");
+	    fprintf(stderr, "WAV export aborted\n");
+	} else {
+	    status_set_errstr("Error exporting WAV: %s", strerror(err));
+	    fprintf(stderr, "Error writing %s: %s\n", filepath, strerror(err));
+	}
+	return;
+    }
+    fprintf(stderr, "Exported %u sample frames to %s\n", len_sframes, filepath);
+    status_set_alertstr("Exported %s", filepath);
 }
 
 
@@ -247,7 +597,8 @@ int32_t wav_load(const char *filename, float **L, float **R)
 	sample_rate = DEFAULT_SAMPLE_RATE;
     }
     
-    int ret = SDL_BuildAudioCVT(&wav_cvt, wav_spec.format, wav_spec.channels, wav_spec.freq, fmt, channels, sample_rate);
+    /* Convert format only; the sample rate is converted below, by the sinc resampler */
+    int ret = SDL_BuildAudioCVT(&wav_cvt, wav_spec.format, wav_spec.channels, wav_spec.freq, fmt, channels, wav_spec.freq);
     uint8_t *final_buffer = NULL;
     int final_buffer_len;
 
@@ -314,22 +665,28 @@ int32_t wav_load(const char *filename, float **L, float **R)
     if (channels >= 2) {
 	if (R) {
 	    *R = malloc(buf_len_sframes * sizeof(float));
-	    for (uint32_t i=0; i<buf_len_sframes; i++) {
-		(*L)[i] = (float)src_buf[i*2] / INT16_MAX;
-		(*R)[i] = (float)src_buf[i*2+1] / INT16_MAX;
-	    }
+	    int16_buf_to_float(src_buf, channels, *L, buf_len_sframes);
+	    int16_buf_to_float(src_buf + 1, channels, *R, buf_len_sframes);
 	} else {
-	    for (uint32_t i=0; i<buf_len_sframes; i++) {
-		(*L)[i] = (float)src_buf[i*2] / INT16_MAX;
-		/* (*L)[i] = ((float)src_buf[i*2] + (float)src_buf[i*2+1]) / 2.0f / INT16_MAX; */
-	    }
+	    int16_buf_to_float(src_buf, channels, *L, buf_len_sframes);
+	    /* (*L)[i] = ((float)src_buf[i*2] + (float)src_buf[i*2+1]) / 2.0f / INT16_MAX; */
 	}
     } else {
-	for (uint32_t i=0; i<buf_len_sframes; i++) {
-	    (*L)[i] = (float)src_buf[i] / INT16_MAX;
-	}
+	int16_buf_to_float(src_buf, 1, *L, buf_len_sframes);
     } 
     free(final_buffer);
+    if (wav_spec.freq != sample_rate) {
+	int32_t resampled_len;
+	float *resampled = resampler_convert(*L, buf_len_sframes, wav_spec.freq, sample_rate, &resampled_len);
+	free(*L);
+	*L = resampled;
+	if (channels >= 2 && R) {
+	    resampled = resampler_convert(*R, buf_len_sframes, wav_spec.freq, sample_rate, &resampled_len);
+	    free(*R);
+	    *R = resampled;
+	}
+	buf_len_sframes = resampled_len;
+    }
     return buf_len_sframes;
 }
 
@@ -352,7 +709,8 @@ ClipRef *wav_load_to_track(Track *track, const char *filename, int32_t start_pos
     session_set_loading_screen("Importing WAV...", NULL, true);
 
     SDL_AudioCVT wav_cvt;
-    int ret = SDL_BuildAudioCVT(&wav_cvt, wav_spec.format, channels, wav_spec.freq, proj->fmt, wav_spec.channels, proj->sample_rate);
+    /* Convert format only; the sample rate is converted below, by the sinc resampler */
+    int ret = SDL_BuildAudioCVT(&wav_cvt, wav_spec.format, channels, wav_spec.freq, proj->fmt, wav_spec.channels, wav_spec.freq);
     uint8_t *final_buffer = NULL;
     int final_buffer_len;
     if (ret < 0) {
@@ -438,26 +796,39 @@ ClipRef *wav_load_to_track(Track *track, const char *filename, int32_t start_pos
 
 
     session_loading_screen_update("Converting audio samples to native format...", 0.8);
-    for (uint32_t i=0; i<buf_len_samples - 2; i+=2) {
-	if (i % 5000000 == 0) {
-	    if (session_loading_screen_update(NULL, 0.8 + 0.2 * (float)i / buf_len_samples) != 0) {
-		fprintf(stderr, "WAV load aborted\n");
-		status_set_errstr("WAV load aborted");
-		clip_destroy(clip);
-		return NULL;
-	    }
+    for (uint32_t i=0; i<clip->len_sframes; i+=WAV_CONVERT_CK_LEN_SFRAMES) {
+	if (session_loading_screen_update(NULL, 0.8 + 0.2 * (float)i / clip->len_sframes) != 0) {
+	    fprintf(stderr, "WAV load aborted\n");
+	    status_set_errstr("WAV load aborted");
+	    clip_destroy(clip);
+	    return NULL;
 	}
-
+	uint32_t n = clip->len_sframes - i < WAV_CONVERT_CK_LEN_SFRAMES ? clip->len_sframes - i : WAV_CONVERT_CK_LEN_SFRAMES;
 	if (channels == 2) {
-	    clip->L[i/2] = (float)src_buf[i] / INT16_MAX;
-	    clip->R[i/2] = (float)src_buf[i+1] / INT16_MAX;
+	    int16_buf_to_float(src_buf + i * 2, 2, clip->L + i, n);
+	    int16_buf_to_float(src_buf + i * 2 + 1, 2, clip->R + i, n);
 	} else if (channels == 1) {
-	    clip->L[i] = (float)src_buf[i] / INT16_MAX;
+	    int16_buf_to_float(src_buf + i, 1, clip->L + i, n);
 	}
     }
     free(final_buffer);
     final_buffer = NULL;
     src_buf = NULL;
+    if (wav_spec.freq != proj->sample_rate) {
+	session_loading_screen_update("Converting sample rate...", 1.0);
+	int32_t resampled_len;
+	pthread_mutex_lock(&clip->buf_realloc_lock);
+	float *resampled = resampler_convert(clip->L, clip->len_sframes, wav_spec.freq, proj->sample_rate, &resampled_len);
+	free(clip->L);
+	clip->L = resampled;
+	if (clip->channels == 2) {
+	    resampled = resampler_convert(clip->R, clip->len_sframes, wav_spec.freq, proj->sample_rate, &resampled_len);
+	    free(clip->R);
+	    clip->R = resampled;
+	}
+	clip->len_sframes = resampled_len;
+	pthread_mutex_unlock(&clip->buf_realloc_lock);
+    }
     /* free(wav_cvt.buf); */
     /* audio_clip_initialize_waveform(clip); */
     clip_init_or_update_waveform(clip);
@@ -11,12 +11,20 @@
 #ifndef JDAW_WAV_H
 #define JDAW_WAV_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "project.h"
 
+enum wav_export_fmt {
+    WAV_EXPORT_INT16=0, /* TPDF dithered */
+    WAV_EXPORT_INT24=1,
+    WAV_EXPORT_FLOAT32=2
+};
+#define WAV_EXPORT_NUM_FMTS 3
 
-/* Gets a mixdown chunk and calls functions in wav.c to create a wav file */
-void wav_write_mixdown(const char *filepath);
+/* Gets a mixdown chunk and calls functions in wav.c to create a wav file. noise_shaping applies to
+   WAV_EXPORT_INT16 only. */
+void wav_write_mixdown(const char *filepath, enum wav_export_fmt fmt, bool noise_shaping);
 
 // void write_wav(const char *fname, int16_t *samples, uint32_t num_samples, uint16_t bits_per_sample, uint8_t channels);
 int32_t wav_load(const char *filename, float **L, float **R);
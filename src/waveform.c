@@ -268,6 +268,13 @@ void waveform_draw_freq_plot(struct freq_plot *fp)
     SDL_SetRenderDrawColor(main_win->rend, 0, 0, 0, 255);
     SDL_RenderFillRect(main_win->rend, &fp->container->rect);
 
+    if (fp->analyzer) {
+	spectrum_analyzer_shown(fp->analyzer);
+	int num_bins = atomic_load(&fp->analyzer->num_bins);
+	for (int i=0; i<fp->num_darrays; i++) {
+	    fp->darray_lens[i] = num_bins;
+	}
+    }
     if (fp->related_obj_lock) {
 	pthread_mutex_lock(fp->related_obj_lock);
     }
@@ -416,6 +423,17 @@ void waveform_draw_with_ck_data(WaveformData *wd, const int32_t start_in_clip, i
     int32_t index_divider;
     int32_t max_chunk;
     if (sfpp < 64) {
+	if (wd->clip->segments.segs[0]) {
+	    /* Clip is recording; samples are in segmented storage */
+	    if (draw_len <= 0) return;
+	    float *samples = malloc(draw_len * sizeof(float));
+	    for (int c=0; c<wd->num_channels && c<2; c++) {
+		clip_read(wd->clip, c, start_in_clip, draw_len, samples);
+		waveform_draw_channel(samples, draw_len, min_x, max_x, channel_h, center_y + c * channel_h, sfpp, draw_color, gain);
+	    }
+	    free(samples);
+	    return;
+	}
 	waveform_draw_channel(wd->clip->L + start_in_clip, draw_len, min_x, max_x, channel_h, center_y, sfpp, draw_color, gain);
 	if (wd->clip->R) {
 	    waveform_draw_channel(wd->clip->R + start_in_clip, draw_len, min_x, max_x, channel_h, center_y + channel_h, sfpp, draw_color, gain);
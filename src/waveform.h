@@ -26,6 +26,7 @@
 #include <pthread.h>
 #include "audio_clip.h"
 #include "logscale.h"
+#include "spectrum_analyzer.h"
 #include "textbox.h"
 #include "value.h"
 
@@ -67,6 +68,7 @@ struct freq_plot {
     Textbox *labels[128];
     int num_labels;
     pthread_mutex_t *related_obj_lock;
+    SpectrumAnalyzer *analyzer; /* If set, darrays are its output, and are only updated while drawn */
 };
 
 /* DEPRECATED: use "waveform_draw_all_channels_generic" instead */
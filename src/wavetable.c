@@ -0,0 +1,70 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    wavetable.c
+
+    * see wavetable.h
+    * each level is synthesized with one inverse real FFT. For x[i] = sum over k of a_k sin(2 pi k i / N),
+      the forward transform has X[k] = -i * a_k * N / 2, so those bins are set and transformed back.
+ *****************************************************************************************************************/
+
+#include <complex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fft.h"
+#include "wavetable.h"
+
+static float *wavetable_build_level(const double *harmonic_amps, int num_harmonics)
+{
+    float *table = malloc((WAVETABLE_LEN + 1) * sizeof(float));
+    if (!table) {
+	fprintf(stderr, "Fatal error: unable to allocate wavetable\n");
+	exit(1);
+    }
+    float buf[FFT_REAL_BUF_LEN(WAVETABLE_LEN)];
+    memset(buf, '\0', sizeof(buf));
+    float complex *X = FFT_BINS(buf);
+    for (int k=1; k<=num_harmonics && k<WAVETABLE_LEN/2; k++) {
+	X[k] = -I * (float)(harmonic_amps[k - 1] * WAVETABLE_LEN / 2.0);
+    }
+    fft_real_inverse(buf, WAVETABLE_LEN);
+    memcpy(table, buf, WAVETABLE_LEN * sizeof(float));
+    table[WAVETABLE_LEN] = table[0];
+    return table;
+}
+
+Wavetable *wavetable_create(const double *harmonic_amps, int num_harmonics)
+{
+    Wavetable *wt = calloc(1, sizeof(Wavetable));
+    if (num_harmonics > WAVETABLE_MAX_HARMONIC) num_harmonics = WAVETABLE_MAX_HARMONIC;
+    for (int l=0; l<WAVETABLE_NUM_LEVELS; l++) {
+	int max_harmonic = WAVETABLE_MAX_HARMONIC >> l;
+	if (l > 0 && max_harmonic >= num_harmonics) {
+	    /* Nothing to remove; same content as the level below */
+	    wt->levels[l] = wt->levels[l - 1];
+	    continue;
+	}
+	int n = num_harmonics < max_harmonic ? num_harmonics : max_harmonic;
+	wt->levels[l] = wavetable_build_level(harmonic_amps, n);
+    }
+    return wt;
+}
+
+void wavetable_destroy(Wavetable *wt)
+{
+    for (int l=0; l<WAVETABLE_NUM_LEVELS; l++) {
+	if (l == 0 || wt->levels[l] != wt->levels[l - 1]) {
+	    free(wt->levels[l]);
+	}
+    }
+    free(wt);
+}
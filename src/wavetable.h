@@ -0,0 +1,63 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    wavetable.h
+
+    * mipmapped, band-limited single-cycle wavetables for oscillators
+    * a table is built from the sine-series amplitudes of a waveform's harmonics. Level l holds only
+      harmonics 1 .. (WAVETABLE_MAX_HARMONIC >> l), so that level 0 serves the lowest pitches and the
+      top level is a pure sine.
+    * wavetable_level picks the richest level whose highest harmonic stays below Nyquist for a given
+      phase increment; reading that level with linear interpolation does not alias
+    * tables are read-only once built, and can be shared between threads
+*****************************************************************************************************************/
+
+#ifndef JDAW_WAVETABLE_H
+#define JDAW_WAVETABLE_H
+
+#include <math.h>
+
+#define WAVETABLE_LEN 4096 /* power of 2 */
+#define WAVETABLE_MAX_HARMONIC 1024
+#define WAVETABLE_NUM_LEVELS 11 /* 1024 harmonics down to 1 */
+
+typedef struct wavetable {
+    /* WAVETABLE_LEN + 1 samples each; the last repeats the first, for interpolation.
+       Levels with identical content share a buffer. */
+    float *levels[WAVETABLE_NUM_LEVELS];
+} Wavetable;
+
+/* harmonic_amps[k] is the amplitude of sin(2 * pi * (k + 1) * phase) */
+Wavetable *wavetable_create(const double *harmonic_amps, int num_harmonics);
+void wavetable_destroy(Wavetable *wt);
+
+/* Table to use for an oscillator advancing phase_incr cycles per sample */
+static inline const float *wavetable_level(const Wavetable *wt, double phase_incr)
+{
+    double top = fabs(phase_incr) * 2.0 * WAVETABLE_MAX_HARMONIC;
+    int level = 0;
+    while (level < WAVETABLE_NUM_LEVELS - 1 && top > 1.0) {
+	top *= 0.5;
+	level++;
+    }
+    return wt->levels[level];
+}
+
+/* Phase in [0, 1) */
+static inline float wavetable_read(const float *restrict table, double phase)
+{
+    double pos = phase * WAVETABLE_LEN;
+    int i = (int)pos;
+    float frac = (float)(pos - i);
+    return table[i] + frac * (table[i + 1] - table[i]);
+}
+
+#endif
@@ -0,0 +1,240 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    worker_pool.c
+
+    * see worker_pool.h
+    * the batch state is published through a single atomic "claim" word:
+          bits 32-63: batch generation
+          bits 16-31: number of jobs in batch
+          bits  0-15: index of next unclaimed job
+    * a thread claims job i by CAS-ing the word from (gen, n, i) to (gen, n, i+1). Because the word
+      carries the generation and job count, a stale claim attempt on a finished batch always fails,
+      and the batch fn/args cannot change while any job of the batch is still claimable or running.
+ *****************************************************************************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "log.h"
+#include "thread_safety.h"
+#include "worker_pool.h"
+
+#define WORKER_POOL_IDLE_SPINS 4096
+#define WORKER_POOL_SLEEP_NSEC 10000000 /* 10ms; bounds latency of a missed wakeup */
+#define WORKER_POOL_STACK_SIZE (8 * 1024 * 1024)
+
+#define CLAIM_NEXT(c) ((uint32_t)((c) & 0xFFFF))
+#define CLAIM_NUM_JOBS(c) ((uint32_t)(((c) >> 16) & 0xFFFF))
+
+struct worker_pool {
+    char name[32];
+    int num_workers;
+    pthread_t threads[WORKER_POOL_MAX_WORKERS];
+
+    /* Batch */
+    _Atomic uint64_t claim;
+    atomic_int num_done;
+    uint32_t gen;
+    WorkerJobFn fn;
+    char *args;
+    size_t arg_stride;
+
+    atomic_flag busy;
+    atomic_bool quit;
+
+    /* Idle workers */
+    atomic_int num_sleeping;
+    pthread_mutex_t sleep_lock;
+    pthread_cond_t wake;
+};
+
+static bool worker_pool_has_work(WorkerPool *wp)
+{
+    uint64_t c = atomic_load_explicit(&wp->claim, memory_order_acquire);
+    return CLAIM_NEXT(c) < CLAIM_NUM_JOBS(c);
+}
+
+/* Claim and run one job from the current batch. Return false if no job was available. */
+static bool worker_pool_run_one(WorkerPool *wp)
+{
+    uint64_t c = atomic_load_explicit(&wp->claim, memory_order_acquire);
+    while (CLAIM_NEXT(c) < CLAIM_NUM_JOBS(c)) {
+	if (atomic_compare_exchange_weak_explicit(&wp->claim, &c, c + 1, memory_order_acq_rel, memory_order_acquire)) {
+	    wp->fn(wp->args + CLAIM_NEXT(c) * wp->arg_stride);
+	    atomic_fetch_add_explicit(&wp->num_done, 1, memory_order_release);
+	    return true;
+	}
+    }
+    return false;
+}
+
+static JDAW_THREAD_LOCAL bool is_worker_thread = false;
+
+bool worker_pool_on_worker_thread()
+{
+    return is_worker_thread;
+}
+
+static void *worker_threadfn(void *arg)
+{
+    WorkerPool *wp = arg;
+    is_worker_thread = true;
+    int idle_spins = 0;
+    while (!atomic_load_explicit(&wp->quit, memory_order_relaxed)) {
+	if (worker_pool_run_one(wp)) {
+	    idle_spins = 0;
+	    continue;
+	}
+	if (idle_spins < WORKER_POOL_IDLE_SPINS) {
+	    idle_spins++;
+	    CPU_RELAX();
+	    continue;
+	}
+	/* The dispatcher signals without holding sleep_lock, so a wakeup can be missed;
+	   the timed wait bounds the cost of that, and the dispatcher runs jobs itself meanwhile */
+	pthread_mutex_lock(&wp->sleep_lock);
+	atomic_fetch_add(&wp->num_sleeping, 1);
+	if (!worker_pool_has_work(wp) && !atomic_load(&wp->quit)) {
+	    struct timespec ts;
+	    clock_gettime(CLOCK_REALTIME, &ts);
+	    ts.tv_nsec += WORKER_POOL_SLEEP_NSEC;
+	    if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	    }
+	    pthread_cond_timedwait(&wp->wake, &wp->sleep_lock, &ts);
+	}
+	atomic_fetch_sub(&wp->num_sleeping, 1);
+	pthread_mutex_unlock(&wp->sleep_lock);
+	idle_spins = 0;
+    }
+    return NULL;
+}
+
+static int worker_thread_create(WorkerPool *wp, pthread_t *thread)
+{
+    pthread_attr_t attr;
+    int ret;
+    if ((ret = pthread_attr_init(&attr)) != 0) {
+	fprintf(stderr, "pthread_attr_init: %s\n", strerror(ret));
+	return ret;
+    }
+    pthread_attr_setstacksize(&attr, WORKER_POOL_STACK_SIZE);
+
+    /* Workers do audio work on behalf of the DSP thread; try to match its scheduling */
+    struct sched_param sp;
+    sp.sched_priority = sched_get_priority_max(SCHED_RR);
+    if (sp.sched_priority >= 0
+	&& pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED) == 0
+	&& pthread_attr_setschedpolicy(&attr, SCHED_RR) == 0
+	&& pthread_attr_setschedparam(&attr, &sp) == 0) {
+	ret = pthread_create(thread, &attr, worker_threadfn, wp);
+	if (ret == 0) {
+	    pthread_attr_destroy(&attr);
+	    return 0;
+	}
+	/* Probably EPERM; fall back to default scheduling */
+	pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+    }
+    ret = pthread_create(thread, &attr, worker_threadfn, wp);
+    pthread_attr_destroy(&attr);
+    return ret;
+}
+
+WorkerPool *worker_pool_create(int num_workers, const char *name)
+{
+    if (num_workers < 0) num_workers = 0;
+    if (num_workers > WORKER_POOL_MAX_WORKERS) num_workers = WORKER_POOL_MAX_WORKERS;
+    WorkerPool *wp = calloc(1, sizeof(WorkerPool));
+    snprintf(wp->name, sizeof(wp->name), "%s", name);
+    atomic_init(&wp->claim, 0);
+    atomic_init(&wp->num_done, 0);
+    atomic_flag_clear(&wp->busy);
+    atomic_init(&wp->quit, false);
+    atomic_init(&wp->num_sleeping, 0);
+    int err;
+    if ((err = pthread_mutex_init(&wp->sleep_lock, NULL)) != 0) {
+	fprintf(stderr, "Error initializing worker pool sleep lock: %s\n", strerror(err));
+	exit(1);
+    }
+    if ((err = pthread_cond_init(&wp->wake, NULL)) != 0) {
+	fprintf(stderr, "Error initializing worker pool cond: %s\n", strerror(err));
+	exit(1);
+    }
+    for (int i=0; i<num_workers; i++) {
+	if ((err = worker_thread_create(wp, wp->threads + i)) != 0) {
+	    log_tmp(LOG_ERROR, "Worker pool \"%s\": unable to create worker %d: %s\n", wp->name, i, strerror(err));
+	    break;
+	}
+	wp->num_workers++;
+    }
+    log_tmp(LOG_INFO, "Worker pool \"%s\" started with %d workers\n", wp->name, wp->num_workers);
+    return wp;
+}
+
+int worker_pool_num_workers(WorkerPool *wp)
+{
+    return wp ? wp->num_workers : 0;
+}
+
+void worker_pool_run(WorkerPool *wp, WorkerJobFn fn, void *args, size_t arg_stride, int num_jobs)
+{
+    if (num_jobs <= 0) return;
+    if (!wp
+	|| wp->num_workers == 0
+	|| num_jobs == 1
+	|| num_jobs > WORKER_POOL_MAX_JOBS
+	|| atomic_flag_test_and_set_explicit(&wp->busy, memory_order_acquire)) {
+	for (int i=0; i<num_jobs; i++) {
+	    fn((char *)args + i * arg_stride);
+	}
+	return;
+    }
+
+    wp->fn = fn;
+    wp->args = args;
+    wp->arg_stride = arg_stride;
+    wp->gen++;
+    atomic_store_explicit(&wp->num_done, 0, memory_order_relaxed);
+    atomic_store_explicit(&wp->claim, ((uint64_t)wp->gen << 32) | ((uint64_t)num_jobs << 16), memory_order_release);
+    if (atomic_load(&wp->num_sleeping) > 0) {
+	pthread_cond_broadcast(&wp->wake);
+    }
+
+    /* Work alongside the workers, then wait for jobs still in flight */
+    while (worker_pool_run_one(wp)) {}
+    while (atomic_load_explicit(&wp->num_done, memory_order_acquire) < num_jobs) {
+	CPU_RELAX();
+    }
+    atomic_flag_clear_explicit(&wp->busy, memory_order_release);
+}
+
+void worker_pool_destroy(WorkerPool *wp)
+{
+    if (!wp) return;
+    atomic_store(&wp->quit, true);
+    pthread_mutex_lock(&wp->sleep_lock);
+    pthread_cond_broadcast(&wp->wake);
+    pthread_mutex_unlock(&wp->sleep_lock);
+    for (int i=0; i<wp->num_workers; i++) {
+	pthread_join(wp->threads[i], NULL);
+    }
+    pthread_cond_destroy(&wp->wake);
+    pthread_mutex_destroy(&wp->sleep_lock);
+    free(wp);
+}
@@ -0,0 +1,60 @@
+/*****************************************************************************************************************
+  Jackdaw | https://jackdaw-audio.net/ | a free, keyboard-focused DAW | built on SDL (https://libsdl.org/)
+******************************************************************************************************************
+
+  Copyright (C) 2023-2026 Charlie Volow
+
+  Jackdaw is licensed under the GNU General Public License.
+
+*****************************************************************************************************************/
+
+/*****************************************************************************************************************
+    worker_pool.h
+
+    * long-lived, pre-spawned worker threads for splitting real-time work (e.g. synth voices) across cores
+    * a "batch" is N independent jobs sharing one job fn; worker_pool_run dispatches the batch and
+      returns only when every job has completed
+    * the calling thread claims and runs jobs alongside the workers, so a batch always completes,
+      even if no worker wakes up in time (or the pool has zero workers)
+    * dispatch and join never take a lock; idle workers spin briefly, then sleep on a condition variable
+    * if the pool is already running a batch (e.g. called from two threads at once), the
+      second caller runs its jobs inline
+*****************************************************************************************************************/
+
+
+#ifndef JDAW_WORKER_POOL_H
+#define JDAW_WORKER_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define WORKER_POOL_MAX_WORKERS 32
+#define WORKER_POOL_MAX_JOBS 0xFFFF
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define CPU_RELAX() __asm__ volatile("yield")
+#else
+#define CPU_RELAX()
+#endif
+
+typedef void (*WorkerJobFn)(void *arg);
+typedef struct worker_pool WorkerPool;
+
+/* Spawn num_workers threads (clamped to [0, WORKER_POOL_MAX_WORKERS]) */
+WorkerPool *worker_pool_create(int num_workers, const char *name);
+
+/* Run fn(args + i * arg_stride) for i in [0, num_jobs). Blocks until all jobs are done.
+   With arg_stride 0, every job receives the same arg. */
+void worker_pool_run(WorkerPool *wp, WorkerJobFn fn, void *args, size_t arg_stride, int num_jobs);
+
+int worker_pool_num_workers(WorkerPool *wp);
+
+/* True on a thread spawned by any worker pool (not on a thread that calls worker_pool_run) */
+bool worker_pool_on_worker_thread();
+
+/* Join all worker threads and free the pool */
+void worker_pool_destroy(WorkerPool *wp);
+
+#endif